@@ -119,7 +119,7 @@ int main(int argc, char *argv[]) {
     const std::string &tolerance_string = input.getCmdOption("--tolerance", 
                                                              "1e-120", 
                                                              asked_help,
-                                                             "Termination tolerance. Note that this is based on matrix norms, and not a great measure of convergence.\nIn general, set to be very small (default) and check the convergence metrics\nthat are provided in the output file.");
+                                                             "Termination tolerance. Note that this is based on matrix norms, and not a great measure of convergence.\nIn general, set to be very small (default) and check the convergence metrics\nthat are provided in the output file (or use --velocity_tolerance for a physical stopping criterion).");
     const double tolerance = stod(tolerance_string);  
 
     const std::string &iteration_string = input.getCmdOption("--max_iterations", 
@@ -143,6 +143,43 @@ int main(int argc, char *argv[]) {
                                                                    "Boolean (true/false) indicating if the least-squares problem should be weighted by area, so that larger cells have more priority.\nSetting to true is generally advised because of the poles.");
     const bool use_area_weight = string_to_bool(use_area_weight_string);
 
+    const std::string &coarse_seed_factor_string = input.getCmdOption("--coarse_seed_factor", 
+                                                                      "1", 
+                                                                      asked_help,
+                                                                      "Integer subsampling factor for a coarse-grid solve that is interpolated up to correct the seed (1 disables).\ne.g. 4 solves on every fourth latitude / longitude first.");
+    const int coarse_seed_factor = stoi(coarse_seed_factor_string);
+
+    const std::string &extrapolate_seed_string = input.getCmdOption("--extrapolate_seed", 
+                                                                    "false", 
+                                                                    asked_help,
+                                                                    "Boolean (true/false) indicating if seeds should be linearly extrapolated from the two previous times (or depths).\nOnly used when no seed file is given, or the seed file only has one time / depth.");
+    const bool extrapolate_seed = string_to_bool(extrapolate_seed_string);
+
+    const std::string &measure_seed_savings_string = input.getCmdOption("--measure_seed_savings", 
+                                                                        "false", 
+                                                                        asked_help,
+                                                                        "Boolean (true/false) indicating if each slice should also be solved from a zero seed,\nto record how many iterations the seeding saved. Roughly doubles the cost.");
+    const bool measure_seed_savings = string_to_bool(measure_seed_savings_string);
+
+    const std::string &use_SHT_string = input.getCmdOption("--use_SHT", 
+                                                           "false", 
+                                                           asked_help,
+                                                           "Boolean (true/false) indicating if the least-squares solver should be seeded with a direct spherical-harmonic solve\n(FFT in longitude and Legendre transforms in latitude), instead of the usual seeds.\nOnly possible for full-sphere grids without land (use_mask = false); otherwise the usual seeds are used.");
+    const bool use_SHT = string_to_bool(use_SHT_string);
+
+    const std::string &velocity_tolerance_string = input.getCmdOption("--velocity_tolerance", 
+                                                                      "0", 
+                                                                      asked_help,
+                                                                      "Stop the solver once the relative (area-weighted) error of the reconstructed velocity is below this.\nSet to 0 (default) to only use --tolerance and --max_iterations.");
+    const double velocity_tolerance = stod(velocity_tolerance_string);
+
+    const std::string &residual_check_interval_string = input.getCmdOption("--residual_check_interval", 
+                                                                           "0", 
+                                                                           asked_help,
+                                                                           "Number of solver iterations between computing the velocity error, which is recorded in the output\nas residual_history. Set to 0 (default) to disable, unless --velocity_tolerance is set, in which case 100 is used.");
+    const int residual_check_interval = ( ( velocity_tolerance > 0 ) and ( stoi(residual_check_interval_string) <= 0 ) ) 
+                                        ? 100 : stoi(residual_check_interval_string);
+
     if (asked_help) { return 0; }
 
     // Print processor assignments
@@ -248,7 +285,9 @@ int main(int argc, char *argv[]) {
 
     // Apply to projection routine
     Apply_Helmholtz_Projection( output_fname, source_data, Psi_seed, Phi_seed, single_seed, 
-            tolerance, max_iterations, use_area_weight, use_mask, Tikhov_Laplace );
+            tolerance, max_iterations, use_area_weight, use_mask, Tikhov_Laplace,
+            coarse_seed_factor, extrapolate_seed, measure_seed_savings, use_SHT,
+            velocity_tolerance, residual_check_interval );
 
     // Done!
     #if DEBUG >= 0
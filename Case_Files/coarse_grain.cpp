@@ -31,6 +31,12 @@
  * @param   --region_definitions_file
  * @param   --region_definitions_dim
  * @param   --region_definitions_var
+ * @param   --mpi_io_hints
+ * @param   --per_rank_outputs
+ * @param   --sample_points_file
+ * @param   --sample_points_lat
+ * @param   --sample_points_lon
+ * @param   --sample_windows
  *
  */
 int main(int argc, char *argv[]) {
@@ -92,7 +98,8 @@ int main(int argc, char *argv[]) {
 
     // first argument is the flag, second argument is default value (for when flag is not present)
     const std::string &input_fname       = input.getCmdOption("--input_file",  "input.nc", asked_help,
-                                                              "netCDF file containing the input variables and grid.");
+                                                              "netCDF file containing the input variables and grid.\n"
+                                                              "Can also be a comma-separated list or glob of files that split the time dimension (e.g. \"day_*.nc\").");
 
     const std::string   &time_dim_name      = input.getCmdOption("--time",        
                                                                  "time",       
@@ -153,6 +160,39 @@ int main(int argc, char *argv[]) {
                                                                    asked_help,
                                                                    "Name of the variable in the regions file that provides the region definitions.");
 
+    const std::string   &mpi_io_hints_string = input.getCmdOption("--mpi_io_hints",
+                                                                  "",
+                                                                  asked_help,
+                                                                  "MPI-IO hints for the netCDF files, as comma-separated key=value pairs\n"
+                                                                  "(e.g. \"cb_nodes=8,romio_cb_write=enable,striping_factor=16\").\n"
+                                                                  "These are added to any from the FLOWSIEVE_MPIIO_HINTS environment variable."),
+                        &per_rank_outputs_string = input.getCmdOption("--per_rank_outputs",
+                                                                      "false",
+                                                                      asked_help,
+                                                                      "Boolean (true/false) indicating if each processor should write its own output files\n"
+                                                                      "(filter_<scale>km.rankNNNN.nc, indexed by filter_<scale>km.ncml) instead of sharing one.\n"
+                                                                      "Use merge_per_rank_outputs.x to combine them into single files.");
+
+    const std::string   &sample_points_fname  = input.getCmdOption("--sample_points_file",
+                                                                   "",
+                                                                   asked_help,
+                                                                   "netCDF file with sample locations (e.g. moorings). If given, only averages over windows around\n"
+                                                                   "the samples are output (subset_<scale>km.nc), only the grid points they need are filtered,\n"
+                                                                   "and the on-line postprocessing is skipped."),
+                        &sample_lat_name      = input.getCmdOption("--sample_points_lat",
+                                                                   "latitude",
+                                                                   asked_help,
+                                                                   "Name of the sample latitudes in the sample points file (same units as the grid, see --is_degrees)."),
+                        &sample_lon_name      = input.getCmdOption("--sample_points_lon",
+                                                                   "longitude",
+                                                                   asked_help,
+                                                                   "Name of the sample longitudes in the sample points file (same units as the grid, see --is_degrees)."),
+                        &sample_windows_string = input.getCmdOption("--sample_windows",
+                                                                    "0",
+                                                                    asked_help,
+                                                                    "Space-separated list of window radii (in metres) to average over around each sample.\n"
+                                                                    "A radius of 0 gives the value at the nearest grid point.");
+
     // Also read in the filter scales from the commandline
     //   e.g. --filter_scales "10.e3 150.76e3 1000e3" (units are in metres)
     std::vector<double> filter_scales;
@@ -160,6 +200,9 @@ int main(int argc, char *argv[]) {
 
     if (asked_help) { return 0; }
 
+    set_mpi_io_hints( mpi_io_hints_string );
+    set_per_rank_outputs( string_to_bool( per_rank_outputs_string ) );
+
     // Set OpenMP thread number
     const int max_threads = omp_get_max_threads();
     omp_set_num_threads( max_threads );
@@ -176,10 +219,12 @@ int main(int argc, char *argv[]) {
     #endif
 
     // Read in the grid coordinates
+    const double start_io_time = MPI_Wtime();
     source_data.load_time(      time_dim_name,      input_fname );
     source_data.load_depth(     depth_dim_name,     input_fname );
     source_data.load_latitude(  latitude_dim_name,  input_fname );
     source_data.load_longitude( longitude_dim_name, input_fname );
+    double startup_io_time = MPI_Wtime() - start_io_time;
 
     // Apply some cleaning to the processor allotments if necessary. 
     source_data.check_processor_divisions( Nprocs_in_time_input, Nprocs_in_depth_input );
@@ -192,9 +237,21 @@ int main(int argc, char *argv[]) {
     // Compute the area of each 'cell' which will be necessary for integration
     source_data.compute_cell_areas();
 
-    // Read in the velocity fields
-    source_data.load_variable( "u_lon", zonal_vel_name, input_fname, true, true );
-    source_data.load_variable( "u_lat", merid_vel_name, input_fname, true, true );
+    // Read in the velocity fields (and, if desired, rho and p) all at once
+    //   If we're using FILTER_OVER_LAND, then the mask will be wiped out, so also keep 
+    //   a mask that still includes land references so that we have both. 
+    //   Will be used to get 'water-only' region areas.
+    std::vector< std::pair< std::string, std::string > > vars_to_load = { 
+        { "u_lon", zonal_vel_name }, 
+        { "u_lat", merid_vel_name } 
+    };
+    if (constants::COMP_BC_TRANSFERS) {
+        vars_to_load.push_back( { "rho", density_var_name } );
+        vars_to_load.push_back( { "p",   pressure_var_name } );
+    }
+    const double pre_load_time = MPI_Wtime();
+    source_data.load_variables( vars_to_load, input_fname, true, true, true, constants::FILTER_OVER_LAND );
+    startup_io_time += MPI_Wtime() - pre_load_time;
 
     // Get the MPI-local dimension sizes
     source_data.Ntime  = source_data.myCounts[0];
@@ -205,26 +262,11 @@ int main(int argc, char *argv[]) {
                                            ( "u_r",       std::vector<double>(source_data.variables.at("u_lon").size(), 0.) ) 
                                 );
 
-    if (constants::COMP_BC_TRANSFERS) {
-        // If desired, read in rho and p
-        source_data.load_variable( "rho", density_var_name,  input_fname, false, false );
-        source_data.load_variable( "p",   pressure_var_name, input_fname, false, false );
-    }
-
-
-
     if ( not(constants::EXTEND_DOMAIN_TO_POLES) ) {
         // Mask out the pole, if necessary (i.e. set lat = 90 to land)
         mask_out_pole( source_data.latitude, source_data.mask, source_data.Ntime, source_data.Ndepth, source_data.Nlat, source_data.Nlon );
     }
 
-    // If we're using FILTER_OVER_LAND, then the mask has been wiped out. Load in a mask that still includes land references
-    //      so that we have both. Will be used to get 'water-only' region areas.
-    if (constants::FILTER_OVER_LAND) { 
-        read_mask_from_file( source_data.reference_mask, zonal_vel_name, input_fname,
-               source_data.Nprocs_in_time, source_data.Nprocs_in_depth );
-    }
-
     // Read in the region definitions and compute region areas
     if ( check_file_existence( region_defs_fname ) ) {
         // If the file exists, then read in from that
@@ -295,6 +337,23 @@ int main(int argc, char *argv[]) {
     }
 
 
+    // The mask is now final, so pre-compute the derivative stencils
+    source_data.build_derivative_operators();
+
+    // If sample points were given, then set up the subset outputs now that the grid is final
+    if ( not(sample_points_fname.empty()) ) {
+        std::vector<double> sample_windows;
+        const char * windows_start = sample_windows_string.c_str();
+        char * windows_end;
+        for ( double window = strtod( windows_start, &windows_end ); windows_end != windows_start; 
+                     window = strtod( windows_start, &windows_end ) ) {
+            sample_windows.push_back( window );
+            windows_start = windows_end;
+        }
+        source_data.load_sample_points( sample_points_fname, sample_lat_name, sample_lon_name, sample_windows, 
+                                        latlon_in_degrees == "true" );
+    }
+
     //
     //// Now pass the arrays along to the filtering routines
     //
@@ -310,9 +369,11 @@ int main(int argc, char *argv[]) {
         fprintf(stdout, "Process completed.\n");
         fprintf(stdout, "\n");
         fprintf(stdout, "Start-up time  = %.13g\n", pre_filter_time - start_time);
+        fprintf(stdout, "   (of which input I/O = %.13g)\n", startup_io_time);
         fprintf(stdout, "Filtering time = %.13g\n", post_filter_time - pre_filter_time);
         fprintf(stdout, "   (clock resolution = %.13g)\n", delta_clock);
     }
+    print_write_bandwidth();
     #endif
 
     #if DEBUG >= 1
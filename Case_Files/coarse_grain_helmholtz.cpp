@@ -163,6 +163,26 @@ int main(int argc, char *argv[]) {
                                                                    asked_help,
                                                                    "netCDF file containing user-specified lat/lon grid for coarsened maps." );
 
+    const std::string   &sample_points_fname  = input.getCmdOption("--sample_points_file",
+                                                                   "",
+                                                                   asked_help,
+                                                                   "netCDF file with sample locations (e.g. moorings). If given, only averages over windows around\n"
+                                                                   "the samples are output (subset_<scale>km.nc), only the grid points they need are filtered,\n"
+                                                                   "and the on-line postprocessing is skipped."),
+                        &sample_lat_name      = input.getCmdOption("--sample_points_lat",
+                                                                   "latitude",
+                                                                   asked_help,
+                                                                   "Name of the sample latitudes in the sample points file (same units as the grid, see --is_degrees)."),
+                        &sample_lon_name      = input.getCmdOption("--sample_points_lon",
+                                                                   "longitude",
+                                                                   asked_help,
+                                                                   "Name of the sample longitudes in the sample points file (same units as the grid, see --is_degrees)."),
+                        &sample_windows_string = input.getCmdOption("--sample_windows",
+                                                                    "0",
+                                                                    asked_help,
+                                                                    "Space-separated list of window radii (in metres) to average over around each sample.\n"
+                                                                    "A radius of 0 gives the value at the nearest grid point.");
+
     // Also read in the filter scales from the commandline
     //   e.g. --filter_scales "10.e3 150.76e3 1000e3" (units are in metres)
     std::vector<double> filter_scales;
@@ -355,6 +375,24 @@ int main(int argc, char *argv[]) {
         source_data.gather_mask_across_depth( source_data.mask, source_data.mask_DEPTH );
     }
 
+    // The mask is now final, so pre-compute the derivative stencils
+    source_data.build_derivative_operators();
+
+    // If sample points were given, then set up the subset outputs now that the grid is final
+    if ( not(sample_points_fname.empty()) ) {
+        std::vector<double> sample_windows;
+        const char * windows_start = sample_windows_string.c_str();
+        char * windows_end;
+        for ( double window = strtod( windows_start, &windows_end ); windows_end != windows_start; 
+                     window = strtod( windows_start, &windows_end ) ) {
+            sample_windows.push_back( window );
+            windows_start = windows_end;
+        }
+        // Z takes three derivative levels here (velocity from Psi / Phi, vorticity, and its gradient)
+        source_data.load_sample_points( sample_points_fname, sample_lat_name, sample_lon_name, sample_windows, 
+                                        latlon_in_degrees == "true", 3 * constants::DiffOrd );
+    }
+
     // Now pass the data along to the filtering routines
     const double pre_filter_time = MPI_Wtime();
     filtering_helmholtz( source_data, filter_scales );
@@ -214,176 +214,172 @@ int main(int argc, char *argv[]) {
     std::vector<double> var_coarse(Npts_coarse);
     std::vector<bool> mask_coarse(Npts_coarse, false);
 
+    //
+    //// Get the bounding box, in the fine grid, of each coarse cell.
+    ////    These only depend on the grids, so they're found once (per coarse latitude / longitude)
+    ////    and turned into a remapping operator that is reused for every variable and time.
+    //
+    int Ilat_coarse, Ilon_coarse, BOT, TOP, LEFT, RIGHT;
+    double target_lat, target_lon;
+    std::vector<int> lat_first( Nlat_coarse ), lat_last( Nlat_coarse ),
+                     lon_first( Nlon_coarse ), lon_last( Nlon_coarse );
+
+    for (Ilat_coarse = 0; Ilat_coarse < Nlat_coarse; ++Ilat_coarse) {
+
+        // bottom
+        if ( COARSE_LAT_GRID_INCREASING ) {
+            if ( Ilat_coarse == 0 ) {
+                target_lat = coarse_data.latitude.at(Ilat_coarse);
+            } else {
+                target_lat = 0.5 * ( coarse_data.latitude.at(Ilat_coarse) + coarse_data.latitude.at(Ilat_coarse - 1) );
+            }
+        } else {
+            if ( Ilat_coarse < Nlat_coarse - 1 ) {
+                target_lat = 0.5 * ( coarse_data.latitude.at(Ilat_coarse) + coarse_data.latitude.at(Ilat_coarse + 1) );
+            } else {
+                target_lat = coarse_data.latitude.at(Ilat_coarse);
+            }
+        }
+        if ( FINE_LAT_GRID_INCREASING ) {
+            BOT = std::lower_bound( fine_data.latitude.begin(), fine_data.latitude.end(), target_lat ) 
+                  - fine_data.latitude.begin();
+        } else {
+            BOT = std::upper_bound( fine_data.latitude.rbegin(), fine_data.latitude.rend(), target_lat ) 
+                  - fine_data.latitude.rbegin();
+            BOT = (Nlat_fine - 1) - BOT;
+        }
+        BOT = (BOT < 0) ? 0 : (BOT >= Nlat_fine) ? Nlat_fine - 1 : BOT;
+
+        // top
+        if ( COARSE_LAT_GRID_INCREASING ) {
+            if ( Ilat_coarse < Nlat_coarse - 1 ) {
+                target_lat = 0.5 * ( coarse_data.latitude.at(Ilat_coarse) + coarse_data.latitude.at(Ilat_coarse + 1) );
+            } else {
+                target_lat = coarse_data.latitude.at(Ilat_coarse);
+            }
+        } else {
+            if ( Ilat_coarse == 0 ) {
+                target_lat = coarse_data.latitude.at(Ilat_coarse);
+            } else {
+                target_lat = 0.5 * ( coarse_data.latitude.at(Ilat_coarse) + coarse_data.latitude.at(Ilat_coarse - 1) );
+            }
+        }
+        if ( FINE_LAT_GRID_INCREASING ) {
+            TOP =  std::lower_bound( fine_data.latitude.begin(), fine_data.latitude.end(), target_lat ) 
+                    - fine_data.latitude.begin();
+        } else {
+            TOP =  std::upper_bound( fine_data.latitude.rbegin(), fine_data.latitude.rend(), target_lat ) 
+                    - fine_data.latitude.rbegin();
+            TOP = (Nlat_fine - 1) - TOP;
+        }
+        TOP = (TOP < 0) ? 0 : (TOP >= Nlat_fine) ? Nlat_fine - 1 : TOP;
+
+        // The box includes both ends
+        lat_first.at(Ilat_coarse) = std::min(BOT, TOP);
+        lat_last.at(Ilat_coarse)  = std::max(BOT, TOP) + 1;
+    }
+
+    for (Ilon_coarse = 0; Ilon_coarse < Nlon_coarse; ++Ilon_coarse) {
+
+        // left
+        if ( COARSE_LON_GRID_INCREASING ) {
+            if ( Ilon_coarse == 0 ) {
+                target_lon = coarse_data.longitude.at(Ilon_coarse);
+            } else {
+                target_lon = 0.5 * ( coarse_data.longitude.at(Ilon_coarse) + coarse_data.longitude.at(Ilon_coarse - 1) );
+            }
+        } else {
+            if ( Ilon_coarse < Nlon_coarse - 1 ) {
+                target_lon = 0.5 * ( coarse_data.longitude.at(Ilon_coarse) + coarse_data.longitude.at(Ilon_coarse + 1) );
+            } else {
+                target_lon = coarse_data.longitude.at(Ilon_coarse);
+            }
+        }
+        if ( FINE_LON_GRID_INCREASING ) {
+            LEFT = std::lower_bound( fine_data.longitude.begin(), fine_data.longitude.end(), target_lon ) 
+                        - fine_data.longitude.begin();
+        } else {
+            LEFT = std::upper_bound( fine_data.longitude.rbegin(), fine_data.longitude.rend(), target_lon ) 
+                        - fine_data.longitude.rbegin();
+            LEFT = (Nlon_fine - 1) - LEFT;
+        }
+        LEFT = (LEFT < 0) ? 0 : (LEFT >= Nlon_fine) ? Nlon_fine - 1 : LEFT;
+
+        // right
+        if ( COARSE_LON_GRID_INCREASING ) {
+            if ( Ilon_coarse < Nlon_coarse - 1 ) {
+                target_lon = 0.5 * ( coarse_data.longitude.at(Ilon_coarse) + coarse_data.longitude.at(Ilon_coarse + 1) );
+            } else {
+                target_lon = coarse_data.longitude.at(Ilon_coarse);
+            }
+        } else {
+            if ( Ilon_coarse == 0 ) {
+                target_lon = coarse_data.longitude.at(Ilon_coarse);
+            } else {
+                target_lon = 0.5 * ( coarse_data.longitude.at(Ilon_coarse) + coarse_data.longitude.at(Ilon_coarse - 1) );
+            }
+        }
+        if ( FINE_LON_GRID_INCREASING ) {
+            RIGHT = std::lower_bound( fine_data.longitude.begin(), fine_data.longitude.end(), target_lon ) 
+                        - fine_data.longitude.begin();
+        } else {
+            RIGHT = std::upper_bound( fine_data.longitude.rbegin(), fine_data.longitude.rend(), target_lon ) 
+                        - fine_data.longitude.rbegin();
+            RIGHT = (Nlon_fine - 1) - RIGHT;
+        }
+        RIGHT = (RIGHT < 0) ? 0 : (RIGHT >= Nlon_fine) ? Nlon_fine - 1 : RIGHT;
+
+        lon_first.at(Ilon_coarse) = std::min(LEFT, RIGHT);
+        lon_last.at(Ilon_coarse)  = std::max(LEFT, RIGHT) + 1;
+    }
+
+    // Plain (unweighted) averages, so each fine cell has weight one and the weights count the cells
+    remap_operator fine_to_coarse;
+    fine_to_coarse.build( Nlat_fine, Nlon_fine, lat_first, lat_last, lon_first, lon_last );
+
     // Next, the coarse velocities
-    int cnt, land_cnt, Itime, Idepth, LEFT, RIGHT, BOT, TOP, Ilat_fine, Ilon_fine, Ilat_coarse, Ilon_coarse;
-    double target_lat, target_lon, interp_val;
-    size_t II_fine, II_coarse, coarse_mask_count;
+    std::vector< std::vector<double> > remapped;
+    std::vector<double> water_counts;
+    double cnt, land_cnt;
+    size_t II_coarse, coarse_mask_count;
+    int Itime, Idepth;
 
     for ( int Ivar = 0; Ivar < Nvars; Ivar++ ) {
 
         fine_data.load_variable( "fine_field", vars_to_refine.at(Ivar), fine_fname, true, true );
-    
-        std::fill( var_coarse.begin(), var_coarse.end(), 0. );
-        std::fill( mask_coarse.begin(), mask_coarse.end(), false );
+
+        fine_to_coarse.apply( remapped, water_counts, { &fine_data.variables.at( "fine_field" ) }, fine_data.mask, Ntime, Ndepth );
 
         coarse_mask_count = 0;
 
+        // A coarse cell is water if at least half of its fine cells are
         #pragma omp parallel \
         default(none) \
-        shared( coarse_data, fine_data, var_coarse, mask_coarse, vars_to_refine, stdout, stderr ) \
-        private( target_lat, target_lon, Itime, Idepth, II_coarse, Ilat_coarse, Ilon_coarse, \
-                 RIGHT, LEFT, BOT, TOP, II_fine, Ilat_fine, Ilon_fine, cnt, interp_val, land_cnt ) \
-        firstprivate( Npts_coarse, Nlon_coarse, Nlat_coarse, Nlon_fine, Nlat_fine, Ntime, Ndepth, \
-                      COARSE_LAT_GRID_INCREASING, COARSE_LON_GRID_INCREASING, FINE_LAT_GRID_INCREASING, FINE_LON_GRID_INCREASING ) \
+        shared( fine_to_coarse, var_coarse, mask_coarse, remapped, water_counts, stdout ) \
+        private( Itime, Idepth, II_coarse, Ilat_coarse, Ilon_coarse, cnt, land_cnt ) \
+        firstprivate( Npts_coarse, Nlon_coarse, Nlat_coarse, Ntime, Ndepth ) \
         reduction( + : coarse_mask_count )
         {
-            #pragma omp for collapse(1) schedule(guided)
+            #pragma omp for collapse(1) schedule(static)
             for (II_coarse = 0; II_coarse < Npts_coarse; ++II_coarse) {
 
                 Index1to4( II_coarse, Itime, Idepth, Ilat_coarse, Ilon_coarse, Ntime, Ndepth, Nlat_coarse, Nlon_coarse );
 
-
-                //
-                //// Get bounding box indices in the fine grid.
-                //
-
-                // bottom
-                if ( COARSE_LAT_GRID_INCREASING ) {
-                    if ( Ilat_coarse == 0 ) {
-                        target_lat = coarse_data.latitude.at(Ilat_coarse);
-                    } else {
-                        target_lat = 0.5 * ( coarse_data.latitude.at(Ilat_coarse) + coarse_data.latitude.at(Ilat_coarse - 1) );
-                    }
-                } else {
-                    if ( Ilat_coarse < Nlat_coarse - 1 ) {
-                        target_lat = 0.5 * ( coarse_data.latitude.at(Ilat_coarse) + coarse_data.latitude.at(Ilat_coarse + 1) );
-                    } else {
-                        target_lat = coarse_data.latitude.at(Ilat_coarse);
-                    }
-                }
-                if ( FINE_LAT_GRID_INCREASING ) {
-                    BOT = std::lower_bound( fine_data.latitude.begin(), fine_data.latitude.end(), target_lat ) 
-                          - fine_data.latitude.begin();
-                } else {
-                    //BOT = std::upper_bound( fine_data.latitude.begin(), fine_data.latitude.end(), target_lat ) 
-                    BOT = std::upper_bound( fine_data.latitude.rbegin(), fine_data.latitude.rend(), target_lat ) 
-                          - fine_data.latitude.rbegin();
-                    BOT = (Nlat_fine - 1) - BOT;
-                }
-                BOT = (BOT < 0) ? 0 : (BOT >= Nlat_fine) ? Nlat_fine - 1 : BOT;
-
-                // top
-                if ( COARSE_LAT_GRID_INCREASING ) {
-                    if ( Ilat_coarse < Nlat_coarse - 1 ) {
-                        target_lat = 0.5 * ( coarse_data.latitude.at(Ilat_coarse) + coarse_data.latitude.at(Ilat_coarse + 1) );
-                    } else {
-                        target_lat = coarse_data.latitude.at(Ilat_coarse);
-                    }
-                } else {
-                    if ( Ilat_coarse == 0 ) {
-                        target_lat = coarse_data.latitude.at(Ilat_coarse);
-                    } else {
-                        target_lat = 0.5 * ( coarse_data.latitude.at(Ilat_coarse) + coarse_data.latitude.at(Ilat_coarse - 1) );
-                    }
-                }
-                if ( FINE_LAT_GRID_INCREASING ) {
-                    TOP =  std::lower_bound( fine_data.latitude.begin(), fine_data.latitude.end(), target_lat ) 
-                            - fine_data.latitude.begin();
-                } else {
-                    //TOP =  std::upper_bound( fine_data.latitude.begin(), fine_data.latitude.end(), target_lat ) 
-                    TOP =  std::upper_bound( fine_data.latitude.rbegin(), fine_data.latitude.rend(), target_lat ) 
-                            - fine_data.latitude.rbegin();
-                    TOP = (Nlat_fine - 1) - TOP;
-                }
-                TOP = (TOP < 0) ? 0 : (TOP >= Nlat_fine) ? Nlat_fine - 1 : TOP;
-
-                // left
-                if ( COARSE_LON_GRID_INCREASING ) {
-                    if ( Ilon_coarse == 0 ) {
-                        target_lon = coarse_data.longitude.at(Ilon_coarse);
-                    } else {
-                        target_lon = 0.5 * ( coarse_data.longitude.at(Ilon_coarse) + coarse_data.longitude.at(Ilon_coarse - 1) );
-                    }
-                } else {
-                    if ( Ilon_coarse < Nlon_coarse - 1 ) {
-                        target_lon = 0.5 * ( coarse_data.longitude.at(Ilon_coarse) + coarse_data.longitude.at(Ilon_coarse + 1) );
-                    } else {
-                        target_lon = coarse_data.longitude.at(Ilon_coarse);
-                    }
-                }
-                if ( FINE_LON_GRID_INCREASING ) {
-                    LEFT = std::lower_bound( fine_data.longitude.begin(), fine_data.longitude.end(), target_lon ) 
-                                - fine_data.longitude.begin();
-                } else {
-                    //LEFT = std::upper_bound( fine_data.longitude.begin(), fine_data.longitude.end(), target_lon ) 
-                    LEFT = std::upper_bound( fine_data.longitude.rbegin(), fine_data.longitude.rend(), target_lon ) 
-                                - fine_data.longitude.rbegin();
-                    LEFT = (Nlon_fine - 1) - LEFT;
-                }
-                LEFT = (LEFT < 0) ? 0 : (LEFT >= Nlon_fine) ? Nlon_fine - 1 : LEFT;
-
-                //fprintf( stdout, " %g, %d", target_lon, LEFT );
-
-                // right
-                if ( COARSE_LON_GRID_INCREASING ) {
-                    if ( Ilon_coarse < Nlon_coarse - 1 ) {
-                        target_lon = 0.5 * ( coarse_data.longitude.at(Ilon_coarse) + coarse_data.longitude.at(Ilon_coarse + 1) );
-                    } else {
-                        target_lon = coarse_data.longitude.at(Ilon_coarse);
-                    }
-                } else {
-                    if ( Ilon_coarse == 0 ) {
-                        target_lon = coarse_data.longitude.at(Ilon_coarse);
-                    } else {
-                        target_lon = 0.5 * ( coarse_data.longitude.at(Ilon_coarse) + coarse_data.longitude.at(Ilon_coarse - 1) );
-                    }
-                }
-                if ( FINE_LON_GRID_INCREASING ) {
-                    RIGHT = std::lower_bound( fine_data.longitude.begin(), fine_data.longitude.end(), target_lon ) 
-                                - fine_data.longitude.begin();
-                } else {
-                    //RIGHT = std::upper_bound( fine_data.longitude.begin(), fine_data.longitude.end(), target_lon ) 
-                    RIGHT = std::upper_bound( fine_data.longitude.rbegin(), fine_data.longitude.rend(), target_lon ) 
-                                - fine_data.longitude.rbegin();
-                    RIGHT = (Nlon_fine - 1) - RIGHT;
-                }
-                RIGHT = (RIGHT < 0) ? 0 : (RIGHT >= Nlon_fine) ? Nlon_fine - 1 : RIGHT;
-
-                //fprintf( stdout, " : %g, %d\n", target_lon, RIGHT );
-                //fprintf( stdout, " %'zu : [ %d, %d, %d, %d ] \n", II_coarse, LEFT, BOT, TOP, RIGHT );
-
-                // Loop through the fine grid and build up the coarsened value.
-                interp_val = 0.;
-                land_cnt = 0.;
-                cnt = 0;
-                for (Ilat_fine = std::min(BOT,TOP); Ilat_fine <= std::max(BOT,TOP); Ilat_fine++) {
-                    for (Ilon_fine = std::min(LEFT,RIGHT); Ilon_fine <= std::max(LEFT,RIGHT); Ilon_fine++) {
-                        II_fine = Index( Itime, Idepth, Ilat_fine, Ilon_fine, Ntime, Ndepth, Nlat_fine, Nlon_fine );
-                        if ( fine_data.mask.at( II_fine ) ) {
-                            interp_val += fine_data.variables.at( "fine_field" ).at( II_fine );
-                            cnt++;
-                        } else {
-                            land_cnt++;
-                        }
-                    }
-                }
-
-                if ( (cnt == 0) and (land_cnt == 0) ) {
-                    fprintf( stderr, "No points in fine-grid correspond to coarse grid (%d, %d)\n", Ilat_coarse, Ilon_coarse );
-                }
+                cnt      = water_counts.at(II_coarse);
+                land_cnt = fine_to_coarse.row_weights.at( Index(0, 0, Ilat_coarse, Ilon_coarse, 1, 1, Nlat_coarse, Nlon_coarse) ) - cnt;
 
                 if ( (cnt == 0) or (cnt < land_cnt) ) {
                     mask_coarse.at(II_coarse) = false;
                     var_coarse.at(II_coarse) = constants::FILTER_OVER_LAND ? 0 : constants::fill_value;
                 } else {
                     mask_coarse.at(II_coarse) = true;
-                    var_coarse.at(II_coarse) = interp_val / cnt;
+                    var_coarse.at(II_coarse) = remapped[0].at(II_coarse);
                 }
                 if (not(mask_coarse.at(II_coarse))) { coarse_mask_count++; }
 
                 #if DEBUG >= 3
-                fprintf( stdout, " %'zu : [ %d, %d, %d, %d ] : %g, %d, %d : %g %s \n", 
-                        II_coarse, LEFT, BOT, TOP, RIGHT, interp_val, cnt, land_cnt, var_coarse.at(II_coarse), mask_coarse.at(II_coarse) ? "Water" : "Land" );
+                fprintf( stdout, " %'zu : %g, %g, %g : %g %s \n", 
+                        II_coarse, remapped[0].at(II_coarse), cnt, land_cnt, var_coarse.at(II_coarse), mask_coarse.at(II_coarse) ? "Water" : "Land" );
                 #endif
             }
         }
@@ -56,10 +56,12 @@ int main(int argc, char *argv[]) {
 
     const std::string   &Nprocs_in_time_string  = input.getCmdOption("--Nprocs_in_time",  "1"),
                         &Nprocs_in_depth_string = input.getCmdOption("--Nprocs_in_depth", "1"),
-                        &Nlayers_string         = input.getCmdOption("--Nlayers", "7");
+                        &Nlayers_string         = input.getCmdOption("--Nlayers", "7"),
+                        &chunk_size_string      = input.getCmdOption("--read_chunk_size", "1");
     const int   Nprocs_in_time_input  = stoi(Nprocs_in_time_string),
                 Nprocs_in_depth_input = stoi(Nprocs_in_depth_string),
-                num_interp_layers     = stoi(Nlayers_string);
+                num_interp_layers     = stoi(Nlayers_string),
+                read_chunk_size       = stoi(chunk_size_string);
 
     std::vector< std::string > vars_to_refine, vars_in_output;
     input.getListofStrings( vars_to_refine, "--input_variables" );
@@ -121,17 +123,38 @@ int main(int argc, char *argv[]) {
     const size_t Npts = Ntime * Ndepth * Nlat * Nlon;
     std::vector<double> interped_field(Npts);
 
-    // Next, the coarse velocities
+    // Only the grid and processor divisions are needed from here on
+    orig_data.variables.erase( "to_interp" );
+
+    // Interpolate each variable a few times at a time, reading the next times while the current ones
+    //   are being interpolated.
+    Timing_Records timing_records;
+    std::vector< std::vector<double> > chunk_fields;
+    std::vector<double> chunk_interped;
+    std::vector<bool> chunk_mask;
+    int Itime_chunk, Ntime_chunk;
     for ( int Ivar = 0; Ivar < Nvars; Ivar++ ) {
 
-        orig_data.load_variable( "to_interp", vars_to_refine.at(Ivar), input_fname, true, true );
+        prefetching_reader reader( orig_data, { vars_to_refine.at(Ivar) }, input_fname, read_chunk_size, &timing_records );
+        while ( reader.next( chunk_fields, chunk_mask, Itime_chunk, Ntime_chunk ) ) {
+
+            const std::vector<int> chunk_counts = { Ntime_chunk, Ndepth, Nlat, Nlon };
+            interpolate_over_land_from_coast( chunk_interped, chunk_fields[0], num_interp_layers,
+                    orig_data.time, orig_data.depth, orig_data.latitude, orig_data.longitude, chunk_mask, chunk_counts);
 
-        interpolate_over_land_from_coast( interped_field, orig_data.variables["to_interp"], num_interp_layers,
-                orig_data.time, orig_data.depth, orig_data.latitude, orig_data.longitude, orig_data.mask, orig_data.myCounts);
+            // Time is the outermost dimension, so the chunk is contiguous in the full field
+            std::copy( chunk_interped.begin(), chunk_interped.end(), 
+                       interped_field.begin() + (size_t) Itime_chunk * Ndepth * Nlat * Nlon );
+        }
 
         write_field_to_output( interped_field, vars_in_output.at(Ivar), starts, counts, output_fname );
     }
 
+    if (constants::DO_TIMING) { 
+        timing_records.print();
+        fflush(stdout);
+    }
+
     #if DEBUG >= 1
     fprintf(stdout, "Processor %d / %d waiting to finalize.\n", wRank + 1, wSize);
     #endif
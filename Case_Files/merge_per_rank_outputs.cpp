@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <omp.h>
+
+#include "../netcdf_io.hpp"
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+/*
+ * \brief Case file to combine per-rank output files (see --per_rank_outputs in coarse_grain) into single files
+ *
+ * Any number of processors can be used, independently of how many wrote the parts.
+ *
+ * @param   --files                 Comma-separated list of outputs to merge, by their single-file names (e.g. filter_100km.nc)
+ * @param   --output_suffix         Suffix (before the .nc) for the merged files
+ * @param   --mpi_io_hints
+ *
+ */
+int main(int argc, char *argv[]) {
+
+    // Specify the number of OpenMP threads
+    //   and initialize the MPI world
+    int thread_safety_provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_safety_provided);
+    const double start_time = MPI_Wtime();
+
+    int wRank=-1, wSize=-1;
+    MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
+    MPI_Comm_size( MPI_COMM_WORLD, &wSize );
+
+    //
+    //// Parse command-line arguments
+    //
+    InputParser input(argc, argv);
+    if(input.cmdOptionExists("--version")){
+        if (wRank == 0) { print_compile_info(NULL); }
+        return 0;
+    }
+    const bool asked_help = input.cmdOptionExists("--help");
+    if (asked_help) {
+        fprintf( stdout, "\033[1;4mThe command-line input arguments [and default values] are:\033[0m\n" );
+    }
+
+    // first argument is the flag, second argument is default value (for when flag is not present)
+    const std::string   &files_string        = input.getCmdOption("--files",
+                                                                  "filter_100km.nc",
+                                                                  asked_help,
+                                                                  "Comma-separated list of the outputs to merge, given by their single-file names\n"
+                                                                  "(e.g. \"filter_100km.nc,filter_200km.nc\" to merge filter_100km.rank*.nc and filter_200km.rank*.nc)."),
+                        &output_suffix       = input.getCmdOption("--output_suffix",
+                                                                  "",
+                                                                  asked_help,
+                                                                  "Suffix added (before the .nc) to the merged filenames. By default, the merged files take the single-file names."),
+                        &mpi_io_hints_string = input.getCmdOption("--mpi_io_hints",
+                                                                  "",
+                                                                  asked_help,
+                                                                  "MPI-IO hints for the merged files, as comma-separated key=value pairs.");
+
+    if (asked_help) { return 0; }
+
+    set_mpi_io_hints( mpi_io_hints_string );
+
+    // Set OpenMP thread number
+    const int max_threads = omp_get_max_threads();
+    omp_set_num_threads( max_threads );
+
+    // Split the list of files
+    std::vector< std::string > filenames;
+    size_t pos = 0, end;
+    while (pos < files_string.size()) {
+        end = files_string.find( ',', pos );
+        if (end == std::string::npos) { end = files_string.size(); }
+        if (end > pos) { filenames.push_back( files_string.substr( pos, end - pos ) ); }
+        pos = end + 1;
+    }
+
+    for (size_t Ifile = 0; Ifile < filenames.size(); Ifile++) {
+        const std::string & filename = filenames[Ifile];
+        const size_t ext_start = filename.rfind( ".nc" );
+        const std::string output_filename = ( ext_start == std::string::npos )
+                                                ? filename + output_suffix
+                                                : filename.substr( 0, ext_start ) + output_suffix + ".nc";
+        merge_per_rank_outputs( filename, output_filename );
+    }
+
+    #if DEBUG >= 0
+    if (wRank == 0) { fprintf(stdout, "\nMerged %zu files in %.4g s\n", filenames.size(), MPI_Wtime() - start_time); }
+    print_write_bandwidth();
+    #endif
+
+    MPI_Finalize();
+    return 0;
+}
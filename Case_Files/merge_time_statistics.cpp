@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <omp.h>
+
+#include "../netcdf_io.hpp"
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+/*
+ * \brief Case file to combine time-statistics files (see POSTPROCESS_WRITE_TIME_STATISTICS) from runs over different times
+ *
+ * e.g. to extend a climatology with a new year of data, merge the statistics file of the new year with
+ * that of the existing climatology. The merged means and standard deviations match those of the full record.
+ *
+ * @param   --files                 Comma-separated list of time-statistics files to merge
+ * @param   --output_file           Name of the merged file
+ * @param   --mpi_io_hints
+ *
+ */
+int main(int argc, char *argv[]) {
+
+    // Specify the number of OpenMP threads
+    //   and initialize the MPI world
+    int thread_safety_provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_safety_provided);
+    const double start_time = MPI_Wtime();
+
+    int wRank=-1, wSize=-1;
+    MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
+    MPI_Comm_size( MPI_COMM_WORLD, &wSize );
+
+    //
+    //// Parse command-line arguments
+    //
+    InputParser input(argc, argv);
+    if(input.cmdOptionExists("--version")){
+        if (wRank == 0) { print_compile_info(NULL); }
+        return 0;
+    }
+    const bool asked_help = input.cmdOptionExists("--help");
+    if (asked_help) {
+        fprintf( stdout, "\033[1;4mThe command-line input arguments [and default values] are:\033[0m\n" );
+    }
+
+    // first argument is the flag, second argument is default value (for when flag is not present)
+    const std::string   &files_string        = input.getCmdOption("--files",
+                                                                  "postprocess_time_statistics_100km.nc",
+                                                                  asked_help,
+                                                                  "Comma-separated list of the time-statistics files to merge (all on the same grid)."),
+                        &output_filename     = input.getCmdOption("--output_file",
+                                                                  "merged_time_statistics.nc",
+                                                                  asked_help,
+                                                                  "Name of the merged time-statistics file."),
+                        &mpi_io_hints_string = input.getCmdOption("--mpi_io_hints",
+                                                                  "",
+                                                                  asked_help,
+                                                                  "MPI-IO hints for the merged file, as comma-separated key=value pairs.");
+
+    if (asked_help) { return 0; }
+
+    set_mpi_io_hints( mpi_io_hints_string );
+
+    // Set OpenMP thread number
+    const int max_threads = omp_get_max_threads();
+    omp_set_num_threads( max_threads );
+
+    // Split the list of files
+    std::vector< std::string > filenames;
+    size_t pos = 0, end;
+    while (pos < files_string.size()) {
+        end = files_string.find( ',', pos );
+        if (end == std::string::npos) { end = files_string.size(); }
+        if (end > pos) { filenames.push_back( files_string.substr( pos, end - pos ) ); }
+        pos = end + 1;
+    }
+
+    merge_time_statistics( filenames, output_filename );
+
+    #if DEBUG >= 0
+    if (wRank == 0) { fprintf(stdout, "\nMerged the time statistics of %zu files in %.4g s\n", filenames.size(), MPI_Wtime() - start_time); }
+    #endif
+
+    MPI_Finalize();
+    return 0;
+}
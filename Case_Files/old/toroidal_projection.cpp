@@ -80,6 +80,9 @@ int main(int argc, char *argv[]) {
     const std::string &use_area_weight_string = input.getCmdOption("--use_area_weight", "true");
     const bool use_area_weight = string_to_bool(use_area_weight_string);
 
+    const std::string &direct_solve_string = input.getCmdOption("--direct_solve", "false");
+    const bool direct_solve = string_to_bool(direct_solve_string);
+
     // Print processor assignments
     const int max_threads = omp_get_max_threads();
     omp_set_num_threads( max_threads );
@@ -136,7 +139,7 @@ int main(int argc, char *argv[]) {
     if (wRank == 0) { fprintf(stdout, " single_seed = %s\n", single_seed ? "true" : "false"); }
 
     // Apply to projection routine
-    Apply_Toroidal_Projection( output_fname, source_data, seed, single_seed, tolerance, max_iterations, use_area_weight, use_mask );
+    Apply_Toroidal_Projection( output_fname, source_data, seed, single_seed, tolerance, max_iterations, use_area_weight, use_mask, direct_solve );
 
     // Done!
     #if DEBUG >= 0
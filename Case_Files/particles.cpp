@@ -68,6 +68,23 @@ int main(int argc, char *argv[]) {
     const std::string &particle_lifespan_string = input.getCmdOption("--particle_lifespan", "-1");
     const double particle_lifespan = stod(particle_lifespan_string);  // in seconds
 
+    // time-stepping scheme ( Euler, RK4, or RK45 ) and, for the Runge-Kutta schemes, the error tolerance per step
+    const std::string &integrator_string = input.getCmdOption("--integrator", "Euler");
+    int integrator;
+    if (integrator_string == "Euler") {
+        integrator = constants::ParticleIntegratorType::ForwardEuler;
+    } else if (integrator_string == "RK4") {
+        integrator = constants::ParticleIntegratorType::RK4;
+    } else if (integrator_string == "RK45") {
+        integrator = constants::ParticleIntegratorType::RK45;
+    } else {
+        fprintf(stderr, "Unrecognized --integrator %s (options are Euler, RK4, and RK45)\n", integrator_string.c_str());
+        assert(false);
+    }
+
+    const std::string &tolerance_string = input.getCmdOption("--tolerance", "1");
+    const double tolerance = stod(tolerance_string);  // in metres
+
 
     // Set OpenMP thread number
     const int max_threads = omp_get_max_threads();
@@ -199,7 +216,7 @@ int main(int argc, char *argv[]) {
         u_lon, u_lat,
         fields_to_track, names_of_tracked_fields,
         time, latitude, longitude,        
-        mask);
+        mask, integrator, tolerance);
 
     fprintf(stdout, "\nProcessor %d of %d finished stepping particles.\n", wRank+1, wSize);
 
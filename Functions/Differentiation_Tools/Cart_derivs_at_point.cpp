@@ -62,23 +62,49 @@ void Cart_derivatives_at_point(
     }
 
     // Compute spherical derivatives
-    spher_derivative_at_point(
-        dfields_dlon_p, fields, longitude, "lon",
-        Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon,
-        mask, order_of_deriv, diff_ord);
+    //   (using the pre-computed stencils if they were built for this mask,
+    //    or else the compile-time version for the usual derivatives)
+    const size_t index = Index( Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon );
+    const bool usual_deriv = (order_of_deriv == 1) and (diff_ord == constants::DiffOrd);
+    if ( source_data.lon_deriv_op.applies_to( longitude, mask, order_of_deriv, diff_ord ) ) {
+        source_data.lon_deriv_op.apply_at_point( dfields_dlon_p, fields, index );
+    } else if ( usual_deriv ) {
+        spher_derivative_at_point<diff_dim::lon, 1, constants::DiffOrd>(
+            dfields_dlon_p, fields, longitude,
+            Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask);
+    } else {
+        spher_derivative_at_point(
+            dfields_dlon_p, fields, longitude, "lon",
+            Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon,
+            mask, order_of_deriv, diff_ord);
+    }
 
-    spher_derivative_at_point(
-        dfields_dlat_p, fields, latitude, "lat",
-        Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon,
-        mask, order_of_deriv, diff_ord);
+    if ( source_data.lat_deriv_op.applies_to( latitude, mask, order_of_deriv, diff_ord ) ) {
+        source_data.lat_deriv_op.apply_at_point( dfields_dlat_p, fields, index );
+    } else if ( usual_deriv ) {
+        spher_derivative_at_point<diff_dim::lat, 1, constants::DiffOrd>(
+            dfields_dlat_p, fields, latitude,
+            Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask);
+    } else {
+        spher_derivative_at_point(
+            dfields_dlat_p, fields, latitude, "lat",
+            Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon,
+            mask, order_of_deriv, diff_ord);
+    }
 
     if ( include_depth_derivs ) {
         // At the moment, can only use second order for
         // depth derivatives since it's non-uniform.
-        spher_derivative_at_point(
-            dfields_dr_p, fields, depth, "depth",
-            Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon,
-            mask, order_of_deriv, 2);
+        if ( order_of_deriv == 1 ) {
+            spher_derivative_at_point<diff_dim::depth, 1, 2>(
+                dfields_dr_p, fields, depth,
+                Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask);
+        } else {
+            spher_derivative_at_point(
+                dfields_dr_p, fields, depth, "depth",
+                Itime, Idepth_DEPTH, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon,
+                mask, order_of_deriv, 2);
+        }
         if (not(source_data.depth_is_elevation)) {
             // If we have an actual depth grid, multiply by
             // (-1) to account for the grid increasing down, not up
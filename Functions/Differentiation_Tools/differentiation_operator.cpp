@@ -0,0 +1,261 @@
+#include <vector>
+#include <string>
+#include <assert.h>
+#include <omp.h>
+#include <math.h>
+#include "../../differentiation_tools.hpp"
+#include "../../constants.hpp"
+#include "../../functions.hpp"
+
+// Find the stencil that spher_derivative_at_point would use at a point: build outwards until
+//   hitting land (or having enough points), then collapse back down, lowering the order if
+//   there isn't enough room. Returns the number of points in the stencil (0 if none).
+int find_stencil_bounds(
+        int & LB,
+        const int Iref,
+        const int Nref,
+        const bool periodic,
+        const size_t base_index,
+        const size_t stride,
+        const std::vector<bool> & mask,
+        const int order_of_deriv,
+        const int diff_ord
+        ) {
+
+    const int LLB = periodic ? Iref - Nref : 0 ;
+    const int UUB = periodic ? Iref + Nref : Nref - 1 ;
+
+    for (int ord = diff_ord; ord > 0; ord -= 2) {
+
+        const int num_deriv_pts = ord + order_of_deriv;
+
+        int UB = Iref, wrapped;
+        LB = Iref;
+        while ( (LB > LLB) and ( (Iref - LB) < num_deriv_pts ) ) {
+            wrapped = ( ( LB - 1 ) % Nref + Nref ) % Nref;
+            if ( mask[ base_index + wrapped * stride ] ) { LB--; } else { break; }
+        }
+        while ( (UB < UUB) and ( (UB - Iref) < num_deriv_pts ) ) {
+            wrapped = ( ( UB + 1 ) % Nref + Nref ) % Nref;
+            if ( mask[ base_index + wrapped * stride ] ) { UB++; } else { break; }
+        }
+
+        while (UB - LB + 1 > num_deriv_pts) {
+            if ((UB - Iref > Iref - LB) and (UB >= Iref)) { UB--; }
+            else { LB++; }
+        }
+
+        if (UB - LB + 1 == num_deriv_pts) { return num_deriv_pts; }
+        if (ord <= 3) { break; } // same fall-backs as spher_diff_stencil
+    }
+    return 0;
+}
+
+// The back-up stencils from get_diff_vector, for when find_stencil_bounds fails: a two-point first
+//   derivative, or a three-point second derivative (uniform grids only). Returns the number of points (0 if none).
+int find_backup_stencil_bounds(
+        int & LB,
+        const int Iref,
+        const int Nref,
+        const bool periodic,
+        const bool uniform,
+        const size_t base_index,
+        const size_t stride,
+        const std::vector<bool> & mask,
+        const int order_of_deriv,
+        const int diff_ord
+        ) {
+
+    int LB_max, UB_max, UB;
+    widest_stencil_bounds( LB_max, UB_max, Iref, Nref, periodic, diff_ord + order_of_deriv, base_index, stride, mask );
+    collapse_stencil( LB, UB, Iref, LB_max, UB_max, 2 + order_of_deriv );
+
+    if ( (order_of_deriv == 1) and (UB - LB + 1 == 2) ) { return 2; }
+    if ( (order_of_deriv == 2) and (UB - LB + 1 == 3) and uniform ) { return 3; }
+    return 0;
+}
+
+void differentiation_operator::build(
+        const std::vector<double> & grid,
+        const std::string & dim,
+        const int Ntime,
+        const int Ndepth,
+        const int Nlat,
+        const int Nlon,
+        const std::vector<bool> & mask,
+        const int order_of_deriv_in,
+        const int diff_ord_in,
+        const bool with_backups_in
+        ) {
+
+    const bool do_dep = (dim == "depth");
+    const bool do_lat = (dim == "lat");
+    const bool do_lon = (dim == "lon");
+    assert( do_dep ^ (do_lat ^ do_lon) ); // ^ = xor
+
+    const size_t Npts = mask.size();
+    assert( Npts == (size_t) Ntime * Ndepth * Nlat * Nlon );
+
+    grid_ptr = &grid;
+    mask_ptr = &mask;
+    mask_size = Npts;
+    order_of_deriv = order_of_deriv_in;
+    diff_ord = diff_ord_in;
+    with_backups = with_backups_in;
+
+    const int Nref = grid.size();
+    const bool periodic = do_dep ? false :
+                          do_lat ? constants::PERIODIC_Y :
+                          do_lon ? constants::PERIODIC_X : false;
+    const bool uniform = do_lon or (do_lat and constants::UNIFORM_LAT_GRID);
+    const size_t stride = do_lon ? 1 : do_lat ? Nlon : (size_t) Nlat * Nlon;
+
+    // If the mask is the same at every time, then so are the stencils
+    points_per_time = (size_t) Ndepth * Nlat * Nlon;
+    time_invariant = true;
+    for (size_t index = points_per_time; index < Npts; index++) {
+        if ( mask[index] != mask[ index % points_per_time ] ) { time_invariant = false; break; }
+    }
+    const size_t Nstored = time_invariant ? points_per_time : Npts;
+
+    // The stencil at a point is determined by its position along the dimension (Iref),
+    //   where the stencil starts relative to it, and how many points it has.
+    //   So first find those for each point, and then only build the distinct ones.
+    //   Back-up stencils are flagged by storing -2 - key.
+    const int max_pts = diff_ord + order_of_deriv;
+    std::vector<int> raw_key( Nstored, -1 );
+
+    if (Nref > 1) {
+        int Itime, Idepth, Ilat, Ilon, Iref, LB, num_pts;
+        size_t index, base_index;
+        #pragma omp parallel default(none) \
+        shared( raw_key, mask ) \
+        private( Itime, Idepth, Ilat, Ilon, Iref, LB, num_pts, index, base_index ) \
+        firstprivate( Nstored, Ntime, Ndepth, Nlat, Nlon, Nref, periodic, uniform, stride, do_lat, do_lon, max_pts, \
+                      order_of_deriv_in, diff_ord_in, with_backups_in )
+        {
+            #pragma omp for collapse(1) schedule(static)
+            for (index = 0; index < Nstored; index++) {
+                Index1to4( index, Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon );
+                Iref = do_lon ? Ilon : do_lat ? Ilat : Idepth;
+                base_index = index - Iref * stride;
+
+                num_pts = find_stencil_bounds( LB, Iref, Nref, periodic, base_index, stride, mask, order_of_deriv_in, diff_ord_in );
+                if (num_pts > 0) {
+                    raw_key[index] = ( Iref * (max_pts + 1) + (Iref - LB) ) * (max_pts + 1) + num_pts;
+                } else if (with_backups_in) {
+                    num_pts = find_backup_stencil_bounds( LB, Iref, Nref, periodic, uniform, base_index, stride, mask, 
+                                                          order_of_deriv_in, diff_ord_in );
+                    if (num_pts > 0) {
+                        raw_key[index] = -2 - ( ( Iref * (max_pts + 1) + (Iref - LB) ) * (max_pts + 1) + num_pts );
+                    }
+                }
+            }
+        }
+    }
+
+    // Build the distinct stencils
+    std::vector<int> key_to_id( Nref * (max_pts + 1) * (max_pts + 1), -1 );
+    std::vector<double> ddl;
+    stencil_start.assign( 1, 0 );
+    stencil_offset.clear();
+    stencil_coeff.clear();
+    for (size_t index = 0; index < Nstored; index++) {
+        const int key = ( raw_key[index] < -1 ) ? -2 - raw_key[index] : raw_key[index];
+        if ( (key < 0) or (key_to_id[key] >= 0) ) { continue; }
+
+        const int num_pts = key % (max_pts + 1),
+                  Iref    = key / ( (max_pts + 1) * (max_pts + 1) ),
+                  LB      = Iref - ( key / (max_pts + 1) ) % (max_pts + 1),
+                  UB      = LB + num_pts - 1,
+                  ord     = num_pts - order_of_deriv;
+
+        ddl.clear();
+        if (ord < 2) {
+            // Back-up stencils (see get_diff_vector)
+            const double dl = grid.at(1) - grid.at(0);
+            if (order_of_deriv == 1) { ddl = { -1. / dl, 1. / dl }; }
+            else                     { ddl = {  1. / pow(dl, 2.), -2. / pow(dl, 2.), 1. / pow(dl, 2.) }; }
+        } else if (uniform) {
+            const double dl = grid.at(1) - grid.at(0);
+            differentiation_vector(ddl, dl, Iref - LB, order_of_deriv, ord);
+        } else {
+            non_uniform_diff_vector(ddl, grid, Iref, LB, UB, ord);
+        }
+
+        for (int IND = LB; IND <= UB; IND++) {
+            const int ind = ( IND % Nref + Nref ) % Nref;
+            stencil_offset.push_back( ( (long) ind - Iref ) * (long) stride );
+            stencil_coeff.push_back( ddl.at(IND - LB) );
+        }
+        key_to_id[key] = stencil_start.size() - 1;
+        stencil_start.push_back( stencil_offset.size() );
+    }
+
+    stencil_id.resize( Nstored );
+    for (size_t index = 0; index < Nstored; index++) {
+        stencil_id[index] = ( raw_key[index] == -1 ) ? -1 :
+                            ( raw_key[index] <  -1 ) ? -2 - key_to_id[ -2 - raw_key[index] ] :
+                                                       key_to_id[ raw_key[index] ];
+    }
+
+    built = true;
+}
+
+void differentiation_operator::apply(
+        std::vector<double> & deriv,
+        const std::vector<double> & field
+        ) const {
+
+    const std::vector<std::vector<double>*> derivs { &deriv };
+    const std::vector<const std::vector<double>*> fields { &field };
+    apply( derivs, fields );
+}
+
+void differentiation_operator::apply(
+        const std::vector<std::vector<double>*> & derivs,
+        const std::vector<const std::vector<double>*> & fields
+        ) const {
+
+    assert( built );
+    assert( derivs.size() == fields.size() );
+    const int num_fields = fields.size();
+    if (num_fields == 0) { return; }
+
+    // Fields that only cover the first time(s) / depth(s) are fine, since stencils don't cross times / depths
+    const size_t Npts = fields[0]->size();
+    assert( Npts <= mask_size );
+    for (int ii = 0; ii < num_fields; ii++) {
+        assert( fields[ii]->size() == Npts );
+        derivs[ii]->resize( Npts );
+    }
+
+    size_t index, kk;
+    long offset;
+    int sid, ii;
+    double coeff;
+    std::vector<double> deriv_vals;
+    #pragma omp parallel default(none) \
+    shared( derivs, fields ) \
+    private( index, kk, offset, sid, ii, coeff, deriv_vals ) \
+    firstprivate( Npts, num_fields )
+    {
+        deriv_vals.resize( num_fields );
+
+        #pragma omp for collapse(1) schedule(static)
+        for (index = 0; index < Npts; index++) {
+            sid = stencil_id[ time_invariant ? index % points_per_time : index ];
+            for (ii = 0; ii < num_fields; ii++) { deriv_vals[ii] = 0.; }
+            if (sid >= 0) {
+                for (kk = stencil_start[sid]; kk < stencil_start[sid+1]; kk++) {
+                    offset = stencil_offset[kk];
+                    coeff  = stencil_coeff[kk];
+                    for (ii = 0; ii < num_fields; ii++) {
+                        deriv_vals[ii] += (*fields[ii])[ index + offset ] * coeff;
+                    }
+                }
+            }
+            for (ii = 0; ii < num_fields; ii++) { (*derivs[ii])[index] = deriv_vals[ii]; }
+        }
+    }
+}
@@ -24,31 +24,15 @@ void non_uniform_diff_vector(
 
     double scale_factor = 1.;
     double c1, c2, c3, c4;
-    double xn1, x0, xp1;
 
     if (diff_ord == 2) {  // second order accurate
         switch (order_of_deriv) {
             case 1: // first derivative
-                xn1 = grid.at(LB);
-                x0  = grid.at(LB+1);
-                xp1 = grid.at(UB);
-                if (Iref == LB) {
-                    c2 = -1. / ( 0.5 * pow(x0  - xn1, 2.) );
-                    c3 =  1. / ( 0.5 * pow(xp1 - xn1, 2.) );
-                    c1 = -(c3 + c2);
-                    scale_factor = (2/(xp1-xn1)) - (2/(x0-xn1));
-                } else if (Iref == UB) {
-                    c1 = -1. / ( 0.5 * pow(xn1 - xp1, 2.) );
-                    c2 =  1. / ( 0.5 * pow(x0  - xp1, 2.) );
-                    c3 = -(c2 + c1);
-                    scale_factor = (2/(x0-xp1)) - (2/(xn1-xp1));
-                } else {
-                    c1 = -1. / ( 0.5 * pow(xn1 - x0, 2.) );
-                    c3 =  1. / ( 0.5 * pow(xp1 - x0, 2.) );
-                    c2 = -(c3 + c1);
-                    scale_factor = (2/(xp1-x0)) - (2/(xn1-x0));
+                {
+                    double coeffs[3];
+                    non_uniform_first_deriv_coeffs( coeffs, grid, Iref, LB, UB );
+                    diff_array.insert(start, coeffs, coeffs + 3);
                 }
-                diff_array.insert(start, {c1, c2, c3});
                 break;
             case 2: // second derivative
                 if (Iref == LB) {
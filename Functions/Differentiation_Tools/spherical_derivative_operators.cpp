@@ -0,0 +1,34 @@
+#include <vector>
+#include "../../constants.hpp"
+#include "../../functions.hpp"
+
+/*!
+ * \brief Build the horizontal derivative operators for a grid and mask
+ *
+ * @param[in]   longitude,latitude          grid
+ * @param[in]   Ntime,Ndepth,Nlat,Nlon      sizes of the (MPI-local) dimensions
+ * @param[in]   mask                        mask to distinguish land/water cells
+ * @param[in]   second_derivs               also build the second-derivative operators (needed for the Laplacian)
+ */
+void spherical_derivative_operators::build(
+        const std::vector<double> & longitude,
+        const std::vector<double> & latitude,
+        const int Ntime,
+        const int Ndepth,
+        const int Nlat,
+        const int Nlon,
+        const std::vector<bool> & mask,
+        const bool second_derivs
+        ) {
+
+    ddlon.build( longitude, "lon", Ntime, Ndepth, Nlat, Nlon, mask, 1, constants::DiffOrd, true );
+    ddlat.build( latitude,  "lat", Ntime, Ndepth, Nlat, Nlon, mask, 1, constants::DiffOrd, true );
+
+    if (second_derivs) {
+        d2dlon2.build( longitude, "lon", Ntime, Ndepth, Nlat, Nlon, mask, 2, constants::DiffOrd, true );
+        d2dlat2.build( latitude,  "lat", Ntime, Ndepth, Nlat, Nlon, mask, 2, constants::DiffOrd, true );
+    } else {
+        d2dlon2 = differentiation_operator();
+        d2dlat2 = differentiation_operator();
+    }
+}
@@ -34,6 +34,18 @@ void filtering(
 
     const std::vector<int>  myStarts = source_data.myStarts;
 
+    // With sample points, only the samples are written (see initialize_subset_file), so only
+    //   the grid points that they need are filtered, and the postprocessing is skipped
+    const point_samples & samples = source_data.samples;
+    const bool subset_outputs = not(samples.empty()),
+               write_fields   = subset_outputs or not(constants::NO_FULL_OUTPUTS);
+
+    // Pre-computed trigonometry for the coordinate transforms (built here if it isn't for this grid)
+    grid_geometry local_geometry;
+    if ( not(source_data.geometry.applies_to( longitude, latitude )) ) { local_geometry.build( longitude, latitude ); }
+    const grid_geometry & geometry = source_data.geometry.applies_to( longitude, latitude ) ?
+                                        source_data.geometry : local_geometry;
+
     const std::vector<double>   &full_u_r   = source_data.variables.at("u_r"),
                                 &full_u_lon = source_data.variables.at("u_lon"),
                                 &full_u_lat = source_data.variables.at("u_lat"),
@@ -45,6 +57,12 @@ void filtering(
     MPI_Comm_rank( comm, &wRank );
     MPI_Comm_size( comm, &wSize );
 
+    #if DEBUG >= 0
+    if ( (subset_outputs) and (constants::APPLY_POSTPROCESS) and (wRank == 0) ) {
+        fprintf(stdout, "Only writing sampled (subset) outputs, so the on-line postprocessing is skipped.\n");
+    }
+    #endif
+
     // If we've passed the DO_TIMING flag, then create some timing vars
     Timing_Records timing_records;
     double clock_on;
@@ -84,7 +102,7 @@ void filtering(
     if (not(constants::MINIMAL_OUTPUT)) {
         vars_to_write.push_back("coarse_u_r");
     }
-    if (not(constants::NO_FULL_OUTPUTS)) {
+    if (write_fields) {
         vars_to_write.push_back("coarse_u_lon");
         vars_to_write.push_back("coarse_u_lat");
         vars_to_write.push_back("coarse_KE");
@@ -136,7 +154,7 @@ void filtering(
     }
     fine_u_lon.resize(num_pts);
     fine_u_lat.resize(num_pts);
-    if (not(constants::NO_FULL_OUTPUTS)) {
+    if (write_fields) {
         vars_to_write.push_back("fine_u_lon");
         vars_to_write.push_back("fine_u_lat");
     }
@@ -168,7 +186,7 @@ void filtering(
         coarse_vort_r.resize(  num_pts);
         coarse_vort_lon.resize(num_pts);
         coarse_vort_lat.resize(num_pts);
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             vars_to_write.push_back("coarse_vort_r");
         }
         postprocess_names.push_back( "coarse_vort_r");
@@ -183,7 +201,7 @@ void filtering(
 
         div.resize(num_pts);
         OkuboWeiss.resize(num_pts);
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             vars_to_write.push_back("coarse_vel_div");
             vars_to_write.push_back("OkuboWeiss");
         }
@@ -234,14 +252,14 @@ void filtering(
         postprocess_names.push_back( "fine_KE");
         postprocess_fields.push_back(&fine_KE);
 
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             vars_to_write.push_back("fine_KE");
         }
 
         // Also an array for the transfer itself
         energy_transfer.resize(num_pts);
         enstrophy_transfer.resize(num_pts);
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             vars_to_write.push_back("Pi");
             vars_to_write.push_back("Z");
         }
@@ -265,7 +283,7 @@ void filtering(
         #endif
         coarse_rho.resize(num_pts);
         coarse_p.resize(  num_pts);
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             vars_to_write.push_back("coarse_rho");
             vars_to_write.push_back("coarse_p");
         }
@@ -281,7 +299,7 @@ void filtering(
         tilde_vort_r.resize(  num_pts);
         tilde_vort_lon.resize(num_pts);
         tilde_vort_lat.resize(num_pts);
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             vars_to_write.push_back("tilde_vort_r");
         }
         postprocess_names.push_back( "tilde_vort_r");
@@ -291,7 +309,7 @@ void filtering(
         tilde_u_r.resize(  num_pts);
         tilde_u_lon.resize(num_pts);
         tilde_u_lat.resize(num_pts);
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             vars_to_write.push_back("tilde_u_r");
             vars_to_write.push_back("tilde_u_lon");
             vars_to_write.push_back("tilde_u_lat");
@@ -300,7 +318,7 @@ void filtering(
         // We also have what we need to compute the PEtoKE term
         //    rho_bar * g * w_bar
         PEtoKE.resize(num_pts);
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             vars_to_write.push_back("PEtoKE");
         }
         #if DEBUG >= 1
@@ -346,6 +364,48 @@ void filtering(
         filt_use_mask.push_back(false);
     }
 
+    // On uniform Cartesian grids the kernel only depends on the index offsets, so it is computed
+    //   once per scale and shared by all threads (see cartesian_offset_kernel)
+    cartesian_offset_kernel offset_kernel;
+    const cartesian_offset_kernel * offset_kernel_ptr = cartesian_offset_kernel::is_possible() ? &offset_kernel : NULL;
+
+    // With a separable kernel, the whole fields are filtered first (two 1D passes), and 
+    //   the main loop just reads off the values (see apply_separable_filter)
+    std::vector<std::vector<double>> sep_filtered, sep_quadratics, sep_tilde, quadratic_fields;
+    std::vector<std::vector<double>*> sep_filtered_ptrs, sep_quadratics_ptrs, sep_tilde_ptrs;
+    std::vector<const std::vector<double>*> quadratic_field_ptrs, tilde_field_ptrs { &u_x, &u_y, &u_z };
+    if (constants::USE_SEPARABLE_KERNEL) {
+        sep_filtered.resize( filter_fields.size() );
+        for (size_t II = 0; II < filter_fields.size(); II++) { sep_filtered_ptrs.push_back( &sep_filtered[II] ); }
+
+        if (constants::COMP_TRANSFERS) {
+            // uxux, uxuy, uxuz, uyuy, uyuz, uzuz, vort_ux, vort_uy, vort_uz
+            const std::vector<double> * vel[3] = { &u_x, &u_y, &u_z };
+            quadratic_fields.resize( 9, std::vector<double>( num_pts, 0. ) );
+            sep_quadratics.resize( 9 );
+            int Iquad = 0;
+            for (int ii = 0; ii < 3; ii++) {
+                for (int jj = ii; jj < 3; jj++) {
+                    for (size_t pt = 0; pt < num_pts; pt++) { quadratic_fields[Iquad][pt] = (*vel[ii])[pt] * (*vel[jj])[pt]; }
+                    Iquad++;
+                }
+            }
+            for (int ii = 0; ii < 3; ii++) {
+                for (size_t pt = 0; pt < num_pts; pt++) { quadratic_fields[Iquad][pt] = full_vort_r[pt] * (*vel[ii])[pt]; }
+                Iquad++;
+            }
+            for (int II = 0; II < 9; II++) {
+                quadratic_field_ptrs.push_back( &quadratic_fields[II] );
+                sep_quadratics_ptrs.push_back( &sep_quadratics[II] );
+            }
+        }
+
+        if (constants::COMP_BC_TRANSFERS) {
+            sep_tilde.resize( 3 );
+            for (int II = 0; II < 3; II++) { sep_tilde_ptrs.push_back( &sep_tilde[II] ); }
+        }
+    }
+
     //
     //// Begin the main filtering loop
     //
@@ -355,12 +415,18 @@ void filtering(
     for (int Iscale = 0; Iscale < Nscales; Iscale++) {
 
         // Create the output file
-        snprintf(fname, 50, "filter_%.6gkm.nc", scales.at(Iscale)/1e3);
-        if (not(constants::NO_FULL_OUTPUTS)) {
-            initialize_output_file( source_data, vars_to_write, fname, scales.at(Iscale));
-
-            // Add some attributes to the file
+        if (subset_outputs) {
+            snprintf(fname, 50, "subset_%.6gkm.nc", scales.at(Iscale)/1e3);
+            initialize_subset_file( source_data.time, source_data.depth, samples, vars_to_write, fname, scales.at(Iscale));
             add_attr_to_file("kernel_alpha", kern_alpha, fname);
+        } else {
+            snprintf(fname, 50, "filter_%.6gkm.nc", scales.at(Iscale)/1e3);
+            if (write_fields) {
+                initialize_output_file( source_data, vars_to_write, fname, scales.at(Iscale));
+
+                // Add some attributes to the file
+                add_attr_to_file("kernel_alpha", kern_alpha, fname);
+            }
         }
 
         #if DEBUG >= 0
@@ -373,6 +439,22 @@ void filtering(
         scale = scales.at(Iscale);
         perc  = perc_base;
 
+        if (constants::USE_SEPARABLE_KERNEL) {
+            if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+            apply_separable_filter( sep_filtered_ptrs, filter_fields, source_data, scale );
+            if (constants::COMP_TRANSFERS) {
+                apply_separable_filter( sep_quadratics_ptrs, quadratic_field_ptrs, source_data, scale );
+            }
+            if (constants::COMP_BC_TRANSFERS) {
+                apply_separable_filter( sep_tilde_ptrs, tilde_field_ptrs, source_data, scale, &full_rho );
+            }
+            if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "separable_filter"); }
+        } else if (offset_kernel_ptr != NULL) {
+            if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+            offset_kernel.build( source_data, scale );
+            if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "kernel_precomputation_offsets"); }
+        }
+
         #if DEBUG >= 1
         if (wRank == 0) { fprintf(stdout, "  filtering: "); }
         fflush(stdout);
@@ -380,10 +462,11 @@ void filtering(
 
         #pragma omp parallel \
         default(none) \
-        shared( source_data, mask, u_x, u_y, u_z, stdout, \
+        shared( source_data, mask, u_x, u_y, u_z, stdout, samples, \
                 filter_fields, filt_use_mask, \
                 timing_records, clock_on, \
-                longitude, latitude, scale,\
+                longitude, latitude, scale, geometry, offset_kernel_ptr, \
+                sep_filtered, sep_quadratics, sep_tilde, \
                 full_KE, filtered_KE, fine_KE, \
                 full_u_r, full_u_lon, full_u_lat, full_vort_r, \
                 coarse_u_r, coarse_u_lon, coarse_u_lat,\
@@ -409,7 +492,7 @@ void filtering(
                 dl_filter_vals, dll_filter_vals, dl_kernel_val, dll_kernel_val, \
                 null_vector, null_ptr_vector ) \
         firstprivate(perc, wRank, local_kernel, local_dl_kernel, local_dll_kernel, \
-                     perc_count, Nlon, Nlat, Ndepth, Ntime )
+                     perc_count, Nlon, Nlat, Ndepth, Ntime, subset_outputs )
         {
 
             tid = omp_get_thread_num();
@@ -464,14 +547,15 @@ void filtering(
 
                 // If our longitude grid is uniform, and spans the full periodic domain,
                 // then we can just compute it once and translate it at each lon index
-                if ( (constants::PERIODIC_X) and (constants::UNIFORM_LON_GRID) and (constants::FULL_LON_SPAN) ) {
+                if (     (constants::PERIODIC_X) and (constants::UNIFORM_LON_GRID) and (constants::FULL_LON_SPAN) 
+                     and not(constants::USE_SEPARABLE_KERNEL) ) {
                     //#if DEBUG >= 3
                     //if (wRank == 0) { fprintf(stdout, "  computing local kernel ... "); }
                     //#endif
                     if ( (constants::DO_TIMING) and (tid == 0) ) { clock_on = MPI_Wtime(); }
                     std::fill(local_kernel.begin(), local_kernel.end(), 0);
                     compute_local_kernel( local_kernel, local_dl_kernel, local_dll_kernel, 
-                            scale, source_data, Ilat, 0, LAT_lb, LAT_ub );
+                            scale, source_data, Ilat, 0, LAT_lb, LAT_ub, offset_kernel_ptr );
                     if ( (constants::DO_TIMING) and (tid == 0) ) { timing_records.add_to_record(MPI_Wtime() - clock_on, "kernel_precomputation_outer"); }
                     //#if DEBUG >= 3
                     //if (wRank == 0) { fprintf(stdout, "  done\n"); }
@@ -498,13 +582,15 @@ void filtering(
                     }
                     #endif
 
+                    if ( subset_outputs and not(samples.needed_points[Ilat * Nlon + Ilon]) ) { continue; }
 
                     if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
-                    if ( not( (constants::PERIODIC_X) and (constants::UNIFORM_LON_GRID) and (constants::FULL_LON_SPAN) ) ) {
+                    if (     not( (constants::PERIODIC_X) and (constants::UNIFORM_LON_GRID) and (constants::FULL_LON_SPAN) ) 
+                         and not(constants::USE_SEPARABLE_KERNEL) ) {
                         // If we couldn't precompute the kernel earlier, then do it now
                         std::fill(local_kernel.begin(), local_kernel.end(), 0);
                         compute_local_kernel( local_kernel, local_dl_kernel, local_dll_kernel,
-                                scale, source_data, Ilat, Ilon, LAT_lb, LAT_ub );
+                                scale, source_data, Ilat, Ilon, LAT_lb, LAT_ub, offset_kernel_ptr );
                         if ( (constants::DO_TIMING) and (tid == 0) ) { timing_records.add_to_record(MPI_Wtime() - clock_on, "kernel_precomputation_inner"); }
                     }
 
@@ -519,18 +605,22 @@ void filtering(
                                 // Apply the filter at the point
                                 if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
 
-                                apply_filter_at_point(  
-                                        filtered_vals, dl_filter_vals, dll_filter_vals,
-                                        dl_kernel_val, dll_kernel_val, 
-                                        filter_fields, source_data, Itime, Idepth, Ilat, Ilon,
-                                        LAT_lb, LAT_ub, scale, filt_use_mask, 
-                                        local_kernel, local_dl_kernel, local_dll_kernel );
+                                if (constants::USE_SEPARABLE_KERNEL) {
+                                    for (size_t II = 0; II < filtered_vals.size(); II++) { *(filtered_vals[II]) = sep_filtered[II][index]; }
+                                } else {
+                                    apply_filter_at_point(  
+                                            filtered_vals, dl_filter_vals, dll_filter_vals,
+                                            dl_kernel_val, dll_kernel_val, 
+                                            filter_fields, source_data, Itime, Idepth, Ilat, Ilon,
+                                            LAT_lb, LAT_ub, scale, filt_use_mask, 
+                                            local_kernel, local_dl_kernel, local_dll_kernel );
+                                }
 
                                 // Convert the filtered fields back to spherical
                                 vel_Cart_to_Spher_at_point(
                                         u_r_tmp, u_lon_tmp, u_lat_tmp,
                                         u_x_tmp, u_y_tmp,   u_z_tmp,
-                                        longitude.at(Ilon), latitude.at(Ilat));
+                                        geometry.cos_lon[Ilon], geometry.sin_lon[Ilon], geometry.cos_lat[Ilat], geometry.sin_lat[Ilat]);
 
                                 coarse_u_r.at(  index) = u_r_tmp;
                                 coarse_u_lon.at(index) = u_lon_tmp;
@@ -551,16 +641,28 @@ void filtering(
                                 if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
                                 if (constants::COMP_TRANSFERS) {
 
-                                    apply_filter_at_point_for_quadratics(
-                                            uxux_tmp, uxuy_tmp, uxuz_tmp, uyuy_tmp, uyuz_tmp, uzuz_tmp, vort_ux_tmp, vort_uy_tmp, vort_uz_tmp,
-                                            u_x, u_y, u_z, full_vort_r, source_data, Itime, Idepth, Ilat, Ilon, LAT_lb, LAT_ub, scale, local_kernel);
+                                    if (constants::USE_SEPARABLE_KERNEL) {
+                                        uxux_tmp = sep_quadratics[0][index];
+                                        uxuy_tmp = sep_quadratics[1][index];
+                                        uxuz_tmp = sep_quadratics[2][index];
+                                        uyuy_tmp = sep_quadratics[3][index];
+                                        uyuz_tmp = sep_quadratics[4][index];
+                                        uzuz_tmp = sep_quadratics[5][index];
+                                        vort_ux_tmp = sep_quadratics[6][index];
+                                        vort_uy_tmp = sep_quadratics[7][index];
+                                        vort_uz_tmp = sep_quadratics[8][index];
+                                    } else {
+                                        apply_filter_at_point_for_quadratics(
+                                                uxux_tmp, uxuy_tmp, uxuz_tmp, uyuy_tmp, uyuz_tmp, uzuz_tmp, vort_ux_tmp, vort_uy_tmp, vort_uz_tmp,
+                                                u_x, u_y, u_z, full_vort_r, source_data, Itime, Idepth, Ilat, Ilon, LAT_lb, LAT_ub, scale, local_kernel);
+                                    }
 
                                     vel_Spher_to_Cart_at_point(
                                             u_x_tmp, u_y_tmp, u_z_tmp,
                                             coarse_u_r.at(index), 
                                             coarse_u_lon.at(index),  
                                             coarse_u_lat.at(index),
-                                            longitude.at(Ilon), latitude.at(Ilat));
+                                            geometry.cos_lon[Ilon], geometry.sin_lon[Ilon], geometry.cos_lat[Ilat], geometry.sin_lat[Ilat]);
 
                                     coarse_uxux.at(index) = uxux_tmp;
                                     coarse_uxuy.at(index) = uxuy_tmp;
@@ -609,17 +711,23 @@ void filtering(
                                     //
                                     // If we have rho, then also compute tilde fields
                                     //
-                                    apply_filter_at_point(  
-                                            tilde_vals, null_ptr_vector, null_ptr_vector, 
-                                            dl_kernel_val, dll_kernel_val, 
-                                            filter_fields, source_data, Itime, Idepth, Ilat, Ilon,
-                                            LAT_lb, LAT_ub, scale, filt_use_mask, 
-                                            local_kernel, null_vector, null_vector, &full_rho );
+                                    if (constants::USE_SEPARABLE_KERNEL) {
+                                        u_x_tilde = sep_tilde[0][index];
+                                        u_y_tilde = sep_tilde[1][index];
+                                        u_z_tilde = sep_tilde[2][index];
+                                    } else {
+                                        apply_filter_at_point(  
+                                                tilde_vals, null_ptr_vector, null_ptr_vector, 
+                                                dl_kernel_val, dll_kernel_val, 
+                                                filter_fields, source_data, Itime, Idepth, Ilat, Ilon,
+                                                LAT_lb, LAT_ub, scale, filt_use_mask, 
+                                                local_kernel, null_vector, null_vector, &full_rho );
+                                    }
 
                                     vel_Cart_to_Spher_at_point(
                                             u_r_tmp,    u_lon_tmp, u_lat_tmp,
                                             u_x_tilde,  u_y_tilde, u_z_tilde,
-                                            longitude.at(Ilon), latitude.at(Ilat));
+                                            geometry.cos_lon[Ilon], geometry.sin_lon[Ilon], geometry.cos_lat[Ilat], geometry.sin_lat[Ilat]);
 
                                     tilde_u_r.at(  index) = u_r_tmp   / rho_tmp;
                                     tilde_u_lon.at(index) = u_lon_tmp / rho_tmp;
@@ -654,21 +762,38 @@ void filtering(
 
         // Write to file
         if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+        output_batch vel_outputs( fname, starts, counts );
         if (not(constants::MINIMAL_OUTPUT)) {
-            write_field_to_output(coarse_u_r,   "coarse_u_r",   starts, counts, fname, &mask);
-            write_field_to_output(fine_u_r,     "fine_u_r",     starts, counts, fname, &mask);
-            write_field_to_output(filtered_KE,  "filtered_KE",  starts, counts, fname, &mask);
+            vel_outputs.add(coarse_u_r,   "coarse_u_r",   &mask);
+            vel_outputs.add(fine_u_r,     "fine_u_r",     &mask);
+            vel_outputs.add(filtered_KE,  "filtered_KE",  &mask);
         }
-        if (not(constants::NO_FULL_OUTPUTS)) {
-            write_field_to_output(coarse_u_lon,       "coarse_u_lon", starts, counts, fname, &mask);
-            write_field_to_output(coarse_u_lat,       "coarse_u_lat", starts, counts, fname, &mask);
-            write_field_to_output(KE_from_coarse_vel, "coarse_KE",    starts, counts, fname, &mask);
+        if (write_fields) {
+            vel_outputs.add(coarse_u_lon,       "coarse_u_lon", &mask);
+            vel_outputs.add(coarse_u_lat,       "coarse_u_lat", &mask);
+            vel_outputs.add(KE_from_coarse_vel, "coarse_KE",    &mask);
 
-            write_field_to_output(fine_u_lon,   "fine_u_lon",   starts, counts, fname, &mask);
-            write_field_to_output(fine_u_lat,   "fine_u_lat",   starts, counts, fname, &mask);
+            vel_outputs.add(fine_u_lon,   "fine_u_lon",   &mask);
+            vel_outputs.add(fine_u_lat,   "fine_u_lat",   &mask);
         }
+        vel_outputs.write();
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "writing"); }
 
+        // Compute the coarse velocity gradient once, and share it between
+        //    vorticity, Pi, and div(J). Vorticity always goes through the cache,
+        //    so that its values do not depend on whether transfers are computed.
+        velocity_gradient_cache vel_grad;
+        if (constants::COMP_VORT or constants::COMP_TRANSFERS) {
+            if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+            const std::vector<const std::vector<double>*> coarse_products 
+                { &coarse_uxux, &coarse_uxuy, &coarse_uxuz, &coarse_uyuy, &coarse_uyuz, &coarse_uzuz };
+            vel_grad.build( source_data, coarse_u_x, coarse_u_y, coarse_u_z,
+                            (source_data.use_depth_derivatives or not(constants::COMP_TRANSFERS)) ? NULL : &coarse_products );
+            if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute velocity gradient"); }
+        }
+        const velocity_gradient_cache * coarse_vel_grad = 
+            (constants::COMP_VORT or constants::COMP_TRANSFERS) ? &vel_grad : NULL;
+
         if (constants::COMP_VORT) {
             // Compute and write vorticity
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
@@ -685,19 +810,21 @@ void filtering(
 
             compute_vorticity(coarse_vort_r, coarse_vort_lon, coarse_vort_lat, div, OkuboWeiss,
                     null_vector, null_vector, null_vector, null_vector,
-                    source_data, coarse_u_r, coarse_u_lon, coarse_u_lat );
+                    source_data, coarse_u_r, coarse_u_lon, coarse_u_lat, coarse_vel_grad );
 
             if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_vorticity"); }
 
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+            output_batch vort_outputs( fname, starts, counts );
             if (not(constants::MINIMAL_OUTPUT)) {
-                write_field_to_output(fine_vort_r, "fine_vort_r", starts, counts, fname, &mask);
-                write_field_to_output(div, "coarse_vel_div", starts, counts, fname, &mask);
+                vort_outputs.add(fine_vort_r, "fine_vort_r", &mask);
+                vort_outputs.add(div, "coarse_vel_div", &mask);
             }
-            if (not(constants::NO_FULL_OUTPUTS)) {
-                write_field_to_output(coarse_vort_r, "coarse_vort_r", starts, counts, fname, &mask);
-                write_field_to_output(OkuboWeiss, "OkuboWeiss", starts, counts, fname, &mask);
+            if (write_fields) {
+                vort_outputs.add(coarse_vort_r, "coarse_vort_r", &mask);
+                vort_outputs.add(OkuboWeiss, "OkuboWeiss", &mask);
             }
+            vort_outputs.write();
             if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "writing"); }
         }
 
@@ -709,16 +836,19 @@ void filtering(
             fflush(stdout);
             #endif
             compute_Pi( energy_transfer, source_data, coarse_u_x,  coarse_u_y,  coarse_u_z, 
-                        coarse_uxux, coarse_uxuy, coarse_uxuz, coarse_uyuy, coarse_uyuz, coarse_uzuz );
+                        coarse_uxux, coarse_uxuy, coarse_uxuz, coarse_uyuy, coarse_uyuz, coarse_uzuz,
+                        NULL, NULL, NULL, coarse_vel_grad );
             compute_Z(  enstrophy_transfer, source_data, coarse_u_x,  coarse_u_y,  coarse_u_z, coarse_vort_r, 
                         coarse_vort_ux, coarse_vort_uy, coarse_vort_uz );
             if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_Pi_and_Z"); }
 
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
-            if (not(constants::NO_FULL_OUTPUTS)) {
-                write_field_to_output(energy_transfer, "Pi", starts, counts, fname, &mask);
-                write_field_to_output(enstrophy_transfer, "Z", starts, counts, fname, &mask);
-                write_field_to_output(fine_KE, "fine_KE", starts, counts, fname, &mask);
+            if (write_fields) {
+                output_batch transfer_outputs( fname, starts, counts );
+                transfer_outputs.add(energy_transfer, "Pi", &mask);
+                transfer_outputs.add(enstrophy_transfer, "Z", &mask);
+                transfer_outputs.add(fine_KE, "fine_KE", &mask);
+                transfer_outputs.write();
             }
             if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "writing"); }
         }
@@ -737,16 +867,18 @@ void filtering(
             if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_Lambda"); }
 
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
-            if (not(constants::NO_FULL_OUTPUTS)) {
-                write_field_to_output(PEtoKE,        "PEtoKE",            starts, counts, fname, &mask);
-                write_field_to_output(coarse_rho,    "coarse_rho",        starts, counts, fname, &mask);
-                write_field_to_output(coarse_p,      "coarse_p",          starts, counts, fname, &mask);
-                write_field_to_output(tilde_vort_r,  "tilde_vort_p",      starts, counts, fname, &mask);
+            output_batch BC_outputs( fname, starts, counts );
+            if (write_fields) {
+                BC_outputs.add(PEtoKE,        "PEtoKE",            &mask);
+                BC_outputs.add(coarse_rho,    "coarse_rho",        &mask);
+                BC_outputs.add(coarse_p,      "coarse_p",          &mask);
+                BC_outputs.add(tilde_vort_r,  "tilde_vort_p",      &mask);
             }
             if (not(constants::MINIMAL_OUTPUT)) {
-                write_field_to_output(fine_rho, "fine_rho", starts, counts, fname, &mask);
-                write_field_to_output(fine_p,   "fine_p",   starts, counts, fname, &mask);
+                BC_outputs.add(fine_rho, "fine_rho", &mask);
+                BC_outputs.add(fine_p,   "fine_p",   &mask);
             }
+            BC_outputs.write();
             if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "writing"); }
         }
 
@@ -760,7 +892,7 @@ void filtering(
                 coarse_u_x,  coarse_u_y,  coarse_u_z,
                 coarse_uxux, coarse_uxuy, coarse_uxuz,
                 coarse_uyuy, coarse_uyuz, coarse_uzuz,
-                coarse_p);
+                coarse_p, coarse_vel_grad);
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_transport"); }
 
         if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
@@ -773,7 +905,7 @@ void filtering(
         //// on-line postprocessing, if desired
         //
 
-        if (constants::APPLY_POSTPROCESS) {
+        if ( (constants::APPLY_POSTPROCESS) and not(subset_outputs) ) {
             MPI_Barrier(MPI_COMM_WORLD);
 
             if (wRank == 0) { fprintf(stdout, "Beginning post-process routines\n"); }
@@ -56,11 +56,23 @@ void filtering_helmholtz(
 
     const std::vector<int>  &myStarts = source_data.myStarts;
 
+    // With sample points, only the samples are written (see initialize_subset_file), so only
+    //   the grid points that they need are filtered, and the postprocessing is skipped
+    const point_samples & samples = source_data.samples;
+    const bool subset_outputs = not(samples.empty()),
+               write_fields   = subset_outputs or not(constants::NO_FULL_OUTPUTS);
+
     // Get some MPI info
     int wRank, wSize;
     MPI_Comm_rank( comm, &wRank );
     MPI_Comm_size( comm, &wSize );
 
+    #if DEBUG >= 0
+    if ( (subset_outputs) and (constants::APPLY_POSTPROCESS) and (wRank == 0) ) {
+        fprintf(stdout, "Only writing sampled (subset) outputs, so the on-line postprocessing is skipped.\n");
+    }
+    #endif
+
     #if DEBUG >= 2
     if (wRank == 0) { fprintf(stdout, "\nEntered filtering_helmholtz\n\n"); }
     #endif
@@ -411,7 +423,7 @@ void filtering_helmholtz(
     #if DEBUG >= 2
     if (wRank == 0) { fprintf(stdout, "\nFlagging variables for output\n"); }
     #endif
-    if (not(constants::NO_FULL_OUTPUTS)) {
+    if (write_fields) {
         //
         // These variables are output unless full outputs are turned off
         // 
@@ -721,12 +733,18 @@ void filtering_helmholtz(
         timing_records.reset();
 
         // Create the output file
-        snprintf(fname, 50, "filter_%.6gkm.nc", scales.at(Iscale)/1e3);
-        if (not(constants::NO_FULL_OUTPUTS)) {
-            initialize_output_file( source_data, vars_to_write, fname, scales.at(Iscale));
-
-            // Add some attributes to the file
+        if (subset_outputs) {
+            snprintf(fname, 50, "subset_%.6gkm.nc", scales.at(Iscale)/1e3);
+            initialize_subset_file( source_data.time, source_data.depth, samples, vars_to_write, fname, scales.at(Iscale));
             add_attr_to_file("kernel_alpha", kern_alpha, fname);
+        } else {
+            snprintf(fname, 50, "filter_%.6gkm.nc", scales.at(Iscale)/1e3);
+            if (write_fields) {
+                initialize_output_file( source_data, vars_to_write, fname, scales.at(Iscale));
+
+                // Add some attributes to the file
+                add_attr_to_file("kernel_alpha", kern_alpha, fname);
+            }
         }
 
         #if DEBUG >= 0
@@ -746,7 +764,7 @@ void filtering_helmholtz(
 
         #pragma omp parallel \
         default(none) \
-        shared( source_data, mask, stdout, perc_base, \
+        shared( source_data, mask, stdout, perc_base, samples, \
                 filter_fields, filt_use_mask, \
                 timing_records, clock_on, \
                 longitude, latitude, scale, \
@@ -775,7 +793,7 @@ void filtering_helmholtz(
                 dl_Psi_tmp, dll_Psi_tmp, dl_Phi_tmp, dll_Phi_tmp, dl_ur_tmp, dll_ur_tmp, \
                 wind_tau_Psi_tmp, wind_tau_Phi_tmp, tau_wind_dot_u_tor_tmp, tau_wind_dot_u_pot_tmp ) \
         firstprivate(perc, wRank, local_kernel, local_dl_kernel, local_dll_kernel, \
-                perc_count, Nlon, Nlat, Ndepth, Ntime )
+                perc_count, Nlon, Nlat, Ndepth, Ntime, subset_outputs )
         {
 
             filtered_vals.clear();
@@ -853,6 +871,8 @@ void filtering_helmholtz(
                 Ilon = Ilatlon % Nlon;
                 Ilat = Ilatlon / Nlon;
 
+                if ( subset_outputs and not(samples.needed_points[Ilatlon]) ) { continue; }
+
                 get_lat_bounds(LAT_lb, LAT_ub, latitude,  Ilat, scale); 
 
                 // If our longitude grid is uniform, and spans the full periodic domain,
@@ -1037,7 +1057,7 @@ void filtering_helmholtz(
         #endif
 
         // Write to file
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             // Don't mask these fields, since they are filled over land from the projection
             write_field_to_output(coarse_F_tor, "coarse_F_tor", starts, counts, fname, NULL);
@@ -1078,7 +1098,7 @@ void filtering_helmholtz(
         vel_Spher_to_Cart( u_x_tot_coarse, u_y_tot_coarse, u_z_tot_coarse, u_r_coarse, u_lon_tot, u_lat_tot, source_data );
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "Sphere to Cart Conversion"); }
 
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             write_field_to_output(u_lon_tor, "u_lon_tor", starts, counts, fname, &mask);
             write_field_to_output(u_lat_tor, "u_lat_tor", starts, counts, fname, &mask);
@@ -1103,7 +1123,7 @@ void filtering_helmholtz(
                 dll_coarse_Phi, dll_coarse_Psi,
                 source_data, scale
                 );
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
 
             write_field_to_output( u_spectrum_tot, "u_spectrum_tot", starts, counts, fname, &mask);
@@ -1135,61 +1155,59 @@ void filtering_helmholtz(
             }
         }
 
-        // compute_vorticity gives vorticity, divergence, and OkuboWeiss
-        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
-        compute_vorticity(
-                vort_tor_r, null_vector, null_vector, div_tor, OkuboWeiss_tor, 
-                null_vector, null_vector, null_vector, null_vector,
-                source_data, zero_array, u_lon_tor, u_lat_tor);
-
-        compute_vorticity(
-                vort_pot_r, null_vector, null_vector, div_pot, OkuboWeiss_pot,
-                null_vector, null_vector, null_vector, null_vector,
-                source_data, u_r_coarse, u_lon_pot, u_lat_pot);
-
-        compute_vorticity(
-                vort_tot_r, null_vector, null_vector, div_tot, OkuboWeiss_tot,
-                null_vector, null_vector, null_vector, null_vector,
-                source_data, u_r_coarse, u_lon_tot, u_lat_tot);
-        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute vorticity"); }
-
-        if (not(constants::MINIMAL_OUTPUT)) {
-            if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
-            write_field_to_output(div_tor, "div_tor", starts, counts, fname, &mask);
-            write_field_to_output(div_pot, "div_pot", starts, counts, fname, &mask);
-            write_field_to_output(div_tot, "div_tot", starts, counts, fname, &mask);
-
-            if (constants::DO_OKUBOWEISS_ANALYSIS) {
-                write_field_to_output(OkuboWeiss_tor, "OkuboWeiss_tor", starts, counts, fname, &mask);
-                write_field_to_output(OkuboWeiss_pot, "OkuboWeiss_pot", starts, counts, fname, &mask);
-                write_field_to_output(OkuboWeiss_tot, "OkuboWeiss_tot", starts, counts, fname, &mask);
-            }
-            if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "writing");  }
-        }
+        // If we need depth derivatives, we'll need to communicated across MPI
+        //    ranks in order to rebuild the depth profile. We'll do that here.
+        const bool merge_depth = source_data.use_depth_derivatives and ( source_data.Nprocs_in_depth > 1 );
+        std::vector<double> u_x_coarse_DEPTH, u_y_coarse_DEPTH, u_z_coarse_DEPTH,
+                            ux_ux_DEPTH, ux_uy_DEPTH, ux_uz_DEPTH, uy_uy_DEPTH, uy_uz_DEPTH, uz_uz_DEPTH,
+                            vort_r_DEPTH, vort_ux_DEPTH, vort_uy_DEPTH, vort_uz_DEPTH;
 
+        // The velocity gradient for each component is computed once, and then shared between
+        //    the diagnostics (including the cross-term Pi that use that component's strain).
+        //    The product derivatives are also stored for div(J), unless it is merged across depth.
+        velocity_gradient_cache vel_grad;
+        std::vector<const std::vector<double>*> coarse_products;
 
         //
         //// Toroidal diagnostics
         //
 
-        // If we need depth derivatives, we'll need to communicated across MPI
-        //    ranks in order to rebuild the depth profile. We'll do that here.
-        std::vector<double> u_x_coarse_DEPTH, u_y_coarse_DEPTH, u_z_coarse_DEPTH,
-                            ux_ux_DEPTH, ux_uy_DEPTH, ux_uz_DEPTH, uy_uy_DEPTH, uy_uz_DEPTH, uz_uz_DEPTH,
-                            vort_r_DEPTH, vort_ux_DEPTH, vort_uy_DEPTH, vort_uz_DEPTH;
+        // Velocity gradient (shared by vorticity, Pi, and div(J))
+        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+        coarse_products = { &ux_ux_tor, &ux_uy_tor, &ux_uz_tor, &uy_uy_tor, &uy_uz_tor, &uz_uz_tor };
+        vel_grad.build( source_data, u_x_tor_coarse, u_y_tor_coarse, u_z_tor_coarse,
+                        merge_depth ? NULL : &coarse_products );
+        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute velocity gradient"); }
+
+        // compute_vorticity gives vorticity, divergence, and OkuboWeiss
+        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+        compute_vorticity(
+                vort_tor_r, null_vector, null_vector, div_tor, OkuboWeiss_tor, 
+                null_vector, null_vector, null_vector, null_vector,
+                source_data, zero_array, u_lon_tor, u_lat_tor, &vel_grad);
+        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute vorticity"); }
 
         if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             // Energy cascade (Pi)
             compute_Pi( Pi_tor, source_data, u_x_tor_coarse, u_y_tor_coarse, u_z_tor_coarse, 
-                        ux_ux_tor, ux_uy_tor, ux_uz_tor, uy_uy_tor, uy_uz_tor, uz_uz_tor );
+                        ux_ux_tor, ux_uy_tor, ux_uz_tor, uy_uy_tor, uy_uz_tor, uz_uz_tor,
+                        NULL, NULL, NULL, &vel_grad );
 
             // Enstrophy cascade (Z)
             compute_Z(  Z_tor, source_data, u_x_tor_coarse, u_y_tor_coarse, u_z_tor_coarse, 
                         vort_tor_r, vort_ux_tor, vort_uy_tor, vort_uz_tor );
+
+            // Cross-term Pi [these should now give all combinations, when mixed appropriated]
+            compute_Pi( Pi_VDD, source_data, u_x_tor_coarse, u_y_tor_coarse, u_z_tor_coarse, 
+                    ux_ux_pot, ux_uy_pot, ux_uz_pot, uy_uy_pot, uy_uz_pot, uz_uz_pot,
+                    &u_x_pot_coarse, &u_y_pot_coarse, &u_z_pot_coarse, &vel_grad );
+            compute_Pi( Pi_VTT, source_data, u_x_tor_coarse, u_y_tor_coarse, u_z_tor_coarse, 
+                    ux_ux_tot, ux_uy_tot, ux_uz_tot, uy_uy_tot, uy_uz_tot, uz_uz_tot,
+                    &u_x_tot_coarse, &u_y_tot_coarse, &u_z_tot_coarse, &vel_grad );
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_Pi_and_Z"); }
 
         // Energy transport
-        if (source_data.use_depth_derivatives and ( source_data.Nprocs_in_depth > 1 )) {
+        if ( merge_depth ) {
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             MPI_Barrier(source_data.MPI_subcomm_sametimes);
             source_data.gather_variable_across_depth( u_x_tor_coarse, u_x_coarse_DEPTH );
@@ -1206,14 +1224,14 @@ void filtering_helmholtz(
             if (wRank == 0) { fprintf( stdout, "Merged variables across depth.\n" ); fflush(stdout); }
         }
         if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
-            if (source_data.use_depth_derivatives and ( source_data.Nprocs_in_depth > 1 )) {
+            if ( merge_depth ) {
                 compute_div_transport( div_J_tor, source_data, u_x_coarse_DEPTH, u_y_coarse_DEPTH, u_z_coarse_DEPTH, 
                                        ux_ux_DEPTH, ux_uy_DEPTH, ux_uz_DEPTH, uy_uy_DEPTH, uy_uz_DEPTH, uz_uz_DEPTH, 
                                        zero_array);
             } else {
                 compute_div_transport( div_J_tor, source_data, u_x_tor_coarse, u_y_tor_coarse, u_z_tor_coarse, 
                                        ux_ux_tor, ux_uy_tor, ux_uz_tor, uy_uy_tor, uy_uz_tor, uz_uz_tor, 
-                                       zero_array);
+                                       zero_array, &vel_grad);
             }
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_transport"); }
 
@@ -1221,18 +1239,42 @@ void filtering_helmholtz(
         //// Potential diagnostics
         //
 
+        // Velocity gradient (shared by vorticity, Pi, and div(J))
+        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+        coarse_products = { &ux_ux_pot, &ux_uy_pot, &ux_uz_pot, &uy_uy_pot, &uy_uz_pot, &uz_uz_pot };
+        vel_grad.build( source_data, u_x_pot_coarse, u_y_pot_coarse, u_z_pot_coarse,
+                        merge_depth ? NULL : &coarse_products );
+        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute velocity gradient"); }
+
+        // compute_vorticity gives vorticity, divergence, and OkuboWeiss
+        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+        compute_vorticity(
+                vort_pot_r, null_vector, null_vector, div_pot, OkuboWeiss_pot, 
+                null_vector, null_vector, null_vector, null_vector,
+                source_data, u_r_coarse, u_lon_pot, u_lat_pot, &vel_grad);
+        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute vorticity"); }
+
         if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             // Energy cascade (Pi)
             compute_Pi( Pi_pot, source_data, u_x_pot_coarse, u_y_pot_coarse, u_z_pot_coarse, 
-                        ux_ux_pot, ux_uy_pot, ux_uz_pot, uy_uy_pot, uy_uz_pot, uz_uz_pot );
+                        ux_ux_pot, ux_uy_pot, ux_uz_pot, uy_uy_pot, uy_uz_pot, uz_uz_pot,
+                        NULL, NULL, NULL, &vel_grad );
 
             // Enstrophy cascade (Z)
             compute_Z(  Z_pot, source_data, u_x_pot_coarse, u_y_pot_coarse, u_z_pot_coarse, 
                         vort_pot_r, vort_ux_pot, vort_uy_pot, vort_uz_pot );
+
+            // Cross-term Pi [these should now give all combinations, when mixed appropriated]
+            compute_Pi( Pi_DVV, source_data, u_x_pot_coarse, u_y_pot_coarse, u_z_pot_coarse, 
+                    ux_ux_tor, ux_uy_tor, ux_uz_tor, uy_uy_tor, uy_uz_tor, uz_uz_tor,
+                    &u_x_tor_coarse, &u_y_tor_coarse, &u_z_tor_coarse, &vel_grad );
+            compute_Pi( Pi_DTT, source_data, u_x_pot_coarse, u_y_pot_coarse, u_z_pot_coarse, 
+                    ux_ux_tot, ux_uy_tot, ux_uz_tot, uy_uy_tot, uy_uz_tot, uz_uz_tot,
+                    &u_x_tot_coarse, &u_y_tot_coarse, &u_z_tot_coarse, &vel_grad );
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_Pi_and_Z"); }
 
         // Energy transport
-        if (source_data.use_depth_derivatives and ( source_data.Nprocs_in_depth > 1 )) {
+        if ( merge_depth ) {
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             MPI_Barrier(source_data.MPI_subcomm_sametimes);
             source_data.gather_variable_across_depth( u_x_pot_coarse, u_x_coarse_DEPTH );
@@ -1248,14 +1290,14 @@ void filtering_helmholtz(
             if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "MPI_COMM_depth_merging"); }
         }
         if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
-            if (source_data.use_depth_derivatives and ( source_data.Nprocs_in_depth > 1 )) {
+            if ( merge_depth ) {
                 compute_div_transport( div_J_pot, source_data, u_x_coarse_DEPTH, u_y_coarse_DEPTH, u_z_coarse_DEPTH, 
                                        ux_ux_DEPTH, ux_uy_DEPTH, ux_uz_DEPTH, uy_uy_DEPTH, uy_uz_DEPTH, uz_uz_DEPTH, 
                                        zero_array);
             } else {
                 compute_div_transport( div_J_pot, source_data, u_x_pot_coarse, u_y_pot_coarse, u_z_pot_coarse, 
                                        ux_ux_pot, ux_uy_pot, ux_uz_pot, uy_uy_pot, uy_uz_pot, uz_uz_pot, 
-                                       zero_array);
+                                       zero_array, &vel_grad);
             }
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_transport"); }
 
@@ -1263,10 +1305,26 @@ void filtering_helmholtz(
         //// Total velocity diagnostics
         //
 
+        // Velocity gradient (shared by vorticity, Pi, and div(J))
+        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+        coarse_products = { &ux_ux_tot, &ux_uy_tot, &ux_uz_tot, &uy_uy_tot, &uy_uz_tot, &uz_uz_tot };
+        vel_grad.build( source_data, u_x_tot_coarse, u_y_tot_coarse, u_z_tot_coarse,
+                        merge_depth ? NULL : &coarse_products );
+        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute velocity gradient"); }
+
+        // compute_vorticity gives vorticity, divergence, and OkuboWeiss
+        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+        compute_vorticity(
+                vort_tot_r, null_vector, null_vector, div_tot, OkuboWeiss_tot, 
+                null_vector, null_vector, null_vector, null_vector,
+                source_data, u_r_coarse, u_lon_tot, u_lat_tot, &vel_grad);
+        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute vorticity"); }
+
         if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             // Energy cascade (Pi)
             compute_Pi( Pi_tot, source_data, u_x_tot_coarse, u_y_tot_coarse, u_z_tot_coarse, 
-                        ux_ux_tot, ux_uy_tot, ux_uz_tot, uy_uy_tot, uy_uz_tot, uz_uz_tot );
+                        ux_ux_tot, ux_uy_tot, ux_uz_tot, uy_uy_tot, uy_uz_tot, uz_uz_tot,
+                        NULL, NULL, NULL, &vel_grad );
 
             // Enstrophy cascade (Z)
             compute_Z(  Z_tot, source_data, u_x_tot_coarse, u_y_tot_coarse, u_z_tot_coarse, 
@@ -1274,7 +1332,7 @@ void filtering_helmholtz(
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_Pi_and_Z"); }
 
         // Energy transport
-        if (source_data.use_depth_derivatives and ( source_data.Nprocs_in_depth > 1 )) {
+        if ( merge_depth ) {
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             MPI_Barrier(source_data.MPI_subcomm_sametimes);
             source_data.gather_variable_across_depth( u_x_tot_coarse, u_x_coarse_DEPTH );
@@ -1290,36 +1348,30 @@ void filtering_helmholtz(
             if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "MPI_COMM_depth_merging"); }
         }
         if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
-            if (source_data.use_depth_derivatives and ( source_data.Nprocs_in_depth > 1 )) {
+            if ( merge_depth ) {
                 compute_div_transport( div_J_tot, source_data, u_x_coarse_DEPTH, u_y_coarse_DEPTH, u_z_coarse_DEPTH, 
                                        ux_ux_DEPTH, ux_uy_DEPTH, ux_uz_DEPTH, uy_uy_DEPTH, uy_uz_DEPTH, uz_uz_DEPTH, 
                                        zero_array);
             } else {
                 compute_div_transport( div_J_tot, source_data, u_x_tot_coarse, u_y_tot_coarse, u_z_tot_coarse, 
                                        ux_ux_tot, ux_uy_tot, ux_uz_tot, uy_uy_tot, uy_uz_tot, uz_uz_tot, 
-                                       zero_array);
+                                       zero_array, &vel_grad);
             }
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_transport"); }
 
-        //
-        //// Cross-term Pi [these should now give all combinations, when mixed appropriated]
-        //
+        if (not(constants::MINIMAL_OUTPUT)) {
+            if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+            write_field_to_output(div_tor, "div_tor", starts, counts, fname, &mask);
+            write_field_to_output(div_pot, "div_pot", starts, counts, fname, &mask);
+            write_field_to_output(div_tot, "div_tot", starts, counts, fname, &mask);
 
-        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
-        compute_Pi( Pi_DVV, source_data, u_x_pot_coarse, u_y_pot_coarse, u_z_pot_coarse, 
-                ux_ux_tor, ux_uy_tor, ux_uz_tor, uy_uy_tor, uy_uz_tor, uz_uz_tor,
-                &u_x_tor_coarse, &u_y_tor_coarse, &u_z_tor_coarse );
-        compute_Pi( Pi_DTT, source_data, u_x_pot_coarse, u_y_pot_coarse, u_z_pot_coarse, 
-                ux_ux_tot, ux_uy_tot, ux_uz_tot, uy_uy_tot, uy_uz_tot, uz_uz_tot,
-                &u_x_tot_coarse, &u_y_tot_coarse, &u_z_tot_coarse );
-
-        compute_Pi( Pi_VDD, source_data, u_x_tor_coarse, u_y_tor_coarse, u_z_tor_coarse, 
-                ux_ux_pot, ux_uy_pot, ux_uz_pot, uy_uy_pot, uy_uz_pot, uz_uz_pot,
-                &u_x_pot_coarse, &u_y_pot_coarse, &u_z_pot_coarse );
-        compute_Pi( Pi_VTT, source_data, u_x_tor_coarse, u_y_tor_coarse, u_z_tor_coarse, 
-                ux_ux_tot, ux_uy_tot, ux_uz_tot, uy_uy_tot, uy_uz_tot, uz_uz_tot,
-                &u_x_tot_coarse, &u_y_tot_coarse, &u_z_tot_coarse );
-        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute_Pi_and_Z"); }
+            if (constants::DO_OKUBOWEISS_ANALYSIS) {
+                write_field_to_output(OkuboWeiss_tor, "OkuboWeiss_tor", starts, counts, fname, &mask);
+                write_field_to_output(OkuboWeiss_pot, "OkuboWeiss_pot", starts, counts, fname, &mask);
+                write_field_to_output(OkuboWeiss_tot, "OkuboWeiss_tot", starts, counts, fname, &mask);
+            }
+            if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "writing");  }
+        }
 
 
         //
@@ -1330,7 +1382,7 @@ void filtering_helmholtz(
         }
 
         // Writing
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             write_field_to_output( Pi_tor, "Pi_tor", starts, counts, fname, &mask);
             write_field_to_output( Pi_pot, "Pi_pot", starts, counts, fname, &mask);
@@ -1380,7 +1432,7 @@ void filtering_helmholtz(
         }
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "compute KE and Enstrophy"); }
 
-        if (not(constants::NO_FULL_OUTPUTS)) {
+        if (write_fields) {
             if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
             write_field_to_output( KE_tor_filt, "KE_tor_filt", starts, counts, fname, &mask);
             write_field_to_output( KE_pot_filt, "KE_pot_filt", starts, counts, fname, &mask);
@@ -1442,7 +1494,7 @@ void filtering_helmholtz(
                 }
             }
 
-            if (not(constants::NO_FULL_OUTPUTS)) {
+            if (write_fields) {
                 if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
                 write_field_to_output( local_wind_forcing_tor, "local_wind_forcing_tor", starts, counts, fname, &mask);
                 write_field_to_output( local_wind_forcing_pot, "local_wind_forcing_pot", starts, counts, fname, &mask);
@@ -1457,7 +1509,7 @@ void filtering_helmholtz(
         //// on-line postprocessing, if desired
         //
 
-        if (constants::APPLY_POSTPROCESS) {
+        if ( (constants::APPLY_POSTPROCESS) and not(subset_outputs) ) {
             MPI_Barrier(MPI_COMM_WORLD);
 
             // If we're doing post-processing, then spectral slopes need to be scaled by
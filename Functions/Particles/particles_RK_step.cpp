@@ -0,0 +1,133 @@
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "../../constants.hpp"
+#include "../../functions.hpp"
+#include "../../particles.hpp"
+
+/*!
+ * \brief Take one Runge-Kutta step of a particle, with an estimate of the (local) error
+ *
+ * For RK45, this is the Dormand-Prince pair: the fifth-order solution is kept, and the difference with the
+ *  embedded fourth-order solution gives the error. The last stage is the slope at the end of the step,
+ *  so it is returned for use as the first stage of the next step (first same as last).
+ *
+ * For RK4, the step is taken once with dt, and again as two steps of dt/2 (step doubling). The latter is kept,
+ *  and the error is their difference divided by 15.
+ *
+ * @param[in,out]   lon_new, lat_new            position at the end of the step
+ * @param[in,out]   step_error                  estimated error (in metres) of the step
+ * @param[in,out]   dlon_dt_end, dlat_dt_end    slopes at the end of the step
+ * @param[in]       dlon_dt, dlat_dt            slopes at the start of the step
+ * @param[in]       t_part, dt                  particle time and step size
+ * @param[in]       lon0, lat0                  position at the start of the step
+ * @param[in]       integrator                  constants::ParticleIntegratorType::RK4 or RK45
+ * @param[in]       ref_ind                     current time index of the velocity fields
+ * @param[in]       vel_lon, vel_lat            velocity fields (m/s)
+ * @param[in]       time, lat, lon              grid
+ * @param[in]       mask                        land mask
+ *
+ * @returns false if the particle left the grid during the step, true otherwise
+ */
+bool particles_RK_step(
+        double & lon_new,
+        double & lat_new,
+        double & step_error,
+        double & dlon_dt_end,
+        double & dlat_dt_end,
+        const double dlon_dt,
+        const double dlat_dt,
+        const double t_part,
+        const double dt,
+        const double lon0,
+        const double lat0,
+        const int integrator,
+        const int ref_ind,
+        const std::vector<double> & vel_lon,
+        const std::vector<double> & vel_lat,
+        const std::vector<double> & time,
+        const std::vector<double> & lat,
+        const std::vector<double> & lon,
+        const std::vector<bool> & mask
+        ) {
+
+    auto slope = [&]( double & k_lon, double & k_lat, const double t, const double y_lon, const double y_lat ) {
+        return particles_velocity_at_point( k_lon, k_lat, t, y_lat, y_lon, ref_ind,
+                                            vel_lon, vel_lat, time, lat, lon, mask );
+    };
+
+    double err_lon, err_lat;
+
+    if (integrator == constants::ParticleIntegratorType::RK45) {
+
+        // Dormand-Prince coefficients
+        const double C[7] = { 0., 1./5, 3./10, 4./5, 8./9, 1., 1. };
+        const double A[7][6] = {
+            { 0., 0., 0., 0., 0., 0. },
+            { 1./5, 0., 0., 0., 0., 0. },
+            { 3./40, 9./40, 0., 0., 0., 0. },
+            { 44./45, -56./15, 32./9, 0., 0., 0. },
+            { 19372./6561, -25360./2187, 64448./6561, -212./729, 0., 0. },
+            { 9017./3168, -355./33, 46732./5247, 49./176, -5103./18656, 0. },
+            { 35./384, 0., 500./1113, 125./192, -2187./6784, 11./84 }
+        };
+        // Fifth-order weights (the last row of A) minus the embedded fourth-order weights
+        const double E[7] = { 71./57600, 0., -71./16695, 71./1920, -17253./339200, 22./525, -1./40 };
+
+        double k_lon[7], k_lat[7], y_lon, y_lat;
+        k_lon[0] = dlon_dt;
+        k_lat[0] = dlat_dt;
+        for (int Istage = 1; Istage < 7; Istage++) {
+            y_lon = lon0;
+            y_lat = lat0;
+            for (int Jstage = 0; Jstage < Istage; Jstage++) {
+                y_lon += dt * A[Istage][Jstage] * k_lon[Jstage];
+                y_lat += dt * A[Istage][Jstage] * k_lat[Jstage];
+            }
+            if ( not( slope( k_lon[Istage], k_lat[Istage], t_part + C[Istage] * dt, y_lon, y_lat ) ) ) { return false; }
+        }
+
+        lon_new = y_lon;
+        lat_new = y_lat;
+        dlon_dt_end = k_lon[6];
+        dlat_dt_end = k_lat[6];
+
+        err_lon = 0.;
+        err_lat = 0.;
+        for (int Istage = 0; Istage < 7; Istage++) {
+            err_lon += dt * E[Istage] * k_lon[Istage];
+            err_lat += dt * E[Istage] * k_lat[Istage];
+        }
+
+    } else {
+
+        // Classic RK4 step from (y_lon, y_lat), given the slope there
+        auto rk4 = [&]( double & y_lon, double & y_lat, const double t, const double h, 
+                        const double k1_lon, const double k1_lat ) {
+            double k2_lon, k2_lat, k3_lon, k3_lat, k4_lon, k4_lat;
+            if ( not( slope( k2_lon, k2_lat, t + 0.5 * h, y_lon + 0.5 * h * k1_lon, y_lat + 0.5 * h * k1_lat ) ) ) { return false; }
+            if ( not( slope( k3_lon, k3_lat, t + 0.5 * h, y_lon + 0.5 * h * k2_lon, y_lat + 0.5 * h * k2_lat ) ) ) { return false; }
+            if ( not( slope( k4_lon, k4_lat, t +       h, y_lon +       h * k3_lon, y_lat +       h * k3_lat ) ) ) { return false; }
+            y_lon += h * ( k1_lon + 2. * k2_lon + 2. * k3_lon + k4_lon ) / 6.;
+            y_lat += h * ( k1_lat + 2. * k2_lat + 2. * k3_lat + k4_lat ) / 6.;
+            return true;
+        };
+
+        double full_lon = lon0, full_lat = lat0, half_lon = lon0, half_lat = lat0, mid_lon, mid_lat;
+        if ( not( rk4( full_lon, full_lat, t_part, dt, dlon_dt, dlat_dt ) ) ) { return false; }
+        if ( not( rk4( half_lon, half_lat, t_part, 0.5 * dt, dlon_dt, dlat_dt ) ) ) { return false; }
+        if ( not( slope( mid_lon, mid_lat, t_part + 0.5 * dt, half_lon, half_lat ) ) ) { return false; }
+        if ( not( rk4( half_lon, half_lat, t_part + 0.5 * dt, 0.5 * dt, mid_lon, mid_lat ) ) ) { return false; }
+
+        lon_new = half_lon;
+        lat_new = half_lat;
+        if ( not( slope( dlon_dt_end, dlat_dt_end, t_part + dt, lon_new, lat_new ) ) ) { return false; }
+
+        err_lon = ( half_lon - full_lon ) / 15.;
+        err_lat = ( half_lat - full_lat ) / 15.;
+    }
+
+    step_error = constants::R_earth * sqrt( pow( err_lon * cos(lat0), 2 ) + pow( err_lat, 2 ) );
+
+    return true;
+}
@@ -7,6 +7,23 @@
 #include "../../functions.hpp"
 #include "../../particles.hpp"
 
+/*!
+ * \brief Advect particles through the (lon, lat) velocity fields, recording their positions (and tracked fields) at target_times
+ *
+ * The integrator is one of constants::ParticleIntegratorType:
+ *  - ForwardEuler : operator-split forward Euler (longitude, then latitude) with a fixed CFL of 1e-5
+ *  - RK4          : classic fourth-order Runge-Kutta, with the error from step doubling
+ *  - RK45         : Dormand-Prince fifth-order pair, with the embedded fourth-order error
+ *
+ * The Runge-Kutta steps are sized so that the estimated error of each step is at most tolerance (in metres).
+ *  The first step (before there is an error estimate) crosses at most one grid cell, and later steps at most
+ *  max_cells_per_step cells, as a safeguard. In all cases, the steps are shortened to land exactly on the target times.
+ *
+ * @param[in]   integrator      time-stepping scheme (see above)
+ * @param[in]   tolerance       error tolerance per step, in metres (RK4 and RK45)
+ * @param[in]   steps_taken     (optional) number of (accepted) steps for each particle
+ *
+ */
 void particles_evolve_trajectories(
         std::vector<double> & part_lon_hist,
         std::vector<double> & part_lat_hist,
@@ -26,6 +43,9 @@ void particles_evolve_trajectories(
         const std::vector<double> & lat,
         const std::vector<double> & lon,
         const std::vector<bool> & mask,
+        const int integrator,
+        const double tolerance,
+        std::vector<int> * steps_taken,
         const MPI_Comm comm
         ) {
 
@@ -34,16 +54,19 @@ void particles_evolve_trajectories(
     MPI_Comm_size( comm, &wSize );
 
     double t_part, lon0, lat0,
-           dx_loc, dy_loc, dt,
+           dx_loc, dy_loc, dt, dt_next,
            vel_lon_part, vel_lat_part, field_val,
            test_val, lon_rng, lat_rng, lon_mid, lat_mid,
-           time_p;
+           time_p, dlon_dt, dlat_dt, dlon_dt_end, dlat_dt_end,
+           lon_new, lat_new, step_error, step_factor;
 
     const double dlon = lon.at(1) - lon.at(0),
                  dlat = lat.at(1) - lat.at(0),
                  cfl  = 1e-5,
+                 max_cells_per_step = 10.,
                  U0   = 2.,
-                 dt_target = target_times.at(1) - target_times.at(0);
+                 dt_target = target_times.at(1) - target_times.at(0),
+                 dt_min    = 1e-6 * dt_target;  // Steps this small are accepted regardless of the error
 
     const unsigned int  Nlat   = lat.size(),
                         Nlon   = lon.size(),
@@ -53,14 +76,16 @@ void particles_evolve_trajectories(
                         Nouts  = target_times.size();
 
     int left, right, bottom, top,
-        num_times_recycled;
-    bool do_recycle;
+        num_times_recycled, ref_ind;
+    bool do_recycle, have_slope, snapped;
 
     std::vector<double> vel_lon_sub( Nlat * Nlon ), 
                         vel_lat_sub( Nlat * Nlon );
     std::vector<bool>   mask_sub(    Nlat * Nlon );
 
-    unsigned int out_ind, step_iter, ref_ind, Ip;
+    if (steps_taken != NULL) { steps_taken->resize( Nparts, 0 ); }
+
+    unsigned int out_ind, step_iter, Ip;
     size_t index;
 
     srand( wRank );
@@ -72,14 +97,16 @@ void particles_evolve_trajectories(
             target_times, time, part_lon_hist, part_lat_hist,\
             rev_part_lon_hist, rev_part_lat_hist,\
             field_trajectories, rev_field_trajectories, fields_to_track,\
-            wRank, wSize)\
+            steps_taken, wRank, wSize)\
     private(Ip, index, \
             t_part, out_ind, step_iter, ref_ind, lon0, lat0, \
-            dx_loc, dy_loc, dt, time_p, vel_lon_part, vel_lat_part, field_val,\
+            dx_loc, dy_loc, dt, dt_next, time_p, vel_lon_part, vel_lat_part, field_val,\
+            dlon_dt, dlat_dt, dlon_dt_end, dlat_dt_end, lon_new, lat_new, step_error, step_factor,\
             test_val, lon_rng, lat_rng, lon_mid, lat_mid, \
-            num_times_recycled, do_recycle, \
+            num_times_recycled, do_recycle, have_slope, snapped, \
             left, right, bottom, top) \
-    firstprivate( Nparts, Nouts, Ntime, dlon, dlat, dt_target, particle_lifespan )
+    firstprivate( Nparts, Nouts, Ntime, dlon, dlat, dt_target, dt_min, particle_lifespan, integrator, tolerance, \
+                  max_cells_per_step )
     {
         #pragma omp for collapse(1) schedule(dynamic)
         for (Ip = 0; Ip < Nparts; ++Ip) {
@@ -124,7 +151,11 @@ void particles_evolve_trajectories(
             vel_lon_part = U0;
             vel_lat_part = U0;
 
-            while (t_part < target_times.back()) {
+            // Runge-Kutta state: slopes at the current position, and the next step size
+            have_slope = false;
+            dt_next    = 0.;
+
+            while ( (t_part < target_times.back()) and (out_ind < Nouts) ) {
 
                 // Get local dt
                 //   we'll use the previous velocities, which should
@@ -132,67 +163,125 @@ void particles_evolve_trajectories(
                 dx_loc = dlon * constants::R_earth * cos(lat0);
                 dy_loc = dlat * constants::R_earth;
 
-                dt = cfl * std::min( dx_loc / std::max(vel_lon_part, 1e-3), 
-                                     dy_loc / std::max(vel_lat_part, 1e-3) );
+                if (integrator == constants::ParticleIntegratorType::ForwardEuler) {
 
-                if ( ( (size_t)out_ind < target_times.size() )
-                     and ( (t_part + dt) - target_times.at(out_ind) > (dt_target / 50.) ) 
-                   )
-                {
-                    dt = target_times.at(out_ind) - t_part;
-                }
+                    dt = cfl * std::min( dx_loc / std::max(fabs(vel_lon_part), 1e-3), 
+                                         dy_loc / std::max(fabs(vel_lat_part), 1e-3) );
 
-                // Subset velocities by time
-                if (Ntime == 1) {
-                    time_p = 0.;
-                } else {
-                    time_p =    ( t_part             - time.at(ref_ind) ) 
-                              / ( time.at(ref_ind+1) - time.at(ref_ind) );
-                }
+                    // Land exactly on the next output time
+                    snapped = ( t_part + dt >= target_times.at(out_ind) );
+                    if (snapped) { dt = target_times.at(out_ind) - t_part; }
 
-                //
-                //// Time-stepping is a simple first-order symplectic scheme
-                //
+                    // Subset velocities by time
+                    if (Ntime == 1) {
+                        time_p = 0.;
+                    } else {
+                        time_p =    ( t_part             - time.at(ref_ind) ) 
+                                  / ( time.at(ref_ind+1) - time.at(ref_ind) );
+                    }
 
-                //
-                //// Get u_lon at position at advance lon position
-                //
-                particles_get_edges(left, right, bottom, top, lat0, lon0, lat, lon);
-                if ( (bottom < 0) or (top < 0) ) { break; }
-                vel_lon_part = particles_interp_from_edges(lat0, lon0, lat, lon, &vel_lon, 
-                        mask, left, right, bottom, top, time_p, ref_ind, Ntime);
-                if ( fabs(vel_lon_part) > 100. ) { break; }
+                    //
+                    //// Time-stepping is a simple first-order symplectic scheme
+                    //
 
-                // convert to radial velocity and step in space
-                lon0 += dt * vel_lon_part / (constants::R_earth * cos(lat0));
-                if (lon0 >  M_PI) { lon0 -= 2 * M_PI; }
-                if (lon0 < -M_PI) { lon0 += 2 * M_PI; }
+                    //
+                    //// Get u_lon at position at advance lon position
+                    //
+                    particles_get_edges(left, right, bottom, top, lat0, lon0, lat, lon);
+                    if ( (bottom < 0) or (top < 0) ) { break; }
+                    vel_lon_part = particles_interp_from_edges(lat0, lon0, lat, lon, &vel_lon, 
+                            mask, left, right, bottom, top, time_p, ref_ind, Ntime);
+                    if ( fabs(vel_lon_part) > 100. ) { break; }
 
-                //
-                //// Get u_lat at position at advance lat position
-                //
-                particles_get_edges(left, right, bottom, top, lat0, lon0, lat, lon);
-                if ( (bottom < 0) or (top < 0) ) { break; }
-                vel_lat_part = particles_interp_from_edges(lat0, lon0, lat, lon, &vel_lat, 
-                        mask, left, right, bottom, top, time_p, ref_ind, Ntime);
-                if ( fabs(vel_lat_part) > 100. ) { break; }
+                    // convert to radial velocity and step in space
+                    lon0 += dt * vel_lon_part / (constants::R_earth * cos(lat0));
+                    if (lon0 >  M_PI) { lon0 -= 2 * M_PI; }
+                    if (lon0 < -M_PI) { lon0 += 2 * M_PI; }
 
-                // convert to radial velocity and step in space
-                lat0 += dt * vel_lat_part / constants::R_earth;
+                    //
+                    //// Get u_lat at position at advance lat position
+                    //
+                    particles_get_edges(left, right, bottom, top, lat0, lon0, lat, lon);
+                    if ( (bottom < 0) or (top < 0) ) { break; }
+                    vel_lat_part = particles_interp_from_edges(lat0, lon0, lat, lon, &vel_lat, 
+                            mask, left, right, bottom, top, time_p, ref_ind, Ntime);
+                    if ( fabs(vel_lat_part) > 100. ) { break; }
+
+                    // convert to radial velocity and step in space
+                    lat0 += dt * vel_lat_part / constants::R_earth;
+
+                } else {
+
+                    // Slopes at the current position (after the first step, these come from the end of the previous step)
+                    if (not(have_slope)) {
+                        if ( not( particles_velocity_at_point( dlon_dt, dlat_dt, t_part, lat0, lon0, ref_ind,
+                                        vel_lon, vel_lat, time, lat, lon, mask ) ) ) { break; }
+                        have_slope = true;
+                    }
+                    vel_lon_part = dlon_dt * constants::R_earth * cos(lat0);
+                    vel_lat_part = dlat_dt * constants::R_earth;
+
+                    // Time to cross one grid cell. Until there is an error estimate, that is the step,
+                    //   afterwards the controller sets the step, with a loose bound as a safeguard.
+                    dt = std::min( dx_loc / std::max(fabs(vel_lon_part), 1e-3), 
+                                   dy_loc / std::max(fabs(vel_lat_part), 1e-3) );
+                    if (dt_next > 0) { dt = std::min( max_cells_per_step * dt, dt_next ); }
+
+                    // Land exactly on the next output time
+                    snapped = ( t_part + dt >= target_times.at(out_ind) );
+                    if (snapped) { dt = target_times.at(out_ind) - t_part; }
+
+                    if ( not( particles_RK_step( lon_new, lat_new, step_error, dlon_dt_end, dlat_dt_end,
+                                    dlon_dt, dlat_dt, t_part, dt, lon0, lat0, integrator, ref_ind,
+                                    vel_lon, vel_lat, time, lat, lon, mask ) ) ) { break; }
+
+                    // Standard step-size controller (both schemes have local errors of order dt^5)
+                    step_factor = ( step_error > 0 ) ? 0.9 * pow( tolerance / step_error, 0.2 ) : 5.;
+                    step_factor = std::max( 0.2, std::min( 5., step_factor ) );
+
+                    if ( ( step_error > tolerance ) and ( dt > dt_min ) ) {
+                        // Reject the step and try again with a smaller one
+                        dt_next = std::max( dt_min, std::min( 1., step_factor ) * dt );
+                        continue;
+                    }
+
+                    // A step that was shortened to hit an output time shouldn't shrink the next one
+                    dt_next = snapped ? std::max( dt_next, step_factor * dt ) : step_factor * dt;
+
+                    lon0 = lon_new;
+                    lat0 = lat_new;
+                    if (lon0 >  M_PI) { lon0 -= 2 * M_PI; }
+                    if (lon0 < -M_PI) { lon0 += 2 * M_PI; }
+
+                    dlon_dt = dlon_dt_end;
+                    dlat_dt = dlat_dt_end;
+                }
 
                 // Update time
-                t_part += dt;
+                t_part = snapped ? target_times.at(out_ind) : t_part + dt;
+
+                if (Ntime > 1) {
+                    // If there's only one Ntime, then we're doing streamlines, not pathlines,
+                    // so don't need to advance time in velocity field
+                    //
+                    // Otherwise, check if we've stepped into the next 'time bin' in the velocity
+                    // field.
+                    while ( ( ref_ind + 2 < (int) Ntime ) and ( t_part > time.at(ref_ind+1) ) ) { ref_ind++; }
+                }
 
                 // Track, if at right time
-                if (      (t_part < target_times.back()) 
-                      and (t_part >= target_times.at(out_ind)) 
-                   ){
+                if (snapped) {
 
                     index = Index(0,       0,      out_ind, Ip,
                                   Ntime,   Ndepth, Nouts,   Nparts);
                     part_lon_hist.at(index) = lon0;
                     part_lat_hist.at(index) = lat0;
 
+                    if (Ntime > 1) {
+                        time_p =    ( t_part             - time.at(ref_ind) ) 
+                                  / ( time.at(ref_ind+1) - time.at(ref_ind) );
+                    }
+
                     particles_get_edges(left, right, bottom, top, lat0, lon0, lat, lon);
 
                     for (size_t Ifield = 0; Ifield < fields_to_track.size(); ++Ifield) {
@@ -238,22 +327,18 @@ void particles_evolve_trajectories(
                         // Set new position
                         lon0 = ( ((double) rand() / (RAND_MAX)) - 0.5) * lon_rng + lon_mid;
                         lat0 = ( ((double) rand() / (RAND_MAX)) - 0.5) * lat_rng + lat_mid;
+
+                        // The slopes (and step size) were for the old position
+                        have_slope = false;
+                        dt_next    = 0.;
                     }
                 }
 
-                if ( (t_part >= target_times.back()) or (out_ind >= Nouts) ) { break; }
-
-                if (Ntime > 1) {
-                    // If there's only one Ntime, then we're doing streamlines, not pathlines,
-                    // so don't need to advance time in velocity field
-                    //
-                    // Otherwise, check if we've stepped into the next 'time bin' in the velocity
-                    // field.
-                    if (t_part > time.at(ref_ind+1)) { ref_ind++; }
-                }
                 step_iter++;
             }
 
+            if (steps_taken != NULL) { steps_taken->at(Ip) = step_iter; }
+
             #if DEBUG >= 1
             fprintf(stdout, "Particle %03d of %03d (rank %d of %d) finished - recycled %d times\n", 
                     Ip+1 + Nparts * wRank, Nparts * wSize, wRank + 1, wSize, num_times_recycled);
@@ -0,0 +1,67 @@
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "../../constants.hpp"
+#include "../../functions.hpp"
+#include "../../particles.hpp"
+
+/*!
+ * \brief Rate of change of a particle's (longitude, latitude), in radians per second, at time t_part
+ *
+ * The velocities are bilinearly interpolated in space (particles_interp_from_edges) and linearly in time.
+ *
+ * @param[in,out]   dlon_dt, dlat_dt    rates of change of longitude and latitude
+ * @param[in]       t_part              particle time
+ * @param[in]       ref_lat, ref_lon    particle position (longitude need not be wrapped)
+ * @param[in]       ref_ind             time index to start searching from (for the time interpolation)
+ * @param[in]       vel_lon, vel_lat    velocity fields (m/s)
+ * @param[in]       time, lat, lon      grid
+ * @param[in]       mask                land mask
+ *
+ * @returns false if the particle has left the grid (or the velocity is unphysical), true otherwise
+ */
+bool particles_velocity_at_point(
+        double & dlon_dt,
+        double & dlat_dt,
+        const double t_part,
+        const double ref_lat,
+        double ref_lon,
+        int ref_ind,
+        const std::vector<double> & vel_lon,
+        const std::vector<double> & vel_lat,
+        const std::vector<double> & time,
+        const std::vector<double> & lat,
+        const std::vector<double> & lon,
+        const std::vector<bool> & mask
+        ) {
+
+    const int Ntime = time.size();
+
+    if (ref_lon >  M_PI) { ref_lon -= 2 * M_PI; }
+    if (ref_lon < -M_PI) { ref_lon += 2 * M_PI; }
+
+    // Find the time interval containing t_part
+    double time_p = 0.;
+    if (Ntime > 1) {
+        ref_ind = std::max( 0, std::min( ref_ind, Ntime - 2 ) );
+        while ( ( ref_ind + 2 < Ntime ) and ( t_part > time.at(ref_ind+1) ) ) { ref_ind++; }
+        while ( ( ref_ind     > 0     ) and ( t_part < time.at(ref_ind)   ) ) { ref_ind--; }
+        time_p =    ( t_part             - time.at(ref_ind) ) 
+                  / ( time.at(ref_ind+1) - time.at(ref_ind) );
+    }
+
+    int left, right, bottom, top;
+    particles_get_edges(left, right, bottom, top, ref_lat, ref_lon, lat, lon);
+    if ( (bottom < 0) or (top < 0) ) { return false; }
+
+    const double vel_lon_part = particles_interp_from_edges(ref_lat, ref_lon, lat, lon, &vel_lon, 
+                                    mask, left, right, bottom, top, time_p, ref_ind, Ntime),
+                 vel_lat_part = particles_interp_from_edges(ref_lat, ref_lon, lat, lon, &vel_lat, 
+                                    mask, left, right, bottom, top, time_p, ref_ind, Ntime);
+    if ( ( fabs(vel_lon_part) > 100. ) or ( fabs(vel_lat_part) > 100. ) ) { return false; }
+
+    dlon_dt = vel_lon_part / (constants::R_earth * cos(ref_lat));
+    dlat_dt = vel_lat_part /  constants::R_earth;
+
+    return true;
+}
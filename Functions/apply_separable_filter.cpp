@@ -0,0 +1,158 @@
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <omp.h>
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+// Offsets (along one dimension) within reach of the kernel, and the 1D kernel at each
+//   (the Gaussian kernels factor as kernel(sqrt(x^2 + y^2)) = kernel(x) * kernel(y)).
+//   If the dimension is periodic, then each point is only reached once.
+void separable_kernel_1D(
+        std::vector<int> & offsets,
+        std::vector<double> & kern_1D,
+        const std::vector<double> & grid,
+        const bool periodic,
+        const double scale
+        ) {
+
+    const int Npts = grid.size();
+    const double dl = ( Npts > 1 ) ? fabs( grid.at(1) - grid.at(0) ) : 0.;
+
+    int reach = ( ( constants::KernPad < 0 ) or ( dl == 0 ) ) ? Npts : (int) ceil( ( constants::KernPad * scale / dl ) / 2. );
+    int lower = -reach, upper = reach;
+    if ( (periodic) and ( 2 * reach + 1 > Npts ) ) { lower = -(Npts / 2); upper = Npts - 1 - (Npts / 2); }
+    else if ( not(periodic) ) { lower = std::max( lower, -(Npts - 1) ); upper = std::min( upper, Npts - 1 ); }
+
+    offsets.clear();
+    kern_1D.clear();
+    for (int off = lower; off <= upper; off++) {
+        offsets.push_back( off );
+        kern_1D.push_back( kernel( abs(off) * dl, scale ) );
+    }
+}
+
+/*!
+ * \brief Filter full fields with a separable kernel, as two 1D passes (along rows, then along columns)
+ *
+ * Gives the same local averages as apply_filter_at_point (including the mask handling and weights),
+ * but the kernel factors into 1D kernels, so that the cost is O(stencil) per point instead of O(stencil^2).
+ * Only possible on uniform Cartesian grids (so that the cell areas are all the same) with Gaussian kernels
+ * (see constants::USE_SEPARABLE_KERNEL). The integration region is the square around the usual circle.
+ *
+ * @param[in,out]   coarse_fields   where to store the filtered fields
+ * @param[in]       fields          fields to filter
+ * @param[in]       source_data     dataset class instance containing the grid and mask
+ * @param[in]       scale           filtering scale
+ * @param[in]       weight          pointer to spatial weight (i.e. rho) (NULL indicates not provided)
+ *
+ */
+void apply_separable_filter(
+        const std::vector<std::vector<double>*> & coarse_fields,
+        const std::vector<const std::vector<double>*> & fields,
+        const dataset & source_data,
+        const double scale,
+        const std::vector<double> * weight
+        ) {
+
+    assert( constants::USE_SEPARABLE_KERNEL );
+    assert( coarse_fields.size() == fields.size() );
+    for (size_t Ifield = 0; Ifield < fields.size(); Ifield++) { assert( fields[Ifield]->size() == source_data.mask.size() ); }
+
+    const std::vector<bool> &mask = source_data.mask;
+
+    const int   Nfields = fields.size(),
+                Nlat    = source_data.Nlat,
+                Nlon    = source_data.Nlon;
+    const size_t Npts   = mask.size(),
+                 Nrows  = Npts / Nlon;
+
+    std::vector<int> lon_offsets, lat_offsets;
+    std::vector<double> lon_kern, lat_kern;
+    separable_kernel_1D( lon_offsets, lon_kern, source_data.longitude, constants::PERIODIC_X, scale );
+    separable_kernel_1D( lat_offsets, lat_kern, source_data.latitude,  constants::PERIODIC_Y, scale );
+    const int Nlon_offsets = lon_offsets.size(),
+              Nlat_offsets = lat_offsets.size();
+
+    // Row-filtered numerators (one per field) and denominator
+    std::vector<std::vector<double>> row_num( Nfields, std::vector<double>( Npts, 0. ) );
+    std::vector<double> row_den( Npts, 0. );
+
+    size_t Irow, index, curr_index;
+    int Ilat, Ilon, II, Ioff, curr;
+    double loc_weight, den;
+    std::vector<double> num( Nfields );
+
+    //
+    //// First pass: along longitude
+    //
+    #pragma omp parallel default(none) \
+    private( Irow, index, curr_index, Ilon, II, Ioff, curr, loc_weight, den ) \
+    firstprivate( num, Nrows, Nlon, Nfields, Nlon_offsets ) \
+    shared( mask, fields, weight, row_num, row_den, lon_offsets, lon_kern )
+    {
+        #pragma omp for collapse(1) schedule(static)
+        for (Irow = 0; Irow < Nrows; Irow++) {
+            for (Ilon = 0; Ilon < Nlon; Ilon++) {
+                index = Irow * Nlon + Ilon;
+                den = 0.;
+                for (II = 0; II < Nfields; II++) { num[II] = 0.; }
+
+                for (Ioff = 0; Ioff < Nlon_offsets; Ioff++) {
+                    curr = Ilon + lon_offsets[Ioff];
+                    if (constants::PERIODIC_X) { curr = ( curr % Nlon + Nlon ) % Nlon; }
+                    else if ( (curr < 0) or (curr >= Nlon) ) { continue; }
+                    curr_index = Irow * Nlon + curr;
+
+                    loc_weight = lon_kern[Ioff];
+                    if (weight != NULL) { loc_weight *= (*weight)[curr_index]; }
+
+                    // Same conventions as apply_filter_at_point
+                    if ( not(constants::DEFORM_AROUND_LAND) or mask[curr_index] ) { den += loc_weight; }
+                    if ( mask[curr_index] ) {
+                        for (II = 0; II < Nfields; II++) { num[II] += (*fields[II])[curr_index] * loc_weight; }
+                    }
+                }
+
+                row_den[index] = den;
+                for (II = 0; II < Nfields; II++) { row_num[II][index] = num[II]; }
+            }
+        }
+    }
+
+    //
+    //// Second pass: along latitude, and then normalize
+    //
+    for (II = 0; II < Nfields; II++) { coarse_fields[II]->resize( Npts ); }
+
+    #pragma omp parallel default(none) \
+    private( Irow, index, curr_index, Ilat, Ilon, II, Ioff, curr, loc_weight, den ) \
+    firstprivate( num, Nrows, Nlat, Nlon, Nfields, Nlat_offsets ) \
+    shared( coarse_fields, row_num, row_den, lat_offsets, lat_kern )
+    {
+        #pragma omp for collapse(1) schedule(static)
+        for (Irow = 0; Irow < Nrows; Irow++) {
+            Ilat = Irow % Nlat;
+            for (Ilon = 0; Ilon < Nlon; Ilon++) {
+                index = Irow * Nlon + Ilon;
+                den = 0.;
+                for (II = 0; II < Nfields; II++) { num[II] = 0.; }
+
+                for (Ioff = 0; Ioff < Nlat_offsets; Ioff++) {
+                    curr = Ilat + lat_offsets[Ioff];
+                    if (constants::PERIODIC_Y) { curr = ( curr % Nlat + Nlat ) % Nlat; }
+                    else if ( (curr < 0) or (curr >= Nlat) ) { continue; }
+                    curr_index = index + (long) ( curr - Ilat ) * Nlon;
+
+                    loc_weight = lat_kern[Ioff];
+                    den += row_den[curr_index] * loc_weight;
+                    for (II = 0; II < Nfields; II++) { num[II] += row_num[II][curr_index] * loc_weight; }
+                }
+
+                // On the off chance that the kernel was null (size zero), just return zero
+                for (II = 0; II < Nfields; II++) { (*coarse_fields[II])[index] = (den == 0) ? 0. : num[II] / den; }
+            }
+        }
+    }
+}
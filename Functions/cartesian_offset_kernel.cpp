@@ -0,0 +1,73 @@
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+/*!
+ * \brief Compute the kernel at every index offset within the kernel's reach
+ *
+ * The reach matches the integration bounds from get_lat_bounds and get_lon_bounds.
+ *
+ * @param[in]   source_data     dataset class instance containing the grid
+ * @param[in]   scale           filtering scale
+ * @param[in]   with_derivs     also store the first and second ell-derivatives of the kernel
+ *
+ */
+void cartesian_offset_kernel::build(
+        const dataset & source_data,
+        const double scale_in,
+        const bool with_derivs
+        ) {
+
+    assert( is_possible() );
+
+    const std::vector<double>   &latitude   = source_data.latitude,
+                                &longitude  = source_data.longitude;
+
+    scale = scale_in;
+    Nlat  = source_data.Nlat;
+    Nlon  = source_data.Nlon;
+
+    const double dlat = ( Nlat > 1 ) ? fabs( latitude.at( 1) - latitude.at( 0) ) : 0.,
+                 dlon = ( Nlon > 1 ) ? fabs( longitude.at(1) - longitude.at(0) ) : 0.;
+
+    // Largest offsets that can be reached (after accounting for periodicity)
+    const int full_dlat = constants::PERIODIC_Y ? Nlat / 2 : Nlat - 1,
+              full_dlon = constants::PERIODIC_X ? Nlon / 2 : Nlon - 1;
+    if ( ( constants::KernPad < 0 ) or ( dlat == 0 ) ) { max_dlat = full_dlat; }
+    else { max_dlat = std::min( full_dlat, (int) ceil( ( constants::KernPad * scale / dlat ) / 2. ) ); }
+    if ( ( constants::KernPad < 0 ) or ( dlon == 0 ) ) { max_dlon = full_dlon; }
+    else { max_dlon = std::min( full_dlon, (int) ceil( ( constants::KernPad * scale / dlon ) / 2. ) ); }
+    if (constants::ZONAL_KERNEL_ONLY) { max_dlat = 0; }
+
+    const size_t Noffsets = (size_t) ( max_dlat + 1 ) * ( max_dlon + 1 );
+    kern.resize( Noffsets );
+    dl_kern.resize(  with_derivs ? Noffsets : 0 );
+    dll_kern.resize( with_derivs ? Noffsets : 0 );
+
+    int Idlat, Idlon;
+    size_t index;
+    double dist;
+    #pragma omp parallel default(none) \
+    private( Idlat, Idlon, index, dist ) \
+    firstprivate( dlat, dlon, with_derivs ) \
+    shared( kern, dl_kern, dll_kern, max_dlat, max_dlon, Nlat, Nlon, scale )
+    {
+        #pragma omp for collapse(2) schedule(static)
+        for (Idlat = 0; Idlat <= max_dlat; Idlat++) {
+            for (Idlon = 0; Idlon <= max_dlon; Idlon++) {
+                index = (size_t) Idlat * ( max_dlon + 1 ) + Idlon;
+                dist = distance( 0., 0., Idlon * dlon, Idlat * dlat, dlon * Nlon, dlat * Nlat );
+                kern[index] = kernel( dist, scale );
+                if (with_derivs) {
+                    dl_kern[index]  = kernel( dist, scale, 1 );
+                    dll_kern[index] = kernel( dist, scale, 2 );
+                }
+            }
+        }
+    }
+
+    built = true;
+}
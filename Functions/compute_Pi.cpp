@@ -15,6 +15,9 @@
  * @param[in]       source_data                     dataset class instance containing data (Psi, Phi, etc)
  * @param[in]       ux,uy,uz                        coarse Cartesian velocity components
  * @param[in]       uxux,uxuy,uxuz,uyuy,uyuz,uzuz   coarse velocity products (e.g. bar(u*v) )  
+ * @param[in]       ux_in_tau,uy_in_tau,uz_in_tau   (optional) velocity components to use in tau (default ux,uy,uz)
+ * @param[in]       vel_grad                        (optional) pre-computed gradient of ux,uy,uz, in which case Pi is
+ *                                                  computed in a single pass without taking any derivatives
  * @param[in]       comm                            MPI communicator object
  *
  */
@@ -33,6 +36,7 @@ void compute_Pi(
         const std::vector<double> * ux_in_tau,
         const std::vector<double> * uy_in_tau,
         const std::vector<double> * uz_in_tau,
+        const velocity_gradient_cache * vel_grad,
         const MPI_Comm comm
         ) {
 
@@ -74,6 +78,44 @@ void compute_Pi(
     // Zero out energy transfer before we start
     std::fill( energy_transfer.begin(), energy_transfer.end(), 0.);
 
+    if ( vel_grad != NULL ) {
+        // With the velocity gradient already available, everything is local, so do it in one pass
+        const std::vector<const std::vector<double>*> u_in_tau { ux_in_tau, uy_in_tau, uz_in_tau },
+                                                      uiuj_all { &uxux, &uxuy, &uxuz, 
+                                                                 &uxuy, &uyuy, &uyuz, 
+                                                                 &uxuz, &uyuz, &uzuz };
+        const double * grad_loc;
+        #pragma omp parallel default(none) \
+        shared( energy_transfer, mask, vel_grad, u_in_tau, uiuj_all ) \
+        private( index, ii, jj, pi_tmp, ui_j, uj_i, grad_loc ) \
+        firstprivate( Npts )
+        {
+            #pragma omp for collapse(1) schedule(guided)
+            for (index = 0; index < Npts; index++) {
+
+                if ( constants::FILTER_OVER_LAND or mask.at(index) ) {
+                    grad_loc = vel_grad->at(index);
+                    for (ii = 0; ii < 3; ii++) {
+                        for (jj = 0; jj < 3; jj++) {
+                            ui_j = grad_loc[ 3 * ii + jj ];
+                            uj_i = grad_loc[ 3 * jj + ii ];
+
+                            double Sij = 0.5 * ( ui_j + uj_i );
+                            double tau_ij_loc = uiuj_all[ 3 * ii + jj ]->at(index) - u_in_tau[ii]->at(index) * u_in_tau[jj]->at(index);
+                            pi_tmp = - constants::rho0 * Sij * tau_ij_loc;
+                            energy_transfer.at(index) += pi_tmp;
+                        }
+                    }
+                }
+            }
+        }
+
+        #if DEBUG >= 2
+        if (wRank == 0) { fprintf(stdout, "     ... done.\n"); }
+        #endif
+        return;
+    }
+
     for (ii = 0; ii < 3; ii++) {
         for (jj = 0; jj < 3; jj++) {
 
@@ -50,114 +50,89 @@ void compute_Z(
     size_t index;
     const size_t Npts = enstrophy_transfer.size();
 
-    double tau_ij_j, u_i_tau_ij_j;
-    std::vector<double> tau_ij;
-    std::vector<double> u_i_tau_ij;
-    tau_ij.resize(ux.size());
-    u_i_tau_ij.resize(ux.size());
+    // tau_j and omega * tau_j for all three j at once, so that
+    //   only one pass of derivatives is needed
+    //
+    //   0 -> x
+    //   1 -> y
+    //   2 -> z
+    std::vector<double> tau_x(ux.size()), tau_y(ux.size()), tau_z(ux.size()),
+                        omega_tau_x(ux.size()), omega_tau_y(ux.size()), omega_tau_z(ux.size());
+    double tau_j_j[3], omega_tau_j_j[3];
 
     // Some convenience handles
-    //   note: the pointers aren't constant, but the things
-    //         to which they are pointing are
-    double omega_loc, uj_loc, omega_uj_loc;
-    const std::vector<double> *omega_uj, *omega, *uj;
+    double omega_loc;
+    const std::vector<double> &omega = coarse_vort_r;
 
     // Set up the derivatives to pass through the differentiation functions
     std::vector<double*> x_deriv_vals, y_deriv_vals, z_deriv_vals;
-    std::vector<const std::vector<double>*> deriv_fields;
-
-    deriv_fields.push_back(&tau_ij);
-    deriv_fields.push_back(&u_i_tau_ij);
+    const std::vector<const std::vector<double>*> deriv_fields { &tau_x, &tau_y, &tau_z, 
+                                                                 &omega_tau_x, &omega_tau_y, &omega_tau_z };
 
     // Zero out enstrophy transfer before we start
     std::fill( enstrophy_transfer.begin(), enstrophy_transfer.end(), 0. );
 
-    // omega
-    omega = &coarse_vort_r;
-
-    for (jj = 0; jj < 3; jj++) {
-
-        //   Assign the handy pointers: omega_uj, uj
-        //
-        //   0 -> x
-        //   1 -> y
-        //   2 -> z
-
-        // uj
-        uj = ( jj == 0 ) ? &ux : ( jj == 1 ) ? &uy : &uz;
-
-        // omega_uj 
-        omega_uj = ( jj == 0 ) ? &vort_ux : ( jj == 1 ) ? &vort_uy : &vort_uz;
-        
-            
-        // First, compute the appropriate
-        //   tau_ij and u_i * tau_ij
-        #pragma omp parallel \
-        default(none) \
-        shared( source_data, tau_ij, u_i_tau_ij, mask, omega, uj, omega_uj)\
-        private(index, omega_uj_loc, omega_loc, uj_loc) \
-        firstprivate( Npts )
-        {
-            #pragma omp for collapse(1) schedule(guided)
-            for (index = 0; index < Npts; index++) {
-
-                if ( mask.at(index) ) {
-                    omega_loc    = omega->at( index );
-                    uj_loc       = uj->at( index );
-                    omega_uj_loc = omega_uj->at( index );
-
-                    tau_ij.at(index) = omega_uj_loc - omega_loc * uj_loc;
-                    u_i_tau_ij.at(index) = omega_loc * tau_ij.at(index);
-
-                }
+    // First, compute the appropriate
+    //   tau_j and omega * tau_j
+    #pragma omp parallel \
+    default(none) \
+    shared( tau_x, tau_y, tau_z, omega_tau_x, omega_tau_y, omega_tau_z, mask, omega, \
+            ux, uy, uz, vort_ux, vort_uy, vort_uz )\
+    private(index, omega_loc) \
+    firstprivate( Npts )
+    {
+        #pragma omp for collapse(1) schedule(guided)
+        for (index = 0; index < Npts; index++) {
+
+            if ( mask.at(index) ) {
+                omega_loc = omega.at( index );
+
+                tau_x.at(index) = vort_ux.at(index) - omega_loc * ux.at(index);
+                tau_y.at(index) = vort_uy.at(index) - omega_loc * uy.at(index);
+                tau_z.at(index) = vort_uz.at(index) - omega_loc * uz.at(index);
+
+                omega_tau_x.at(index) = omega_loc * tau_x.at(index);
+                omega_tau_y.at(index) = omega_loc * tau_y.at(index);
+                omega_tau_z.at(index) = omega_loc * tau_z.at(index);
             }
         }
+    }
 
-        #pragma omp parallel \
-        default(none) \
-        shared( source_data, enstrophy_transfer, mask, \
-                jj, omega, tau_ij, u_i_tau_ij, deriv_fields,std::cout)\
-        private(Itime, Idepth, Ilat, Ilon, index, \
-                Z_tmp, tau_ij_j, u_i_tau_ij_j,\
-                x_deriv_vals, y_deriv_vals, z_deriv_vals) \
-        firstprivate( Npts )
-        {
-
-            x_deriv_vals.resize(2);
-            y_deriv_vals.resize(2);
-            z_deriv_vals.resize(2);
-
-            // Now set the appropriate derivative pointers in order to compute
-            //     tau_ij,j
-            //     (u_i * tau_ij)_,j
-            x_deriv_vals.at(0) = (jj == 0) ? &tau_ij_j     : NULL;
-            x_deriv_vals.at(1) = (jj == 0) ? &u_i_tau_ij_j : NULL;
-
-            y_deriv_vals.at(0) = (jj == 1) ? &tau_ij_j     : NULL;
-            y_deriv_vals.at(1) = (jj == 1) ? &u_i_tau_ij_j : NULL;
-
-            z_deriv_vals.at(0) = (jj == 2) ? &tau_ij_j     : NULL;
-            z_deriv_vals.at(1) = (jj == 2) ? &u_i_tau_ij_j : NULL;
-
-            // Now actually compute Z -  in particular, compute
-            //           u_i * tau_ij,j - (u_i * tau_ij)_,j               
-            #pragma omp for collapse(1) schedule(guided)
-            for (index = 0; index < Npts; index++) {
-
-                if ( mask.at(index) ) {
-
-                    source_data.index1to4_local( index, Itime, Idepth, Ilat, Ilon);
-
-                    // Compute the desired derivatives
-                    Cart_derivatives_at_point(
-                            x_deriv_vals, y_deriv_vals, z_deriv_vals, deriv_fields,
-                            source_data, Itime, Idepth, Ilat, Ilon,
-                            1, constants::DiffOrd);
-
-                    // u_i * tau_ij,j - (u_i * tau_ij)_,j
-                    Z_tmp = omega->at(index) * tau_ij_j  -  u_i_tau_ij_j;
+    #pragma omp parallel \
+    default(none) \
+    shared( source_data, enstrophy_transfer, mask, omega, deriv_fields )\
+    private(Itime, Idepth, Ilat, Ilon, index, jj, \
+            Z_tmp, tau_j_j, omega_tau_j_j,\
+            x_deriv_vals, y_deriv_vals, z_deriv_vals) \
+    firstprivate( Npts )
+    {
+
+        // Only the x derivative of the x terms, etc, are needed, i.e.
+        //     tau_j,j
+        //     (omega * tau_j)_,j
+        x_deriv_vals = { &tau_j_j[0], NULL, NULL, &omega_tau_j_j[0], NULL, NULL };
+        y_deriv_vals = { NULL, &tau_j_j[1], NULL, NULL, &omega_tau_j_j[1], NULL };
+        z_deriv_vals = { NULL, NULL, &tau_j_j[2], NULL, NULL, &omega_tau_j_j[2] };
+
+        // Now actually compute Z -  in particular, compute
+        //           omega * tau_j,j - (omega * tau_j)_,j               
+        #pragma omp for collapse(1) schedule(guided)
+        for (index = 0; index < Npts; index++) {
+
+            if ( mask.at(index) ) {
+
+                source_data.index1to4_local( index, Itime, Idepth, Ilat, Ilon);
+
+                // Compute the desired derivatives
+                Cart_derivatives_at_point(
+                        x_deriv_vals, y_deriv_vals, z_deriv_vals, deriv_fields,
+                        source_data, Itime, Idepth, Ilat, Ilon,
+                        1, constants::DiffOrd);
+
+                for (jj = 0; jj < 3; jj++) {
+                    // omega * tau_j,j - (omega * tau_j)_,j
+                    Z_tmp = omega.at(index) * tau_j_j[jj]  -  omega_tau_j_j[jj];
                     enstrophy_transfer.at(index) += constants::rho0 * Z_tmp;
-                        
                 }
             }
         }
@@ -86,6 +86,11 @@
  * @param[in]       u_x,u_y,u_z                     coarse Cartesian velocity components
  * @param[in]       uxux,uxuy,uxuz,uyuy,uyuz,uzuz   coarse velocity products (e.g. bar(u*v) )  
  * @param[in]       coarse_p                        coarse pressure
+ * @param[in]       vel_grad                        (optional) pre-computed velocity gradient. If it also
+ *                                                  has the product derivatives, then only the pressure
+ *                                                  (if COMP_BC_TRANSFERS) is differentiated here.
+ *                                                  Ignored when using depth derivatives.
+ * @param[in]       comm                            MPI communicator object
  *
  */
 
@@ -102,6 +107,7 @@ void compute_div_transport(
         const std::vector<double> & uyuz,
         const std::vector<double> & uzuz,
         const std::vector<double> & coarse_p,
+        const velocity_gradient_cache * vel_grad,
         const MPI_Comm comm
         ) {
 
@@ -166,13 +172,21 @@ void compute_div_transport(
     if (constants::COMP_BC_TRANSFERS) {
         deriv_fields.push_back(&coarse_p);
     }
+
+    // With the gradients already computed, only the pressure is left to differentiate
+    const bool use_cache = ( vel_grad != NULL ) 
+                            and vel_grad->has_products() 
+                            and not( source_data.use_depth_derivatives );
+    const std::vector<const std::vector<double>*> p_deriv_field { &coarse_p };
+    std::vector<double*> p_x_deriv_vals, p_y_deriv_vals, p_z_deriv_vals;
+    const double *grad_loc, *prod_deriv_loc;
     
     #pragma omp parallel \
     default(none) \
     shared( div_J, source_data, mask, \
             u_x, u_y, u_z, uxux, uxuy, uxuz,\
             uyuy, uyuz, uzuz,\
-            deriv_fields)\
+            deriv_fields, vel_grad, p_deriv_field)\
     private(Itime, Idepth, Ilat, Ilon, index, global_index, \
             ux,   uy,   uz,\
             ux_x, uy_x, uz_x,\
@@ -186,8 +200,9 @@ void compute_div_transport(
             uzux_loc, uzuy_loc, uzuz_loc,\
             dpdx, dpdy, dpdz,\
             x_deriv_vals, y_deriv_vals, z_deriv_vals,\
-            div_J_tmp) \
-    firstprivate( Npts )
+            p_x_deriv_vals, p_y_deriv_vals, p_z_deriv_vals,\
+            grad_loc, prod_deriv_loc, div_J_tmp) \
+    firstprivate( Npts, use_cache )
     {
         x_deriv_vals.push_back(&ux_x);
         x_deriv_vals.push_back(&uy_x);
@@ -228,6 +243,10 @@ void compute_div_transport(
             z_deriv_vals.push_back(&dpdz);
         }
 
+        p_x_deriv_vals.push_back(&dpdx);
+        p_y_deriv_vals.push_back(&dpdy);
+        p_z_deriv_vals.push_back(&dpdz);
+
         #pragma omp for collapse(1) schedule(guided)
         for (index = 0; index < Npts; index++) {
 
@@ -244,10 +263,30 @@ void compute_div_transport(
                     global_index = index;
                 }
                 source_data.index1to4_local( index, Itime, Idepth, Ilat, Ilon);
-                Cart_derivatives_at_point(
-                        x_deriv_vals, y_deriv_vals, z_deriv_vals, deriv_fields,
-                        source_data, Itime, Idepth, Ilat, Ilon,
-                        1, constants::DiffOrd, source_data.use_depth_derivatives);
+                if ( use_cache ) {
+                    grad_loc       = vel_grad->at(index);
+                    prod_deriv_loc = &(vel_grad->prod_deriv[ 9 * index ]);
+
+                    ux_x = grad_loc[0]; ux_y = grad_loc[1]; ux_z = grad_loc[2];
+                    uy_x = grad_loc[3]; uy_y = grad_loc[4]; uy_z = grad_loc[5];
+                    uz_x = grad_loc[6]; uz_y = grad_loc[7]; uz_z = grad_loc[8];
+
+                    uxux_x = prod_deriv_loc[0]; uxuy_y = prod_deriv_loc[1]; uxuz_z = prod_deriv_loc[2];
+                    uyux_x = prod_deriv_loc[3]; uyuy_y = prod_deriv_loc[4]; uyuz_z = prod_deriv_loc[5];
+                    uzux_x = prod_deriv_loc[6]; uzuy_y = prod_deriv_loc[7]; uzuz_z = prod_deriv_loc[8];
+
+                    if (constants::COMP_BC_TRANSFERS) {
+                        Cart_derivatives_at_point(
+                                p_x_deriv_vals, p_y_deriv_vals, p_z_deriv_vals, p_deriv_field,
+                                source_data, Itime, Idepth, Ilat, Ilon,
+                                1, constants::DiffOrd);
+                    }
+                } else {
+                    Cart_derivatives_at_point(
+                            x_deriv_vals, y_deriv_vals, z_deriv_vals, deriv_fields,
+                            source_data, Itime, Idepth, Ilat, Ilon,
+                            1, constants::DiffOrd, source_data.use_depth_derivatives);
+                }
 
                 // u_i
                 ux = u_x.at(global_index);
@@ -1,5 +1,6 @@
 #include <math.h>
 #include <vector>
+#include <algorithm>
 #include "../functions.hpp"
 #include "../constants.hpp"
 
@@ -17,6 +18,8 @@
  * @param[in]       source_data         dataset class instance containing data (Psi, Phi, etc)
  * @param[in]       Ilat,Ilon           reference coordinate (kernel centre)
  * @param[in]       LAT_lb,LAT_ub       upper and lower latitudinal bounds for kernel
+ * @param[in]       offset_kernel       (optional) kernel by index offsets (uniform Cartesian grids), 
+ *                                          from which values are copied instead of recomputed
  *
  */
 void compute_local_kernel(
@@ -28,7 +31,8 @@ void compute_local_kernel(
         const int Ilat,
         const int Ilon,
         const int LAT_lb,
-        const int LAT_ub
+        const int LAT_ub,
+        const cartesian_offset_kernel * offset_kernel
         ){
 
     const std::vector<double>   &latitude   = source_data.latitude,
@@ -39,7 +43,7 @@ void compute_local_kernel(
                 Nlat    = source_data.Nlat,
                 Nlon    = source_data.Nlon;
 
-    double dist, kern, dlat_m, dlon_m;
+    double dist, kern;
     size_t index;
     int curr_lon, curr_lat, LON_lb, LON_ub;
 
@@ -50,6 +54,29 @@ void compute_local_kernel(
     const bool do_dl  = (local_dl_kernel.size() > 0),
                do_dll = (local_dll_kernel.size() > 0);
 
+    // Use the pre-computed grid unit vectors for the distances, if available
+    const grid_geometry & geometry = source_data.geometry;
+    const bool use_geometry = not(constants::CARTESIAN) and geometry.applies_to( longitude, latitude );
+
+    // With the unit vectors, distances are computed along contiguous runs of each row
+    //   (from the chord lengths, so that the loop vectorizes) and stored here
+    std::vector<double> row_dist( use_geometry ? Nlon : 0 );
+    const size_t ref_index = (size_t) Ilat * Nlon + Ilon;
+    const double ref_x = use_geometry ? geometry.r_hat_x[ref_index] : 0.,
+                 ref_y = use_geometry ? geometry.r_hat_y[ref_index] : 0.,
+                 ref_z = use_geometry ? geometry.r_hat_z[ref_index] : 0.;
+    int seg_start, seg_len, Iseg;
+    size_t row_start;
+
+    // On uniform Cartesian grids, the kernel might have already been computed by offsets
+    const bool use_offsets =     ( offset_kernel != NULL ) and offset_kernel->applies_to( source_data, scale )
+                             and ( not(do_dl or do_dll) or not(offset_kernel->dl_kern.empty()) );
+    size_t offset_index;
+
+    // Cartesian grid spacings (and domain lengths, for periodicity)
+    const double dlat_m = constants::CARTESIAN ? latitude.at( 1) - latitude.at( 0) : 0.,
+                 dlon_m = constants::CARTESIAN ? longitude.at(1) - longitude.at(0) : 0.;
+
     for (int LAT = LAT_lb; LAT < LAT_ub; LAT++) {
 
         // Handle periodicity
@@ -60,6 +87,37 @@ void compute_local_kernel(
         // Get lon bounds at the latitude
         get_lon_bounds(LON_lb, LON_ub, longitude, Ilon, lat_at_ilat, lat_at_curr, scale);
 
+        if ( use_geometry and not(use_offsets) ) {
+            // Split [LON_lb, LON_ub) into runs that do not wrap around the periodic boundary
+            for (int LON = LON_lb; LON < LON_ub; LON += seg_len) {
+                if (constants::PERIODIC_X) { seg_start = ( LON % Nlon + Nlon ) % Nlon; }
+                else                       { seg_start = LON; }
+                seg_len = std::min( LON_ub - LON, Nlon - seg_start );
+                row_start = Index(0, 0, curr_lat, seg_start, Ntime, Ndepth, Nlat, Nlon);
+
+                const double * __restrict__ x = &geometry.r_hat_x[row_start];
+                const double * __restrict__ y = &geometry.r_hat_y[row_start];
+                const double * __restrict__ z = &geometry.r_hat_z[row_start];
+                double * __restrict__ dists = &row_dist[0];
+                #pragma omp simd
+                for (Iseg = 0; Iseg < seg_len; Iseg++) {
+                    dists[Iseg] = grid_geometry::arc_from_chord_sq(
+                                          ( x[Iseg] - ref_x ) * ( x[Iseg] - ref_x )
+                                        + ( y[Iseg] - ref_y ) * ( y[Iseg] - ref_y )
+                                        + ( z[Iseg] - ref_z ) * ( z[Iseg] - ref_z ) );
+                }
+
+                for (Iseg = 0; Iseg < seg_len; Iseg++) {
+                    index = row_start + Iseg;
+                    dist = row_dist[Iseg];
+                    local_kernel.at(index) = kernel(dist, scale);
+                    if (do_dl)  { local_dl_kernel.at(index)  = kernel(dist, scale, 1); }
+                    if (do_dll) { local_dll_kernel.at(index) = kernel(dist, scale, 2); }
+                }
+            }
+            continue;
+        }
+
         for (int LON = LON_lb; LON < LON_ub; LON++) {
 
             // Handle periodicity
@@ -68,9 +126,19 @@ void compute_local_kernel(
 
             index = Index(0, 0, curr_lat, curr_lon, Ntime, Ndepth, Nlat, Nlon);
 
-            if (constants::CARTESIAN) {
-                dlat_m = latitude.at( 1) - latitude.at( 0);
-                dlon_m = longitude.at(1) - longitude.at(0);
+            if (use_offsets) {
+                offset_index = offset_kernel->offset_index( Ilat, Ilon, curr_lat, curr_lon );
+                #if DEBUG >= 1
+                local_kernel.at(index) = offset_kernel->kern.at(offset_index);
+                if (do_dl)  { local_dl_kernel.at(index)  = offset_kernel->dl_kern.at(offset_index); }
+                if (do_dll) { local_dll_kernel.at(index) = offset_kernel->dll_kern.at(offset_index); }
+                #else
+                local_kernel[index] = offset_kernel->kern[offset_index];
+                if (do_dl)  { local_dl_kernel[index]  = offset_kernel->dl_kern[offset_index]; }
+                if (do_dll) { local_dll_kernel[index] = offset_kernel->dll_kern[offset_index]; }
+                #endif
+                continue;
+            } else if (constants::CARTESIAN) {
                 dist = distance(lon_at_ilon,     lat_at_ilat,
                                 longitude.at(curr_lon), lat_at_curr,
                                 dlon_m * Nlon, dlat_m * Nlat);
@@ -16,6 +16,7 @@
  *  @param[in]          source_data                 dataset class instance containing data (Psi, Phi, etc)
  *  @param[in]          u_r,u_lon,u_lat             velocity components
  *  @param[in]          mask                        2D array to distinguish land from water
+ *  @param[in]          vel_grad                    (optional) pre-computed Cartesian velocity gradient (see velocity_gradient_cache)
  *  @param[in]          comm                        MPI communicator object
  *
  */
@@ -33,6 +34,7 @@ void compute_vorticity(
         const std::vector<double> & u_r,
         const std::vector<double> & u_lon,
         const std::vector<double> & u_lat,
+        const velocity_gradient_cache * vel_grad,
         const MPI_Comm comm
         ) {
 
@@ -76,7 +78,7 @@ void compute_vorticity(
 
     #pragma omp parallel \
     default(none) \
-    shared( source_data, mask, u_r, u_lon, u_lat, \
+    shared( source_data, mask, u_r, u_lon, u_lat, vel_grad, \
             vort_r, vort_lon, vort_lat, vel_div, OkuboWeiss, \
             cyclonic_energy, anticyclonic_energy, \
             divergent_strain_energy, traceless_strain_energy ) \
@@ -109,7 +111,7 @@ void compute_vorticity(
                         cyclonic_energy_tmp, anticyclonic_energy_tmp, 
                         divergent_strain_energy_tmp, traceless_strain_energy_tmp,
                         source_data, u_r, u_lon, u_lat,        
-                        Itime, Idepth, Ilat, Ilon);
+                        Itime, Idepth, Ilat, Ilon, vel_grad);
             }
 
             if (do_vort_r)   { vort_r.at(  index) = vort_r_tmp; }
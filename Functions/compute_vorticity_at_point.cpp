@@ -19,6 +19,13 @@
  * @param[in]       source_data                     dataset class instance containing data (Psi, Phi, etc)
  * @param[in]       u_r,u_lon,u_lat                         velocity components
  * @param[in]       Itime,Idepth,Ilat,Ilon                  Current index in time and space
+ * @param[in]       vel_grad                                (optional) pre-computed Cartesian velocity gradient,
+ *                                                          in which case no derivatives are taken here
+ *
+ * When the Cartesian gradient (G) is provided, the spherical derivatives are recovered by projecting
+ * onto the unit vectors, e.g. \f$ \hat{e}_\phi \cdot G \hat{e}_\lambda \f$ is
+ * \f$ ( u_{\phi,\lambda} / \cos\phi + u_\lambda \tan\phi ) / R \f$ . These agree with the spherical
+ * derivatives up to the truncation error of the finite differences.
  *
  */
 void compute_vorticity_at_point(
@@ -38,7 +45,8 @@ void compute_vorticity_at_point(
         const int Itime,
         const int Idepth,
         const int Ilat,
-        const int Ilon
+        const int Ilon,
+        const velocity_gradient_cache * vel_grad
         ) {
 
     const int   Ntime   = source_data.Ntime,    // this is the MPI-local Ntime, not the full Ntime
@@ -51,6 +59,79 @@ void compute_vorticity_at_point(
     vort_lon_tmp = 0.;
     vort_lat_tmp = 0.;
 
+    if ( vel_grad != NULL ) {
+
+        size_t index = Index(Itime, Idepth, Ilat, Ilon,
+                             Ntime, Ndepth, Nlat, Nlon);
+        const double * G = vel_grad->at(index);
+
+        if (constants::CARTESIAN) {
+            vort_lon_tmp = G[7] - G[5];
+            vort_lat_tmp = G[2] - G[6];
+            vort_r_tmp   = G[3] - G[1];
+
+            div_tmp = G[0] + G[4] + G[8];
+
+            OkuboWeiss_tmp = pow(G[0] - G[4], 2) + 4 * G[1] * G[3];
+            return;
+        }
+
+        const double    lat     = source_data.latitude.at(Ilat),
+                        lon     = source_data.longitude.at(Ilon),
+                        cos_lat = cos(lat),
+                        sin_lat = sin(lat),
+                        cos_lon = cos(lon),
+                        sin_lon = sin(lon),
+                        u_r_loc = u_r.at(index);
+
+        // Unit vectors
+        const double    e_lon[3] = { - sin_lon,           cos_lon,           0.      },
+                        e_lat[3] = { - sin_lat * cos_lon, - sin_lat * sin_lon, cos_lat },
+                        e_r[3]   = {   cos_lat * cos_lon,   cos_lat * sin_lon, sin_lat };
+
+        // Derivatives of the (Cartesian) velocity vector along each unit vector
+        double a_lon[3], a_lat[3];
+        for (int ii = 0; ii < 3; ii++) {
+            a_lon[ii] = G[3*ii] * e_lon[0] + G[3*ii+1] * e_lon[1] + G[3*ii+2] * e_lon[2];
+            a_lat[ii] = G[3*ii] * e_lat[0] + G[3*ii+1] * e_lat[1] + G[3*ii+2] * e_lat[2];
+        }
+
+        double lon_lon = 0., lat_lon = 0., r_lon = 0., lon_lat = 0., lat_lat = 0., r_lat = 0.;
+        for (int ii = 0; ii < 3; ii++) {
+            lon_lon += e_lon[ii] * a_lon[ii];
+            lat_lon += e_lat[ii] * a_lon[ii];
+            r_lon   += e_r[ii]   * a_lon[ii];
+            lon_lat += e_lon[ii] * a_lat[ii];
+            lat_lat += e_lat[ii] * a_lat[ii];
+            r_lat   += e_r[ii]   * a_lat[ii];
+        }
+
+        vort_r_tmp   = lat_lon - lon_lat;
+        vort_lon_tmp =   r_lat;
+        vort_lat_tmp = - r_lon;
+
+        div_tmp = lon_lon + lat_lat;
+
+        const double    S_11 = lon_lon - u_r_loc / constants::R_earth,
+                        S_22 = lat_lat - u_r_loc / constants::R_earth,
+                        S_12 = 0.5 * ( lat_lon + lon_lat );
+
+        OkuboWeiss_tmp = pow(S_11 - S_22, 2) + pow(2 * S_12, 2) - pow(vort_r_tmp, 2);
+
+        // Johnson-decomposed Energy
+        if ( vort_r_tmp * lat >= 0 ) {
+            cyclonic_energy = 2 * pow(0.5 * vort_r_tmp, 2);
+            anticyclonic_energy = 0.;
+        } else {
+            cyclonic_energy = 0.;
+            anticyclonic_energy = 2 * pow(0.5 * vort_r_tmp, 2);
+        }
+        divergent_strain_energy = pow( S_11, 2) + pow( S_22, 2 );
+        traceless_strain_energy = 2 * pow( S_12, 2);
+
+        return;
+    }
+
     std::vector<const std::vector<double>*> deriv_fields {&u_lon, &u_lat, &u_r};
 
     if (constants::CARTESIAN) {
@@ -91,11 +172,20 @@ void compute_vorticity_at_point(
                                 lat_deriv_vals {&ulon_lat, &ulat_lat, &ur_lat},
                                 r_deriv_vals   {&ulon_r,   &ulat_r,   &ur_r  };
 
-        spher_derivative_at_point( lat_deriv_vals, deriv_fields, latitude, "lat",
-                Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask);
+        // Use the pre-computed stencils if they were built for this mask
+        if ( source_data.lat_deriv_op.applies_to( latitude, mask, 1, constants::DiffOrd ) ) {
+            source_data.lat_deriv_op.apply_at_point( lat_deriv_vals, deriv_fields, index );
+        } else {
+            spher_derivative_at_point<diff_dim::lat, 1, constants::DiffOrd>( lat_deriv_vals, deriv_fields, latitude,
+                    Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask);
+        }
 
-        spher_derivative_at_point( lon_deriv_vals, deriv_fields, longitude, "lon",
-                Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask);
+        if ( source_data.lon_deriv_op.applies_to( longitude, mask, 1, constants::DiffOrd ) ) {
+            source_data.lon_deriv_op.apply_at_point( lon_deriv_vals, deriv_fields, index );
+        } else {
+            spher_derivative_at_point<diff_dim::lon, 1, constants::DiffOrd>( lon_deriv_vals, deriv_fields, longitude,
+                    Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask);
+        }
 
         //spher_derivative_at_point( r_deriv_vals, deriv_fields, depth, "depth",
         //        Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask);
@@ -10,8 +10,24 @@
 dataset::dataset() {
 };
 
+/*!
+ * \brief Load the time dimension
+ *
+ * filename can also be a list or glob of several files (see expand_input_files), 
+ * in which case the time axis is the concatenation of the times in each file, and 
+ * variables are then read directly from the relevant files (see load_variables).
+ *
+ * @param[in]   dim_name    name of the time dimension
+ * @param[in]   filename    name of the file(s) from which to load the time
+ *
+ */
 void dataset::load_time( const std::string dim_name, const std::string filename ) {
+    time_files = expand_input_files( filename );
+    time_file_starts.assign( 1, 0 );
+
     if ( ( dim_name == "DNE" ) or ( dim_name == "DOES_NOT_EXIST" ) ) {
+        assert( time_files.size() == 1 ); // Can only split over several files along an existing time dimension
+        time_file_starts.push_back( 1 );
         time.resize(1);
         time[0] = 0.;
         #if DEBUG >= 1
@@ -20,7 +36,23 @@ void dataset::load_time( const std::string dim_name, const std::string filename
         if (wRank == 0) { fprintf(stdout, "Time dimension DNE, so setting as singleton.\n"); }
         #endif
     } else {
-        read_var_from_file(time, dim_name, filename);
+        time.clear();
+        std::vector<double> file_time;
+        for (size_t Ifile = 0; Ifile < time_files.size(); Ifile++) {
+            read_var_from_file(file_time, dim_name, time_files[Ifile]);
+
+            #if DEBUG >= 0
+            if ( ( time.size() > 0 ) and ( file_time.size() > 0 ) and ( file_time.front() <= time.back() ) ) {
+                int wRank=-1;
+                MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
+                if (wRank == 0) { fprintf(stderr, " WARNING!! Times in %s do not follow those in %s\n", 
+                                          time_files[Ifile].c_str(), time_files[Ifile-1].c_str() ); }
+            }
+            #endif
+
+            time.insert( time.end(), file_time.begin(), file_time.end() );
+            time_file_starts.push_back( time.size() );
+        }
     }
     full_Ntime = time.size();
 };
@@ -38,7 +70,7 @@ void dataset::load_depth( const std::string dim_name, const std::string filename
         }
         #endif
     } else {
-        read_var_from_file(depth, dim_name, filename);
+        read_var_from_file(depth, dim_name, expand_input_files( filename ).front());
     }
     full_Ndepth = depth.size();
 
@@ -50,12 +82,12 @@ void dataset::load_depth( const std::string dim_name, const std::string filename
 };
 
 void dataset::load_latitude( const std::string dim_name, const std::string filename ) {
-    read_var_from_file(latitude, dim_name, filename);
+    read_var_from_file(latitude, dim_name, expand_input_files( filename ).front());
     Nlat = latitude.size();
 };
 
 void dataset::load_longitude( const std::string dim_name, const std::string filename ) {
-    read_var_from_file(longitude, dim_name, filename);
+    read_var_from_file(longitude, dim_name, expand_input_files( filename ).front());
     Nlon = longitude.size();
 };
 
@@ -65,6 +97,14 @@ void dataset::compute_cell_areas() {
 
     areas.resize( Nlat * Nlon );
     compute_areas( areas, longitude, latitude );
+
+    // The grid is final by the time the areas are computed, so also cache its trigonometry
+    geometry.build( longitude, latitude );
+
+    // and the remapping onto the coarse map grid, if there is one
+    if ( coarse_map_lat.size() > 1 ) {
+        coarse_map_operator.build_for_coarse_map( latitude, longitude, coarse_map_lat, coarse_map_lon, areas );
+    }
 }
 
 void dataset::load_variable( 
@@ -76,6 +116,13 @@ void dataset::load_variable(
         const bool do_splits
         ) {
 
+    // If the time axis is spread over several files, then pass along to load_variables
+    const std::vector<std::string> input_files = expand_input_files( filename );
+    if ( input_files.size() > 1 ) {
+        load_variables( { std::make_pair( var_name, var_name_in_file ) }, filename, read_mask, load_counts, do_splits );
+        return;
+    }
+
     // Add a new entry to the variables dictionary with an empty array
     variables.insert( std::pair< std::string, std::vector<double> >( var_name, std::vector<double>() ) );
     
@@ -83,7 +130,7 @@ void dataset::load_variable(
     const double land_fill_value = 0;
 
     // Now read in from the file and store in the variables dictionary
-    read_var_from_file( variables.at( var_name ), var_name_in_file, filename, 
+    read_var_from_file( variables.at( var_name ), var_name_in_file, input_files.front(), 
                         read_mask ? &mask : NULL, 
                         load_counts ? &myCounts : NULL, 
                         load_counts ? &myStarts : NULL, 
@@ -92,6 +139,117 @@ void dataset::load_variable(
                         (Nprocs_in_quadrature == 1) ? MPI_COMM_WORLD : MPI_subcomm_samequadrature );
 };
 
+/*!
+ * \brief Load several variables from the same file, and store them in the variables dictionary
+ *
+ * Same as calling load_variable for each, except that the file is only opened once 
+ * (see read_vars_from_file), and the mask is determined from the first variable.
+ *
+ * If the time axis is spread over several files (see load_time), then each processor reads
+ * its own time range directly from the files that it overlaps. Variables are then assumed
+ * to have dimensions (time, depth, latitude, longitude).
+ *
+ * @param[in]   vars                    list of (name in dictionary, name in file) pairs
+ * @param[in]   filename                name of the file from which to load the variables
+ * @param[in]   read_mask               whether or not to (re-)determine the mask
+ * @param[in]   load_counts             whether or not to store myCounts and myStarts
+ * @param[in]   do_splits               whether or not to split the variables over MPI processors
+ * @param[in]   read_reference_mask     whether or not to also store the reference mask (which ignores FILTER_OVER_LAND)
+ *
+ */
+void dataset::load_variables( 
+        const std::vector< std::pair< std::string, std::string > > & vars,
+        const std::string filename,
+        const bool read_mask,
+        const bool load_counts,
+        const bool do_splits,
+        const bool read_reference_mask
+        ) {
+
+    std::vector< std::vector<double> * > var_ptrs;
+    std::vector< std::string > var_names_in_file;
+    for (size_t Ivar = 0; Ivar < vars.size(); Ivar++) {
+        // Add a new entry to the variables dictionary with an empty array
+        variables.insert( std::pair< std::string, std::vector<double> >( vars[Ivar].first, std::vector<double>() ) );
+        var_ptrs.push_back( &variables.at( vars[Ivar].first ) );
+        var_names_in_file.push_back( vars[Ivar].second );
+    }
+
+    const int force_split_dim = -1;
+    const double land_fill_value = 0;
+    const MPI_Comm comm = (Nprocs_in_quadrature == 1) ? MPI_COMM_WORLD : MPI_subcomm_samequadrature;
+
+    const std::vector< std::string > files = expand_input_files( filename );
+    if ( files.size() == 1 ) {
+        // Now read in from the file and store in the variables dictionary
+        read_vars_from_file( var_ptrs, var_names_in_file, files[0], 
+                             read_mask ? &mask : NULL, 
+                             load_counts ? &myCounts : NULL, 
+                             load_counts ? &myStarts : NULL, 
+                             Nprocs_in_time, Nprocs_in_depth,
+                             do_splits, force_split_dim, land_fill_value, comm,
+                             NULL, NULL,
+                             read_reference_mask ? &reference_mask : NULL );
+        return;
+    }
+
+    assert( files == time_files ); // Must first load the time axis (load_time) from the same files
+
+    // This processor's range of times and depths (same division as in read_var_from_file)
+    int wRank=-1, Itime_proc, Idepth_proc, Ilat_proc, Ilon_proc;
+    MPI_Comm_rank( comm, &wRank );
+    Index1to4( wRank, Itime_proc, Idepth_proc, Ilat_proc, Ilon_proc, Nprocs_in_time, Nprocs_in_depth, 1, 1 );
+
+    int time_start = 0, time_count = full_Ntime, depth_start = 0, depth_count = full_Ndepth;
+    if (do_splits) {
+        time_count  = full_Ntime  / Nprocs_in_time;
+        time_start  = Itime_proc  * time_count  + std::min( Itime_proc,  full_Ntime  % Nprocs_in_time  );
+        if (Itime_proc  < full_Ntime  % Nprocs_in_time ) { time_count++;  }
+
+        depth_count = full_Ndepth / Nprocs_in_depth;
+        depth_start = Idepth_proc * depth_count + std::min( Idepth_proc, full_Ndepth % Nprocs_in_depth );
+        if (Idepth_proc < full_Ndepth % Nprocs_in_depth) { depth_count++; }
+    }
+
+    if (load_counts) {
+        myCounts = { time_count, depth_count, Nlat, Nlon };
+        myStarts = { time_start, depth_start, 0,    0    };
+    }
+
+    for (size_t Ivar = 0; Ivar < vars.size(); Ivar++) { var_ptrs[Ivar]->clear(); }
+    if (read_mask)           { mask.clear(); }
+    if (read_reference_mask) { reference_mask.clear(); }
+
+    // Each processor only opens the files that overlap its time range, and reads
+    //   its part of each (independently of the other processors)
+    std::vector< std::vector<double> > file_vars( vars.size() );
+    std::vector< std::vector<double> * > file_var_ptrs;
+    for (size_t Ivar = 0; Ivar < vars.size(); Ivar++) { file_var_ptrs.push_back( &file_vars[Ivar] ); }
+    std::vector<bool> file_mask, file_reference_mask;
+    int file_lb, file_ub;
+    for (size_t Ifile = 0; Ifile < files.size(); Ifile++) {
+        file_lb = std::max( time_start,              time_file_starts[Ifile]     );
+        file_ub = std::min( time_start + time_count, time_file_starts[Ifile + 1] );
+        if (file_ub <= file_lb) { continue; }
+
+        const size_t slab_starts[4] = { (size_t) ( file_lb - time_file_starts[Ifile] ), (size_t) depth_start, 0, 0 },
+                     slab_counts[4] = { (size_t) ( file_ub - file_lb ), (size_t) depth_count, (size_t) Nlat, (size_t) Nlon };
+
+        read_vars_from_file( file_var_ptrs, var_names_in_file, files[Ifile], 
+                             read_mask ? &file_mask : NULL, NULL, NULL, 1, 1, 
+                             false, force_split_dim, land_fill_value, MPI_COMM_SELF,
+                             slab_starts, slab_counts,
+                             read_reference_mask ? &file_reference_mask : NULL );
+
+        // Time is the outermost dimension, so just append
+        for (size_t Ivar = 0; Ivar < vars.size(); Ivar++) {
+            var_ptrs[Ivar]->insert( var_ptrs[Ivar]->end(), file_vars[Ivar].begin(), file_vars[Ivar].end() );
+        }
+        if (read_mask)           { mask.insert( mask.end(), file_mask.begin(), file_mask.end() ); }
+        if (read_reference_mask) { reference_mask.insert( reference_mask.end(), file_reference_mask.begin(), file_reference_mask.end() ); }
+    }
+};
+
 void dataset::check_processor_divisions(    const int Nprocs_in_time_input, 
                                             const int Nprocs_in_depth_input, 
                                             const int Nprocs_in_quad_input, 
@@ -239,6 +397,44 @@ void dataset::compute_region_areas() {
             }
         }
     }
+
+    // Also index the regions by grid cell, for the postprocessing
+    list_regions_by_cell( region_cell_starts, region_cell_lists );
+}
+
+/*!
+ * \brief List the regions that contain each (horizontal) grid cell
+ *
+ * Cell Ilat * Nlon + Ilon is in regions cell_lists[ cell_starts[cell] ], ..., cell_lists[ cell_starts[cell + 1] - 1 ].
+ * This way, the region statistics can be accumulated for all regions in a single pass over a field,
+ * instead of looking up (in the regions map) every region at every point.
+ *
+ * @param[out]  cell_starts     start of each cell's list (size Nlat * Nlon + 1)
+ * @param[out]  cell_lists      region indices (in the order of region_names)
+ *
+ */
+void dataset::list_regions_by_cell(
+        std::vector<size_t> & cell_starts,
+        std::vector<int> & cell_lists
+        ) const {
+
+    const int num_regions = region_names.size();
+    const size_t num_cells = (size_t) Nlat * Nlon;
+
+    std::vector< const std::vector<bool> * > region_masks( num_regions );
+    for (int Iregion = 0; Iregion < num_regions; ++Iregion) {
+        region_masks[Iregion] = &regions.at( region_names.at( Iregion ) );
+    }
+
+    cell_starts.resize( num_cells + 1 );
+    cell_lists.clear();
+    for (size_t cell = 0; cell < num_cells; ++cell) {
+        cell_starts[cell] = cell_lists.size();
+        for (int Iregion = 0; Iregion < num_regions; ++Iregion) {
+            if ( (*region_masks[Iregion])[cell] ) { cell_lists.push_back( Iregion ); }
+        }
+    }
+    cell_starts[num_cells] = cell_lists.size();
 }
 
 
@@ -256,6 +452,11 @@ void dataset::prepare_for_coarsened_grids(
     // also do the areas of the coarsened map grid
     coarse_map_areas.resize( coarse_map_lat.size() * coarse_map_lon.size() );
     compute_areas( coarse_map_areas, coarse_map_lat, coarse_map_lon );
+
+    // If the cell areas are already computed, then the remapping can be built now (otherwise, see compute_cell_areas)
+    if ( ( coarse_map_lat.size() > 1 ) and ( areas.size() == (size_t) Nlat * Nlon ) and ( areas.size() > 0 ) ) {
+        coarse_map_operator.build_for_coarse_map( latitude, longitude, coarse_map_lat, coarse_map_lon, areas );
+    }
 }
 
 
@@ -340,6 +541,22 @@ void dataset::gather_mask_across_depth( const std::vector<bool> & var,
 }
 
 
+void dataset::build_derivative_operators( const int diff_ord ) {
+
+    lon_deriv_op.build( longitude, "lon", Ntime, Ndepth, Nlat, Nlon, mask, 1, diff_ord );
+    lat_deriv_op.build( latitude,  "lat", Ntime, Ndepth, Nlat, Nlon, mask, 1, diff_ord );
+
+    #if DEBUG >= 1
+    int wRank=-1;
+    MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
+    if (wRank == 0) {
+        fprintf( stdout, "Built derivative stencils (%zu in longitude, %zu in latitude).\n",
+                lon_deriv_op.num_stencils(), lat_deriv_op.num_stencils() );
+        fflush( stdout );
+    }
+    #endif
+}
+
 size_t dataset::local_index(  const int Itime, const int Idepth, const int Ilat, const int Ilon 
         ) const {
     return Index( Itime, Idepth, Ilat, Ilon, 
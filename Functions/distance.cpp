@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <math.h>    
 #include "../constants.hpp"
+#include "../functions.hpp"
 
 /*!
  * \brief Compute the distance (in metres) between two points in the domain.
@@ -65,31 +66,9 @@ double distance(
         }
         // Since cos is even and cos(2pi - x) = cos(x), we don't need to worry about periodicity in computing Delta_lon for cos(Delta_lon)
         //      for sin(Delta_lon), sin is odd and sin(2pi - x) = -sin(x), but since the result is being squared, it's not a concern either
-
-        long double Delta_sigma;
-
-        if (not(constants::USE_HIGH_PRECISION_DISTANCE)) {
-            // This is cheaper, and so long as our distances are at least a couple metres, the floating-point issues shouldn't arise.
-            const double acos_argument = sin_lat1 * sin_lat2 + cos_lat1 * cos_lat2 * cos_Delta_lon;
-            
-            // Handle some rounding cases when distance is nearly maximal
-            if ( ( acos_argument < -1 ) and ( fabs(acos_argument + 1) < 1e-10 ) ) { 
-                Delta_sigma = M_PI;
-            } else {
-                Delta_sigma = acos( acos_argument );
-            }
-        } else {
-            // If desired, use the more expensive distance calculator
-            long double numer, denom;
-            numer =   pow(                                    cos_lat2 * sin(Delta_lon), 2 ) 
-                    + pow( cos_lat1 * sin_lat2  -  sin_lat1 * cos_lat2 * cos_Delta_lon , 2 );
-            numer =  sqrt(numer);
-
-            denom =        sin_lat1 * sin_lat2  +  cos_lat1 * cos_lat2 * cos_Delta_lon ;
-
-            Delta_sigma = atan2(numer, denom);
-        }
-        distance = constants::R_earth * Delta_sigma;
+        //      (and sin(Delta_lon) is only needed for the high-precision version)
+        distance = grid_geometry::great_circle_distance( cos_lat1, sin_lat1, cos_lat2, sin_lat2, cos_Delta_lon,
+                                                         constants::USE_HIGH_PRECISION_DISTANCE ? sin( Delta_lon ) : 0. );
 
     }
 
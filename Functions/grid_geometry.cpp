@@ -0,0 +1,109 @@
+#include <math.h>
+#include <vector>
+#include <omp.h>
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+/*!
+ * \brief Compute the trigonometry and unit vectors of a grid
+ *
+ * @param[in]   longitude,latitude  grid (in radians for spherical coordinates)
+ *
+ */
+void grid_geometry::build(
+        const std::vector<double> & longitude,
+        const std::vector<double> & latitude
+        ) {
+
+    const int Nlon = longitude.size(),
+              Nlat = latitude.size();
+
+    lon_ptr = &longitude;
+    lat_ptr = &latitude;
+
+    cos_lon.resize( Nlon );
+    sin_lon.resize( Nlon );
+    for (int Ilon = 0; Ilon < Nlon; Ilon++) {
+        cos_lon[Ilon] = cos( longitude[Ilon] );
+        sin_lon[Ilon] = sin( longitude[Ilon] );
+    }
+
+    cos_lat.resize( Nlat );
+    sin_lat.resize( Nlat );
+    for (int Ilat = 0; Ilat < Nlat; Ilat++) {
+        cos_lat[Ilat] = cos( latitude[Ilat] );
+        sin_lat[Ilat] = sin( latitude[Ilat] );
+    }
+
+    r_hat_x.resize( Nlat * Nlon );
+    r_hat_y.resize( Nlat * Nlon );
+    r_hat_z.resize( Nlat * Nlon );
+
+    int Ilat, Ilon;
+    #pragma omp parallel default(none) \
+    private( Ilat, Ilon ) \
+    shared( r_hat_x, r_hat_y, r_hat_z, cos_lon, sin_lon, cos_lat, sin_lat ) \
+    firstprivate( Nlat, Nlon )
+    {
+        #pragma omp for collapse(1) schedule(static)
+        for (Ilat = 0; Ilat < Nlat; Ilat++) {
+            #pragma omp simd
+            for (Ilon = 0; Ilon < Nlon; Ilon++) {
+                r_hat_x[ Ilat * Nlon + Ilon ] = cos_lon[Ilon] * cos_lat[Ilat];
+                r_hat_y[ Ilat * Nlon + Ilon ] = sin_lon[Ilon] * cos_lat[Ilat];
+                r_hat_z[ Ilat * Nlon + Ilon ] = sin_lat[Ilat];
+            }
+        }
+    }
+
+    built = true;
+}
+
+/*!
+ * \brief Great-circle distance (in metres) from the trigonometry of the two points
+ *
+ * This is the spherical-coordinates part of distance(), which calls this. Distances between grid points
+ * can instead be computed from the cached unit vectors (see grid_geometry::distance_between).
+ *
+ * @param[in]   cos_lat1,sin_lat1           trigonometry of the latitude of the first position
+ * @param[in]   cos_lat2,sin_lat2           trigonometry of the latitude of the second position
+ * @param[in]   cos_Delta_lon,sin_Delta_lon trigonometry of the longitude difference
+ *
+ * @returns returns the distance (in metres) between two points.
+ *
+ */
+double grid_geometry::great_circle_distance(
+        const long double cos_lat1,
+        const long double sin_lat1,
+        const long double cos_lat2,
+        const long double sin_lat2,
+        const long double cos_Delta_lon,
+        const long double sin_Delta_lon
+        ) {
+
+    long double Delta_sigma;
+
+    if (not(constants::USE_HIGH_PRECISION_DISTANCE)) {
+        // This is cheaper, and so long as our distances are at least a couple metres, the floating-point issues shouldn't arise.
+        const double acos_argument = sin_lat1 * sin_lat2 + cos_lat1 * cos_lat2 * cos_Delta_lon;
+
+        // Handle some rounding cases when distance is nearly maximal
+        if ( ( acos_argument < -1 ) and ( fabs(acos_argument + 1) < 1e-10 ) ) {
+            Delta_sigma = M_PI;
+        } else {
+            Delta_sigma = acos( acos_argument );
+        }
+    } else {
+        // If desired, use the more expensive distance calculator
+        long double numer, denom;
+        numer =   pow(                                    cos_lat2 * sin_Delta_lon, 2 )
+                + pow( cos_lat1 * sin_lat2  -  sin_lat1 * cos_lat2 * cos_Delta_lon , 2 );
+        numer =  sqrt(numer);
+
+        denom =        sin_lat1 * sin_lat2  +  cos_lat1 * cos_lat2 * cos_Delta_lon ;
+
+        Delta_sigma = atan2(numer, denom);
+    }
+
+    return constants::R_earth * Delta_sigma;
+}
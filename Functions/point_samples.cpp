@@ -0,0 +1,187 @@
+#include <math.h>
+#include <vector>
+#include <float.h>
+#include <cassert>
+#include <omp.h>
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+/*!
+ * \brief Find the grid points in each window around each sample, and the points needed to compute them
+ *
+ * latitude, longitude, and windows should already be set, and use the same units as the grid
+ * (radians for spherical coordinates).
+ *
+ * @param[in]   source_data     dataset class instance with the (final) grid and cell areas
+ * @param[in]   halo            number of grid cells around the windows that are also needed (e.g. for derivatives)
+ *
+ */
+void point_samples::build(
+        const dataset & source_data,
+        const int halo
+        ) {
+
+    const std::vector<double>   &grid_lat   = source_data.latitude,
+                                &grid_lon   = source_data.longitude,
+                                &areas      = source_data.areas;
+
+    const int   Nlat        = source_data.Nlat,
+                Nlon        = source_data.Nlon,
+                Nsamp       = Nsamples(),
+                Nwin        = Nwindows();
+
+    // Physical domain lengths, for periodic Cartesian grids (see distance)
+    const double Llon = constants::CARTESIAN ? ( grid_lon.at(1) - grid_lon.at(0) ) * Nlon : 0.,
+                 Llat = constants::CARTESIAN ? ( grid_lat.at(1) - grid_lat.at(0) ) * Nlat : 0.;
+
+    double max_window = 0.;
+    for (int Iwin = 0; Iwin < Nwin; Iwin++) { max_window = fmax( max_window, windows[Iwin] ); }
+
+    // Only the latitudes within the largest window of a sample need to be checked
+    const double lat_reach = ( constants::CARTESIAN ) ? max_window : max_window / constants::R_earth;
+    const bool check_all_lats = constants::CARTESIAN and constants::PERIODIC_Y;
+
+    window_points.clear();
+    window_areas.clear();
+    window_points.resize( Nwin * Nsamp );
+    window_areas.resize(  Nwin * Nsamp );
+
+    int Isamp, Iwin, Ilat, Ilon, Ilat_near, Ilon_near;
+    double dist, dist_near;
+    #pragma omp parallel default(none) \
+    private( Isamp, Iwin, Ilat, Ilon, Ilat_near, Ilon_near, dist, dist_near ) \
+    shared( grid_lat, grid_lon, areas ) \
+    firstprivate( Nlat, Nlon, Nsamp, Nwin, Llon, Llat, lat_reach, check_all_lats )
+    {
+        #pragma omp for collapse(1) schedule(dynamic)
+        for (Isamp = 0; Isamp < Nsamp; Isamp++) {
+
+            const double lat0 = latitude[Isamp],
+                         lon0 = longitude[Isamp];
+
+            // The nearest grid point (for point samples, and for windows that are too small to catch any)
+            Ilat_near = 0;
+            for (Ilat = 1; Ilat < Nlat; Ilat++) {
+                if ( fabs( grid_lat[Ilat] - lat0 ) < fabs( grid_lat[Ilat_near] - lat0 ) ) { Ilat_near = Ilat; }
+            }
+            Ilon_near = 0;
+            dist_near = DBL_MAX;
+            for (Ilon = 0; Ilon < Nlon; Ilon++) {
+                dist = distance( grid_lon[Ilon], grid_lat[Ilat_near], lon0, lat0, Llon, Llat );
+                if ( dist < dist_near ) { dist_near = dist; Ilon_near = Ilon; }
+            }
+
+            for (Ilat = 0; Ilat < Nlat; Ilat++) {
+                if ( not(check_all_lats) and ( fabs( grid_lat[Ilat] - lat0 ) > lat_reach ) ) { continue; }
+                for (Ilon = 0; Ilon < Nlon; Ilon++) {
+                    dist = distance( grid_lon[Ilon], grid_lat[Ilat], lon0, lat0, Llon, Llat );
+                    for (Iwin = 0; Iwin < Nwin; Iwin++) {
+                        if ( dist <= windows[Iwin] ) {
+                            window_points[ Iwin * Nsamp + Isamp ].push_back( Ilat * Nlon + Ilon );
+                            window_areas[  Iwin * Nsamp + Isamp ].push_back( areas[ Ilat * Nlon + Ilon ] );
+                        }
+                    }
+                }
+            }
+
+            for (Iwin = 0; Iwin < Nwin; Iwin++) {
+                if ( window_points[ Iwin * Nsamp + Isamp ].empty() ) {
+                    window_points[ Iwin * Nsamp + Isamp ].push_back( Ilat_near * Nlon + Ilon_near );
+                    window_areas[  Iwin * Nsamp + Isamp ].push_back( areas[ Ilat_near * Nlon + Ilon_near ] );
+                }
+            }
+        }
+    }
+
+    // Flag the window points, and then grow them by the halo (first along longitude, then latitude)
+    std::vector<bool> in_windows( Nlat * Nlon, false );
+    for (size_t Iwp = 0; Iwp < window_points.size(); Iwp++) {
+        for (size_t Ipt = 0; Ipt < window_points[Iwp].size(); Ipt++) { in_windows[ window_points[Iwp][Ipt] ] = true; }
+    }
+
+    std::vector<bool> lon_grown( Nlat * Nlon, false );
+    for (Ilat = 0; Ilat < Nlat; Ilat++) {
+        for (Ilon = 0; Ilon < Nlon; Ilon++) {
+            if ( not(in_windows[ Ilat * Nlon + Ilon ]) ) { continue; }
+            for (int Ioff = -halo; Ioff <= halo; Ioff++) {
+                int curr_lon = Ilon + Ioff;
+                if (constants::PERIODIC_X) { curr_lon = ( curr_lon % Nlon + Nlon ) % Nlon; }
+                else if ( (curr_lon < 0) or (curr_lon >= Nlon) ) { continue; }
+                lon_grown[ Ilat * Nlon + curr_lon ] = true;
+            }
+        }
+    }
+
+    needed_points.assign( Nlat * Nlon, false );
+    for (Ilat = 0; Ilat < Nlat; Ilat++) {
+        for (Ilon = 0; Ilon < Nlon; Ilon++) {
+            if ( not(lon_grown[ Ilat * Nlon + Ilon ]) ) { continue; }
+            for (int Ioff = -halo; Ioff <= halo; Ioff++) {
+                int curr_lat = Ilat + Ioff;
+                if (constants::PERIODIC_Y) { curr_lat = ( curr_lat % Nlat + Nlat ) % Nlat; }
+                else if ( (curr_lat < 0) or (curr_lat >= Nlat) ) { continue; }
+                needed_points[ curr_lat * Nlon + Ilon ] = true;
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Area-weighted means of field over each window
+ *
+ * @param[out]  sampled         sampled values, ordered as (time, depth, window, sample)
+ * @param[out]  sampled_mask    false where a window has no (unmasked) points
+ * @param[in]   field           field to sample (MPI-local times and depths, full horizontal grid)
+ * @param[in]   mask            points to include (all, if NULL)
+ * @param[in]   Ntime,Ndepth    MPI-local number of times and depths in field
+ *
+ */
+void point_samples::sample(
+        std::vector<double> & sampled,
+        std::vector<bool> & sampled_mask,
+        const std::vector<double> & field,
+        const std::vector<bool> * mask,
+        const int Ntime,
+        const int Ndepth
+        ) const {
+
+    const size_t Nhoriz    = needed_points.size(),
+                 Nwinsamp  = window_points.size(),
+                 Nout      = (size_t) Ntime * Ndepth * Nwinsamp;
+
+    assert( field.size() == (size_t) Ntime * Ndepth * Nhoriz );
+
+    sampled.resize( Nout );
+    std::vector<double> sampled_areas( Nout );
+
+    size_t Iout, Ipt, index;
+    double field_sum, area_sum;
+    #pragma omp parallel default(none) \
+    private( Iout, Ipt, index, field_sum, area_sum ) \
+    shared( sampled, sampled_areas, field, mask ) \
+    firstprivate( Nhoriz, Nwinsamp, Nout )
+    {
+        #pragma omp for collapse(1) schedule(static)
+        for (Iout = 0; Iout < Nout; Iout++) {
+            const std::vector<size_t> & points = window_points[ Iout % Nwinsamp ];
+            const std::vector<double> & point_areas = window_areas[ Iout % Nwinsamp ];
+            const size_t offset = ( Iout / Nwinsamp ) * Nhoriz;
+
+            field_sum = 0.;
+            area_sum  = 0.;
+            for (Ipt = 0; Ipt < points.size(); Ipt++) {
+                index = offset + points[Ipt];
+                if ( (mask == NULL) or (*mask)[index] ) {
+                    field_sum += point_areas[Ipt] * field[index];
+                    area_sum  += point_areas[Ipt];
+                }
+            }
+            sampled[Iout]       = ( area_sum > 0 ) ? field_sum / area_sum : 0.;
+            sampled_areas[Iout] = area_sum;
+        }
+    }
+
+    // (std::vector<bool> can't be written from several threads)
+    sampled_mask.resize( Nout );
+    for (Iout = 0; Iout < Nout; Iout++) { sampled_mask[Iout] = ( sampled_areas[Iout] > 0 ); }
+}
@@ -0,0 +1,277 @@
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <mpi.h>
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+quantile_sketch::quantile_sketch( const double compression )
+    : compression( compression ), total( 0. ), min_value( DBL_MAX ), max_value( -DBL_MAX ) {}
+
+void quantile_sketch::clear() {
+    total = 0.;
+    min_value =  DBL_MAX;
+    max_value = -DBL_MAX;
+    means.clear();
+    weights.clear();
+    buffered_means.clear();
+    buffered_weights.clear();
+}
+
+void quantile_sketch::add( const double value, const double weight ) {
+    if ( weight <= 0 ) { return; }
+
+    buffered_means.push_back( value );
+    buffered_weights.push_back( weight );
+    total += weight;
+    min_value = fmin( min_value, value );
+    max_value = fmax( max_value, value );
+
+    if ( buffered_means.size() > 10 * compression ) { compress(); }
+}
+
+void quantile_sketch::merge( const quantile_sketch & other ) {
+    if ( other.empty() ) { return; }
+
+    buffered_means.insert(   buffered_means.end(),   other.means.begin(),            other.means.end() );
+    buffered_means.insert(   buffered_means.end(),   other.buffered_means.begin(),   other.buffered_means.end() );
+    buffered_weights.insert( buffered_weights.end(), other.weights.begin(),          other.weights.end() );
+    buffered_weights.insert( buffered_weights.end(), other.buffered_weights.begin(), other.buffered_weights.end() );
+    total += other.total;
+    min_value = fmin( min_value, other.min_value );
+    max_value = fmax( max_value, other.max_value );
+
+    if ( buffered_means.size() > 10 * compression ) { compress(); }
+}
+
+/*!
+ * \brief Merge the buffered values into the centroids, keeping the centroid sizes within the t-digest limits
+ *
+ * The limits come from the scale function k(q) = compression / (2 pi) * asin( 2q - 1 ): each centroid
+ * spans at most one unit of k, so centroids are small near q = 0 and q = 1 and larger in the middle.
+ *
+ */
+void quantile_sketch::compress() {
+
+    if ( buffered_means.empty() ) { return; }
+
+    std::vector< std::pair< double, double > > centroids;
+    centroids.reserve( means.size() + buffered_means.size() );
+    for (size_t II = 0; II < means.size(); II++) {
+        centroids.push_back( std::make_pair( means[II], weights[II] ) );
+    }
+    for (size_t II = 0; II < buffered_means.size(); II++) {
+        centroids.push_back( std::make_pair( buffered_means[II], buffered_weights[II] ) );
+    }
+    std::sort( centroids.begin(), centroids.end() );
+
+    means.clear();
+    weights.clear();
+    buffered_means.clear();
+    buffered_weights.clear();
+
+    // Scale function, and its inverse (clipped to [0,1])
+    const double norm = compression / ( 2. * M_PI );
+    auto k_of_q = [norm]( const double q ) { return norm * asin( fmax( -1., fmin( 1., 2. * q - 1. ) ) ); };
+    auto q_of_k = [norm]( const double k ) { return ( k >= norm * M_PI / 2. ) ? 1. : 0.5 * ( sin( k / norm ) + 1. ); };
+
+    double  weight_so_far = 0.,
+            curr_mean     = centroids[0].first,
+            curr_weight   = centroids[0].second,
+            weight_limit  = total * q_of_k( k_of_q( 0. ) + 1. );
+
+    for (size_t II = 1; II < centroids.size(); II++) {
+        if ( weight_so_far + curr_weight + centroids[II].second <= weight_limit ) {
+            curr_weight += centroids[II].second;
+            curr_mean   += ( centroids[II].first - curr_mean ) * centroids[II].second / curr_weight;
+        } else {
+            means.push_back( curr_mean );
+            weights.push_back( curr_weight );
+            weight_so_far += curr_weight;
+            weight_limit = total * q_of_k( k_of_q( weight_so_far / total ) + 1. );
+
+            curr_mean   = centroids[II].first;
+            curr_weight = centroids[II].second;
+        }
+    }
+    means.push_back( curr_mean );
+    weights.push_back( curr_weight );
+}
+
+/*!
+ * \brief Value below which a fraction q of the (total) weight lies
+ *
+ * Interpolates linearly between the centroid centres (and the extreme values at the ends).
+ * If only a few values have been added (no more than the buffer holds), they are not merged
+ * into centroids first, so the result is the exact (interpolated) order statistic.
+ *
+ * @param[in]   q       quantile, between 0 and 1
+ *
+ */
+double quantile_sketch::quantile( const double q ) {
+
+    if ( empty() ) { return constants::fill_value; }
+
+    if ( means.empty() ) {
+        // Just sort the values, without merging them into centroids
+        std::vector< std::pair< double, double > > values( buffered_means.size() );
+        for (size_t II = 0; II < values.size(); II++) { values[II] = std::make_pair( buffered_means[II], buffered_weights[II] ); }
+        std::sort( values.begin(), values.end() );
+
+        means.resize( values.size() );
+        weights.resize( values.size() );
+        for (size_t II = 0; II < values.size(); II++) {
+            means[II]   = values[II].first;
+            weights[II] = values[II].second;
+        }
+        buffered_means.clear();
+        buffered_weights.clear();
+    } else {
+        compress();
+    }
+
+    const size_t Ncent = means.size();
+    if ( Ncent == 1 ) { return means[0]; }
+
+    const double target = fmax( 0., fmin( 1., q ) ) * total;
+
+    // Below the first centre / above the last centre, interpolate to the extreme values
+    if ( target <= 0.5 * weights[0] ) {
+        return min_value + ( means[0] - min_value ) * target / ( 0.5 * weights[0] );
+    }
+    if ( target >= total - 0.5 * weights[Ncent-1] ) {
+        return max_value - ( max_value - means[Ncent-1] ) * ( total - target ) / ( 0.5 * weights[Ncent-1] );
+    }
+
+    double centre = 0.5 * weights[0], next_centre;
+    for (size_t II = 0; II < Ncent - 1; II++) {
+        next_centre = centre + 0.5 * ( weights[II] + weights[II+1] );
+        if ( target <= next_centre ) {
+            return means[II] + ( means[II+1] - means[II] ) * ( target - centre ) / ( next_centre - centre );
+        }
+        centre = next_centre;
+    }
+    return means[Ncent-1];
+}
+
+void quantile_sketch::pack( std::vector<double> & buffer ) {
+    compress();
+    buffer.push_back( (double) means.size() );
+    buffer.insert( buffer.end(), means.begin(),   means.end() );
+    buffer.insert( buffer.end(), weights.begin(), weights.end() );
+    buffer.push_back( min_value );
+    buffer.push_back( max_value );
+}
+
+size_t quantile_sketch::unpack( const std::vector<double> & buffer, const size_t position ) {
+    const size_t Ncent = (size_t) buffer.at( position );
+    const double * other_means   = &buffer[ position + 1 ],
+                 * other_weights = &buffer[ position + 1 + Ncent ];
+
+    for (size_t II = 0; II < Ncent; II++) {
+        buffered_means.push_back( other_means[II] );
+        buffered_weights.push_back( other_weights[II] );
+        total += other_weights[II];
+    }
+    if ( Ncent > 0 ) {
+        min_value = fmin( min_value, buffer.at( position + 1 + 2 * Ncent ) );
+        max_value = fmax( max_value, buffer.at( position + 2 + 2 * Ncent ) );
+    }
+
+    if ( buffered_means.size() > 10 * compression ) { compress(); }
+
+    return position + 3 + 2 * Ncent;
+}
+
+// Point-to-point transfers and broadcasts of a flat buffer, with the length sent as a 64-bit integer
+//   and the data sent in pieces that fit in an int count, so that large buffers are not truncated.
+static const size_t max_chunk = INT_MAX;
+
+static void send_sketch_buffer( const std::vector<double> & buffer, const int dest, const MPI_Comm comm ) {
+    const uint64_t length = buffer.size();
+    MPI_Send( &length, 1, MPI_UINT64_T, dest, 0, comm );
+    for (size_t start = 0; start < buffer.size(); start += max_chunk) {
+        MPI_Send( &buffer[start], (int) std::min( max_chunk, buffer.size() - start ), MPI_DOUBLE, dest, 1, comm );
+    }
+}
+
+static void recv_sketch_buffer( std::vector<double> & buffer, const int source, const MPI_Comm comm ) {
+    uint64_t length = 0;
+    MPI_Recv( &length, 1, MPI_UINT64_T, source, 0, comm, MPI_STATUS_IGNORE );
+    buffer.resize( length );
+    for (size_t start = 0; start < buffer.size(); start += max_chunk) {
+        MPI_Recv( &buffer[start], (int) std::min( max_chunk, buffer.size() - start ), MPI_DOUBLE, source, 1, comm, MPI_STATUS_IGNORE );
+    }
+}
+
+static void bcast_sketch_buffer( std::vector<double> & buffer, const int root, const MPI_Comm comm ) {
+    uint64_t length = buffer.size();
+    MPI_Bcast( &length, 1, MPI_UINT64_T, root, comm );
+    buffer.resize( length );
+    for (size_t start = 0; start < buffer.size(); start += max_chunk) {
+        MPI_Bcast( &buffer[start], (int) std::min( max_chunk, buffer.size() - start ), MPI_DOUBLE, root, comm );
+    }
+}
+
+/*!
+ * \brief Merge each sketch with its counterparts on all of the other processors in comm
+ *
+ * All processors need to have the same number of sketches (in the same order). The sketches are
+ * merged pairwise up a binomial tree onto rank 0 (so each processor only ever holds its own sketches
+ * and one incoming set, rather than everyone's), and the result is then broadcast, so that afterwards
+ * every processor holds the same (merged) sketches.
+ *
+ * @param[in,out]   sketches    sketches to merge
+ * @param[in]       comm        MPI communicator
+ *
+ */
+void merge_quantile_sketches(
+        std::vector<quantile_sketch> & sketches,
+        const MPI_Comm comm
+        ) {
+
+    int wRank=-1, wSize=-1;
+    MPI_Comm_rank( comm, &wRank );
+    MPI_Comm_size( comm, &wSize );
+
+    if ( ( wSize == 1 ) or ( sketches.empty() ) ) { return; }
+
+    std::vector<double> buffer;
+    size_t position;
+
+    // At each level, ranks that are multiples of 2*step take in the sketches of rank + step,
+    //   and the others hand theirs off and drop out
+    for (int step = 1; step < wSize; step *= 2) {
+        if ( wRank % (2 * step) == 0 ) {
+            if ( wRank + step < wSize ) {
+                recv_sketch_buffer( buffer, wRank + step, comm );
+                position = 0;
+                for (size_t Isketch = 0; Isketch < sketches.size(); Isketch++) {
+                    position = sketches[Isketch].unpack( buffer, position );
+                }
+            }
+        } else {
+            buffer.clear();
+            for (size_t Isketch = 0; Isketch < sketches.size(); Isketch++) { sketches[Isketch].pack( buffer ); }
+            send_sketch_buffer( buffer, wRank - step, comm );
+            break;
+        }
+    }
+
+    // Share the merged sketches
+    buffer.clear();
+    if ( wRank == 0 ) {
+        for (size_t Isketch = 0; Isketch < sketches.size(); Isketch++) { sketches[Isketch].pack( buffer ); }
+    }
+    bcast_sketch_buffer( buffer, 0, comm );
+
+    // Rank 0 also rebuilds from the buffer, so that every processor has identical sketches
+    position = 0;
+    for (size_t Isketch = 0; Isketch < sketches.size(); Isketch++) {
+        sketches[Isketch].clear();
+        position = sketches[Isketch].unpack( buffer, position );
+    }
+}
@@ -0,0 +1,156 @@
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <omp.h>
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+void remap_operator::build(
+        const int Nlat_fine_in,
+        const int Nlon_fine_in,
+        const std::vector<int> & lat_first,
+        const std::vector<int> & lat_last,
+        const std::vector<int> & lon_first,
+        const std::vector<int> & lon_last,
+        const std::vector<double> * fine_weights
+        ) {
+
+    assert( lat_first.size() == lat_last.size() );
+    assert( lon_first.size() == lon_last.size() );
+
+    Nlat_fine   = Nlat_fine_in;
+    Nlon_fine   = Nlon_fine_in;
+    Nlat_coarse = lat_first.size();
+    Nlon_coarse = lon_first.size();
+
+    const size_t Ncoarse = (size_t) Nlat_coarse * Nlon_coarse;
+
+    row_starts.resize( Ncoarse + 1 );
+    row_weights.assign( Ncoarse, 0. );
+    columns.clear();
+    weights.clear();
+
+    int Ilat, Ilon;
+    size_t Icoarse, cell;
+    for (int Ilat_coarse = 0; Ilat_coarse < Nlat_coarse; ++Ilat_coarse) {
+        for (int Ilon_coarse = 0; Ilon_coarse < Nlon_coarse; ++Ilon_coarse) {
+            Icoarse = Index(0, 0, Ilat_coarse, Ilon_coarse, 1, 1, Nlat_coarse, Nlon_coarse);
+            row_starts[Icoarse] = columns.size();
+
+            for ( Ilat = lat_first[Ilat_coarse]; Ilat < lat_last[Ilat_coarse]; Ilat++ ) {
+                for ( Ilon = lon_first[Ilon_coarse]; Ilon < lon_last[Ilon_coarse]; Ilon++ ) {
+                    cell = Index(0, 0, Ilat, Ilon, 1, 1, Nlat_fine, Nlon_fine);
+                    columns.push_back( cell );
+                    weights.push_back( ( fine_weights == NULL ) ? 1. : fine_weights->at(cell) );
+                    row_weights[Icoarse] += weights.back();
+                }
+            }
+        }
+    }
+    row_starts[Ncoarse] = columns.size();
+
+    built = true;
+}
+
+/*!
+ * \brief Build the area-weighted operator for the coarsened maps
+ *
+ * Coarse cell I spans the fine points from the first one at or above coarse point I to the
+ * last one before coarse point I+1 (or the second-to-last fine point, for the last coarse point),
+ * which is how compute_coarsened_map has always binned the fine grid.
+ *
+ * @param[in]   latitude, longitude                 fine grid (increasing)
+ * @param[in]   coarse_latitude, coarse_longitude   coarse grid (increasing)
+ * @param[in]   areas                               fine cell areas
+ *
+ */
+void remap_operator::build_for_coarse_map(
+        const std::vector<double> & latitude,
+        const std::vector<double> & longitude,
+        const std::vector<double> & coarse_latitude,
+        const std::vector<double> & coarse_longitude,
+        const std::vector<double> & areas
+        ) {
+
+    // Index range, along one dimension, of each coarse cell
+    auto bin_bounds = []( std::vector<int> & first, std::vector<int> & last,
+                          const std::vector<double> & grid, const std::vector<double> & coarse_grid ) {
+        const int N = grid.size(), N_coarse = coarse_grid.size();
+        first.resize( N_coarse );
+        last.resize( N_coarse );
+        for (int Ic = 0; Ic < N_coarse; ++Ic) {
+            first[Ic] = std::lower_bound( grid.begin(), grid.end(), coarse_grid[Ic] ) - grid.begin();
+            last[Ic]  = ( Ic + 1 < N_coarse )
+                        ? std::lower_bound( grid.begin(), grid.end(), coarse_grid[Ic+1] ) - grid.begin()
+                        : N - 1;
+
+            first[Ic] = ( first[Ic] < 0 ) ? 0 : ( first[Ic] >= N ) ? N - 1 : first[Ic];
+            last[Ic]  = ( last[Ic]  < 0 ) ? 0 : ( last[Ic]  >= N ) ? N - 1 : last[Ic];
+        }
+    };
+
+    std::vector<int> lat_first, lat_last, lon_first, lon_last;
+    bin_bounds( lat_first, lat_last, latitude,  coarse_latitude  );
+    bin_bounds( lon_first, lon_last, longitude, coarse_longitude );
+
+    build( latitude.size(), longitude.size(), lat_first, lat_last, lon_first, lon_last, &areas );
+}
+
+void remap_operator::apply(
+        std::vector< std::vector<double> > & coarse_fields,
+        std::vector<double> & water_weights,
+        const std::vector<const std::vector<double>*> & fine_fields,
+        const std::vector<bool> & fine_mask,
+        const int Ntime,
+        const int Ndepth
+        ) const {
+
+    assert( built );
+
+    const int num_fields = fine_fields.size();
+    const size_t Ncoarse = (size_t) Nlat_coarse * Nlon_coarse,
+                 Nfine   = (size_t) Nlat_fine   * Nlon_fine,
+                 Nlayers = (size_t) Ntime * Ndepth;
+
+    coarse_fields.resize( num_fields );
+    for (int Ifield = 0; Ifield < num_fields; ++Ifield) { coarse_fields[Ifield].resize( Nlayers * Ncoarse ); }
+    water_weights.resize( Nlayers * Ncoarse );
+
+    int Ifield;
+    size_t Ilayer, Icoarse, Ientry, fine_index, coarse_index;
+    double W;
+
+    #pragma omp parallel default(none)\
+    private( Ifield, Ilayer, Icoarse, Ientry, fine_index, coarse_index, W )\
+    shared( coarse_fields, water_weights, fine_fields, fine_mask ) \
+    firstprivate( num_fields, Ncoarse, Nfine, Nlayers )
+    {
+        std::vector<double> sums( num_fields );
+
+        #pragma omp for collapse(2) schedule(static)
+        for (Ilayer = 0; Ilayer < Nlayers; ++Ilayer) {
+            for (Icoarse = 0; Icoarse < Ncoarse; ++Icoarse) {
+
+                W = 0.;
+                std::fill( sums.begin(), sums.end(), 0. );
+
+                for (Ientry = row_starts[Icoarse]; Ientry < row_starts[Icoarse+1]; ++Ientry) {
+                    fine_index = Ilayer * Nfine + columns[Ientry];
+                    if ( fine_mask[fine_index] ) {
+                        W += weights[Ientry];
+                        for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+                            sums[Ifield] += weights[Ientry] * (*fine_fields[Ifield])[fine_index];
+                        }
+                    }
+                }
+
+                coarse_index = Ilayer * Ncoarse + Icoarse;
+                water_weights[coarse_index] = W;
+                for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+                    coarse_fields[Ifield][coarse_index] = ( W > 0 ) ? sums[Ifield] / W : 0.;
+                }
+            }
+        }
+    }
+}
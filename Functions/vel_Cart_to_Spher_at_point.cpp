@@ -41,11 +41,39 @@ void vel_Cart_to_Spher_at_point(
         u_lat = u_y;
         u_r   = u_z;
     } else {
-        const double cos_lon = cos(lon);
-        const double cos_lat = cos(lat);
-        const double sin_lon = sin(lon);
-        const double sin_lat = sin(lat);
+        vel_Cart_to_Spher_at_point( u_r, u_lon, u_lat, u_x, u_y, u_z, cos(lon), sin(lon), cos(lat), sin(lat) );
+    }
+}
 
+/*!
+ * \brief Convert single Cartesian velocity to spherical velocity, with the trigonometry of the location given
+ *
+ * Same as above, but for when sin / cos of the location are already known (e.g. from grid_geometry).
+ *
+ * @param[in,out]   u_r,u_lon,u_lat     Computed Spherical velocities
+ * @param[in]       u_x,u_y,u_z         Cartesian velocities to be converted
+ * @param[in]       cos_lon,sin_lon     cos and sin of the longitude of the location of conversion
+ * @param[in]       cos_lat,sin_lat     cos and sin of the latitude of the location of conversion
+ *
+ */
+void vel_Cart_to_Spher_at_point(
+            double & u_r,
+            double & u_lon,
+            double & u_lat,
+            const double u_x,
+            const double u_y,
+            const double u_z,
+            const double cos_lon,
+            const double sin_lon,
+            const double cos_lat,
+            const double sin_lat
+        ) {
+
+    if (constants::CARTESIAN) {
+        u_lon = u_x;
+        u_lat = u_y;
+        u_r   = u_z;
+    } else {
         u_r   =   u_x * cos_lon * cos_lat
                 + u_y * sin_lon * cos_lat
                 + u_z           * sin_lat;
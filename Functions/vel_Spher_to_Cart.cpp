@@ -3,7 +3,10 @@
 #include "../constants.hpp"
 
 /*!
- * \brief Wrapper that applies vel_Spher_to_Cart_at_point to every point in the domain.
+ * \brief Convert velocities from spherical to Cartesian at every point in the domain.
+ *
+ * Same as applying vel_Spher_to_Cart_at_point at every point, but using the pre-computed
+ *   trigonometry of the grid (source_data.geometry).
  *
  * @param[in,out]   u_x,u_y,u_z         Computed Cartesian velocities
  * @param[in]       u_r,u_lon,u_lat     Spherical velocities to convert
@@ -25,13 +28,25 @@ void vel_Spher_to_Cart(
 
     const std::vector<bool> &mask = source_data.mask;
 
-    const int   Ntime   = source_data.Ntime,
-                Ndepth  = source_data.Ndepth,
-                Nlat    = source_data.Nlat,
+    const int   Nlat    = source_data.Nlat,
                 Nlon    = source_data.Nlon;
 
-    size_t index;
-    int Itime, Idepth, Ilat, Ilon;
+    // Use the pre-computed trigonometry, unless it's for a different grid
+    grid_geometry local_geometry;
+    if ( not(constants::CARTESIAN) and not(source_data.geometry.applies_to( longitude, latitude )) ) {
+        local_geometry.build( longitude, latitude );
+    }
+    const grid_geometry & geometry = source_data.geometry.applies_to( longitude, latitude ) ? 
+                                        source_data.geometry : local_geometry;
+    const std::vector<double>   &cos_lon = geometry.cos_lon,
+                                &sin_lon = geometry.sin_lon,
+                                &cos_lat = geometry.cos_lat,
+                                &sin_lat = geometry.sin_lat;
+
+    // Loop through rows of constant (time, depth, latitude), so that the inner loop is contiguous
+    const size_t Nrows = u_lon.size() / Nlon;
+    size_t index, Irow;
+    int Ilat, Ilon;
 
     if (constants::CARTESIAN) {
         u_x = u_lon;
@@ -39,20 +54,28 @@ void vel_Spher_to_Cart(
         u_z = u_r;
     } else {
         #pragma omp parallel default(none) \
-        private( Itime, Idepth, Ilat, Ilon, index ) \
-        shared( u_x, u_y, u_z, u_r, u_lon, u_lat, longitude, latitude, mask, source_data ) \
-        firstprivate( Nlon, Nlat, Ntime, Ndepth )
+        private( Irow, Ilat, Ilon, index ) \
+        shared( u_x, u_y, u_z, u_r, u_lon, u_lat, mask, cos_lon, sin_lon, cos_lat, sin_lat ) \
+        firstprivate( Nlon, Nlat, Nrows )
         {
-            #pragma omp for collapse(1) schedule(guided)
-            for (index = 0; index < u_lon.size(); ++index) {
+            #pragma omp for collapse(1) schedule(static)
+            for (Irow = 0; Irow < Nrows; ++Irow) {
+                Ilat = Irow % Nlat;
+                for (Ilon = 0; Ilon < Nlon; ++Ilon) {
+                    index = Irow * Nlon + Ilon;
+
+                    if ( mask[index] ) { // Skip land areas
+                        u_x[index] =   u_r[index] * cos_lon[Ilon] * cos_lat[Ilat]
+                                     - u_lon[index] * sin_lon[Ilon]
+                                     - u_lat[index] * cos_lon[Ilon] * sin_lat[Ilat];
 
-                if ( mask.at(index) ) { // Skip land areas
-                    Index1to4( index, Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon );
+                        u_y[index] =   u_r[index] * sin_lon[Ilon] * cos_lat[Ilat]
+                                     + u_lon[index] * cos_lon[Ilon]
+                                     - u_lat[index] * sin_lon[Ilon] * sin_lat[Ilat];
 
-                    vel_Spher_to_Cart_at_point(     
-                            u_x.at(index), u_y.at(  index), u_z.at(  index),
-                            u_r.at(index), u_lon.at(index), u_lat.at(index),
-                            longitude.at(Ilon), latitude.at(Ilat));
+                        u_z[index] =   u_r[index]                 * sin_lat[Ilat]
+                                     + u_lat[index]               * cos_lat[Ilat];
+                    }
                 }
             }
         }
@@ -41,10 +41,39 @@ void vel_Spher_to_Cart_at_point(
         u_y = u_lat;
         u_z = u_r;
     } else {
-        const double cos_lon = cos(lon);
-        const double cos_lat = cos(lat);
-        const double sin_lon = sin(lon);
-        const double sin_lat = sin(lat);
+        vel_Spher_to_Cart_at_point( u_x, u_y, u_z, u_r, u_lon, u_lat, cos(lon), sin(lon), cos(lat), sin(lat) );
+    }
+}
+
+/*!
+ * \brief Convert single spherical velocity to Cartesian velocity, with the trigonometry of the location given
+ *
+ * Same as above, but for when sin / cos of the location are already known (e.g. from grid_geometry).
+ *
+ * @param[in,out]   u_x,u_y,u_z         Computed Cartesian velocities
+ * @param[in]       u_r,u_lon,u_lat     Spherical velocities to be converted
+ * @param[in]       cos_lon,sin_lon     cos and sin of the longitude of the location of conversion
+ * @param[in]       cos_lat,sin_lat     cos and sin of the latitude of the location of conversion
+ *
+ */
+void vel_Spher_to_Cart_at_point(
+            double & u_x,
+            double & u_y,
+            double & u_z,
+            const double u_r,
+            const double u_lon,
+            const double u_lat,
+            const double cos_lon,
+            const double sin_lon,
+            const double cos_lat,
+            const double sin_lat
+        ) {
+
+    if (constants::CARTESIAN) {
+        u_x = u_lon;
+        u_y = u_lat;
+        u_z = u_r;
+    } else {
         u_x =   u_r * cos_lon * cos_lat
             - u_lon * sin_lon
             - u_lat * cos_lon * sin_lat;
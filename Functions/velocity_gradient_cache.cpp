@@ -0,0 +1,103 @@
+#include <vector>
+#include <omp.h>
+#include <assert.h>
+#include "../functions.hpp"
+#include "../constants.hpp"
+#include "../differentiation_tools.hpp"
+
+/*!
+ * \brief Compute (and store) the Cartesian velocity gradient in a single pass
+ *
+ * Uses the same derivatives as compute_Pi and compute_div_transport (Cart_derivatives_at_point,
+ * without depth derivatives), so results computed from the cache are identical.
+ *
+ * @param[in]   source_data     dataset class instance containing the grid and mask
+ * @param[in]   ux,uy,uz        coarse Cartesian velocity components
+ * @param[in]   products        (optional) coarse velocity products uxux, uxuy, uxuz, uyuy, uyuz, uzuz
+ *                              whose derivatives are needed for compute_div_transport
+ *
+ */
+void velocity_gradient_cache::build(
+        const dataset & source_data,
+        const std::vector<double> & ux,
+        const std::vector<double> & uy,
+        const std::vector<double> & uz,
+        const std::vector<const std::vector<double>*> * products
+        ) {
+
+    const std::vector<bool> &mask = source_data.mask;
+    const size_t Npts = ux.size();
+    const bool do_products = ( products != NULL );
+
+    assert( uy.size() == Npts );
+    assert( uz.size() == Npts );
+    if (do_products) { assert( products->size() == 6 ); }
+
+    grad.assign( 9 * Npts, 0. );
+    if (do_products) { prod_deriv.assign( 9 * Npts, 0. ); }
+    else             { prod_deriv.clear(); }
+
+    // Fields to differentiate: the velocity, followed by the (upper-triangle) products
+    std::vector<const std::vector<double>*> deriv_fields { &ux, &uy, &uz };
+    if (do_products) { deriv_fields.insert( deriv_fields.end(), products->begin(), products->end() ); }
+    const int num_fields = deriv_fields.size();
+
+    // Where each product is, i.e. uiuj is deriv_fields[ prod_ind[3*ii + jj] ]
+    const int prod_ind[9] = { 3, 4, 5,
+                              4, 6, 7,
+                              5, 7, 8 };
+
+    int Itime, Idepth, Ilat, Ilon, ii, jj;
+    size_t index;
+    std::vector<double> x_derivs, y_derivs, z_derivs;
+    std::vector<double*> x_deriv_vals, y_deriv_vals, z_deriv_vals;
+
+    #pragma omp parallel \
+    default(none) \
+    shared( source_data, mask, deriv_fields, grad, prod_deriv, prod_ind ) \
+    private( Itime, Idepth, Ilat, Ilon, index, ii, jj, \
+             x_derivs, y_derivs, z_derivs, x_deriv_vals, y_deriv_vals, z_deriv_vals ) \
+    firstprivate( Npts, num_fields, do_products )
+    {
+        x_derivs.resize( num_fields );
+        y_derivs.resize( num_fields );
+        z_derivs.resize( num_fields );
+        x_deriv_vals.resize( num_fields );
+        y_deriv_vals.resize( num_fields );
+        z_deriv_vals.resize( num_fields );
+        for (ii = 0; ii < num_fields; ii++) {
+            x_deriv_vals.at(ii) = &x_derivs.at(ii);
+            y_deriv_vals.at(ii) = &y_derivs.at(ii);
+            z_deriv_vals.at(ii) = &z_derivs.at(ii);
+        }
+
+        #pragma omp for collapse(1) schedule(guided)
+        for (index = 0; index < Npts; index++) {
+
+            if ( constants::FILTER_OVER_LAND or mask.at(index) ) {
+
+                source_data.index1to4_local( index, Itime, Idepth, Ilat, Ilon);
+
+                Cart_derivatives_at_point(
+                        x_deriv_vals, y_deriv_vals, z_deriv_vals, deriv_fields,
+                        source_data, Itime, Idepth, Ilat, Ilon,
+                        1, constants::DiffOrd);
+
+                for (ii = 0; ii < 3; ii++) {
+                    grad[ 9 * index + 3 * ii + 0 ] = x_derivs[ii];
+                    grad[ 9 * index + 3 * ii + 1 ] = y_derivs[ii];
+                    grad[ 9 * index + 3 * ii + 2 ] = z_derivs[ii];
+                }
+
+                if (do_products) {
+                    for (ii = 0; ii < 3; ii++) {
+                        for (jj = 0; jj < 3; jj++) {
+                            const std::vector<double> & derivs = ( jj == 0 ) ? x_derivs : ( jj == 1 ) ? y_derivs : z_derivs;
+                            prod_deriv[ 9 * index + 3 * ii + jj ] = derivs[ prod_ind[ 3 * ii + jj ] ];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -15,12 +15,21 @@ void add_attr_to_file(
     MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
     MPI_Comm_size( MPI_COMM_WORLD, &wSize );
 
-    if (wRank == 0) {
+    // Per-rank outputs get the attribute in every part
+    const bool per_rank = is_per_rank_output( filename );
+    if (per_rank) { MPI_Comm_rank( comm, &wRank ); }
+
+    if ( (wRank == 0) and raw_file::is_raw( filename ) ) {
+        raw_file file;
+        file.read_header( filename );
+        file.add_attribute( varname, value );
+    } else if ( (wRank == 0) or per_rank ) {
         // Open the NETCDF file
         int FLAG = NC_WRITE;
         int ncid=0, retval;
         char buffer [50];
-        snprintf(buffer, 50, filename);
+        if (per_rank) { snprintf(buffer, 50, per_rank_output_name( filename, wRank ).c_str()); }
+        else          { snprintf(buffer, 50, filename); }
         retval = nc_open(buffer, FLAG, &ncid);
         if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
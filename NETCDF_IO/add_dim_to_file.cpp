@@ -0,0 +1,35 @@
+#include <vector>
+#include <string>
+#include "../netcdf_io.hpp"
+#include "../constants.hpp"
+
+void add_dim_to_file(
+        const std::string dim_name,
+        const size_t dim_len,
+        const char * filename
+        ) {
+
+    // Open the NETCDF file
+    int FLAG = NC_WRITE;
+    int ncid=0, retval;
+    char buffer [50];
+    snprintf(buffer, 50, filename);
+    retval = nc_open(buffer, FLAG, &ncid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    // Declare the dimension
+    int dim_id;
+    char dimname [50];
+    snprintf(dimname, 50, dim_name.c_str());
+    retval = nc_def_dim(ncid, dimname, dim_len, &dim_id);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    #if DEBUG >= 2
+    fprintf(stdout, "  - added dimension %s (length %zu) to %s -\n", dimname, dim_len, filename);
+    #endif
+
+    // Close the file
+    retval = nc_close(ncid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+}
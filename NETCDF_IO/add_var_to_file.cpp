@@ -1,6 +1,7 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
 #include "../netcdf_io.hpp"
 #include "../constants.hpp"
 #include <cassert>
@@ -19,6 +20,18 @@ void add_var_to_file(
                    "Cannot cast to both single and int. Update cast flags in constants.hpp\n"
                  );
 
+    if ( raw_file::is_raw( filename ) ) {
+        // Raw files always hold (unpacked) doubles, and only record the units
+        raw_file file;
+        file.read_header( filename );
+        file.add_variable( var_name, std::vector<std::string>( dim_list, dim_list + num_dims ),
+                           constants::variable_units.count( var_name ) ? constants::variable_units.at( var_name ) : "" );
+        #if DEBUG >= 2
+        fprintf(stdout, "  - added %s to %s -\n", var_name.c_str(), filename);
+        #endif
+        return;
+    }
+
     int datatype;
     if      (constants::CAST_TO_SINGLE) { datatype = NC_FLOAT;  }
     else if (constants::CAST_TO_INT   ) { datatype = NC_SHORT;  }
@@ -71,8 +84,15 @@ void add_var_to_file(
                     Okubo_avg_index = var_name.find("_OkuboWeiss_average"),
                     area_avg_index  = var_name.find("_area_average"),
                     coarse_map_index  = var_name.find("_coarsened_map"),
-                    zonal_avg_index = var_name.find("_zonal_average");
-    if ( time_avg_index != std::string::npos ) {
+                    zonal_avg_index = var_name.find("_zonal_average"),
+                    area_quant_index  = var_name.find("_area_quantiles"),
+                    zonal_quant_index = var_name.find("_zonal_quantiles");
+    if ( ( area_quant_index != std::string::npos ) or ( zonal_quant_index != std::string::npos ) ) {
+        nc_put_att_text( ncid, var_id, "variable_type", 
+                         constants::quantile_description.size(),    
+                         constants::quantile_description.c_str() );
+        substring = var_name.substr( 0, std::min( area_quant_index, zonal_quant_index ) );
+    } else if ( time_avg_index != std::string::npos ) {
         nc_put_att_text( ncid, var_id, "variable_type", 
                          constants::time_average_description.size(), 
                          constants::time_average_description.c_str() );
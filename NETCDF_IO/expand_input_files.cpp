@@ -0,0 +1,41 @@
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <glob.h>
+#include "../netcdf_io.hpp"
+
+std::vector< std::string > expand_input_files( const std::string & file_spec ) {
+
+    std::vector< std::string > files;
+
+    // Split on commas, and expand each entry as a (shell-style) glob
+    size_t entry_start = 0, entry_end;
+    std::string entry;
+    glob_t glob_result;
+    while ( entry_start <= file_spec.size() ) {
+        entry_end = file_spec.find( ',', entry_start );
+        if ( entry_end == std::string::npos ) { entry_end = file_spec.size(); }
+
+        // Trim whitespace
+        entry = file_spec.substr( entry_start, entry_end - entry_start );
+        entry.erase( 0, entry.find_first_not_of( " \t" ) );
+        entry.erase( entry.find_last_not_of( " \t" ) + 1 );
+
+        if ( not(entry.empty()) ) {
+            // glob returns matches in sorted order. If there are no matches, then keep 
+            //   the entry as-is, so that the usual missing-file errors are raised later.
+            if ( glob( entry.c_str(), 0, NULL, &glob_result ) == 0 ) {
+                for (size_t Imatch = 0; Imatch < glob_result.gl_pathc; Imatch++) {
+                    files.push_back( std::string( glob_result.gl_pathv[Imatch] ) );
+                }
+            } else {
+                files.push_back( entry );
+            }
+            globfree( &glob_result );
+        }
+
+        entry_start = entry_end + 1;
+    }
+
+    return files;
+}
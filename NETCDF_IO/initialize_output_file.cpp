@@ -1,6 +1,7 @@
 #include <math.h>
 #include <vector>
 #include <mpi.h>
+#include <cassert>
 #include "../netcdf_io.hpp"
 #include "../constants.hpp"
 
@@ -20,140 +21,209 @@ void initialize_output_file(
     if (wRank == 0) { fprintf(stdout, "\nPreparing to initialize the output file.\n"); }
     #endif
 
+    // With per-rank outputs, each processor's file only holds its own times and depths
+    const bool per_rank = per_rank_outputs() and not( raw_file::is_raw( filename ) );
+    int cRank = 0, cSize = 1;
+    size_t part_start[2] = {0, 0}, part_count[2] = {0, 0};
+    std::vector<double> part_time, part_depth;
+    if (per_rank) {
+        MPI_Comm_rank( comm, &cRank );
+        MPI_Comm_size( comm, &cSize );
+        assert( source_data.myStarts.size() == 4 );
+        for (int II = 0; II < 2; II++) {
+            part_start[II] = source_data.myStarts.at(II);
+            part_count[II] = source_data.myCounts.at(II);
+        }
+        part_time.assign(  source_data.time.begin()  + part_start[0], source_data.time.begin()  + part_start[0] + part_count[0] );
+        part_depth.assign( source_data.depth.begin() + part_start[1], source_data.depth.begin() + part_start[1] + part_count[1] );
+        register_per_rank_output( filename, part_start, part_count, comm );
+    }
+
     // Create some tidy names for variables
-    const std::vector<double>   &time       = source_data.time,
-                                &depth      = source_data.depth,
+    const std::vector<double>   &time       = per_rank ? part_time  : source_data.time,
+                                &depth      = per_rank ? part_depth : source_data.depth,
                                 &latitude   = source_data.latitude,
                                 &longitude  = source_data.longitude,
                                 &areas      = source_data.areas;
 
-    // Open the NETCDF file
-    int FLAG = NC_NETCDF4 | NC_CLOBBER | NC_MPIIO;
-    int ncid=0, retval;
     char buffer [50];
-    snprintf(buffer, 50, filename);
-    retval = nc_create_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    if (per_rank) { snprintf(buffer, 50, per_rank_output_name( filename, cRank ).c_str()); }
+    else          { snprintf(buffer, 50, filename); }
 
-    #if DEBUG>=2
-    if (wRank == 0) { fprintf(stdout, "    Logging the filter scale\n"); }
-    #endif
-    if ( filter_scale >= 0 ) {
-        retval = nc_put_att_double(ncid, NC_GLOBAL, "filter_scale", NC_DOUBLE, 1, &filter_scale);
-        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-    }
+    if ( raw_file::is_raw( filename ) ) {
+        // Raw files are set up by the root rank alone
+        if (wRank == 0) {
+            raw_file file;
+            file.create( filename, { {"time",      time.size()},
+                                     {"depth",     depth.size()},
+                                     {"latitude",  latitude.size()},
+                                     {"longitude", longitude.size()} } );
 
-    retval = nc_put_att_double(ncid, NC_GLOBAL, "rho0", NC_DOUBLE, 1, &constants::rho0);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            // Coordinates (lat/lon in degrees, to match what is read back from the netcdf outputs)
+            const double coord_scale = constants::CARTESIAN ? 1. : 180. / M_PI;
+            const std::vector<std::string> coord_names = {"time", "depth", "latitude", "longitude"};
+            const std::vector<const std::vector<double>*> coords = {&time, &depth, &latitude, &longitude};
+            for (size_t Icoord = 0; Icoord < coords.size(); Icoord++) {
+                file.add_variable( coord_names[Icoord], { coord_names[Icoord] } );
+                if (coords[Icoord]->size() == 0) { continue; }
+                double * coord = file.map_variable( coord_names[Icoord], true );
+                for (size_t II = 0; II < coords[Icoord]->size(); II++) {
+                    coord[II] = coords[Icoord]->at(II) * ( (Icoord >= 2) ? coord_scale : 1. );
+                }
+            }
 
-    // Record coordinate type
-    #if DEBUG>=2
-    if (wRank == 0) { fprintf(stdout, "    Logging the grid type\n"); }
-    #endif
-    if (constants::CARTESIAN) {
-        retval = nc_put_att_text(ncid, NC_GLOBAL, "coord-type", 10, "cartesian");
+            file.add_variable( "cell_areas", {"latitude", "longitude"} );
+            if (areas.size() > 0) {
+                double * cell_areas = file.map_variable( "cell_areas", true );
+                for (size_t II = 0; II < areas.size(); II++) { cell_areas[II] = areas[II]; }
+            }
+            file.unmap_all();
+
+            if ( filter_scale >= 0 ) { file.add_attribute( "filter_scale", filter_scale ); }
+            file.add_attribute( "CARTESIAN", constants::CARTESIAN ? 1. : 0. );
+        }
     } else {
-        retval = nc_put_att_text(ncid, NC_GLOBAL, "coord-type", 10, "spherical");
-    }
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
-    // Extract dimension sizes
-    const int Ntime   = time.size();
-    const int Ndepth  = depth.size();
-    const int Nlat    = latitude.size();
-    const int Nlon    = longitude.size();
+        // Open the NETCDF file
+        int FLAG = NC_NETCDF4 | NC_CLOBBER | NC_MPIIO;
+        int ncid=0, retval;
+        if (per_rank) { retval = nc_create(buffer, NC_NETCDF4 | NC_CLOBBER, &ncid); }
+        else          { retval = nc_create_par(buffer, FLAG, comm, mpi_io_hints(), &ncid); }
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        // Record where this part sits in the full file (for merge_per_rank_outputs)
+        if (per_rank) {
+            const double part_info[5] = { (double) cSize, (double) source_data.time.size(), (double) source_data.depth.size(),
+                                          (double) part_start[0], (double) part_start[1] };
+            const char * part_info_names[5] = { "per_rank_num_parts", "per_rank_full_Ntime", "per_rank_full_Ndepth",
+                                                "per_rank_time_start", "per_rank_depth_start" };
+            for (int II = 0; II < 5; II++) {
+                retval = nc_put_att_double(ncid, NC_GLOBAL, part_info_names[II], NC_DOUBLE, 1, &part_info[II]);
+                if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            }
+        }
 
-    // Define the dimensions
-    #if DEBUG>=2
-    if (wRank == 0) { fprintf(stdout, "    Defining the dimensions\n"); }
-    #endif
-    int time_dimid, depth_dimid, lat_dimid, lon_dimid;
-    retval = nc_def_dim(ncid, "time",      Ntime,     &time_dimid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-    retval = nc_def_dim(ncid, "depth",     Ndepth,    &depth_dimid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-    retval = nc_def_dim(ncid, "latitude",  Nlat,      &lat_dimid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-    retval = nc_def_dim(ncid, "longitude", Nlon,      &lon_dimid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-
-    // Define coordinate variables
-    #if DEBUG>=2
-    if (wRank == 0) { fprintf(stdout, "    Defining the dimension variables\n"); }
-    #endif
-    int time_varid, depth_varid, lat_varid, lon_varid;
-    retval = nc_def_var(ncid, "time",      NC_DOUBLE, 1, &time_dimid,  &time_varid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-    retval = nc_def_var(ncid, "depth",     NC_DOUBLE, 1, &depth_dimid, &depth_varid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-    retval = nc_def_var(ncid, "latitude",  NC_DOUBLE, 1, &lat_dimid,   &lat_varid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-    retval = nc_def_var(ncid, "longitude", NC_DOUBLE, 1, &lon_dimid,   &lon_varid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-
-    if (not(constants::CARTESIAN)) {
         #if DEBUG>=2
-        if (wRank == 0) { fprintf(stdout, "    Add scale factors for Rad to Degrees\n"); }
+        if (wRank == 0) { fprintf(stdout, "    Logging the filter scale\n"); }
         #endif
-        const double rad_to_degree = 180. / M_PI;
-        retval = nc_put_att_double(ncid, lon_varid, "scale_factor", 
-                NC_DOUBLE, 1, &rad_to_degree);
+        if ( filter_scale >= 0 ) {
+            retval = nc_put_att_double(ncid, NC_GLOBAL, "filter_scale", NC_DOUBLE, 1, &filter_scale);
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        }
+
+        retval = nc_put_att_double(ncid, NC_GLOBAL, "rho0", NC_DOUBLE, 1, &constants::rho0);
         if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-        retval = nc_put_att_double(ncid, lat_varid, "scale_factor", 
-                NC_DOUBLE, 1, &rad_to_degree);
+
+        // Record coordinate type
+        #if DEBUG>=2
+        if (wRank == 0) { fprintf(stdout, "    Logging the grid type\n"); }
+        #endif
+        if (constants::CARTESIAN) {
+            retval = nc_put_att_text(ncid, NC_GLOBAL, "coord-type", 10, "cartesian");
+        } else {
+            retval = nc_put_att_text(ncid, NC_GLOBAL, "coord-type", 10, "spherical");
+        }
         if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-    }
 
-    // Write the coordinate variables
-    #if DEBUG>=2
-    if (wRank == 0) { fprintf(stdout, "    Write the dimensions\n"); }
-    #endif
-    size_t start[1], count[1];
-    start[0] = 0;
-    count[0] = Ntime;
-    retval = nc_put_vara_double(ncid, time_varid,  start, count, &time[0]);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        // Extract dimension sizes
+        const int Ntime   = time.size();
+        const int Ndepth  = depth.size();
+        const int Nlat    = latitude.size();
+        const int Nlon    = longitude.size();
 
-    count[0] = Ndepth;
-    retval = nc_put_vara_double(ncid, depth_varid, start, count, &depth[0]);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        // Define the dimensions
+        #if DEBUG>=2
+        if (wRank == 0) { fprintf(stdout, "    Defining the dimensions\n"); }
+        #endif
+        int time_dimid, depth_dimid, lat_dimid, lon_dimid;
+        retval = nc_def_dim(ncid, "time",      Ntime,     &time_dimid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_def_dim(ncid, "depth",     Ndepth,    &depth_dimid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_def_dim(ncid, "latitude",  Nlat,      &lat_dimid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_def_dim(ncid, "longitude", Nlon,      &lon_dimid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        // Define coordinate variables
+        #if DEBUG>=2
+        if (wRank == 0) { fprintf(stdout, "    Defining the dimension variables\n"); }
+        #endif
+        int time_varid, depth_varid, lat_varid, lon_varid;
+        retval = nc_def_var(ncid, "time",      NC_DOUBLE, 1, &time_dimid,  &time_varid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_def_var(ncid, "depth",     NC_DOUBLE, 1, &depth_dimid, &depth_varid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_def_var(ncid, "latitude",  NC_DOUBLE, 1, &lat_dimid,   &lat_varid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_def_var(ncid, "longitude", NC_DOUBLE, 1, &lon_dimid,   &lon_varid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
-    count[0] = Nlat;
-    retval = nc_put_vara_double(ncid, lat_varid,   start, count, &latitude[0]);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        if (not(constants::CARTESIAN)) {
+            #if DEBUG>=2
+            if (wRank == 0) { fprintf(stdout, "    Add scale factors for Rad to Degrees\n"); }
+            #endif
+            const double rad_to_degree = 180. / M_PI;
+            retval = nc_put_att_double(ncid, lon_varid, "scale_factor", 
+                    NC_DOUBLE, 1, &rad_to_degree);
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            retval = nc_put_att_double(ncid, lat_varid, "scale_factor", 
+                    NC_DOUBLE, 1, &rad_to_degree);
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        }
 
-    count[0] = Nlon;
-    retval = nc_put_vara_double(ncid, lon_varid,   start, count, &longitude[0]);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        // Write the coordinate variables
+        #if DEBUG>=2
+        if (wRank == 0) { fprintf(stdout, "    Write the dimensions\n"); }
+        #endif
+        size_t start[1], count[1];
+        start[0] = 0;
+        count[0] = Ntime;
+        retval = nc_put_vara_double(ncid, time_varid,  start, count, &time[0]);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
-    // Write the cell areas for convenience
-    #if DEBUG>=2
-    if (wRank == 0) { fprintf(stdout, "    Write the cell areas\n"); }
-    #endif
-    int area_dimids[2];
-    area_dimids[0] = lat_dimid;
-    area_dimids[1] = lon_dimid;
-    int area_varid;
-    retval = nc_def_var(ncid, "cell_areas", NC_DOUBLE, 2, area_dimids, &area_varid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-
-    size_t area_start[2], area_count[2];
-    area_start[0] = 0;
-    area_start[1] = 0;
-    area_count[0] = Nlat;
-    area_count[1] = Nlon;
-    retval = nc_put_vara_double(ncid, area_varid, area_start, area_count, &areas[0]);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-
-    // Close the file
-    retval = nc_close(ncid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        count[0] = Ndepth;
+        retval = nc_put_vara_double(ncid, depth_varid, start, count, &depth[0]);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        count[0] = Nlat;
+        retval = nc_put_vara_double(ncid, lat_varid,   start, count, &latitude[0]);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        count[0] = Nlon;
+        retval = nc_put_vara_double(ncid, lon_varid,   start, count, &longitude[0]);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        // Write the cell areas for convenience
+        #if DEBUG>=2
+        if (wRank == 0) { fprintf(stdout, "    Write the cell areas\n"); }
+        #endif
+        int area_dimids[2];
+        area_dimids[0] = lat_dimid;
+        area_dimids[1] = lon_dimid;
+        int area_varid;
+        retval = nc_def_var(ncid, "cell_areas", NC_DOUBLE, 2, area_dimids, &area_varid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        size_t area_start[2], area_count[2];
+        area_start[0] = 0;
+        area_start[1] = 0;
+        area_count[0] = Nlat;
+        area_count[1] = Nlon;
+        retval = nc_put_vara_double(ncid, area_varid, area_start, area_count, &areas[0]);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        // Close the file
+        retval = nc_close(ncid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    }
 
     #if DEBUG >= 2
     if (wRank == 0) { fprintf(stdout, "\nOutput file (%s) initialized.\n", buffer); }
     #endif
 
-    if (wRank == 0) {
+    if ( (wRank == 0) or per_rank ) {
         #if DEBUG>=2
         if (wRank == 0) { fprintf(stdout, "    Root rank will now add each variable.\n"); }
         #endif
@@ -179,6 +249,9 @@ void initialize_output_file(
         add_attr_to_file("KernPad",                             (double) constants::KernPad,    filename);
     }
 
+    // The raw files are only touched by the root rank, so the others need to wait for it
+    if ( raw_file::is_raw( filename ) ) { MPI_Barrier(comm); }
+
     #if DEBUG >= 2
     if (wRank == 0) { fprintf(stdout, "\n"); }
     #endif
@@ -21,7 +21,7 @@ void initialize_particle_file(
     int ncid=0, retval;
     char buffer [50];
     snprintf(buffer, 50, filename.c_str());
-    retval = nc_create_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
+    retval = nc_create_par(buffer, FLAG, comm, mpi_io_hints(), &ncid);
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
     // Record coordinate type
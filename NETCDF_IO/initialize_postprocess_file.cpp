@@ -32,7 +32,7 @@ void initialize_postprocess_file(
     int ncid=0, retval;
     char buffer [50];
     snprintf(buffer, 50, filename);
-    retval = nc_create_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
+    retval = nc_create_par(buffer, FLAG, comm, mpi_io_hints(), &ncid);
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
     retval = nc_put_att_double(ncid, NC_GLOBAL, "filter_scale", NC_DOUBLE, 1, &filter_scale);
@@ -51,10 +51,11 @@ void initialize_postprocess_file(
                 Nlat    = latitude.size(),
                 Nlon    = longitude.size(),
                 Nregion = source_data.region_names.size(),
-                Nokubo  = OkuboWeiss_dim_vals.size();
+                Nokubo  = OkuboWeiss_dim_vals.size(),
+                Nquant  = constants::POSTPROCESS_QUANTILES.size();
 
     // Define the dimensions
-    int time_dimid, depth_dimid, lat_dimid, lon_dimid, reg_dimid, Okubo_dimid;
+    int time_dimid, depth_dimid, lat_dimid, lon_dimid, reg_dimid, Okubo_dimid, quant_dimid;
     retval = nc_def_dim(ncid, "time",      Ntime,     &time_dimid);
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
     retval = nc_def_dim(ncid, "depth",     Ndepth,    &depth_dimid);
@@ -69,9 +70,13 @@ void initialize_postprocess_file(
         retval = nc_def_dim(ncid, "OkuboWeiss", Nokubo, &Okubo_dimid);
         if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
     }
+    if (Nquant > 0) {
+        retval = nc_def_dim(ncid, "quantile", Nquant, &quant_dimid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    }
 
     // Define coordinate variables
-    int time_varid, depth_varid, lat_varid, lon_varid, reg_varid, Okubo_varid;
+    int time_varid, depth_varid, lat_varid, lon_varid, reg_varid, Okubo_varid, quant_varid;
     retval = nc_def_var(ncid, "time",      NC_DOUBLE,  1, &time_dimid,  &time_varid);
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
     retval = nc_def_var(ncid, "depth",     NC_DOUBLE,  1, &depth_dimid, &depth_varid);
@@ -86,6 +91,10 @@ void initialize_postprocess_file(
         retval = nc_def_var(ncid, "OkuboWeiss",    NC_DOUBLE, 1,  &Okubo_dimid,   &Okubo_varid);
         if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
     }
+    if (Nquant > 0) {
+        retval = nc_def_var(ncid, "quantile",  NC_DOUBLE, 1,  &quant_dimid,   &quant_varid);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    }
 
     std::string degrees_north = "degrees_north", degrees_east = "degrees_east";
     nc_put_att_text( ncid, lat_varid, "units", degrees_north.size(), degrees_north.c_str() );
@@ -124,6 +133,12 @@ void initialize_postprocess_file(
         if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
     }
 
+    if (Nquant > 0) {
+        count[0] = Nquant;
+        retval = nc_put_vara_double(ncid, quant_varid, start, count, &constants::POSTPROCESS_QUANTILES[0]);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    }
+
     // Coarsened-grid dimensions and variables
     int coarse_lat_dimid, coarse_lon_dimid, coarse_lat_varid, coarse_lon_varid;
     if ( source_data.coarse_map_lat.size() > 1 ) {
@@ -196,6 +211,16 @@ void initialize_postprocess_file(
             add_var_to_file(int_vars.at(varInd)+"_area_std_dev", dim_names, ndims, buffer);
         }
 
+        // region quantiles
+        if (Nquant > 0) {
+            const char* dim_names_quant[] = {"time", "depth", "quantile", "region"};
+            const char* dim_names_quant_all[] = {"depth", "quantile", "region"};
+            for (size_t varInd = 0; varInd < int_vars.size(); ++varInd) {
+                add_var_to_file( int_vars.at(varInd)+"_area_quantiles", dim_names_quant, 4, buffer);
+                add_var_to_file( int_vars.at(varInd)+"_area_quantiles_all_times", dim_names_quant_all, 3, buffer);
+            }
+        }
+
         // time averages
         if (constants::POSTPROCESS_DO_TIME_MEANS) {
             const char* dim_names_time_ave[] = {"depth", "latitude", "longitude"};
@@ -226,6 +251,15 @@ void initialize_postprocess_file(
                 add_var_to_file( int_vars.at(varInd)+"_zonal_median", dim_names_time_ave, ndims_time_ave, buffer);
                 //add_var_to_file(int_vars.at(varInd)+"_zonal_std_dev", dim_names_time_ave, ndims_time_ave, buffer);
             }
+
+            if (Nquant > 0) {
+                const char* dim_names_quant[] = {"time", "depth", "quantile", "latitude"};
+                const char* dim_names_quant_all[] = {"depth", "quantile", "latitude"};
+                for (size_t varInd = 0; varInd < int_vars.size(); ++varInd) {
+                    add_var_to_file( int_vars.at(varInd)+"_zonal_quantiles", dim_names_quant, 4, buffer);
+                    add_var_to_file( int_vars.at(varInd)+"_zonal_quantiles_all_times", dim_names_quant_all, 3, buffer);
+                }
+            }
         }
 
         // region averages : averaged over OkuboWeiss contours
@@ -1,14 +1,23 @@
 #include <math.h>
 #include <vector>
+#include <string>
+#include <map>
 #include <mpi.h>
 #include "../netcdf_io.hpp"
 #include "../constants.hpp"
 
+// The samples of each file that has been initialized as a subset file
+static std::map< std::string, const point_samples * > subset_files;
+
+const point_samples * subset_output_samples( const std::string & filename ) {
+    const std::map< std::string, const point_samples * >::const_iterator entry = subset_files.find( filename );
+    return ( entry == subset_files.end() ) ? NULL : entry->second;
+}
+
 void initialize_subset_file(
         const std::vector<double> & time,       /**< [in] time vector (1D) */
         const std::vector<double> & depth,      /**< [in] longitude vector (1D) */
-        const std::vector<double> & windows,    /**< [in] windowing sizes */
-        const int & Nsamples,                   /**< [in] number of samples */
+        const point_samples & samples,          /**< [in] sample locations and windows */
         const std::vector<std::string> & vars,  /**< [in] name of variables to write */
         const char * filename,                  /**< [in] name for the output file */
         const double filter_scale,              /**< [in] lengthscale used in the filter */
@@ -24,7 +33,7 @@ void initialize_subset_file(
     int ncid=0, retval;
     char buffer [50];
     snprintf(buffer, 50, filename);
-    retval = nc_create_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
+    retval = nc_create_par(buffer, FLAG, comm, mpi_io_hints(), &ncid);
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
     retval = nc_put_att_double(ncid, NC_GLOBAL, "filter_scale", NC_FLOAT, 1, &filter_scale);
@@ -36,7 +45,8 @@ void initialize_subset_file(
     // Extract dimension sizes
     const int Ntime    = time.size();
     const int Ndepth   = depth.size();
-    const int Nwindows = windows.size();
+    const int Nwindows = samples.Nwindows();
+    const int Nsamples = samples.Nsamples();
 
     // Define the dimensions
     int time_dimid, depth_dimid, wind_dimid, samp_dimid;
@@ -60,6 +70,21 @@ void initialize_subset_file(
     retval = nc_def_var(ncid, "sample", NC_FLOAT, 1, &samp_dimid,  &samp_varid);
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
+    // Locations of the samples
+    int samp_lat_varid, samp_lon_varid;
+    retval = nc_def_var(ncid, "sample_latitude",  NC_DOUBLE, 1, &samp_dimid, &samp_lat_varid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_def_var(ncid, "sample_longitude", NC_DOUBLE, 1, &samp_dimid, &samp_lon_varid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    if (not(constants::CARTESIAN)) {
+        const double rad_to_degree = 180. / M_PI;
+        retval = nc_put_att_double(ncid, samp_lon_varid, "scale_factor", NC_DOUBLE, 1, &rad_to_degree);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_put_att_double(ncid, samp_lat_varid, "scale_factor", NC_DOUBLE, 1, &rad_to_degree);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    }
+
     // Write the coordinate variables
     size_t start[1], count[1];
     start[0] = 0;
@@ -72,7 +97,19 @@ void initialize_subset_file(
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
     count[0] = Nwindows;
-    retval = nc_put_vara_double(ncid, wind_varid, start, count, &windows[0]);
+    retval = nc_put_vara_double(ncid, wind_varid, start, count, &samples.windows[0]);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    std::vector<double> sample_index( Nsamples );
+    for (int Isamp = 0; Isamp < Nsamples; Isamp++) { sample_index[Isamp] = Isamp; }
+    count[0] = Nsamples;
+    retval = nc_put_vara_double(ncid, samp_varid, start, count, &sample_index[0]);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    retval = nc_put_vara_double(ncid, samp_lat_varid, start, count, &samples.latitude[0]);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    retval = nc_put_vara_double(ncid, samp_lon_varid, start, count, &samples.longitude[0]);
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
     // Close the file
@@ -92,4 +129,7 @@ void initialize_subset_file(
             add_var_to_file(vars.at(varInd), dim_names, ndims, buffer);
         }
     }
+
+    // From now on, fields written to this file are sampled first (see output_batch::write)
+    subset_files[ filename ] = &samples;
 }
@@ -34,7 +34,7 @@ void dataset::load_region_definitions(
     }
     #endif
 
-    retval = nc_open_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
+    retval = nc_open_par(buffer, FLAG, comm, mpi_io_hints(), &ncid);
     if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
 
     int dim_id, name_id;
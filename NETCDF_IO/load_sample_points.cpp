@@ -0,0 +1,68 @@
+#include "../netcdf_io.hpp"
+#include "../constants.hpp"
+#include "../functions.hpp"
+#include <cassert>
+
+/*!
+ * \brief Read in sample locations (e.g. moorings) and set up the windows around them for subset outputs
+ *
+ * The file only needs 1D latitude and longitude variables (of the same length) giving the sample locations.
+ *
+ * @param[in]   filename            netcdf file with the sample locations
+ * @param[in]   lat_name,lon_name   names of the sample latitude / longitude variables in the file
+ * @param[in]   windows             window radii (in metres) over which to average around each sample (0 for point values)
+ * @param[in]   in_degrees          whether the sample locations are in degrees (ignored for Cartesian grids)
+ * @param[in]   halo                number of grid cells kept around the windows for the derivative stencils.
+ *                                  Each derivative taken of the coarse fields before sampling needs DiffOrd cells
+ *                                  (e.g. Z needs two in coarse_grain, and three in coarse_grain_helmholtz,
+ *                                  where the velocities are themselves derivatives of Psi and Phi)
+ * @param[in]   comm                MPI Communicator
+ *
+ */
+void dataset::load_sample_points(
+        const std::string filename,
+        const std::string lat_name,
+        const std::string lon_name,
+        const std::vector<double> & windows,
+        const bool in_degrees,
+        const int halo,
+        const MPI_Comm comm
+        ) {
+
+    assert( check_file_existence( filename.c_str() ) ); // Make sure the file exists
+    assert( ( Nlat > 0 ) and ( Nlon > 0 ) and ( areas.size() == (size_t) Nlat * Nlon ) ); // The grid should already be final
+
+    int wRank, wSize;
+    MPI_Comm_rank( comm, &wRank );
+    MPI_Comm_size( comm, &wSize );
+
+    #if DEBUG >= 1
+    if (wRank == 0) {
+        fprintf(stdout, "Attempting to read sample locations from %s\n", filename.c_str());
+        fflush(stdout);
+    }
+    #endif
+
+    read_var_from_file( samples.latitude,  lat_name, filename, NULL, NULL, NULL, 1, 1, false );
+    read_var_from_file( samples.longitude, lon_name, filename, NULL, NULL, NULL, 1, 1, false );
+    assert( samples.latitude.size() == samples.longitude.size() );
+
+    if (in_degrees) { convert_coordinates( samples.longitude, samples.latitude ); }
+
+    samples.windows = windows;
+    if ( samples.windows.empty() ) { samples.windows.push_back( 0. ); }
+
+    // The coarse fields are differentiated before being sampled, so keep
+    //   enough of a halo around the windows for the derivative stencils
+    samples.build( *this, halo );
+
+    #if DEBUG >= 0
+    if (wRank == 0) {
+        size_t Nneeded = 0;
+        for (size_t II = 0; II < samples.needed_points.size(); II++) { if (samples.needed_points[II]) { Nneeded++; } }
+        fprintf(stdout, "  %'zu samples with %'zu windows, using %'zu of %'zu grid points\n",
+                samples.Nsamples(), samples.Nwindows(), Nneeded, samples.needed_points.size());
+        fflush(stdout);
+    }
+    #endif
+}
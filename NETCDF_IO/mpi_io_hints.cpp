@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include <utility>
+#include <mpi.h>
+#include "../netcdf_io.hpp"
+#include "../constants.hpp"
+
+// Hints (in the order given), and the MPI_Info built from them (rebuilt when the hints change)
+static std::vector< std::pair< std::string, std::string > > hint_list;
+static bool hints_initialized = false, hints_changed = false;
+static MPI_Info hint_info = MPI_INFO_NULL;
+
+// Bytes written and time spent writing (on this processor), for the bandwidth report
+static double bytes_written = 0., time_writing = 0.;
+static size_t num_writes = 0;
+
+// Add "key=value" pairs (comma-separated) to the hints, replacing any earlier values for the same keys
+static void add_hints( const std::string & hints ) {
+    size_t pos = 0, end, eq;
+    while (pos < hints.size()) {
+        end = hints.find( ',', pos );
+        if (end == std::string::npos) { end = hints.size(); }
+        const std::string entry = hints.substr( pos, end - pos );
+        pos = end + 1;
+
+        eq = entry.find( '=' );
+        if ( (eq == std::string::npos) or (eq == 0) ) {
+            if (entry.find_first_not_of(" ") != std::string::npos) {
+                fprintf( stderr, "Ignoring badly formatted MPI-IO hint '%s' (should be key=value)\n", entry.c_str() );
+            }
+            continue;
+        }
+        const size_t key_start = entry.find_first_not_of(" "),
+                     key_end   = entry.find_last_not_of(" ", eq - 1),
+                     val_start = entry.find_first_not_of(" ", eq + 1),
+                     val_end   = entry.find_last_not_of(" ");
+        const std::string key   = entry.substr( key_start, key_end + 1 - key_start ),
+                          value = (val_start == std::string::npos) ? "" : entry.substr( val_start, val_end + 1 - val_start );
+
+        bool found = false;
+        for (size_t II = 0; II < hint_list.size(); II++) {
+            if (hint_list[II].first == key) { hint_list[II].second = value; found = true; }
+        }
+        if (not(found)) { hint_list.push_back( std::make_pair( key, value ) ); }
+        hints_changed = true;
+    }
+}
+
+static void initialize_hints() {
+    if (hints_initialized) { return; }
+    hints_initialized = true;
+    const char * env_hints = getenv( "FLOWSIEVE_MPIIO_HINTS" );
+    if (env_hints != NULL) { add_hints( env_hints ); }
+}
+
+void set_mpi_io_hints( const std::string & hints ) {
+    initialize_hints();
+    add_hints( hints );
+}
+
+MPI_Info mpi_io_hints() {
+    initialize_hints();
+    if (hints_changed) {
+        if (hint_info != MPI_INFO_NULL) { MPI_Info_free( &hint_info ); }
+        if (hint_list.size() > 0) {
+            MPI_Info_create( &hint_info );
+            for (size_t II = 0; II < hint_list.size(); II++) {
+                MPI_Info_set( hint_info, hint_list[II].first.c_str(), hint_list[II].second.c_str() );
+            }
+        }
+        hints_changed = false;
+    }
+    return hint_info;
+}
+
+void record_write_bandwidth( const double bytes, const double seconds ) {
+    bytes_written += bytes;
+    time_writing  += seconds;
+    num_writes++;
+}
+
+void print_write_bandwidth( const MPI_Comm comm ) {
+
+    int wRank;
+    MPI_Comm_rank( comm, &wRank );
+
+    // Processors write at the same time, so the aggregate rate uses the total bytes and the slowest processor
+    double total_bytes, max_time;
+    MPI_Reduce( &bytes_written, &total_bytes, 1, MPI_DOUBLE, MPI_SUM, 0, comm );
+    MPI_Reduce( &time_writing,  &max_time,    1, MPI_DOUBLE, MPI_MAX, 0, comm );
+
+    if (wRank == 0) {
+        fprintf( stdout, "\nOutput writes: %zu writes, %.4g MB in %.4g s (aggregate %.4g MB/s)\n",
+                num_writes, total_bytes / 1e6, max_time, (max_time > 0) ? total_bytes / 1e6 / max_time : 0. );
+        initialize_hints();
+        if (hint_list.size() == 0) {
+            fprintf( stdout, "  MPI-IO hints: none (set with FLOWSIEVE_MPIIO_HINTS or --mpi_io_hints)\n" );
+        } else {
+            fprintf( stdout, "  MPI-IO hints:" );
+            for (size_t II = 0; II < hint_list.size(); II++) {
+                fprintf( stdout, " %s=%s", hint_list[II].first.c_str(), hint_list[II].second.c_str() );
+            }
+            fprintf( stdout, "\n" );
+        }
+    }
+}
@@ -4,68 +4,107 @@
 #include "../netcdf_io.hpp"
 #include "../constants.hpp"
 
-void package_field(
-        std::vector<signed short> & packaged,
-        double & scale_factor,
-        double & add_offset,
-        const std::vector<double> & original,
-        const std::vector<bool> * mask,
-        MPI_Comm comm
+void field_extremes(
+        double & fmin,
+        double & fmax,
+        const std::vector<double> & field,
+        const std::vector<bool> * mask
         ) {
 
+    const double * vals = field.data();
+    const size_t Npts = field.size();
     size_t index;
+    double fmin_loc = 0, fmax_loc = 0, val;
 
-    // First, we need to compute the min and max values 
-    //   to allow us to convert to signed shorts
-    double fmax, fmin, fmin_loc=0, fmax_loc=0;
+    // Land values are replaced by zero, which doesn't change the extremes (since
+    //   they start from zero), so that the loops vectorize without branching
     #pragma omp parallel \
-    default(none) private(index) \
-    shared(original, mask) \
+    default(none) private(index, val) \
+    shared(vals, mask) firstprivate(Npts) \
     reduction(max : fmax_loc) reduction(min : fmin_loc)
     {
-        #pragma omp for collapse(1) schedule(guided)
-        for (index = 0; index < original.size(); index++) {
-            if ( mask->at(index) ) {
-                fmax_loc = std::max(fmax_loc, original.at(index));
-                fmin_loc = std::min(fmin_loc, original.at(index));
+        if (mask == NULL) {
+            #pragma omp for simd collapse(1) schedule(static)
+            for (index = 0; index < Npts; index++) {
+                fmax_loc = std::max(fmax_loc, vals[index]);
+                fmin_loc = std::min(fmin_loc, vals[index]);
+            }
+        } else {
+            #pragma omp for simd collapse(1) schedule(static)
+            for (index = 0; index < Npts; index++) {
+                val = (*mask)[index] ? vals[index] : 0.;
+                fmax_loc = std::max(fmax_loc, val);
+                fmin_loc = std::min(fmin_loc, val);
             }
         }
     }
-    MPI_Allreduce(&fmax_loc, &fmax, 1, MPI_DOUBLE, MPI_MAX, comm);
-    MPI_Allreduce(&fmin_loc, &fmin, 1, MPI_DOUBLE, MPI_MIN, comm);
+
+    fmin = fmin_loc;
+    fmax = fmax_loc;
+}
+
+void package_field(
+        std::vector<signed short> & packaged,
+        double & scale_factor,
+        double & add_offset,
+        const std::vector<double> & original,
+        const std::vector<bool> * mask,
+        MPI_Comm comm
+        ) {
+
+    // First, we need to compute the min and max values
+    //   to allow us to convert to signed shorts
+    //   (both are reduced together, as maxima of {max, -min})
+    double local_extremes[2], extremes[2], fmin_loc, fmax_loc;
+    field_extremes( fmin_loc, fmax_loc, original, mask );
+    local_extremes[0] =  fmax_loc;
+    local_extremes[1] = -fmin_loc;
+    MPI_Allreduce(local_extremes, extremes, 2, MPI_DOUBLE, MPI_MAX, comm);
+
+    package_field( packaged, scale_factor, add_offset, original, mask, -extremes[1], extremes[0] );
+}
+
+void package_field(
+        std::vector<signed short> & packaged,
+        double & scale_factor,
+        double & add_offset,
+        const std::vector<double> & original,
+        const std::vector<bool> * mask,
+        const double fmin,
+        const double fmax
+        ) {
 
     // Number of Discrete Representable Values
     //   (less two for numerical reasons)
     //int ndrv = pow(2, 16) - 2;
-    const int ndrv =   constants::fill_value_s < 0 
-                     ? constants::fill_value_s + 2 
+    const int ndrv =   constants::fill_value_s < 0
+                     ? constants::fill_value_s + 2
                      : constants::fill_value_s - 2;
 
     // Now that we have the min/max, we go ahead and do the conversion
+    //   (a constant field is all at the offset)
     const double fmiddle = 0.5 * (fmax + fmin);
     const double frange  = fmax - fmin;
-    double local_double;
-    signed short local_int;
+
+    packaged.resize( original.size() );
+    const double * vals = original.data();
+    signed short * packed = packaged.data();
+    const size_t Npts = original.size();
+    size_t index;
     #pragma omp parallel \
     default (none) \
-    shared(mask, original, packaged) \
-    private(index, local_double, local_int) \
-    firstprivate( fmiddle, frange )
+    shared(mask, vals, packed) \
+    private(index) \
+    firstprivate( fmiddle, frange, Npts, ndrv )
     {
-        #pragma omp for collapse(1) schedule(guided)
-        for (index = 0; index < original.size(); index++) {
-            if ( mask->at(index) ) {
-
-                // Scale original down to [-0.5,0.5] and store in local_double
-                local_double = (original.at(index) - fmiddle) / frange;
-
-                // Now convert to int in [-ndrv/2, ndrv/2]
-                local_int = (signed short) round(ndrv * local_double);
-
+        #pragma omp for collapse(1) schedule(static)
+        for (index = 0; index < Npts; index++) {
+            // Scale original down to [-0.5,0.5], and then convert to int in [-ndrv/2, ndrv/2]
+            if ( (mask == NULL) or (*mask)[index] ) {
+                packed[index] = (frange == 0) ? 0 : (signed short) round( ndrv * ( ( vals[index] - fmiddle ) / frange ) );
             } else {
-                local_int = constants::fill_value_s;
+                packed[index] = constants::fill_value_s;
             }
-            packaged.at(index) = local_int;
         }
     }
 
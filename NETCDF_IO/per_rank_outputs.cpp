@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <float.h>
+#include <mpi.h>
+#include "../netcdf_io.hpp"
+#include "../constants.hpp"
+
+// Whether new output files are written per-rank, and the (time, depth) start of this
+//   processor's part of each file that has been initialized that way
+static bool use_per_rank_outputs = false;
+static std::map< std::string, std::vector<size_t> > per_rank_files;
+
+void set_per_rank_outputs( const bool per_rank ) {
+    use_per_rank_outputs = per_rank;
+}
+
+bool per_rank_outputs() {
+    return use_per_rank_outputs;
+}
+
+std::string per_rank_output_name( const std::string & filename, const int rank ) {
+    // name.nc -> name.rank0012.nc
+    const size_t ext_start = filename.rfind( ".nc" );
+    const std::string stem = ( ext_start == std::string::npos ) ? filename : filename.substr( 0, ext_start );
+    char rank_string [16];
+    snprintf( rank_string, 16, ".rank%04d", rank );
+    return stem + rank_string + ".nc";
+}
+
+bool is_per_rank_output( const std::string & filename, size_t * part_start ) {
+    const std::map< std::string, std::vector<size_t> >::const_iterator entry = per_rank_files.find( filename );
+    if ( entry == per_rank_files.end() ) { return false; }
+    if ( part_start != NULL ) {
+        part_start[0] = entry->second[0];
+        part_start[1] = entry->second[1];
+    }
+    return true;
+}
+
+void register_per_rank_output(
+        const std::string & filename,
+        const size_t * part_start,
+        const size_t * part_count,
+        const MPI_Comm comm
+        ) {
+
+    int wRank, wSize;
+    MPI_Comm_rank( comm, &wRank );
+    MPI_Comm_size( comm, &wSize );
+
+    per_rank_files[ filename ] = { part_start[0], part_start[1] };
+
+    // Rank 0 needs the layout of every part to write the index
+    const int my_part[4] = { (int) part_start[0], (int) part_count[0], (int) part_start[1], (int) part_count[1] };
+    std::vector<int> parts( 4 * wSize );
+    MPI_Gather( my_part, 4, MPI_INT, parts.data(), 4, MPI_INT, 0, comm );
+    if (wRank != 0) { return; }
+
+    // NcML resolves locations relative to the index file, which sits beside the parts
+    const size_t dir_end = filename.rfind( '/' );
+    const std::string ncml_name = filename.substr( 0, filename.rfind( ".nc" ) ) + ".ncml";
+
+    FILE * ncml = fopen( ncml_name.c_str(), "w" );
+    if (ncml == NULL) {
+        fprintf( stderr, "Could not write the per-rank index %s\n", ncml_name.c_str() );
+        return;
+    }
+    fprintf( ncml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" );
+    fprintf( ncml, "<netcdf xmlns=\"http://www.unidata.ucar.edu/namespaces/netcdf/ncml-2.2\">\n" );
+    fprintf( ncml, "  <aggregation dimName=\"time\" type=\"joinExisting\">\n" );
+
+    // Processors with the same times form one (depth-joined) entry of the time aggregation
+    std::map< int, std::map< int, int > > parts_by_time;
+    for (int Ipart = 0; Ipart < wSize; Ipart++) {
+        if ( (parts[4*Ipart + 1] == 0) or (parts[4*Ipart + 3] == 0) ) { continue; }
+        parts_by_time[ parts[4*Ipart] ][ parts[4*Ipart + 2] ] = Ipart;
+    }
+    for ( const auto & time_group : parts_by_time ) {
+        const int Ntime = parts[ 4 * time_group.second.begin()->second + 1 ];
+        fprintf( ncml, "    <netcdf ncoords=\"%d\">\n", Ntime );
+        fprintf( ncml, "      <aggregation dimName=\"depth\" type=\"joinExisting\">\n" );
+        for ( const auto & depth_entry : time_group.second ) {
+            const int Ipart = depth_entry.second;
+            const std::string part_name = per_rank_output_name( filename, Ipart );
+            fprintf( ncml, "        <netcdf location=\"%s\" ncoords=\"%d\"/>\n",
+                    part_name.substr( dir_end == std::string::npos ? 0 : dir_end + 1 ).c_str(), parts[4*Ipart + 3] );
+        }
+        fprintf( ncml, "      </aggregation>\n" );
+        fprintf( ncml, "    </netcdf>\n" );
+    }
+
+    fprintf( ncml, "  </aggregation>\n" );
+    fprintf( ncml, "</netcdf>\n" );
+    fclose( ncml );
+
+    #if DEBUG >= 1
+    fprintf( stdout, "  Wrote the index of the %d per-rank parts of %s to %s\n", wSize, filename.c_str(), ncml_name.c_str() );
+    #endif
+}
+
+void merge_per_rank_outputs(
+        const std::string & filename,
+        const std::string & output_filename,
+        const MPI_Comm comm
+        ) {
+
+    int wRank, wSize;
+    MPI_Comm_rank( comm, &wRank );
+    MPI_Comm_size( comm, &wSize );
+
+    int ncid, retval, varid, Nvars, Natts, Nvar_dims, var_dims[NC_MAX_VAR_DIMS];
+    nc_type att_type;
+    size_t att_len;
+    char name_buffer [NC_MAX_NAME + 1];
+
+    // The first part provides the layout, the horizontal grid, the variables, and the global attributes
+    double num_parts = 0, full_Ntime = 0, full_Ndepth = 0, filter_scale = -1;
+    std::vector< std::string > var_names, attr_names;
+    std::vector< double > attr_values;
+    dataset merged;
+
+    retval = nc_open( per_rank_output_name( filename, 0 ).c_str(), NC_NOWRITE, &ncid );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    retval = nc_get_att_double( ncid, NC_GLOBAL, "per_rank_num_parts", &num_parts );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_get_att_double( ncid, NC_GLOBAL, "per_rank_full_Ntime", &full_Ntime );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_get_att_double( ncid, NC_GLOBAL, "per_rank_full_Ndepth", &full_Ndepth );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    nc_get_att_double( ncid, NC_GLOBAL, "filter_scale", &filter_scale );
+
+    // Global (scalar, double) attributes, other than the per-rank layout
+    retval = nc_inq_natts( ncid, &Natts );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    for (int Iatt = 0; Iatt < Natts; Iatt++) {
+        retval = nc_inq_attname( ncid, NC_GLOBAL, Iatt, name_buffer );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_inq_att( ncid, NC_GLOBAL, name_buffer, &att_type, &att_len );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        const std::string att_name( name_buffer );
+        if ( (att_type != NC_DOUBLE) or (att_len != 1) or (att_name.find( "per_rank_" ) == 0) or (att_name == "filter_scale") ) { continue; }
+        attr_names.push_back( att_name );
+        attr_values.push_back( 0. );
+        nc_get_att_double( ncid, NC_GLOBAL, name_buffer, &attr_values.back() );
+    }
+
+    // The (time, depth, latitude, longitude) variables
+    retval = nc_inq_nvars( ncid, &Nvars );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    int lat_dimid, lon_dimid;
+    retval = nc_inq_dimid( ncid, "latitude", &lat_dimid );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_inq_dimid( ncid, "longitude", &lon_dimid );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    for (varid = 0; varid < Nvars; varid++) {
+        retval = nc_inq_var( ncid, varid, name_buffer, NULL, &Nvar_dims, var_dims, NULL );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        if ( (Nvar_dims == 4) and (var_dims[2] == lat_dimid) and (var_dims[3] == lon_dimid) ) {
+            var_names.push_back( std::string( name_buffer ) );
+        }
+    }
+
+    // Grid (as stored, i.e. without the radians-to-degrees scale_factor)
+    size_t Nlat, Nlon;
+    retval = nc_inq_dimlen( ncid, lat_dimid, &Nlat );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_inq_dimlen( ncid, lon_dimid, &Nlon );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    merged.latitude.resize( Nlat );
+    merged.longitude.resize( Nlon );
+    merged.areas.resize( Nlat * Nlon );
+    retval = nc_inq_varid( ncid, "latitude", &varid );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_get_var_double( ncid, varid, merged.latitude.data() );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_inq_varid( ncid, "longitude", &varid );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_get_var_double( ncid, varid, merged.longitude.data() );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_inq_varid( ncid, "cell_areas", &varid );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_get_var_double( ncid, varid, merged.areas.data() );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    retval = nc_close( ncid );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    const int Nparts = (int) num_parts,
+              Nmerged_vars = var_names.size();
+
+    #if DEBUG >= 0
+    if (wRank == 0) {
+        fprintf( stdout, "Merging %d variables from %d parts of %s into %s\n",
+                Nmerged_vars, Nparts, filename.c_str(), output_filename.c_str() );
+        fflush( stdout );
+    }
+    #endif
+
+    // Read this processor's parts (every Nprocs-th part), and their pieces of the time / depth axes
+    //   (the axes are then combined as maxima, since unfilled entries are -DBL_MAX)
+    std::vector< int > my_parts;
+    for (int Ipart = wRank; Ipart < Nparts; Ipart += wSize) { my_parts.push_back( Ipart ); }
+    const size_t Nmy_parts = my_parts.size();
+
+    std::vector< double > local_time( (size_t) full_Ntime, -DBL_MAX ), local_depth( (size_t) full_Ndepth, -DBL_MAX );
+    std::vector< std::vector<size_t> > part_starts( Nmy_parts, std::vector<size_t>(4, 0) ),
+                                       part_counts( Nmy_parts, std::vector<size_t>(4, 0) );
+    std::vector< std::vector<double> > part_fields( Nmy_parts * Nmerged_vars );
+    std::vector< std::vector<bool> > part_masks( Nmy_parts * Nmerged_vars );
+    double part_time_start, part_depth_start;
+    const size_t zero = 0;
+    for (size_t Ilocal = 0; Ilocal < Nmy_parts; Ilocal++) {
+        const std::string part_name = per_rank_output_name( filename, my_parts[Ilocal] );
+
+        retval = nc_open( part_name.c_str(), NC_NOWRITE, &ncid );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_get_att_double( ncid, NC_GLOBAL, "per_rank_time_start", &part_time_start );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_get_att_double( ncid, NC_GLOBAL, "per_rank_depth_start", &part_depth_start );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        std::vector<size_t> & start = part_starts[Ilocal],
+                            & count = part_counts[Ilocal];
+        start[0] = (size_t) part_time_start;
+        start[1] = (size_t) part_depth_start;
+        const char * axis_names[2] = { "time", "depth" };
+        std::vector<double> * axes[2] = { &local_time, &local_depth };
+        for (int Iaxis = 0; Iaxis < 2; Iaxis++) {
+            int dimid;
+            retval = nc_inq_dimid( ncid, axis_names[Iaxis], &dimid );
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            retval = nc_inq_dimlen( ncid, dimid, &count[Iaxis] );
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            retval = nc_inq_varid( ncid, axis_names[Iaxis], &varid );
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            retval = nc_get_vara_double( ncid, varid, &zero, &count[Iaxis], &(axes[Iaxis]->at( start[Iaxis] )) );
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        }
+        count[2] = Nlat;
+        count[3] = Nlon;
+
+        retval = nc_close( ncid );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        // The masks keep track of which points were written as the fill value
+        for (int Ivar = 0; Ivar < Nmerged_vars; Ivar++) {
+            const size_t Ifield = Ilocal * Nmerged_vars + Ivar;
+            std::vector< std::vector<double> * > field_ptrs = { &part_fields[Ifield] };
+            std::vector< std::string > field_name = { var_names[Ivar] };
+            read_vars_from_file( field_ptrs, field_name, part_name, NULL, NULL, NULL, 1, 1, false, -1, 0.,
+                                 MPI_COMM_SELF, NULL, NULL, &part_masks[Ifield] );
+        }
+    }
+
+    merged.time.resize( (size_t) full_Ntime );
+    merged.depth.resize( (size_t) full_Ndepth );
+    MPI_Allreduce( local_time.data(),  merged.time.data(),  merged.time.size(),  MPI_DOUBLE, MPI_MAX, comm );
+    MPI_Allreduce( local_depth.data(), merged.depth.data(), merged.depth.size(), MPI_DOUBLE, MPI_MAX, comm );
+
+    // Set up the merged file (as a single, shared, file)
+    const bool was_per_rank = per_rank_outputs();
+    set_per_rank_outputs( false );
+    initialize_output_file( merged, var_names, output_filename.c_str(), filter_scale, comm );
+    set_per_rank_outputs( was_per_rank );
+    for (size_t Iatt = 0; Iatt < attr_names.size(); Iatt++) {
+        add_attr_to_file( attr_names[Iatt].c_str(), attr_values[Iatt], output_filename.c_str(), comm );
+    }
+
+    // Write every part at once (processors without parts queue empty placeholders)
+    const size_t empty_slab[4] = { 0, 0, 0, 0 };
+    const std::vector<double> empty_field;
+    output_batch outputs( output_filename, empty_slab, empty_slab, comm );
+    for (int Ivar = 0; Ivar < Nmerged_vars; Ivar++) {
+        if (Nmy_parts == 0) { outputs.add( empty_field, var_names[Ivar] ); }
+        for (size_t Ilocal = 0; Ilocal < Nmy_parts; Ilocal++) {
+            const size_t Ifield = Ilocal * Nmerged_vars + Ivar;
+            outputs.add( part_fields[Ifield], var_names[Ivar], &part_masks[Ifield],
+                         part_starts[Ilocal].data(), part_counts[Ilocal].data() );
+        }
+    }
+    outputs.write();
+
+    #if DEBUG >= 0
+    if (wRank == 0) { fprintf( stdout, "  done merging %s\n", output_filename.c_str() ); }
+    #endif
+}
@@ -0,0 +1,136 @@
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <cassert>
+#include <mpi.h>
+#include <omp.h>
+#include "../netcdf_io.hpp"
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+prefetching_reader::prefetching_reader(
+        const dataset & source_data,
+        const std::vector< std::string > & var_names_in,
+        const std::string & filename,
+        const int chunk_size,
+        Timing_Records * timings_in
+        ) :
+    var_names( var_names_in ),
+    timings( timings_in )
+{
+
+    assert( chunk_size > 0 );
+    assert( source_data.myCounts.size() == 4 ); // Only for (time, depth, lat, lon) variables
+
+    depth_start = source_data.myStarts.at(1);
+    depth_count = source_data.myCounts.at(1);
+    Nlat        = source_data.myCounts.at(2);
+    Nlon        = source_data.myCounts.at(3);
+
+    // Use the per-file time ranges, if the time axis is spread over several files
+    std::vector< std::string > files = source_data.time_files;
+    std::vector< int > file_starts = source_data.time_file_starts;
+    if (files.size() == 0) {
+        files = { filename };
+        file_starts = { 0, source_data.full_Ntime };
+    }
+
+    // Split this processor's times into chunks, without crossing files
+    const int time_start = source_data.myStarts.at(0),
+              time_end   = time_start + source_data.myCounts.at(0);
+    size_t Ifile = 0;
+    for (int Itime = time_start; Itime < time_end; ) {
+        while ( file_starts.at(Ifile + 1) <= Itime ) { Ifile++; }
+        const int count = std::min( chunk_size, std::min( time_end, file_starts.at(Ifile + 1) ) - Itime );
+
+        chunk_files.push_back(       files.at(Ifile) );
+        chunk_file_starts.push_back( Itime - file_starts.at(Ifile) );
+        chunk_starts.push_back(      Itime - time_start );
+        chunk_counts.push_back(      count );
+        Itime += count;
+    }
+
+    // The helper thread reads through MPI-IO, so MPI needs to allow calls from any thread
+    int thread_level;
+    MPI_Query_thread( &thread_level );
+    use_thread = ( thread_level == MPI_THREAD_MULTIPLE );
+
+    // Make sure the records exist on every processor (Timing_Records::print reduces over them)
+    if (timings != NULL) {
+        timings->add_to_record( 0., "I/O exposed (read-ahead)" );
+        timings->add_to_record( 0., "I/O hidden (read-ahead)" );
+    }
+
+    pending.fields.resize( var_names.size() );
+    if (num_chunks() > 0) { start_read( 0 ); }
+}
+
+prefetching_reader::~prefetching_reader() {
+    if ( reading and use_thread ) { helper.join(); }
+}
+
+void prefetching_reader::read_chunk( const size_t Ichunk, chunk_buffer & buffer ) const {
+
+    const double clock_on = MPI_Wtime();
+
+    const size_t slab_starts[4] = { (size_t) chunk_file_starts.at(Ichunk), (size_t) depth_start, 0, 0 },
+                 slab_counts[4] = { (size_t) chunk_counts.at(Ichunk), (size_t) depth_count, (size_t) Nlat, (size_t) Nlon };
+
+    std::vector< std::vector<double> * > field_ptrs;
+    for (size_t Ivar = 0; Ivar < buffer.fields.size(); Ivar++) { field_ptrs.push_back( &buffer.fields[Ivar] ); }
+
+    read_vars_from_file( field_ptrs, var_names, chunk_files.at(Ichunk), &buffer.mask, NULL, NULL, 1, 1,
+                         false, -1, 0., MPI_COMM_SELF, slab_starts, slab_counts );
+
+    buffer.read_time = MPI_Wtime() - clock_on;
+}
+
+void prefetching_reader::start_read( const size_t Ichunk ) {
+    next_chunk = Ichunk;
+    reading = true;
+    if (use_thread) {
+        // Leave the cores to the computation on the main thread
+        helper = std::thread( [this, Ichunk]() {
+                omp_set_num_threads( 1 );
+                read_chunk( Ichunk, pending );
+            } );
+    }
+}
+
+void prefetching_reader::finish_read() {
+
+    const double clock_on = MPI_Wtime();
+    if (use_thread) { helper.join(); }
+    else            { read_chunk( next_chunk, pending ); }
+    const double wait_time = MPI_Wtime() - clock_on;
+    reading = false;
+
+    exposed_time += wait_time;
+    hidden_time  += std::max( 0., pending.read_time - wait_time );
+    if (timings != NULL) {
+        timings->add_to_record( wait_time, "I/O exposed (read-ahead)" );
+        timings->add_to_record( std::max( 0., pending.read_time - wait_time ), "I/O hidden (read-ahead)" );
+    }
+}
+
+bool prefetching_reader::next(
+        std::vector< std::vector<double> > & fields,
+        std::vector<bool> & mask,
+        int & Itime_start,
+        int & Ntime
+        ) {
+
+    if (not(reading)) { return false; }
+    finish_read();
+
+    // Hand over the chunk, and re-use the caller's old buffers for the next read
+    fields.resize( var_names.size() );
+    fields.swap( pending.fields );
+    mask.swap( pending.mask );
+    Itime_start = chunk_starts.at( next_chunk );
+    Ntime       = chunk_counts.at( next_chunk );
+
+    if (next_chunk + 1 < num_chunks()) { start_read( next_chunk + 1 ); }
+    return true;
+}
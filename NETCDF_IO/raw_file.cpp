@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "../netcdf_io.hpp"
+#include "../constants.hpp"
+
+//
+//// Minimal JSON reading, sufficient for the headers written by raw_file::write_header
+//
+
+struct raw_json_value {
+    char type = 'n';    // 'o'bject, 'a'rray, 's'tring, 'd'ouble, or 'n'ull
+    std::string str;
+    double num = 0.;
+    std::vector< std::pair< std::string, raw_json_value > > members;
+    std::vector< raw_json_value > elements;
+
+    const raw_json_value & at( const std::string & key ) const {
+        for (size_t II = 0; II < members.size(); II++) {
+            if (members[II].first == key) { return members[II].second; }
+        }
+        fprintf( stderr, "Raw file header is missing '%s'\n", key.c_str() );
+        assert(false);
+        return *this;
+    }
+};
+
+void raw_json_skip_space( const char * & pos ) {
+    while ( (*pos == ' ') or (*pos == '\n') or (*pos == '\t') or (*pos == '\r') ) { pos++; }
+}
+
+std::string raw_json_parse_string( const char * & pos ) {
+    std::string out;
+    assert( *pos == '"' );
+    pos++;
+    while ( (*pos != '"') and (*pos != '\0') ) {
+        if (*pos == '\\') { pos++; }
+        out.push_back( *pos );
+        pos++;
+    }
+    pos++;
+    return out;
+}
+
+raw_json_value raw_json_parse( const char * & pos ) {
+    raw_json_value val;
+    raw_json_skip_space( pos );
+    if (*pos == '{') {
+        val.type = 'o';
+        pos++;
+        raw_json_skip_space( pos );
+        while (*pos != '}') {
+            raw_json_skip_space( pos );
+            const std::string key = raw_json_parse_string( pos );
+            raw_json_skip_space( pos );
+            assert( *pos == ':' );
+            pos++;
+            val.members.push_back( std::make_pair( key, raw_json_parse( pos ) ) );
+            raw_json_skip_space( pos );
+            if (*pos == ',') { pos++; }
+        }
+        pos++;
+    } else if (*pos == '[') {
+        val.type = 'a';
+        pos++;
+        raw_json_skip_space( pos );
+        while (*pos != ']') {
+            val.elements.push_back( raw_json_parse( pos ) );
+            raw_json_skip_space( pos );
+            if (*pos == ',') { pos++; }
+        }
+        pos++;
+    } else if (*pos == '"') {
+        val.type = 's';
+        val.str = raw_json_parse_string( pos );
+    } else {
+        char * end;
+        val.type = 'd';
+        val.num = strtod( pos, &end );
+        assert( end != pos );
+        pos = end;
+    }
+    return val;
+}
+
+std::string raw_json_quote( const std::string & str ) {
+    std::string out = "\"";
+    for (size_t II = 0; II < str.size(); II++) {
+        if ( (str[II] == '"') or (str[II] == '\\') ) { out.push_back('\\'); }
+        out.push_back( str[II] );
+    }
+    out.push_back('"');
+    return out;
+}
+
+
+//
+//// raw_file
+//
+
+const size_t raw_file::header_bytes;
+const size_t raw_file::data_alignment;
+
+raw_file::~raw_file() {
+    unmap_all();
+}
+
+bool raw_file::is_raw( const std::string & filename ) {
+    const std::string ext = ".raw";
+    return ( filename.size() > ext.size() )
+        and ( filename.compare( filename.size() - ext.size(), ext.size(), ext ) == 0 );
+}
+
+void raw_file::create(
+        const std::string & filename_in,
+        const std::vector< std::pair< std::string, size_t > > & dims_in
+        ) {
+
+    filename = filename_in;
+    dims = dims_in;
+    attributes.clear();
+    variables.clear();
+
+    FILE * file = fopen( filename.c_str(), "w" );
+    assert( file != NULL ); // Could not create the raw file
+    fclose( file );
+
+    write_header();
+}
+
+void raw_file::read_header( const std::string & filename_in ) {
+
+    filename = filename_in;
+    dims.clear();
+    attributes.clear();
+    variables.clear();
+
+    std::vector<char> text( header_bytes + 1, '\0' );
+    FILE * file = fopen( filename.c_str(), "r" );
+    assert( file != NULL ); // Could not open the raw file
+    const size_t num_read = fread( &text[0], 1, header_bytes, file );
+    fclose( file );
+    assert( num_read == header_bytes ); // The file is too short to be a raw file
+
+    const char * pos = &text[0];
+    const raw_json_value header = raw_json_parse( pos );
+    assert( header.at("format").str == "FlowSieve-raw" );
+
+    fill_value = header.at("fill_value").num;
+
+    const raw_json_value & dims_json = header.at("dims");
+    for (size_t II = 0; II < dims_json.members.size(); II++) {
+        dims.push_back( std::make_pair( dims_json.members[II].first, (size_t) dims_json.members[II].second.num ) );
+    }
+
+    const raw_json_value & attrs_json = header.at("attributes");
+    for (size_t II = 0; II < attrs_json.members.size(); II++) {
+        attributes.push_back( std::make_pair( attrs_json.members[II].first, attrs_json.members[II].second.num ) );
+    }
+
+    const raw_json_value & vars_json = header.at("variables");
+    for (size_t II = 0; II < vars_json.elements.size(); II++) {
+        const raw_json_value & var_json = vars_json.elements[II];
+        variable_info var;
+        var.name   = var_json.at("name").str;
+        var.units  = var_json.at("units").str;
+        var.offset = (size_t) var_json.at("offset").num;
+        var.size   = 1;
+        const raw_json_value & var_dims = var_json.at("dims");
+        for (size_t Idim = 0; Idim < var_dims.elements.size(); Idim++) { var.dims.push_back( var_dims.elements[Idim].str ); }
+        const std::vector< size_t > var_shape = shape( var );
+        for (size_t Idim = 0; Idim < var_shape.size(); Idim++) { var.size *= var_shape[Idim]; }
+        variables.push_back( var );
+    }
+}
+
+void raw_file::write_header() const {
+
+    char num_buffer[64];
+    std::string text = "{\n  \"format\": \"FlowSieve-raw\",\n  \"version\": 1,\n";
+
+    snprintf( num_buffer, 64, "%.17g", fill_value );
+    text += "  \"fill_value\": " + std::string( num_buffer ) + ",\n";
+
+    text += "  \"dims\": {";
+    for (size_t II = 0; II < dims.size(); II++) {
+        snprintf( num_buffer, 64, "%zu", dims[II].second );
+        text += ( II == 0 ? " " : ", " ) + raw_json_quote( dims[II].first ) + ": " + num_buffer;
+    }
+    text += " },\n";
+
+    text += "  \"attributes\": {";
+    for (size_t II = 0; II < attributes.size(); II++) {
+        snprintf( num_buffer, 64, "%.17g", attributes[II].second );
+        text += ( II == 0 ? " " : ", " ) + raw_json_quote( attributes[II].first ) + ": " + num_buffer;
+    }
+    text += " },\n";
+
+    text += "  \"variables\": [\n";
+    for (size_t II = 0; II < variables.size(); II++) {
+        const variable_info & var = variables[II];
+        text += "    { \"name\": " + raw_json_quote( var.name ) + ", \"dims\": [";
+        for (size_t Idim = 0; Idim < var.dims.size(); Idim++) {
+            text += ( Idim == 0 ? " " : ", " ) + raw_json_quote( var.dims[Idim] );
+        }
+        snprintf( num_buffer, 64, "%zu", var.offset );
+        text += " ], \"units\": " + raw_json_quote( var.units ) + ", \"offset\": " + num_buffer + " }";
+        text += ( II + 1 < variables.size() ) ? ",\n" : "\n";
+    }
+    text += "  ]\n}\n";
+
+    assert( text.size() < header_bytes ); // Too many variables / attributes for the raw header
+    text.resize( header_bytes - 1, ' ' );
+    text.push_back( '\n' );
+
+    const int fd = open( filename.c_str(), O_WRONLY );
+    assert( fd >= 0 );
+    const ssize_t num_written = pwrite( fd, text.c_str(), header_bytes, 0 );
+    assert( num_written == (ssize_t) header_bytes );
+    close( fd );
+}
+
+void raw_file::add_variable(
+        const std::string & var_name,
+        const std::vector< std::string > & var_dims,
+        const std::string & units
+        ) {
+
+    variable_info var;
+    var.name  = var_name;
+    var.units = units;
+    var.dims  = var_dims;
+    var.size  = 1;
+    const std::vector< size_t > var_shape = shape( var );
+    for (size_t Idim = 0; Idim < var_shape.size(); Idim++) { var.size *= var_shape[Idim]; }
+
+    // Place after the last variable, aligned
+    size_t end = header_bytes;
+    for (size_t II = 0; II < variables.size(); II++) {
+        end = std::max( end, variables[II].offset + variables[II].size * sizeof(double) );
+    }
+    var.offset = ( ( end + data_alignment - 1 ) / data_alignment ) * data_alignment;
+    variables.push_back( var );
+
+    // Extend the file (the new space reads as zero until written)
+    const int fd = open( filename.c_str(), O_WRONLY );
+    assert( fd >= 0 );
+    const int retval = ftruncate( fd, var.offset + var.size * sizeof(double) );
+    assert( retval == 0 );
+    close( fd );
+
+    write_header();
+}
+
+void raw_file::add_attribute( const std::string & attr_name, const double value ) {
+    bool found = false;
+    for (size_t II = 0; II < attributes.size(); II++) {
+        if (attributes[II].first == attr_name) { attributes[II].second = value; found = true; }
+    }
+    if (not(found)) { attributes.push_back( std::make_pair( attr_name, value ) ); }
+    write_header();
+}
+
+const raw_file::variable_info & raw_file::get_variable( const std::string & var_name ) const {
+    for (size_t II = 0; II < variables.size(); II++) {
+        if (variables[II].name == var_name) { return variables[II]; }
+    }
+    fprintf( stderr, "Variable %s not found in %s\n", var_name.c_str(), filename.c_str() );
+    assert(false);
+    return variables.at(0);
+}
+
+std::vector< size_t > raw_file::shape( const variable_info & var ) const {
+    std::vector< size_t > var_shape;
+    for (size_t Idim = 0; Idim < var.dims.size(); Idim++) {
+        bool found = false;
+        for (size_t II = 0; II < dims.size(); II++) {
+            if (dims[II].first == var.dims[Idim]) { var_shape.push_back( dims[II].second ); found = true; break; }
+        }
+        assert( found ); // Variable refers to an unknown dimension
+    }
+    return var_shape;
+}
+
+double * raw_file::map_variable( const std::string & var_name, const bool writable ) {
+
+    const variable_info & var = get_variable( var_name );
+    if (var.size == 0) { return NULL; }
+
+    // mmap offsets must be page-aligned
+    const size_t page_size  = sysconf( _SC_PAGESIZE ),
+                 map_start  = ( var.offset / page_size ) * page_size,
+                 map_length = var.offset + var.size * sizeof(double) - map_start;
+
+    const int fd = open( filename.c_str(), writable ? O_RDWR : O_RDONLY );
+    assert( fd >= 0 );
+    void * mapping = mmap( NULL, map_length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, map_start );
+    close( fd );
+    assert( mapping != MAP_FAILED );
+
+    mappings.push_back( std::make_pair( mapping, map_length ) );
+    return (double *) ( (char *) mapping + ( var.offset - map_start ) );
+}
+
+void raw_file::unmap_all() {
+    for (size_t II = 0; II < mappings.size(); II++) {
+        // Flush writes through, so that processors on other nodes see them
+        msync(  mappings[II].first, mappings[II].second, MS_SYNC );
+        munmap( mappings[II].first, mappings[II].second );
+    }
+    mappings.clear();
+}
+
+size_t raw_file::slab_runs(
+        const variable_info & var,
+        const size_t * start,
+        const size_t * count,
+        std::vector< size_t > & run_offsets
+        ) const {
+
+    const std::vector< size_t > var_shape = shape( var );
+    const int num_dims = var_shape.size();
+
+    // Trailing dimensions that are read in full are contiguous (along with the next one in)
+    size_t run_length = 1;
+    int Irun = num_dims - 1;
+    while ( (Irun >= 0) and (start[Irun] == 0) and (count[Irun] == var_shape[Irun]) ) {
+        run_length *= var_shape[Irun];
+        Irun--;
+    }
+    if (Irun >= 0) { run_length *= count[Irun]; }
+
+    size_t num_runs = 1;
+    for (int Idim = 0; Idim < Irun; Idim++) { num_runs *= count[Idim]; }
+    if (run_length == 0) { num_runs = 0; }
+    run_offsets.resize( num_runs );
+
+    size_t rem, offset, stride;
+    for (size_t Ir = 0; Ir < num_runs; Ir++) {
+        rem = Ir;
+        offset = 0;
+        stride = 1;
+        for (int Idim = num_dims - 1; Idim >= 0; Idim--) {
+            if ( Idim < Irun ) {
+                offset += ( start[Idim] + rem % count[Idim] ) * stride;
+                rem /= count[Idim];
+            } else if ( Idim == Irun ) {
+                offset += start[Idim] * stride;
+            }
+            stride *= var_shape[Idim];
+        }
+        run_offsets[Ir] = offset;
+    }
+
+    return run_length;
+}
@@ -32,7 +32,7 @@ void read_attr_from_file(
     int ncid=0, retval;
     char buffer [50];
     snprintf(buffer, 50, filename.c_str());
-    retval = nc_open_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
+    retval = nc_open_par(buffer, FLAG, comm, mpi_io_hints(), &ncid);
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
     // Get information about the variable
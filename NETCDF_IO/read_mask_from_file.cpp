@@ -56,7 +56,7 @@ void read_mask_from_file(
     }
     #endif
 
-    retval = nc_open_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
+    retval = nc_open_par(buffer, FLAG, comm, mpi_io_hints(), &ncid);
     if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
 
     // Check if netcdf-4 format
@@ -4,17 +4,388 @@
 #include "../functions.hpp"
 #include <cassert>
 #include <math.h>
+#include <algorithm>
+#include <omp.h>
+#include <string.h>
+#include <type_traits>
+
+// Type-specific netcdf reads, so that packed data is not converted to double by netcdf
+int get_vara( const int ncid, const int var_id, const size_t * start, const size_t * count, signed char * vals ) { return nc_get_vara_schar(  ncid, var_id, start, count, vals ); }
+int get_vara( const int ncid, const int var_id, const size_t * start, const size_t * count, short * vals )       { return nc_get_vara_short(  ncid, var_id, start, count, vals ); }
+int get_vara( const int ncid, const int var_id, const size_t * start, const size_t * count, int * vals )         { return nc_get_vara_int(    ncid, var_id, start, count, vals ); }
+int get_vara( const int ncid, const int var_id, const size_t * start, const size_t * count, float * vals )       { return nc_get_vara_float(  ncid, var_id, start, count, vals ); }
+int get_vara( const int ncid, const int var_id, const size_t * start, const size_t * count, double * vals )      { return nc_get_vara_double( ncid, var_id, start, count, vals ); }
+
+// Running tallies for the diagnostic printouts
+struct read_var_stats {
+    size_t num_land = 0, num_water = 0, num_unmasked = 0, num_zeros = 0;
+    double var_max = -1e10, var_min = 1e10;
+};
 
 /*!
- *  \brief Read a specific variable from a specific file.
+ * \brief Determine this processor's part of dimension II
+ *
+ * On entry, count is the full size of the dimension. On exit, start and count give this processor's part.
+ */
+void get_processor_slab(
+        size_t & start,
+        size_t & count,
+        const int II,
+        const int num_dims,
+        const int Nprocs_in_time,
+        const int Nprocs_in_depth,
+        const bool do_splits,
+        const int force_split_dim,
+        const size_t * slab_starts,
+        const size_t * slab_counts,
+        const int wRank,
+        const int wSize
+        ) {
+
+    int Nprocs_in_dim, Iproc_in_dim, my_count, overflow,
+        Itime_proc, Idepth_proc, Ilat_proc, Ilon_proc;
+
+    start = 0;
+    if (slab_starts != NULL) {
+        // Use the requested hyperslab, instead of splitting
+        assert( slab_starts[II] + slab_counts[II] <= count );
+        start = slab_starts[II];
+        count = slab_counts[II];
+    } else if (do_splits) {
+        // If we're split on multiple MPI procs and have > 2 dimensions, 
+        //   then divide all but the last two 
+        //
+        //   we don't split the last two because those 
+        //   are assumed to be lat/lon
+
+        if ( ( (num_dims > 2) and (wSize > 1) and (II <= 1) )
+             or
+             ( II == force_split_dim )
+           ) {
+
+            assert( Nprocs_in_time > 0 ); // Must specify the number of processors used in time
+            assert( Nprocs_in_depth > 0 ); // Must specify the number of processors used in depth
+            assert( Nprocs_in_time * Nprocs_in_depth == wSize ); // Total number of processors does no match with specified values
+
+            if      ( II == 0 ) { Nprocs_in_dim = Nprocs_in_time;  }
+            else if ( II == 1 ) { Nprocs_in_dim = Nprocs_in_depth; }
+            else                { Nprocs_in_dim = 0; assert(false); }  // II <= 1 so won't happen
+
+            assert( (count >= Nprocs_in_dim) && "Too many processors have been assigned to dimension." );
+
+            my_count = ( (int)count ) / Nprocs_in_dim;
+            overflow = (int)( count - my_count * Nprocs_in_dim );
+
+
+            Index1to4( wRank, Itime_proc,      Idepth_proc,     Ilat_proc, Ilon_proc,
+                              Nprocs_in_time,  Nprocs_in_depth, 1,         1          );
+            if      ( II == 0 ) { Iproc_in_dim = Itime_proc;  }
+            else if ( II == 1 ) { Iproc_in_dim = Idepth_proc; }
+            else                { Iproc_in_dim = -1; assert(false); }  // II <= 1 so won't happen
+
+            start = (size_t) (   
+                      std::min(Iproc_in_dim,            overflow) * (my_count + 1)
+                    + std::max(Iproc_in_dim - overflow, 0       ) *  my_count
+                    );
+
+            // Distribute the remainder over the first chunk of processors
+            if (wRank < overflow) { my_count++; }
+            count = (size_t) my_count;
+        }
+    }
+}
+
+/*!
+ * \brief Apply the fill value, scale factor, and offset to a chunk of raw (file-type) values
+ *
+ * Writes var[target, target + Npts) (and the masks, if not NULL) from raw[0, Npts).
+ * raw may alias &var[target] (when the file type is double).
+ * The reference mask ignores constants::FILTER_OVER_LAND (see read_mask_from_file).
+ */
+template<class T>
+void unpack_and_mask(
+        std::vector<double> & var,
+        std::vector<bool> * mask,
+        std::vector<bool> * reference_mask,
+        read_var_stats & stats,
+        const T * raw,
+        const size_t target,
+        const size_t Npts,
+        const double fill_val,
+        const double scale,
+        const double offset,
+        const double land_fill_value
+        ) {
+
+    // vector<bool> packs into words, so give each thread whole blocks of bits
+    const size_t block_size     = 512,
+                 first_block    = target / block_size,
+                 end_block      = ( target + Npts + block_size - 1 ) / block_size;
+
+    size_t num_land = 0, num_water = 0, num_unmasked = 0, num_zeros = 0;
+    double var_max = stats.var_max, var_min = stats.var_min;
+
+    double * vals = &var[0];
+    size_t Iblock, lb, ub, II;
+    double raw_val, val;
+    bool is_fill;
+
+    #pragma omp parallel default(none) \
+    private( Iblock, lb, ub, II, raw_val, val, is_fill ) \
+    shared( mask, reference_mask, raw, vals ) \
+    firstprivate( first_block, end_block, target, Npts, fill_val, scale, offset, land_fill_value ) \
+    reduction(+ : num_land, num_water, num_unmasked, num_zeros) \
+    reduction(max : var_max) reduction(min : var_min)
+    {
+        #pragma omp for collapse(1) schedule(static)
+        for (Iblock = first_block; Iblock < end_block; Iblock++) {
+            lb = std::max( Iblock * block_size, target );
+            ub = std::min( (Iblock + 1) * block_size, target + Npts );
+
+            // Masked if equal to fill value (do this first, since raw may alias vals)
+            if (mask != NULL) {
+                for (II = lb; II < ub; II++) {
+                    (*mask)[II] = constants::FILTER_OVER_LAND or ( ( (double) raw[II - target] ) != fill_val );
+                }
+            }
+            if (reference_mask != NULL) {
+                for (II = lb; II < ub; II++) {
+                    (*reference_mask)[II] = ( ( (double) raw[II - target] ) != fill_val );
+                }
+            }
+
+            #pragma omp simd reduction(+ : num_land, num_water, num_unmasked, num_zeros) reduction(max : var_max) reduction(min : var_min)
+            for (II = lb; II < ub; II++) {
+                raw_val = (double) raw[II - target];
+                is_fill = ( raw_val == fill_val );
+
+                // Apply scale factor and offset to non-masked values, and
+                //   if requested to filter over land, then fill in the land now
+                val = is_fill ? ( constants::FILTER_OVER_LAND ? land_fill_value : fill_val ) 
+                              : raw_val * scale + offset;
+                vals[II] = val;
+
+                num_water    += is_fill ? 0 : 1;
+                num_unmasked += ( is_fill and constants::FILTER_OVER_LAND ) ? 1 : 0;
+                num_land     += ( is_fill and not(constants::FILTER_OVER_LAND) ) ? 1 : 0;
+                num_zeros    += ( val == 0 ) ? 1 : 0;
+                var_max = is_fill ? var_max : std::max( var_max, val );
+                var_min = is_fill ? var_min : std::min( var_min, val );
+            }
+        }
+    }
+
+    stats.num_land      += num_land;
+    stats.num_water     += num_water;
+    stats.num_unmasked  += num_unmasked;
+    stats.num_zeros     += num_zeros;
+    stats.var_max = var_max;
+    stats.var_min = var_min;
+}
+
+/*!
+ * \brief Read a hyperslab in the file's own type, in chunks that respect constants::READ_MEMORY_BUDGET,
+ *        unpacking each chunk into var as it arrives.
+ */
+template<class T>
+void read_and_unpack(
+        std::vector<double> & var,
+        std::vector<bool> * mask,
+        std::vector<bool> * reference_mask,
+        read_var_stats & stats,
+        const int ncid,
+        const int var_id,
+        const int num_dims,
+        const size_t * start,
+        const size_t * count,
+        const double fill_val,
+        const double scale,
+        const double offset,
+        const double land_fill_value,
+        const int wRank
+        ) {
+
+    const bool read_in_place = std::is_same< T, double >::value;
+    const size_t num_pts = var.size(),
+                 max_pts = std::max( (size_t) 1, constants::READ_MEMORY_BUDGET / sizeof(T) );
+
+    // Find the outermost dimension (Isplit) along which to chunk, such that one index of it fits in the budget.
+    //   Dimensions outside of it are then read one index at a time.
+    int Isplit = -1;
+    size_t pts_per_index = num_pts;
+    if ( num_pts > max_pts ) {
+        for (Isplit = 0; Isplit < num_dims; Isplit++) {
+            pts_per_index = 1;
+            for (int Idim = Isplit + 1; Idim < num_dims; Idim++) { pts_per_index *= count[Idim]; }
+            if ( pts_per_index <= max_pts ) { break; }
+        }
+        #if DEBUG >= 2
+        if (wRank == 0) { fprintf(stdout, "Data is large, so will read in chunks (along dimension %d)\n", Isplit); }
+        #endif
+    }
+
+    std::vector<T> buffer;
+    if (not(read_in_place)) { buffer.resize( std::min( num_pts, max_pts ) ); }
+
+    std::vector<size_t> chunk_start( start, start + num_dims ),
+                        chunk_count( count, count + num_dims );
+    const size_t indices_per_chunk = ( Isplit < 0 ) ? 1 : std::max( (size_t) 1, max_pts / pts_per_index );
+    size_t num_outer = 1;
+    for (int Idim = 0; Idim < Isplit; Idim++) { num_outer *= count[Idim]; chunk_count[Idim] = 1; }
+
+    size_t target = 0, rem, Isplit_index;
+    int retval;
+    T * raw;
+    for (size_t Iouter = 0; Iouter < num_outer; Iouter++) {
+
+        // Position in the dimensions outside of Isplit
+        rem = Iouter;
+        for (int Idim = Isplit - 1; Idim >= 0; Idim--) {
+            chunk_start[Idim] = start[Idim] + rem % count[Idim];
+            rem /= count[Idim];
+        }
+
+        // Then step along Isplit (or, if not chunking, do the whole thing at once)
+        Isplit_index = 0;
+        do {
+            if (Isplit >= 0) {
+                chunk_start[Isplit] = start[Isplit] + Isplit_index;
+                chunk_count[Isplit] = std::min( indices_per_chunk, count[Isplit] - Isplit_index );
+            }
+            size_t chunk_pts = 1;
+            for (int Idim = 0; Idim < num_dims; Idim++) { chunk_pts *= chunk_count[Idim]; }
+
+            // Read even if empty, since the read may be collective
+            raw = read_in_place ? reinterpret_cast<T*>( var.data() + target ) : buffer.data();
+            retval = get_vara( ncid, var_id, &chunk_start[0], &chunk_count[0], raw );
+            if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
+
+            if (chunk_pts > 0) {
+                unpack_and_mask( var, mask, reference_mask, stats, raw, target, chunk_pts, fill_val, scale, offset, land_fill_value );
+            }
+
+            target += chunk_pts;
+            Isplit_index += ( Isplit >= 0 ) ? chunk_count[Isplit] : 1;
+        } while ( ( Isplit >= 0 ) and ( Isplit_index < count[Isplit] ) );
+    }
+    assert( target == num_pts );
+}
+
+/*!
+ * \brief Version of read_vars_from_file for raw files (see raw_file)
+ *
+ * Values are stored unpacked, so only the fill value (land) needs handling. If this processor's
+ * part of a variable is contiguous (i.e. split only in time / depth), then it is unpacked directly 
+ * from the mapped file.
+ */
+void read_vars_from_raw_file(
+        const std::vector< std::vector<double> * > & vars,
+        const std::vector< std::string > & var_names,
+        const std::string & filename,
+        std::vector<bool> *mask,
+        std::vector<int> *myCounts,
+        std::vector<int> *myStarts,
+        const int Nprocs_in_time,
+        const int Nprocs_in_depth,
+        const bool do_splits,
+        const int force_split_dim,
+        const double land_fill_value,
+        const size_t * slab_starts,
+        const size_t * slab_counts,
+        std::vector<bool> *reference_mask,
+        const int wRank,
+        const int wSize
+        ) {
+
+    raw_file file;
+    file.read_header( filename );
+
+    for (size_t Ivar = 0; Ivar < vars.size(); Ivar++) {
+
+        const raw_file::variable_info & var_info = file.get_variable( var_names[Ivar] );
+        const int num_dims = var_info.dims.size();
+        std::vector<size_t> start( num_dims ), count = file.shape( var_info );
+        size_t num_pts = 1;
+        if ( (myCounts != NULL) and (Ivar == 0) ) {
+            myCounts->resize(num_dims);
+            myStarts->resize(num_dims);
+        }
+        for (int II = 0; II < num_dims; II++) {
+            get_processor_slab( start[II], count[II], II, num_dims, Nprocs_in_time, Nprocs_in_depth, 
+                                do_splits, force_split_dim, slab_starts, slab_counts, wRank, wSize );
+            num_pts *= count[II];
+            if ( (myCounts != NULL) and (Ivar == 0) ) { myCounts->at(II) = (int) count[II]; }
+            if ( (myStarts != NULL) and (Ivar == 0) ) { myStarts->at(II) = (int) start[II]; }
+        }
+
+        std::vector<double> & var = *vars[Ivar];
+        var.resize(num_pts);
+
+        std::vector<bool>   *var_mask           = (Ivar == 0) ? mask           : NULL,
+                            *var_reference_mask = (Ivar == 0) ? reference_mask : NULL;
+        if (var_mask           != NULL) { var_mask->resize(var.size()); }
+        if (var_reference_mask != NULL) { var_reference_mask->resize(var.size()); }
+
+        if (num_pts == 0) { continue; }
+
+        std::vector<size_t> run_offsets;
+        const size_t run_length = file.slab_runs( var_info, &start[0], &count[0], run_offsets );
+        const double * data = file.map_variable( var_names[Ivar] );
+
+        read_var_stats stats;
+        if (run_offsets.size() == 1) {
+            // Contiguous, so unpack straight from the file
+            unpack_and_mask( var, var_mask, var_reference_mask, stats, data + run_offsets[0], 0, num_pts, 
+                             file.fill_value, 1., 0., land_fill_value );
+        } else {
+            // Otherwise, gather the runs and then unpack in place
+            size_t Irun;
+            const size_t Nruns = run_offsets.size();
+            double * vals = &var[0];
+            #pragma omp parallel default(none) \
+            private( Irun ) \
+            shared( run_offsets, data, vals ) \
+            firstprivate( Nruns, run_length )
+            {
+                #pragma omp for collapse(1) schedule(static)
+                for (Irun = 0; Irun < Nruns; Irun++) {
+                    memcpy( vals + Irun * run_length, data + run_offsets[Irun], run_length * sizeof(double) );
+                }
+            }
+            unpack_and_mask( var, var_mask, var_reference_mask, stats, vals, 0, num_pts, 
+                             file.fill_value, 1., 0., land_fill_value );
+        }
+        file.unmap_all();
+
+        #if DEBUG >= 1
+        if (wRank == 0) {
+            fprintf(stdout, "  Read %s from %s (raw)\n", var_names[Ivar].c_str(), filename.c_str());
+            fprintf(stdout, "  Land cover = %'.4g%% (%'zu water vs %'zu land) (%'zu land converted to water) \n", 
+                    100 * ((double)stats.num_land) / (stats.num_land + stats.num_water + stats.num_unmasked),
+                    stats.num_water + stats.num_unmasked, stats.num_land, stats.num_unmasked);
+        }
+        #endif
+    }
+}
+
+/*!
+ *  \brief Read a list of variables from a specific file.
  *
  *  Accounts for variable attributes 'scale_factor' and 'add_offset'.
  *
- *  If mask != NULL, then determine the mask based on variable attribute '_FillValue'
+ *  The file is opened once for all of the variables. The mask (and reference mask) are
+ *  determined from the first variable, based on its attribute '_FillValue', as it is unpacked.
  *
- *  @param[in,out]  var                 vector into which to store the loaded variable
- *  @param[in]      var_name            name of the variable to be read
- *  @param[in]      filename            name of the file from which to load the variable
+ *  Packed (byte / short / int / float) variables are read in their own type, and unpacked in parallel.
+ *  Reads are broken into chunks of at most constants::READ_MEMORY_BUDGET bytes. If no processor
+ *  needs to break up its read of a variable, then that variable is read collectively.
+ *
+ *  By default, the data is divided over MPI processors in time and depth (see do_splits).
+ *  Alternatively, each processor can read an arbitrary hyperslab by passing slab_starts and slab_counts.
+ *
+ *  @param[in,out]  vars                vectors into which to store the loaded variables
+ *  @param[in]      var_names           names of the variables to be read
+ *  @param[in]      filename            name of the file from which to load the variables
  *  @param[in,out]  mask                point to where a mask array should be stored (if not NULL) (true = water, false = land)
  *  @param[in,out]  myCounts            the sizes of each dimension (on this MPI process) if not NULL
  *  @param[in,out]  myStarts            the starting index for each dimension, if not NULL
@@ -24,12 +395,15 @@
  *  @param[in]      force_split_dim     Dimension along which data splitting should be force
  *  @param[in]      land_fill_value     Value to place at 'land' areas, if needed
  *  @param[in]      comm                the MPI communicator world
+ *  @param[in]      slab_starts         (optional) starting index of this processor's hyperslab, for each dimension
+ *  @param[in]      slab_counts         (optional) size of this processor's hyperslab, for each dimension
+ *  @param[in,out]  reference_mask      point to where the mask, ignoring constants::FILTER_OVER_LAND, should be stored (if not NULL)
  *
  */
 
-void read_var_from_file(
-        std::vector<double> &var,
-        const std::string & var_name,
+void read_vars_from_file(
+        const std::vector< std::vector<double> * > & vars,
+        const std::vector< std::string > & var_names,
         const std::string & filename,
         std::vector<bool> *mask,
         std::vector<int> *myCounts,
@@ -39,15 +413,25 @@ void read_var_from_file(
         const bool do_splits,
         const int force_split_dim,
         const double land_fill_value,
-        const MPI_Comm comm
+        const MPI_Comm comm,
+        const size_t * slab_starts,
+        const size_t * slab_counts,
+        std::vector<bool> *reference_mask
         ) {
 
+    assert( vars.size() == var_names.size() );
     assert( check_file_existence( filename.c_str() ) );
 
-    int wRank, wSize, Nprocs_in_dim, Iproc_in_dim;
+    int wRank, wSize;
     MPI_Comm_rank( comm, &wRank );
     MPI_Comm_size( comm, &wSize );
 
+    if ( raw_file::is_raw( filename ) ) {
+        read_vars_from_raw_file( vars, var_names, filename, mask, myCounts, myStarts, Nprocs_in_time, Nprocs_in_depth,
+                                 do_splits, force_split_dim, land_fill_value, slab_starts, slab_counts, reference_mask, wRank, wSize );
+        return;
+    }
+
     // Open the NETCDF file
     const int str_len = 250;
     int FLAG = NC_NETCDF4 | NC_MPIIO;
@@ -57,12 +441,14 @@ void read_var_from_file(
 
     #if DEBUG >= 1
     if (wRank == 0) {
-        fprintf(stdout, "Attempting to read %s from %s\n", var_name.c_str(), buffer);
+        for (size_t Ivar = 0; Ivar < var_names.size(); Ivar++) {
+            fprintf(stdout, "Attempting to read %s from %s\n", var_names[Ivar].c_str(), buffer);
+        }
         fflush(stdout);
     }
     #endif
 
-    retval = nc_open_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
+    retval = nc_open_par(buffer, FLAG, comm, mpi_io_hints(), &ncid);
     if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
 
     // Check if netcdf-4 format
@@ -84,225 +470,204 @@ void read_var_from_file(
     #endif
     assert( input_nc_format == NC_FORMAT_NETCDF4 ); // input file must be netCDF-4 format. Use `nccopy -k netCDF-4 input.nc output.nc` to change file version
 
-    char varname [str_len];
-    snprintf(varname, str_len, var_name.c_str());
+    for (size_t Ivar = 0; Ivar < vars.size(); Ivar++) {
 
-    int var_id, num_dims;
-    int dim_ids[NC_MAX_VAR_DIMS];
+        char varname [str_len];
+        snprintf(varname, str_len, var_names[Ivar].c_str());
 
-    // Get the ID for the variable
-    retval = nc_inq_varid(ncid, varname, &var_id );
-    if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
+        int var_id, num_dims;
+        int dim_ids[NC_MAX_VAR_DIMS];
 
-    // This should return an error if the variable doesn't exist
-    retval = nc_inq_var(ncid, var_id, NULL, NULL, NULL, NULL, NULL);
-    if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
-    if (retval == NC_ENOTVAR ) { NC_ERR(NC_ENOTVAR, __LINE__, __FILE__); }
+        // Get the ID for the variable
+        retval = nc_inq_varid(ncid, varname, &var_id );
+        if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
 
-    // Get information about the variable
-    retval = nc_inq_var(ncid, var_id, NULL, NULL, &num_dims, dim_ids, NULL );
-    if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
-    assert( num_dims > 0 );
-    #if DEBUG >= 3
-    if (wRank == 0) {
-        if (num_dims == 1) {
-            fprintf(stdout, "  has %'d dimension of size ", num_dims);
-        } else {
-            fprintf(stdout, "  has %'d dimensions of size ", num_dims);
-        }
-    }
-    #endif
+        // This should return an error if the variable doesn't exist
+        retval = nc_inq_var(ncid, var_id, NULL, NULL, NULL, NULL, NULL);
+        if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
+        if (retval == NC_ENOTVAR ) { NC_ERR(NC_ENOTVAR, __LINE__, __FILE__); }
 
-    // Get the size of each dimension
-    size_t start[num_dims], count[num_dims];
-    size_t num_pts = 1;
-    int my_count, overflow,
-        Itime_proc, Idepth_proc, Ilat_proc, Ilon_proc;
-    if (myCounts != NULL) {
-        myCounts->resize(num_dims);
-        myStarts->resize(num_dims);
-    }
-    for (int II = 0; II < num_dims; II++) {
-        start[II] = 0;
-        retval = nc_inq_dim(ncid, dim_ids[II] , NULL, &count[II]);
+        // Get information about the variable
+        retval = nc_inq_var(ncid, var_id, NULL, NULL, &num_dims, dim_ids, NULL );
         if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
-        #if DEBUG >= 2
-        if (wRank == 0) { fprintf(stdout, "%'zu ", count[II]); }
+        assert( num_dims > 0 );
+        assert( (slab_starts == NULL) == (slab_counts == NULL) );
+        #if DEBUG >= 3
+        if (wRank == 0) {
+            if (num_dims == 1) {
+                fprintf(stdout, "  has %'d dimension of size ", num_dims);
+            } else {
+                fprintf(stdout, "  has %'d dimensions of size ", num_dims);
+            }
+        }
         #endif
 
-        if (do_splits) {
-            // If we're split on multiple MPI procs and have > 2 dimensions, 
-            //   then divide all but the last two 
-            //
-            //   we don't split the last two because those 
-            //   are assumed to be lat/lon
-
-            if ( ( (num_dims > 2) and (wSize > 1) and (II <= 1) )
-                 or
-                 ( II == force_split_dim )
-               ) {
-
-                assert( Nprocs_in_time > 0 ); // Must specify the number of processors used in time
-                assert( Nprocs_in_depth > 0 ); // Must specify the number of processors used in depth
-                assert( Nprocs_in_time * Nprocs_in_depth == wSize ); // Total number of processors does no match with specified values
-
-                if      ( II == 0 ) { Nprocs_in_dim = Nprocs_in_time;  }
-                else if ( II == 1 ) { Nprocs_in_dim = Nprocs_in_depth; }
-                else                { Nprocs_in_dim = 0; assert(false); }  // II <= 1 so won't happen
-
-                assert( (count[II] >= Nprocs_in_dim) && "Too many processors have been assigned to dimension." );
-
-                my_count = ( (int)count[II] ) / Nprocs_in_dim;
-                overflow = (int)( count[II] - my_count * Nprocs_in_dim );
-
-
-                Index1to4( wRank, Itime_proc,      Idepth_proc,     Ilat_proc, Ilon_proc,
-                                  Nprocs_in_time,  Nprocs_in_depth, 1,         1          );
-                if      ( II == 0 ) { Iproc_in_dim = Itime_proc;  }
-                else if ( II == 1 ) { Iproc_in_dim = Idepth_proc; }
-                else                { Iproc_in_dim = -1; assert(false); }  // II <= 1 so won't happen
+        // Get the size of each dimension
+        size_t start[num_dims], count[num_dims];
+        size_t num_pts = 1;
+        if ( (myCounts != NULL) and (Ivar == 0) ) {
+            myCounts->resize(num_dims);
+            myStarts->resize(num_dims);
+        }
+        for (int II = 0; II < num_dims; II++) {
+            start[II] = 0;
+            retval = nc_inq_dim(ncid, dim_ids[II] , NULL, &count[II]);
+            if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
+            #if DEBUG >= 2
+            if (wRank == 0) { fprintf(stdout, "%'zu ", count[II]); }
+            #endif
 
-                start[II] = (size_t) (   
-                          std::min(Iproc_in_dim,            overflow) * (my_count + 1)
-                        + std::max(Iproc_in_dim - overflow, 0       ) *  my_count
-                        );
+            get_processor_slab( start[II], count[II], II, num_dims, Nprocs_in_time, Nprocs_in_depth, 
+                                do_splits, force_split_dim, slab_starts, slab_counts, wRank, wSize );
+            num_pts *= count[II];
 
-                // Distribute the remainder over the first chunk of processors
-                if (wRank < overflow) { my_count++; }
-                count[II] = (size_t) my_count;
-            }
+            if ( (myCounts != NULL) and (Ivar == 0) ) { myCounts->at(II) = (int) count[II]; }
+            if ( (myStarts != NULL) and (Ivar == 0) ) { myStarts->at(II) = (int) start[II]; }
         }
-        num_pts *= count[II];
+        #if DEBUG >= 2
+        if (wRank == 0) { fprintf(stdout, "\n"); }
+        fflush(stdout);
+        #endif
 
-        if (myCounts != NULL) { myCounts->at(II) = (int) count[II]; }
-        if (myStarts != NULL) { myStarts->at(II) = (int) start[II]; }
-    }
-    #if DEBUG >= 2
-    if (wRank == 0) { fprintf(stdout, "\n"); }
-    fflush(stdout);
-    #endif
+        // Now resize the vector to the appropriate size
+        std::vector<double> & var = *vars[Ivar];
+        var.resize(num_pts);
 
-    // Now resize the vector to the appropriate size
-    var.resize(num_pts);
+        // Determine masking (from the first variable), if desired
+        double fill_val = 1e100;  // backup value
+        std::vector<bool>   *var_mask           = (Ivar == 0) ? mask           : NULL,
+                            *var_reference_mask = (Ivar == 0) ? reference_mask : NULL;
+        if (var_mask           != NULL) { var_mask->resize(var.size()); }
+        if (var_reference_mask != NULL) { var_reference_mask->resize(var.size()); }
 
-    // Now read in the data
-    if (num_pts < 4 * pow(512,3)) {
-        retval = nc_get_vara_double(ncid, var_id, start, count, &var[0]);
+        // Get the relevant fill value
+        nc_get_att_double(ncid, var_id, "_FillValue", &fill_val);
         if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
-    } else {
+
         #if DEBUG >= 2
-        if (wRank == 0) { fprintf(stdout, "Data is large, so will read in chunks\n"); }
+        if (wRank == 0) { fprintf(stdout, "  fill value = %'g\n", fill_val); }
         #endif
-        // We can't read in more than 4 * 512^3 at a time, so break into chunks 
-        //   right now we assume that splitting the first dimension is sufficient
-        const unsigned int num_chunks = ceil( num_pts / ( 4 * pow(512,3) ) );
 
-        size_t target = 0;
-        const size_t full_time_count = count[0];
-        size_t curr_count, pts_per_slice = 1;
+        // Apply scale factor if appropriate
+        double scale = 1.;
+        retval = nc_get_att_double(ncid, var_id, "scale_factor", &scale);
+        if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
+        #if DEBUG >= 2
+        if (wRank == 0) { fprintf(stdout, "  scale factor = %'g\n", scale); }
+        #endif
 
+        // Apply offset if appropriate
+        double offset = 0.;
+        retval = nc_get_att_double(ncid, var_id, "add_offset", &offset);
+        if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
+        #if DEBUG >= 2
+        if (wRank == 0) { fprintf(stdout, "  additive offset = %'g\n", offset); }
+        #endif
 
-        for (int Idim = 1; Idim < num_dims; ++Idim) {
-            pts_per_slice *= count[Idim];
+        // Now read in the data (in the file's type) and unpack it
+        nc_type var_type;
+        size_t type_size;
+        retval = nc_inq_vartype(ncid, var_id, &var_type);
+        if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
+        switch (var_type) {
+            case NC_BYTE:   type_size = sizeof(signed char);    break;
+            case NC_SHORT:  type_size = sizeof(short);          break;
+            case NC_INT:    type_size = sizeof(int);            break;
+            case NC_FLOAT:  type_size = sizeof(float);          break;
+            default:        type_size = sizeof(double);         break;
         }
 
-        for (unsigned int Ichunk = 0; Ichunk < num_chunks; ++Ichunk) {
-
-            curr_count = floor( full_time_count / num_chunks );
-            if (Ichunk < ( full_time_count % num_chunks ) ) {
-                curr_count++;
-            }
-
-            count[0] = curr_count;
-
-            retval = nc_get_vara_double(ncid, var_id, start, count, &var[target]);
+        // If every processor can read its part in one go, then do it collectively
+        int one_read = ( num_pts * type_size <= constants::READ_MEMORY_BUDGET ) ? 1 : 0, all_one_read;
+        MPI_Allreduce( &one_read, &all_one_read, 1, MPI_INT, MPI_LAND, comm );
+        if (all_one_read) {
+            retval = nc_var_par_access(ncid, var_id, NC_COLLECTIVE);
             if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
-
-            start[0] += curr_count;
-            target += curr_count * pts_per_slice;
-
         }
-    }
-    
-    // Determine masking, if desired
-    double fill_val = 1e100;  // backup value
-    double var_max = -1e10, var_min = 1e10;
-    size_t num_land = 0, num_water = 0, num_unmasked = 0;
 
-    if (mask != NULL) { mask->resize(var.size()); }
-
-    // Get the relevant fill value
-    nc_get_att_double(ncid, var_id, "_FillValue", &fill_val);
-    if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
-
-    #if DEBUG >= 2
-    if (wRank == 0) { fprintf(stdout, "  fill value = %'g\n", fill_val); }
-    #endif
-
-    // Apply scale factor if appropriate
-    double scale = 1.;
-    retval = nc_get_att_double(ncid, var_id, "scale_factor", &scale);
-    if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
-    #if DEBUG >= 2
-    if (wRank == 0) { fprintf(stdout, "  scale factor = %'g\n", scale); }
-    #endif
-
-    // Apply offset if appropriate
-    double offset = 0.;
-    retval = nc_get_att_double(ncid, var_id, "add_offset", &offset);
-    if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
-    #if DEBUG >= 2
-    if (wRank == 0) { fprintf(stdout, "  additive offset = %'g\n", offset); }
-    #endif
-
-    // Masked if equal to fill value
-    size_t num_zeros = 0;
-    for (size_t II = 0; II < var.size(); II++) {
-        if ( var.at(II) == fill_val ) {
-            if (constants::FILTER_OVER_LAND) {
-                // If requested to filter over land, then fill in the mask now
-                if (mask != NULL) { mask->at(II) = true; }
-                num_unmasked++;
-                var.at(II) = land_fill_value;
-            } else {
-                if (mask != NULL) { mask->at(II) = false; }
-                num_land++;
-            }
-        } else {
-            var_max = std::max( var_max, var.at(II) );
-            var_min = std::min( var_min, var.at(II) );
-            if (mask != NULL) { mask->at(II) = true; }
-            num_water++;
-
-            // Apply scale factor and offset to non-masked values
-            if (scale  != 1.) { var.at(II) = var.at(II) * scale; }
-            if (offset != 0.) { var.at(II) = var.at(II) + offset; }
+        read_var_stats stats;
+        switch (var_type) {
+            case NC_BYTE:
+                read_and_unpack<signed char>( var, var_mask, var_reference_mask, stats, ncid, var_id, num_dims, start, count, fill_val, scale, offset, land_fill_value, wRank );
+                break;
+            case NC_SHORT:
+                read_and_unpack<short>(       var, var_mask, var_reference_mask, stats, ncid, var_id, num_dims, start, count, fill_val, scale, offset, land_fill_value, wRank );
+                break;
+            case NC_INT:
+                read_and_unpack<int>(         var, var_mask, var_reference_mask, stats, ncid, var_id, num_dims, start, count, fill_val, scale, offset, land_fill_value, wRank );
+                break;
+            case NC_FLOAT:
+                read_and_unpack<float>(       var, var_mask, var_reference_mask, stats, ncid, var_id, num_dims, start, count, fill_val, scale, offset, land_fill_value, wRank );
+                break;
+            default:
+                // Anything else is converted to double by netcdf
+                read_and_unpack<double>(      var, var_mask, var_reference_mask, stats, ncid, var_id, num_dims, start, count, fill_val, scale, offset, land_fill_value, wRank );
+                break;
         }
 
-        if (var.at(II) == 0) { num_zeros++; }
-    }
-
-    var_max = var_max * scale + offset;
-    var_min = var_min * scale + offset;
-
-    #if DEBUG >= 1
-    if (wRank == 0) {
-        fprintf(stdout, "  Land cover = %'.4g%% (%'zu water vs %'zu land) (%'zu land converted to water) \n", 
-                100 * ((double)num_land) / (num_land + num_water + num_unmasked),
-                num_water + num_unmasked, num_land, num_unmasked);
-    }
-    #endif
+        #if DEBUG >= 1
+        if (wRank == 0) {
+            fprintf(stdout, "  Land cover = %'.4g%% (%'zu water vs %'zu land) (%'zu land converted to water) \n", 
+                    100 * ((double)stats.num_land) / (stats.num_land + stats.num_water + stats.num_unmasked),
+                    stats.num_water + stats.num_unmasked, stats.num_land, stats.num_unmasked);
+        }
+        #endif
 
-    #if DEBUG >= 1
-    if (wRank == 0) { 
-        fprintf(stdout, "  var_max = %g\n", var_max);
-        fprintf(stdout, "  var_min = %g\n", var_min);
-        fprintf(stdout, "  num zeros = %zu\n", num_zeros);
-        fprintf(stdout, "\n\n"); 
+        #if DEBUG >= 1
+        if (wRank == 0) { 
+            fprintf(stdout, "  var_max = %g\n", stats.var_max);
+            fprintf(stdout, "  var_min = %g\n", stats.var_min);
+            fprintf(stdout, "  num zeros = %zu\n", stats.num_zeros);
+            fprintf(stdout, "\n\n"); 
+        }
+        #endif
     }
-    #endif
 
     MPI_Barrier(comm);
     retval = nc_close(ncid);
     if (retval != NC_NOERR ) { NC_ERR(retval, __LINE__, __FILE__); }
 }
+
+/*!
+ *  \brief Read a specific variable from a specific file.
+ *
+ *  Single-variable version of read_vars_from_file (see there for details).
+ *
+ *  @param[in,out]  var                 vector into which to store the loaded variable
+ *  @param[in]      var_name            name of the variable to be read
+ *  @param[in]      filename            name of the file from which to load the variable
+ *  @param[in,out]  mask                point to where a mask array should be stored (if not NULL) (true = water, false = land)
+ *  @param[in,out]  myCounts            the sizes of each dimension (on this MPI process) if not NULL
+ *  @param[in,out]  myStarts            the starting index for each dimension, if not NULL
+ *  @param[in]      Nprocs_in_time      Number of MPI processors in time (for dividing data)
+ *  @param[in]      Nprocs_in_depth     Number of MPI processors in depth (for dividing data)
+ *  @param[in]      do_splits           boolean indicating if the arrays should be split over MPI procs.
+ *  @param[in]      force_split_dim     Dimension along which data splitting should be force
+ *  @param[in]      land_fill_value     Value to place at 'land' areas, if needed
+ *  @param[in]      comm                the MPI communicator world
+ *  @param[in]      slab_starts         (optional) starting index of this processor's hyperslab, for each dimension
+ *  @param[in]      slab_counts         (optional) size of this processor's hyperslab, for each dimension
+ *
+ */
+
+void read_var_from_file(
+        std::vector<double> &var,
+        const std::string & var_name,
+        const std::string & filename,
+        std::vector<bool> *mask,
+        std::vector<int> *myCounts,
+        std::vector<int> *myStarts,
+        const int Nprocs_in_time,
+        const int Nprocs_in_depth,
+        const bool do_splits,
+        const int force_split_dim,
+        const double land_fill_value,
+        const MPI_Comm comm,
+        const size_t * slab_starts,
+        const size_t * slab_counts
+        ) {
+
+    read_vars_from_file( std::vector< std::vector<double> * >{ &var }, std::vector< std::string >{ var_name }, filename,
+                         mask, myCounts, myStarts, Nprocs_in_time, Nprocs_in_depth, do_splits, force_split_dim,
+                         land_fill_value, comm, slab_starts, slab_counts );
+}
@@ -0,0 +1,292 @@
+#include <math.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cassert>
+#include <mpi.h>
+#include <omp.h>
+#include "../netcdf_io.hpp"
+#include "../constants.hpp"
+
+void write_time_statistics(
+        const std::string & filename,
+        const std::vector<std::string> & vars,
+        const std::vector<double> & depth,
+        const std::vector<double> & latitude,
+        const std::vector<double> & longitude,
+        const std::vector<double> & time_counts,
+        const std::vector< std::vector<double> > & time_means,
+        const std::vector< std::vector<double> > & time_sq_devs,
+        const int Sdepth,
+        const int Ndepth,
+        const double time_first,
+        const double time_last,
+        const double num_times,
+        const double filter_scale,
+        const MPI_Comm comm
+        ) {
+
+    int wRank=-1;
+    MPI_Comm_rank( comm, &wRank );
+
+    const int   Nvars       = vars.size(),
+                full_Ndepth = depth.size(),
+                Nlat        = latitude.size(),
+                Nlon        = longitude.size();
+
+    // Create the file, with the dimensions and coordinates
+    int ncid=0, retval;
+    retval = nc_create_par( filename.c_str(), NC_NETCDF4 | NC_CLOBBER | NC_MPIIO, comm, mpi_io_hints(), &ncid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    retval = nc_put_att_double(ncid, NC_GLOBAL, "filter_scale", NC_DOUBLE, 1, &filter_scale);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_put_att_double(ncid, NC_GLOBAL, "time_first",   NC_DOUBLE, 1, &time_first);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_put_att_double(ncid, NC_GLOBAL, "time_last",    NC_DOUBLE, 1, &time_last);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_put_att_double(ncid, NC_GLOBAL, "num_times",    NC_DOUBLE, 1, &num_times);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    int dimids[3];
+    retval = nc_def_dim(ncid, "depth",     full_Ndepth, &dimids[0]);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_def_dim(ncid, "latitude",  Nlat,        &dimids[1]);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_def_dim(ncid, "longitude", Nlon,        &dimids[2]);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    int depth_varid, lat_varid, lon_varid;
+    retval = nc_def_var(ncid, "depth",     NC_DOUBLE, 1, &dimids[0], &depth_varid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_def_var(ncid, "latitude",  NC_DOUBLE, 1, &dimids[1], &lat_varid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_def_var(ncid, "longitude", NC_DOUBLE, 1, &dimids[2], &lon_varid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    if (not(constants::CARTESIAN)) {
+        const double rad_to_degree = 180. / M_PI;
+        retval = nc_put_att_double(ncid, lon_varid, "scale_factor", NC_DOUBLE, 1, &rad_to_degree);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_put_att_double(ncid, lat_varid, "scale_factor", NC_DOUBLE, 1, &rad_to_degree);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    }
+
+    // The statistics are always stored as doubles (never packed, see CAST_TO_INT), so that merging them is exact
+    int count_varid;
+    std::vector<int> mean_varids( Nvars ), sq_dev_varids( Nvars );
+    retval = nc_def_var(ncid, "time_count", NC_DOUBLE, 3, dimids, &count_varid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    for (int Ivar = 0; Ivar < Nvars; Ivar++) {
+        retval = nc_def_var(ncid, (vars[Ivar] + "_time_mean").c_str(),   NC_DOUBLE, 3, dimids, &mean_varids[Ivar]);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_def_var(ncid, (vars[Ivar] + "_time_sq_dev").c_str(), NC_DOUBLE, 3, dimids, &sq_dev_varids[Ivar]);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    }
+
+    retval = nc_enddef(ncid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    // Coordinates (everyone writes the same values)
+    size_t start[3] = { 0, 0, 0 }, count[3];
+    count[0] = full_Ndepth;
+    retval = nc_put_vara_double(ncid, depth_varid, start, count, &depth[0]);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    count[0] = Nlat;
+    retval = nc_put_vara_double(ncid, lat_varid,   start, count, &latitude[0]);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    count[0] = Nlon;
+    retval = nc_put_vara_double(ncid, lon_varid,   start, count, &longitude[0]);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    // This processor's depths (processors with the same depths write the same values)
+    start[0] = Sdepth;
+    count[0] = Ndepth;
+    count[1] = Nlat;
+    count[2] = Nlon;
+
+    retval = nc_var_par_access(ncid, count_varid, NC_COLLECTIVE);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    retval = nc_put_vara_double(ncid, count_varid, start, count, time_counts.data());
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    for (int Ivar = 0; Ivar < Nvars; Ivar++) {
+        retval = nc_var_par_access(ncid, mean_varids[Ivar], NC_COLLECTIVE);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_put_vara_double(ncid, mean_varids[Ivar], start, count, time_means[Ivar].data());
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        retval = nc_var_par_access(ncid, sq_dev_varids[Ivar], NC_COLLECTIVE);
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_put_vara_double(ncid, sq_dev_varids[Ivar], start, count, time_sq_devs[Ivar].data());
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    }
+
+    retval = nc_close(ncid);
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    #if DEBUG >= 1
+    if (wRank == 0) { fprintf(stdout, "Wrote time statistics for %d variables to %s\n", Nvars, filename.c_str()); }
+    #endif
+}
+
+void merge_time_statistics(
+        const std::vector<std::string> & filenames,
+        const std::string & output_filename,
+        const MPI_Comm comm
+        ) {
+
+    int wRank=-1, wSize=-1;
+    MPI_Comm_rank( comm, &wRank );
+    MPI_Comm_size( comm, &wSize );
+
+    assert( ( filenames.size() > 0 ) && "Need at least one time-statistics file to merge." );
+
+    int ncid, retval, varid, Nvars_file;
+    char name_buffer [NC_MAX_NAME + 1];
+
+    // The first file provides the grid and the variables
+    std::vector<double> depth, latitude, longitude;
+    std::vector<std::string> vars;
+    double filter_scale = -1;
+
+    const std::string mean_suffix = "_time_mean";
+    const char * axis_names[3] = { "depth", "latitude", "longitude" };
+    std::vector<double> * axes[3] = { &depth, &latitude, &longitude };
+    size_t axis_lengths[3];
+
+    retval = nc_open( filenames[0].c_str(), NC_NOWRITE, &ncid );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    nc_get_att_double( ncid, NC_GLOBAL, "filter_scale", &filter_scale );
+    for (int Iaxis = 0; Iaxis < 3; Iaxis++) {
+        int dimid;
+        retval = nc_inq_dimid( ncid, axis_names[Iaxis], &dimid );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_inq_dimlen( ncid, dimid, &axis_lengths[Iaxis] );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        axes[Iaxis]->resize( axis_lengths[Iaxis] );
+        retval = nc_inq_varid( ncid, axis_names[Iaxis], &varid );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_get_var_double( ncid, varid, axes[Iaxis]->data() );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    }
+    retval = nc_inq_nvars( ncid, &Nvars_file );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    for (varid = 0; varid < Nvars_file; varid++) {
+        retval = nc_inq_varname( ncid, varid, name_buffer );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        const std::string var_name( name_buffer );
+        if ( ( var_name.size() > mean_suffix.size() )
+             and ( var_name.compare( var_name.size() - mean_suffix.size(), mean_suffix.size(), mean_suffix ) == 0 ) ) {
+            vars.push_back( var_name.substr( 0, var_name.size() - mean_suffix.size() ) );
+        }
+    }
+    retval = nc_close( ncid );
+    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+    const int Nvars = vars.size(),
+              full_Ndepth = depth.size();
+    const size_t Nlat = latitude.size(),
+                 Nlon = longitude.size();
+
+    #if DEBUG >= 0
+    if (wRank == 0) {
+        fprintf( stdout, "Merging the time statistics of %d variables from %zu files into %s\n",
+                Nvars, filenames.size(), output_filename.c_str() );
+        fflush( stdout );
+    }
+    #endif
+
+    // Share the depths out over the processors
+    const int Sdepth = ( (size_t) full_Ndepth * wRank ) / wSize,
+              Ndepth = ( (size_t) full_Ndepth * ( wRank + 1 ) ) / wSize - Sdepth;
+    const size_t Npts = (size_t) Ndepth * Nlat * Nlon;
+
+    std::vector<double> counts( Npts, 0. ), file_counts( Npts );
+    std::vector< std::vector<double> >  means( Nvars, std::vector<double>( Npts, 0. ) ),
+                                        sq_devs( Nvars, std::vector<double>( Npts, 0. ) ),
+                                        file_means( Nvars, std::vector<double>( Npts ) ),
+                                        file_sq_devs( Nvars, std::vector<double>( Npts ) );
+    double time_first = 0., time_last = 0., num_times = 0., file_time_first, file_time_last, file_num_times;
+
+    const size_t start[3] = { (size_t) Sdepth, 0, 0 },
+                 count[3] = { (size_t) Ndepth, Nlat, Nlon };
+
+    for (size_t Ifile = 0; Ifile < filenames.size(); Ifile++) {
+
+        retval = nc_open( filenames[Ifile].c_str(), NC_NOWRITE, &ncid );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        // Check that the grids match
+        for (int Iaxis = 0; Iaxis < 3; Iaxis++) {
+            int dimid;
+            size_t length;
+            retval = nc_inq_dimid( ncid, axis_names[Iaxis], &dimid );
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            retval = nc_inq_dimlen( ncid, dimid, &length );
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            if ( length != axis_lengths[Iaxis] ) {
+                fprintf( stderr, "The %s dimension of %s (%zu) does not match the first file (%zu)\n",
+                        axis_names[Iaxis], filenames[Ifile].c_str(), length, axis_lengths[Iaxis] );
+            }
+            assert( ( length == axis_lengths[Iaxis] ) && "Time-statistics files must be on the same grid." );
+        }
+
+        retval = nc_get_att_double( ncid, NC_GLOBAL, "time_first", &file_time_first );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_get_att_double( ncid, NC_GLOBAL, "time_last",  &file_time_last );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        retval = nc_get_att_double( ncid, NC_GLOBAL, "num_times",  &file_num_times );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        time_first = ( Ifile == 0 ) ? file_time_first : fmin( time_first, file_time_first );
+        time_last  = ( Ifile == 0 ) ? file_time_last  : fmax( time_last,  file_time_last  );
+        num_times += file_num_times;
+
+        if ( Npts > 0 ) {
+            retval = nc_inq_varid( ncid, "time_count", &varid );
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            retval = nc_get_vara_double( ncid, varid, start, count, file_counts.data() );
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            for (int Ivar = 0; Ivar < Nvars; Ivar++) {
+                retval = nc_inq_varid( ncid, (vars[Ivar] + "_time_mean").c_str(), &varid );
+                if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+                retval = nc_get_vara_double( ncid, varid, start, count, file_means[Ivar].data() );
+                if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+                retval = nc_inq_varid( ncid, (vars[Ivar] + "_time_sq_dev").c_str(), &varid );
+                if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+                retval = nc_get_vara_double( ncid, varid, start, count, file_sq_devs[Ivar].data() );
+                if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            }
+        }
+
+        retval = nc_close( ncid );
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+        // Combine (Chan et al.'s parallel update)
+        size_t index;
+        int Ivar;
+        double new_count, delta;
+        #pragma omp parallel default(none) \
+        private( index, Ivar, new_count, delta ) \
+        shared( counts, means, sq_devs, file_counts, file_means, file_sq_devs ) \
+        firstprivate( Npts, Nvars )
+        {
+            #pragma omp for collapse(1) schedule(static)
+            for (index = 0; index < Npts; index++) {
+                if ( file_counts[index] <= 0 ) { continue; }
+                new_count = counts[index] + file_counts[index];
+                for (Ivar = 0; Ivar < Nvars; Ivar++) {
+                    delta = file_means[Ivar][index] - means[Ivar][index];
+                    means[Ivar][index]   += delta * file_counts[index] / new_count;
+                    sq_devs[Ivar][index] +=   file_sq_devs[Ivar][index]
+                                            + delta * delta * counts[index] * file_counts[index] / new_count;
+                }
+                counts[index] = new_count;
+            }
+        }
+    }
+
+    write_time_statistics(  output_filename, vars, depth, latitude, longitude,
+                            counts, means, sq_devs, Sdepth, Ndepth,
+                            time_first, time_last, num_times, filter_scale, comm );
+}
@@ -1,5 +1,6 @@
 #include <fenv.h>
 #include <vector>
+#include <algorithm>
 #include <string>
 #include <mpi.h>
 #include <math.h>
@@ -16,6 +17,83 @@ void write_field_to_output(
         MPI_Comm comm
         ) {
 
+    output_batch batch( filename, start, count, comm );
+    batch.add( field, field_name, mask );
+    batch.write();
+}
+
+output_batch::output_batch(
+        const std::string & filename_in,
+        const size_t * start_in,
+        const size_t * count_in,
+        MPI_Comm comm_in
+        ) :
+    filename( filename_in ),
+    start( start_in ),
+    count( count_in ),
+    comm( comm_in )
+{ }
+
+void output_batch::add(
+        const std::vector<double> & field,
+        const std::string & field_name,
+        const std::vector<bool> * mask
+        ) {
+    add( field, field_name, mask, start, count );
+}
+
+void output_batch::add(
+        const std::vector<double> & field,
+        const std::string & field_name,
+        const std::vector<bool> * mask,
+        const size_t * field_start,
+        const size_t * field_count
+        ) {
+    fields.push_back( &field );
+    field_names.push_back( field_name );
+    masks.push_back( mask );
+    field_starts.push_back( field_start );
+    field_counts.push_back( field_count );
+}
+
+// Raw files store the unpacked values (with land as the fill value) directly into the mapped file
+void write_field_to_raw_output(
+        const std::vector<double> & field,
+        const std::string & field_name,
+        const size_t * start,
+        const size_t * count,
+        const std::string & filename,
+        const std::vector<bool> * mask
+        ) {
+
+    raw_file file;
+    file.read_header( filename );
+
+    std::vector<size_t> run_offsets;
+    const size_t run_length = file.slab_runs( file.get_variable( field_name ), start, count, run_offsets );
+    const size_t Nruns = run_offsets.size();
+    const double fill_value = file.fill_value;
+    double * data = ( Nruns > 0 ) ? file.map_variable( field_name, true ) : NULL;
+
+    size_t Irun, Ipt, index;
+    #pragma omp parallel default(none) \
+    private( Irun, Ipt, index ) \
+    shared( run_offsets, data, field, mask ) \
+    firstprivate( Nruns, run_length, fill_value )
+    {
+        #pragma omp for collapse(1) schedule(static)
+        for (Irun = 0; Irun < Nruns; Irun++) {
+            for (Ipt = 0; Ipt < run_length; Ipt++) {
+                index = Irun * run_length + Ipt;
+                data[ run_offsets[Irun] + Ipt ] = ( (mask == NULL) or (*mask)[index] ) ? field[index] : fill_value;
+            }
+        }
+    }
+    file.unmap_all();
+}
+
+void output_batch::write() {
+
     // During writing, ignore floating point exceptions
     std::fenv_t fe_env;
     feholdexcept( &fe_env );
@@ -24,144 +102,235 @@ void write_field_to_output(
     MPI_Comm_rank( comm, &wRank );
     MPI_Comm_size( comm, &wSize );
 
+    const size_t Nfields = fields.size();
+
     #if DEBUG >= 2
-    if (wRank == 0) { fprintf(stdout, "  Preparing to write %s to %s (%'zu points).\n", field_name.c_str(), filename.c_str(), field.size()); }
+    if (wRank == 0) { fprintf(stdout, "  Preparing to write %zu fields to %s.\n", Nfields, filename.c_str()); }
     fflush(stdout);
     #endif
 
-    // Open the NETCDF file
-    int FLAG = NC_NETCDF4 | NC_WRITE | NC_MPIIO;
-    int ncid=0, retval;
-    char buffer [50];
-    snprintf(buffer, 50, filename.c_str());
-    MPI_Barrier(comm);
-    retval = nc_open_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-
-    // Get the variable ID for the field
-    int field_varid;
-    retval = nc_inq_varid(ncid, field_name.c_str(), &field_varid );
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-
-    std::vector<signed short> reduced_field; 
-    std::vector<double> output_field;
-    size_t index;
-    double add_offset, scale_factor;
-
-    // This is the maximum value of the transformed variable
-    const double max_val =   constants::fill_value < 0 
-                           ? constants::fill_value + 2 
-                           : constants::fill_value - 2;
-    if (constants::CAST_TO_INT) {
-        // If we want to reduce output size, pack into short ints
-        //   floats are 32bit, short ints are 16bit, so we can cut
-        //   file size in half. Of course, this is at the cost
-        //   of precision.
-
-        reduced_field.resize(field.size());
-
-        #if DEBUG >= 2
-        if (wRank == 0) { fprintf(stdout, "    Preparing to package the field.\n"); }
-        fflush(stdout);
-        #endif
-        package_field(reduced_field, scale_factor, add_offset, field, mask);
+    // Subset files only hold the samples of each field (see initialize_subset_file),
+    //   so sample the queued fields, and write those instead
+    const point_samples * samples = subset_output_samples( filename );
+    std::vector< std::vector<double> > sampled_fields;
+    std::vector< std::vector<bool> > sampled_masks;
+    std::vector< size_t > sampled_slabs;
+    if (samples != NULL) {
+        sampled_fields.resize( Nfields );
+        sampled_masks.resize(  Nfields );
+        sampled_slabs.resize( 8 * Nfields );
+        for (size_t Ifield = 0; Ifield < Nfields; Ifield++) {
+            const size_t * field_start = field_starts[Ifield],
+                         * field_count = field_counts[Ifield];
+            samples->sample( sampled_fields[Ifield], sampled_masks[Ifield], *fields[Ifield], masks[Ifield],
+                             field_count[0], field_count[1] );
 
-        // We need to record the scale and translation used to encode in signed shorts
-        retval = nc_put_att_double( ncid, field_varid, "scale_factor", NC_DOUBLE, 1, &scale_factor );
-        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            size_t * slab = &sampled_slabs[ 8 * Ifield ];
+            slab[0] = field_start[0];   slab[4] = field_count[0];
+            slab[1] = field_start[1];   slab[5] = field_count[1];
+            slab[2] = 0;                slab[6] = samples->Nwindows();
+            slab[3] = 0;                slab[7] = samples->Nsamples();
 
-        retval = nc_put_att_double( ncid, field_varid, "add_offset",   NC_DOUBLE, 1, &add_offset );
-        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            fields[Ifield]       = &sampled_fields[Ifield];
+            masks[Ifield]        = &sampled_masks[Ifield];
+            field_starts[Ifield] = slab;
+            field_counts[Ifield] = slab + 4;
+        }
+    }
 
-        retval = nc_put_vara_short( ncid, field_varid, start, count, &(reduced_field[0]) );
-        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+    // Bytes handed over to be written (by this processor), for the bandwidth report
+    double bytes = 0.;
+    const size_t value_size = ( constants::CAST_TO_INT and not(raw_file::is_raw( filename )) ) ? sizeof(signed short) : sizeof(double);
+    for (size_t Ifield = 0; Ifield < Nfields; Ifield++) { bytes += fields[Ifield]->size() * value_size; }
+    double clock_on;
 
+    if ( raw_file::is_raw( filename ) ) {
+        MPI_Barrier(comm);
+        clock_on = MPI_Wtime();
+        for (size_t Ifield = 0; Ifield < Nfields; Ifield++) {
+            write_field_to_raw_output( *fields[Ifield], field_names[Ifield], field_starts[Ifield], field_counts[Ifield], 
+                                       filename, masks[Ifield] );
+        }
+        record_write_bandwidth( bytes, MPI_Wtime() - clock_on );
+        MPI_Barrier(comm);
     } else {
 
-        // Get the median value to let us use offsets
-        //      to do this, get min and max (first, MPI_local values)
-        //      initalize with first element before looping over all values
-        double  fmax_loc = 0,
-                fmin_loc = 0;
-        #pragma omp parallel \
-        default(none) shared(field, mask) private(index) \
-        reduction(max : fmax_loc) reduction(min : fmin_loc)
-        {
-            #pragma omp for collapse(1) schedule(dynamic)
-            for (index = 0; index < field.size(); index++) {
-                if ( (mask == NULL) or ( mask->at(index) ) ) {
-                    fmax_loc = std::max(fmax_loc, field.at(index));
-                    fmin_loc = std::min(fmin_loc, field.at(index));
-                }
-            }
+        // Variables in the order in which they were first queued, and the variable of each queued field
+        std::vector< std::string > var_names;
+        std::vector< size_t > field_vars( Nfields );
+        for (size_t Ifield = 0; Ifield < Nfields; Ifield++) {
+            field_vars[Ifield] = std::find( var_names.begin(), var_names.end(), field_names[Ifield] ) - var_names.begin();
+            if ( field_vars[Ifield] == var_names.size() ) { var_names.push_back( field_names[Ifield] ); }
         }
+        const size_t Nvars = var_names.size();
 
-        // Now communicate across MPI to get true max and min values
-        double fmin, fmax;
-        MPI_Allreduce(&fmax_loc, &fmax, 1, MPI_DOUBLE, MPI_MAX, comm);
-        MPI_Allreduce(&fmin_loc, &fmin, 1, MPI_DOUBLE, MPI_MIN, comm);
+        // Get the local extremes of every variable, and then reduce them all at once
+        //      (as maxima of {max_0, max_1, ..., -min_0, -min_1, ...})
+        //   Per-rank files also share the extremes, so that every part is packed the same way
+        std::vector<double> local_extremes( 2 * Nvars, 0. ), extremes( 2 * Nvars );
+        double fmin_loc, fmax_loc;
+        for (size_t Ifield = 0; Ifield < Nfields; Ifield++) {
+            const size_t Ivar = field_vars[Ifield];
+            field_extremes( fmin_loc, fmax_loc, *fields[Ifield], masks[Ifield] );
+            local_extremes[        Ivar] = std::max( local_extremes[        Ivar],  fmax_loc );
+            local_extremes[Nvars + Ivar] = std::max( local_extremes[Nvars + Ivar], -fmin_loc );
+        }
+        MPI_Allreduce( local_extremes.data(), extremes.data(), 2 * Nvars, MPI_DOUBLE, MPI_MAX, comm );
 
-        const double fmiddle = 0.5 * ( fmax + fmin );
-        const double frange  = fmax - fmin;
+        // Per-rank files are written independently (no barriers or MPI-IO), and only hold
+        //   this processor's times and depths
+        size_t part_start[2] = {0, 0};
+        const bool per_rank = is_per_rank_output( filename, part_start );
 
-        #if DEBUG >= 2
-        if (wRank == 0) { 
-            fprintf(stdout, "    fmin, fmax, fmiddle, frange = %'g, %'g, %'g, %'g\n", 
-                    fmin, fmax, fmiddle, frange);
-            fflush(stdout);
+        // Open the NETCDF file
+        int FLAG = NC_NETCDF4 | NC_WRITE | NC_MPIIO;
+        int ncid=0, retval;
+        char buffer [50];
+        if (per_rank) {
+            snprintf(buffer, 50, per_rank_output_name( filename, wRank ).c_str());
+            clock_on = MPI_Wtime();
+            retval = nc_open(buffer, NC_NETCDF4 | NC_WRITE, &ncid);
+        } else {
+            snprintf(buffer, 50, filename.c_str());
+            MPI_Barrier(comm);
+            clock_on = MPI_Wtime();
+            retval = nc_open_par(buffer, FLAG, comm, mpi_io_hints(), &ncid);
         }
-        #endif
+        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
-        // Get the multiplicative scale factor. If it's extreme, then truncate it.
-        scale_factor = frange == 0. ? 1. : fabs( frange / max_val );
+        std::vector<signed short> reduced_field;
+        std::vector<double> output_field;
+        size_t index, local_start[4];
+        double add_offset, scale_factor;
 
-        #if DEBUG >= 2
-        if (wRank == 0) { 
-            fprintf(stdout, "    scale_factor, add_offtset, max_transform_val = %'g, %'g, %'g\n", scale_factor, fmiddle, max_val);
-            fflush(stdout);
-        }
-        #endif
+        // This is the maximum value of the transformed variable
+        const double max_val =   constants::fill_value < 0
+                               ? constants::fill_value + 2
+                               : constants::fill_value - 2;
 
-        retval = nc_put_att_double( ncid, field_varid, "scale_factor", NC_DOUBLE, 1, &scale_factor );
-        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+        for (size_t Ivar = 0; Ivar < Nvars; Ivar++) {
 
-        retval = nc_put_att_double(ncid, field_varid, "add_offset", NC_DOUBLE, 1, &fmiddle );
-        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+            const double fmax = extremes[Ivar],
+                         fmin = -extremes[Nvars + Ivar];
+
+            // Get the variable ID for the field
+            int field_varid;
+            retval = nc_inq_varid(ncid, var_names[Ivar].c_str(), &field_varid );
+            if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+            bool wrote_attributes = false;
+            for (size_t Ifield = 0; Ifield < Nfields; Ifield++) {
+
+                if ( field_vars[Ifield] != Ivar ) { continue; }
+
+                const std::vector<double> & field = *fields[Ifield];
+                const std::vector<bool> * mask = masks[Ifield];
+
+                const size_t * start = field_starts[Ifield];
+                if (per_rank) {
+                    local_start[0] = start[0] - part_start[0];
+                    local_start[1] = start[1] - part_start[1];
+                    local_start[2] = start[2];
+                    local_start[3] = start[3];
+                    start = local_start;
+                }
+
+                if (constants::CAST_TO_INT) {
+                    // If we want to reduce output size, pack into short ints
+                    //   floats are 32bit, short ints are 16bit, so we can cut
+                    //   file size in half. Of course, this is at the cost
+                    //   of precision.
+                    package_field(reduced_field, scale_factor, add_offset, field, mask, fmin, fmax);
+
+                    // We need to record the scale and translation used to encode in signed shorts
+                    if (not(wrote_attributes)) {
+                        retval = nc_put_att_double( ncid, field_varid, "scale_factor", NC_DOUBLE, 1, &scale_factor );
+                        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+                        retval = nc_put_att_double( ncid, field_varid, "add_offset",   NC_DOUBLE, 1, &add_offset );
+                        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+                        wrote_attributes = true;
+                    }
+
+                    retval = nc_put_vara_short( ncid, field_varid, start, field_counts[Ifield], reduced_field.data() );
+                    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
-        output_field.resize(field.size());
-        #pragma omp parallel \
-        default(none) \
-        shared(output_field, field, mask, scale_factor) \
-        private(index) \
-        firstprivate( fmiddle )
-        {
-            #pragma omp for collapse(1) schedule(static)
-            for (index = 0; index < field.size(); index++) {
-                if ( (mask == NULL) or ( mask->at(index) ) ) {
-                    output_field.at(index) = ( field.at(index) - fmiddle ) / scale_factor;
                 } else {
-                    output_field.at(index) = constants::fill_value;
+
+                    // Use the middle value as an offset
+                    const double fmiddle = 0.5 * ( fmax + fmin );
+                    const double frange  = fmax - fmin;
+
+                    // Get the multiplicative scale factor. If it's extreme, then truncate it.
+                    scale_factor = frange == 0. ? 1. : fabs( frange / max_val );
+
+                    if (not(wrote_attributes)) {
+                        #if DEBUG >= 2
+                        if (wRank == 0) {
+                            fprintf(stdout, "    %s: fmin, fmax, fmiddle, frange = %'g, %'g, %'g, %'g\n",
+                                    var_names[Ivar].c_str(), fmin, fmax, fmiddle, frange);
+                            fprintf(stdout, "    scale_factor, add_offtset, max_transform_val = %'g, %'g, %'g\n", scale_factor, fmiddle, max_val);
+                            fflush(stdout);
+                        }
+                        #endif
+
+                        retval = nc_put_att_double( ncid, field_varid, "scale_factor", NC_DOUBLE, 1, &scale_factor );
+                        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
+                        retval = nc_put_att_double(ncid, field_varid, "add_offset", NC_DOUBLE, 1, &fmiddle );
+                        if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+                        wrote_attributes = true;
+                    }
+
+                    output_field.resize(field.size());
+                    const double * vals = field.data();
+                    double * out = output_field.data();
+                    const size_t Npts = field.size();
+                    #pragma omp parallel \
+                    default(none) \
+                    shared(out, vals, mask) \
+                    private(index) \
+                    firstprivate( fmiddle, scale_factor, Npts )
+                    {
+                        #pragma omp for collapse(1) schedule(static)
+                        for (index = 0; index < Npts; index++) {
+                            if ( (mask == NULL) or ( (*mask)[index] ) ) {
+                                out[index] = ( vals[index] - fmiddle ) / scale_factor;
+                            } else {
+                                out[index] = constants::fill_value;
+                            }
+                        }
+                    }
+
+                    // Otherwise, just write the 32-bit float field to the file
+                    retval = nc_put_vara_double(ncid, field_varid, start, field_counts[Ifield], output_field.data());
+                    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
+
                 }
             }
         }
 
-        // Otherwise, just write the 32-bit float field to the file
-        retval = nc_put_vara_double(ncid, field_varid, start, count, &(output_field[0]));
+        // Close the file
+        if (not(per_rank)) { MPI_Barrier(comm); }
+        retval = nc_close(ncid);
         if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-
+        record_write_bandwidth( bytes, MPI_Wtime() - clock_on );
     }
 
-    // Close the file
-    MPI_Barrier(comm);
-    retval = nc_close(ncid);
-    if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
-
     #if DEBUG >= 1
-    if (wRank == 0) { 
-        fprintf(stdout, "    wrote %s to %s \n", field_name.c_str(), filename.c_str());
+    if (wRank == 0) {
+        for (size_t Ifield = 0; Ifield < Nfields; Ifield++) {
+            fprintf(stdout, "    wrote %s to %s \n", field_names[Ifield].c_str(), filename.c_str());
+        }
         fflush(stdout);
     }
     #endif
 
+    fields.clear();
+    field_names.clear();
+    masks.clear();
+    field_starts.clear();
+    field_counts.clear();
+
     fesetenv( &fe_env );
 }
@@ -27,7 +27,7 @@ void write_time_average_to_post(
     snprintf(buffer, 50, filename);
 
     MPI_Barrier(comm);
-    retval = nc_open_par(buffer, FLAG, comm, MPI_INFO_NULL, &ncid);
+    retval = nc_open_par(buffer, FLAG, comm, mpi_io_hints(), &ncid);
     if (retval) { NC_ERR(retval, __LINE__, __FILE__); }
 
     // Get the variable ID for the field
@@ -43,6 +43,9 @@ void Apply_Postprocess_Routines(
     const int num_fields  = vars_to_process.size();
     const int num_regions = source_data.region_names.size();
 
+    const std::vector<double> &quantile_levels = constants::POSTPROCESS_QUANTILES;
+    const int Nquantiles = quantile_levels.size();
+
     int wRank=-1, wSize=-1;
     MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
     MPI_Comm_size( MPI_COMM_WORLD, &wSize );
@@ -155,6 +158,32 @@ void Apply_Postprocess_Routines(
             );
     if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "postprocess_writing");  }
 
+    //
+    //// Region quantiles
+    //
+
+    if (Nquantiles > 0) {
+        #if DEBUG >= 1
+        if (wRank == 0) { fprintf(stdout, "\n\n  .. computing the quantiles in each region\n"); }
+        fflush(stdout);
+        #endif
+
+        std::vector< std::vector< double > >
+            region_quantiles(num_fields, std::vector<double>(Ntime * Ndepth * Nquantiles * num_regions, 0.)), 
+            region_quantiles_all_times(num_fields, std::vector<double>(Ndepth * Nquantiles * num_regions, 0.));
+
+        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+        compute_region_quantiles( region_quantiles, region_quantiles_all_times, source_data, postprocess_fields, quantile_levels );
+        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "postprocess_quantiles");  }
+
+        if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
+        write_quantiles(
+                region_quantiles, region_quantiles_all_times, vars_to_process, "area", filename,
+                Stime, Sdepth, Ntime, Ndepth, Nquantiles, num_regions, num_fields
+                );
+        if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "postprocess_writing");  }
+    }
+
     //
     //// Zonal averages and standard deviations
     //
@@ -168,11 +197,14 @@ void Apply_Postprocess_Routines(
         std::vector< std::vector< double > >
             zonal_averages(num_fields, std::vector<double>(Ntime * Ndepth * Nlat, 0.)), 
             zonal_std_devs(num_fields, std::vector<double>(Ntime * Ndepth * Nlat, 0.)),
-            zonal_medians(num_fields, std::vector<double>(Ntime * Ndepth * Nlat, 0.));
+            zonal_medians(num_fields, std::vector<double>(Ntime * Ndepth * Nlat, 0.)),
+            zonal_quantiles(num_fields, std::vector<double>(Ntime * Ndepth * Nquantiles * Nlat, 0.)),
+            zonal_quantiles_all_times(num_fields, std::vector<double>(Ndepth * Nquantiles * Nlat, 0.));
 
         if (constants::DO_TIMING) { clock_on = MPI_Wtime(); }
         compute_zonal_avg_and_std( zonal_averages, zonal_std_devs, source_data, postprocess_fields );
-        compute_zonal_median( zonal_medians, source_data, postprocess_fields );
+        compute_zonal_quantiles( zonal_medians, zonal_quantiles, zonal_quantiles_all_times, 
+                                 source_data, postprocess_fields, quantile_levels );
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "postprocess_zonal_means");  }
 
         if (doing_spectral_slope) {
@@ -202,6 +234,12 @@ void Apply_Postprocess_Routines(
             zonal_averages, zonal_std_devs, zonal_medians, vars_to_process, filename,
             Stime, Sdepth, Ntime, Ndepth, Nlat, num_fields
             );
+        if (Nquantiles > 0) {
+            write_quantiles(
+                zonal_quantiles, zonal_quantiles_all_times, vars_to_process, "zonal", filename,
+                Stime, Sdepth, Ntime, Ndepth, Nquantiles, Nlat, num_fields
+                );
+        }
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "postprocess_writing");  }
     }
 
@@ -346,7 +384,9 @@ void Apply_Postprocess_Routines(
             time_std_dev.at( Ifield ).resize( Ndepth * Nlat * Nlon, 0. );
         }
 
-        compute_time_avg_std( time_average, time_std_dev, source_data, postprocess_fields, mask_count, always_masked, full_Ntime );
+        std::vector<std::vector<double>> time_sq_devs;
+        compute_time_avg_std( time_average, time_std_dev, source_data, postprocess_fields, mask_count, always_masked, full_Ntime,
+                              constants::POSTPROCESS_WRITE_TIME_STATISTICS ? &time_sq_devs : NULL );
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "postprocess_time_means");  }
 
         #if DEBUG >= 1
@@ -372,9 +412,29 @@ void Apply_Postprocess_Routines(
 
         for (int Ifield = 0; Ifield < num_fields; ++Ifield) {
             write_field_to_output( time_average.at(Ifield), vars_to_process.at(Ifield) + "_time_average", start, count, filename, &output_mask );
-            // To turn these outputs back on, also need to turn back on the calculations in compute_time_avg_std
+            // To turn these outputs back on, also need to turn back on the variable in initialize_postprocess_file
             //write_field_to_output( time_std_dev.at(Ifield), vars_to_process.at(Ifield) + "_time_std_dev", start, count, filename, &output_mask );
         }
+
+        // Write the mergeable statistics (so that later runs can be combined with this one)
+        if (constants::POSTPROCESS_WRITE_TIME_STATISTICS) {
+            char stats_filename[50];
+            if (filter_scale >= 0) {
+                snprintf(stats_filename, 50, (filename_base + "_time_statistics_%.6gkm.nc").c_str(), filter_scale/1e3);
+            } else {
+                snprintf(stats_filename, 50, (filename_base + "_time_statistics.nc").c_str());
+            }
+
+            std::vector<double> time_counts( mask_count.begin(), mask_count.end() );
+
+            // source_data.time holds the full time axis
+            const double time_first = source_data.time.empty() ? 0. : source_data.time.front(),
+                         time_last  = source_data.time.empty() ? 0. : source_data.time.back();
+
+            write_time_statistics(  stats_filename, vars_to_process, source_data.depth, source_data.latitude, source_data.longitude,
+                                    time_counts, time_average, time_sq_devs, Sdepth, Ndepth,
+                                    time_first, time_last, full_Ntime, filter_scale, comm );
+        }
         if (constants::DO_TIMING) { timing_records.add_to_record(MPI_Wtime() - clock_on, "postprocess_writing");  }
     }
 }
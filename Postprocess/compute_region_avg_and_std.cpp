@@ -8,14 +8,23 @@
 #include "../functions.hpp"
 #include "../postprocess.hpp"
 
-
-// Pragma-magic to allow reduction over vector operator
-//      thanks to: https://stackoverflow.com/questions/43168661/openmp-and-reduction-on-stdvector
-#pragma omp declare reduction(vec_double_plus : std::vector<double> : \
-                              std::transform(omp_out.begin(), omp_out.end(), omp_in.begin(), omp_out.begin(), std::plus<double>())) \
-                    initializer(omp_priv = decltype(omp_orig)(omp_orig.size()))
-
-
+/*!
+ * \brief Area-weighted mean and standard deviation of each field over each region, at each (MPI-local) time and depth
+ *
+ * Everything is accumulated in a single pass over the fields: each cell only visits the regions that contain it
+ * (see dataset::list_regions_by_cell), and the mean and variance are accumulated together with the (weighted)
+ * Welford update, which avoids the cancellation in sum(f^2) - sum(f)^2. Each thread accumulates its own
+ * partial results, which are then combined (Chan et al.'s parallel update).
+ *
+ * As before, the means and deviations are normalized by the region areas (dataset::region_areas), and
+ * fill values are skipped (but still counted in the area).
+ *
+ * @param[in,out]   field_averages, field_std_devs  results, each (field) of size Ntime * Ndepth * num_regions
+ * @param[in]       source_data                     dataset class instance (for the grid, mask, and regions)
+ * @param[in]       postprocess_fields              fields to process
+ * @param[in]       comm                            MPI communicator
+ *
+ */
 void compute_region_avg_and_std(
         std::vector< std::vector< double > > & field_averages,
         std::vector< std::vector< double > > & field_std_devs,
@@ -32,138 +41,109 @@ void compute_region_avg_and_std(
     const int   num_regions   = source_data.region_names.size(),
                 num_fields    = postprocess_fields.size();
 
-    double reg_area, dA, increment;
-
-    int Ifield, Iregion, Itime, Idepth, Ilat, Ilon;
-    size_t int_index, area_index, index;
+    const size_t num_stats = (size_t) num_fields * Ntime * Ndepth * num_regions;
 
     #if DEBUG >= 1
     int wRank;
     MPI_Comm_rank( comm, &wRank );
+    if (wRank == 0) { fprintf(stdout, "  Computing region means and standard deviations\n"); }
     #endif
 
-    #if DEBUG >= 1
-    if (wRank == 0) { fprintf(stdout, "  Computing region means\n"); }
-    #endif
+    // The regions of each cell (use the ones from compute_region_areas, if they're current)
+    std::vector<size_t> local_cell_starts;
+    std::vector<int> local_cell_lists;
+    const bool have_lists = source_data.region_cell_starts.size() == (size_t) Nlat * Nlon + 1;
+    if (not(have_lists)) { source_data.list_regions_by_cell( local_cell_starts, local_cell_lists ); }
+    const std::vector<size_t> & cell_starts = have_lists ? source_data.region_cell_starts : local_cell_starts;
+    const std::vector<int>    & cell_lists  = have_lists ? source_data.region_cell_lists  : local_cell_lists;
+
+    const std::vector<double> & areas = source_data.areas;
+    const std::vector<bool> & mask = source_data.mask;
+
+    // Accumulated weight, mean, and sum of weighted squared deviations from the mean,
+    //   indexed as (field, time, depth, region)
+    std::vector<double> weights( num_stats, 0. ), means( num_stats, 0. ), sq_devs( num_stats, 0. );
 
-    std::vector<double> field_integrals(Ntime*Ndepth*num_regions*num_fields,0.);
+    int Ifield, Itime, Idepth, Ilat, Ilon;
+    size_t index, cell, Ilist, stat_index;
+    double dA, val, delta, W_tot, delta_means;
 
     #pragma omp parallel default(none)\
-    private(Ilat, Ilon, index, dA, area_index, increment, int_index, \
-            Idepth, Itime, Iregion, Ifield, reg_area )\
-    shared( source_data, postprocess_fields, stderr ) \
-    firstprivate( Nlon, Nlat, Ndepth, Ntime, num_regions, num_fields ) \
-    reduction(vec_double_plus : field_integrals)
-    { 
-        #pragma omp for collapse(5) schedule(static)
-        for (Iregion = 0; Iregion < num_regions; ++Iregion) {
-            for (Itime = 0; Itime < Ntime; ++Itime) {
-                for (Idepth = 0; Idepth < Ndepth; ++Idepth) {
-                    for (Ilat = 0; Ilat < Nlat; ++Ilat) {
-                        for (Ilon = 0; Ilon < Nlon; ++Ilon) {
-                            index = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
-
-                            if ( constants::FILTER_OVER_LAND or source_data.mask.at(index) ) { // Skip land areas
-
-                                area_index = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
-                                dA = source_data.areas.at(area_index);
-
-                                if ( source_data.regions.at( source_data.region_names.at(Iregion) ).at(area_index) )
-                                {
-                                    int_index = Index(0, Itime, Idepth, Iregion, 1, Ntime, Ndepth, num_regions);
-                                    reg_area = source_data.region_areas.at(int_index);
-                                    for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-                                        increment = postprocess_fields.at(Ifield)->at(index) * dA;
-                                        if ( postprocess_fields.at(Ifield)->at(index) == constants::fill_value ) {
-                                            increment = 0;
-                                        }
-                                        int_index = Index(Ifield, Itime, Idepth, Iregion, num_fields, Ntime, Ndepth, num_regions);
-                                        field_integrals.at(int_index) += (reg_area == 0) ? 0. : increment / reg_area;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-    #pragma omp parallel default(none) \
-    private( int_index, Ifield ) \
-    shared( field_integrals, field_averages ) \
-    firstprivate( Nlon, Nlat, Ndepth, Ntime, num_regions, num_fields )
+    private( Ifield, Itime, Idepth, Ilat, Ilon, index, cell, Ilist, stat_index, \
+             dA, val, delta, W_tot, delta_means )\
+    shared( postprocess_fields, cell_starts, cell_lists, areas, mask, weights, means, sq_devs ) \
+    firstprivate( Nlon, Nlat, Ndepth, Ntime, num_regions, num_fields, num_stats )
     {
-        #pragma omp for collapse(2) schedule(static)
-        for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-            for (int_index = 0; int_index < (size_t) Ntime*Ndepth*num_regions; int_index++) {
-                field_averages.at(Ifield).at(int_index)  = field_integrals.at(Ifield*Ntime*Ndepth*num_regions + int_index);
-            }
-        }
-    }
+        std::vector<double> thread_weights( num_stats, 0. ), thread_means( num_stats, 0. ), thread_sq_devs( num_stats, 0. );
 
-    //
-    //// Repeat the process on standard deviations
-    //
+        #pragma omp for collapse(3) schedule(static)
+        for (Itime = 0; Itime < Ntime; ++Itime) {
+            for (Idepth = 0; Idepth < Ndepth; ++Idepth) {
+                for (Ilat = 0; Ilat < Nlat; ++Ilat) {
+                    for (Ilon = 0; Ilon < Nlon; ++Ilon) {
+                        index = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
 
+                        if ( not( constants::FILTER_OVER_LAND or mask[index] ) ) { continue; } // Skip land areas
 
-    #if DEBUG >= 1
-    if (wRank == 0) { fprintf(stdout, "  Computing region standard deviations\n"); }
-    #endif
+                        cell = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
+                        dA = areas[cell];
 
-    std::fill( field_integrals.begin(), field_integrals.end(), 0. );
+                        for (Ilist = cell_starts[cell]; Ilist < cell_starts[cell+1]; ++Ilist) {
+                            for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+                                stat_index = Index(Ifield, Itime, Idepth, cell_lists[Ilist], num_fields, Ntime, Ndepth, num_regions);
 
-    #pragma omp parallel default(none)\
-    private(Ilat, Ilon, index, dA, area_index, increment, int_index, \
-            Idepth, Itime, Iregion, Ifield, reg_area )\
-    shared( source_data, postprocess_fields, field_averages ) \
-    firstprivate( Nlon, Nlat, Ndepth, Ntime, num_regions, num_fields ) \
-    reduction(vec_double_plus : field_integrals)
-    { 
-        #pragma omp for collapse(5) schedule(static)
-        for (Iregion = 0; Iregion < num_regions; ++Iregion) {
-            for (Itime = 0; Itime < Ntime; ++Itime) {
-                for (Idepth = 0; Idepth < Ndepth; ++Idepth) {
-                    for (Ilat = 0; Ilat < Nlat; ++Ilat) {
-                        for (Ilon = 0; Ilon < Nlon; ++Ilon) {
-                            index = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
-
-                            if ( constants::FILTER_OVER_LAND or source_data.mask.at(index) ) { // Skip land areas
-
-                                area_index = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
-                                dA = source_data.areas.at(area_index);
-
-                                if ( source_data.regions.at( source_data.region_names.at(Iregion) ).at(area_index) )
-                                {
-                                    int_index = Index(0, Itime, Idepth, Iregion, 1, Ntime, Ndepth, num_regions);
-                                    reg_area = source_data.region_areas.at(int_index);
-                                    for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-                                        increment = pow(     field_averages.at(Ifield).at(int_index)
-                                                           - postprocess_fields.at(Ifield)->at(index),
-                                                        2.) * dA;
-
-                                        field_integrals.at(Ifield*Ntime*Ndepth*num_regions + int_index) += 
-                                            (reg_area == 0) ? 0. : increment / reg_area;
-                                    }
-                                }
+                                // Skip fill values (they still count towards the region area, see below)
+                                val = (*postprocess_fields[Ifield])[index];
+                                if ( val == constants::fill_value ) { continue; }
+
+                                // Weighted Welford update
+                                thread_weights[stat_index] += dA;
+                                delta = val - thread_means[stat_index];
+                                thread_means[stat_index]   += delta * dA / thread_weights[stat_index];
+                                thread_sq_devs[stat_index] += dA * delta * ( val - thread_means[stat_index] );
                             }
                         }
                     }
                 }
             }
         }
+
+        // Combine the partial results
+        #pragma omp critical
+        {
+            for (stat_index = 0; stat_index < num_stats; ++stat_index) {
+                if ( thread_weights[stat_index] == 0 ) { continue; }
+                W_tot = weights[stat_index] + thread_weights[stat_index];
+                delta_means = thread_means[stat_index] - means[stat_index];
+                means[stat_index]   += delta_means * thread_weights[stat_index] / W_tot;
+                sq_devs[stat_index] +=   thread_sq_devs[stat_index]
+                                       + delta_means * delta_means * weights[stat_index] * thread_weights[stat_index] / W_tot;
+                weights[stat_index] = W_tot;
+            }
+        }
     }
 
+    // Normalize by the region areas. With A the region area, the mean is sum(f dA) / A = mean * W / A,
+    //   and sum( (f - mean_A)^2 dA ) = sq_devs + W (mean - mean_A)^2
+    const size_t num_per_field = (size_t) Ntime * Ndepth * num_regions;
+    size_t int_index;
+    double reg_area, avg;
     #pragma omp parallel default(none) \
-    private( int_index, Ifield ) \
-    shared( field_integrals, field_std_devs ) \
-    firstprivate( Ndepth, Ntime, num_regions, num_fields ) 
+    private( int_index, Ifield, stat_index, reg_area, avg ) \
+    shared( source_data, weights, means, sq_devs, field_averages, field_std_devs ) \
+    firstprivate( num_fields, num_per_field )
     {
         #pragma omp for collapse(2) schedule(static)
         for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-            for (int_index = 0; int_index < (size_t) Ntime*Ndepth*num_regions; int_index++) {
-                field_std_devs.at(Ifield).at(int_index)  = sqrt( field_integrals.at(Ifield*Ntime*Ndepth*num_regions + int_index) );
+            for (int_index = 0; int_index < num_per_field; int_index++) {
+                stat_index = Ifield * num_per_field + int_index;
+                reg_area = source_data.region_areas.at(int_index);
+                avg = (reg_area == 0) ? 0. : means[stat_index] * weights[stat_index] / reg_area;
+                field_averages.at(Ifield).at(int_index) = avg;
+                field_std_devs.at(Ifield).at(int_index) = (reg_area == 0) ? 0. :
+                    sqrt( fmax( 0., (   sq_devs[stat_index]
+                                      + weights[stat_index] * pow( means[stat_index] - avg, 2 ) ) / reg_area ) );
             }
         }
     }
-
 }
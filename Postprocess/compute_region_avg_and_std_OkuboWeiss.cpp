@@ -40,8 +40,8 @@ void compute_region_avg_and_std_OkuboWeiss(
 
     double dA;
 
-    int Ifield, Iregion, Itime, Idepth, Ilat, Ilon, IOkubo;
-    size_t int_index, area_index, index;
+    int Ifield, Itime, Idepth, Ilat, Ilon, IOkubo;
+    size_t int_index, area_index, index, Ilist;
 
     #if DEBUG >= 1
     int wRank;
@@ -49,43 +49,52 @@ void compute_region_avg_and_std_OkuboWeiss(
     #endif
 
     #if DEBUG >= 1
-    if (wRank == 0) { fprintf(stdout, "  Computing area OkuboWeiss histograms\n"); }
+    if (wRank == 0) { fprintf(stdout, "  Computing region OkuboWeiss histograms\n"); }
     #endif
 
-    std::vector<double> area_sums( Ntime * Ndepth * NOkubo * num_regions, 0. );
+    // The regions of each cell (use the ones from compute_region_areas, if they're current)
+    std::vector<size_t> local_cell_starts;
+    std::vector<int> local_cell_lists;
+    const bool have_lists = source_data.region_cell_starts.size() == (size_t) Nlat * Nlon + 1;
+    if (not(have_lists)) { source_data.list_regions_by_cell( local_cell_starts, local_cell_lists ); }
+    const std::vector<size_t> & cell_starts = have_lists ? source_data.region_cell_starts : local_cell_starts;
+    const std::vector<int>    & cell_lists  = have_lists ? source_data.region_cell_lists  : local_cell_lists;
 
-    //fprintf( stdout, "%d, %d, %d, %d, %d, %d - %'zu\n", 
-    //         Ntime, Ndepth, Nlat, Nlon, NOkubo, num_regions, area_sums.size());
+    // The areas and all of the field integrals are accumulated in one pass (with the Okubo-Weiss
+    //   bin found once per point), as [ areas, field 0 integrals, field 1 integrals, ... ]
+    const size_t num_bins = (size_t) Ntime * Ndepth * NOkubo * num_regions;
+    std::vector<double> integrals( ( num_fields + 1 ) * num_bins, 0. );
 
     #pragma omp parallel default(none)\
-    private( Iregion, Itime, Idepth, Ilat, Ilon, IOkubo, index, area_index, int_index, dA )\
-    shared( source_data, OkuboWeiss, OkuboWeiss_bounds ) \
-    firstprivate( Nlon, Nlat, Ndepth, Ntime, NOkubo, num_regions ) \
-    reduction(vec_double_plus : area_sums)
+    private( Ifield, Itime, Idepth, Ilat, Ilon, IOkubo, index, area_index, int_index, Ilist, dA )\
+    shared( source_data, postprocess_fields, OkuboWeiss, OkuboWeiss_bounds, cell_starts, cell_lists ) \
+    firstprivate( Nlon, Nlat, Ndepth, Ntime, NOkubo, num_regions, num_fields, num_bins ) \
+    reduction(vec_double_plus : integrals)
     { 
-        #pragma omp for collapse(5) schedule(static)
-        for (Iregion = 0; Iregion < num_regions; ++Iregion) {
-            for (Itime = 0; Itime < Ntime; ++Itime) {
-                for (Idepth = 0; Idepth < Ndepth; ++Idepth) {
-                    for (Ilat = 0; Ilat < Nlat; ++Ilat) {
-                        for (Ilon = 0; Ilon < Nlon; ++Ilon) {
-
-                            index = Index(Itime, Idepth, Ilat, Ilon,
-                                          Ntime, Ndepth, Nlat, Nlon);
-
-                            if ( constants::FILTER_OVER_LAND or source_data.mask.at(index) ) { // Skip land areas
-                                IOkubo = std::lower_bound(  OkuboWeiss_bounds.begin(), 
-                                                            OkuboWeiss_bounds.end(), 
-                                                            OkuboWeiss.at(index) ) 
-                                         - OkuboWeiss_bounds.begin();
-                                if (IOkubo >= NOkubo) { IOkubo = NOkubo - 1; }
-                                int_index = Index(Itime, Idepth, IOkubo, Iregion,
+        #pragma omp for collapse(4) schedule(static)
+        for (Itime = 0; Itime < Ntime; ++Itime) {
+            for (Idepth = 0; Idepth < Ndepth; ++Idepth) {
+                for (Ilat = 0; Ilat < Nlat; ++Ilat) {
+                    for (Ilon = 0; Ilon < Nlon; ++Ilon) {
+
+                        index = Index(Itime, Idepth, Ilat, Ilon,
+                                      Ntime, Ndepth, Nlat, Nlon);
+
+                        if ( constants::FILTER_OVER_LAND or source_data.mask.at(index) ) { // Skip land areas
+                            IOkubo = std::lower_bound(  OkuboWeiss_bounds.begin(), 
+                                                        OkuboWeiss_bounds.end(), 
+                                                        OkuboWeiss.at(index) ) 
+                                     - OkuboWeiss_bounds.begin();
+                            if (IOkubo >= NOkubo) { IOkubo = NOkubo - 1; }
+                            area_index = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
+                            dA = source_data.areas.at(area_index);
+
+                            for (Ilist = cell_starts[area_index]; Ilist < cell_starts[area_index+1]; ++Ilist) {
+                                int_index = Index(Itime, Idepth, IOkubo, cell_lists[Ilist],
                                                   Ntime, Ndepth, NOkubo, num_regions);
-                                area_index = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
-
-                                if ( source_data.regions.at( source_data.region_names.at(Iregion) ).at(area_index) ) {
-                                    dA = source_data.areas.at(area_index);
-                                    area_sums.at(int_index) += dA;
+                                integrals[int_index] += dA;
+                                for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+                                    integrals[ (Ifield + 1) * num_bins + int_index ] += postprocess_fields[Ifield]->at(index) * dA;
                                 }
                             }
                         }
@@ -96,81 +105,15 @@ void compute_region_avg_and_std_OkuboWeiss(
     }
 
     #pragma omp parallel default(none) \
-    private( int_index ) \
-    shared( OkuboWeiss_areas, area_sums ) \
-    firstprivate( Ifield )
+    private( int_index, Ifield ) \
+    shared( OkuboWeiss_areas, field_averages, integrals ) \
+    firstprivate( num_fields, num_bins )
     {
         #pragma omp for collapse(1) schedule(static)
-        for (int_index = 0; int_index < area_sums.size(); int_index++) {
-            OkuboWeiss_areas.at(int_index) = area_sums.at(int_index);
-        }
-    }
-
-    //
-    //// Now apply to the actual data
-    //
-
-    #if DEBUG >= 1
-    if (wRank == 0) { fprintf(stdout, "  Computing region OkuboWeiss histograms\n"); }
-    #endif
-
-    for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-        #if DEBUG >= 2
-        if (wRank == 0) { fprintf(stdout, "    processing field %d of %d\n", Ifield + 1, num_fields); }
-        #endif
-
-        std::vector<double> field_integrals( Ntime * Ndepth * NOkubo * num_regions, 0. );
-
-        #pragma omp parallel default(none)\
-        private( Iregion, Itime, Idepth, Ilat, Ilon, IOkubo,\
-                index, area_index, int_index, dA )\
-        shared( source_data, postprocess_fields, OkuboWeiss, OkuboWeiss_bounds ) \
-        firstprivate( Ifield, Nlon, Nlat, Ndepth, Ntime, NOkubo, num_regions ) \
-        reduction(vec_double_plus : field_integrals)
-        { 
-            #pragma omp for collapse(5) schedule(static)
-            for (Iregion = 0; Iregion < num_regions; ++Iregion) {
-                for (Itime = 0; Itime < Ntime; ++Itime) {
-                    for (Idepth = 0; Idepth < Ndepth; ++Idepth) {
-                        for (Ilat = 0; Ilat < Nlat; ++Ilat) {
-                            for (Ilon = 0; Ilon < Nlon; ++Ilon) {
-
-                                index = Index(Itime, Idepth, Ilat, Ilon,
-                                              Ntime, Ndepth, Nlat, Nlon);
-
-                                if ( constants::FILTER_OVER_LAND or source_data.mask.at(index) ) { // Skip land areas
-                                    IOkubo = std::lower_bound(  OkuboWeiss_bounds.begin(), 
-                                                                OkuboWeiss_bounds.end(), 
-                                                                OkuboWeiss.at(index) ) 
-                                             - OkuboWeiss_bounds.begin();
-                                    if (IOkubo >= NOkubo) { IOkubo = NOkubo - 1; }
-                                    int_index = Index(Itime, Idepth, IOkubo, Iregion,
-                                                      Ntime, Ndepth, NOkubo, num_regions);
-                                    area_index = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
-
-                                    if ( source_data.regions.at( source_data.region_names.at(Iregion) ).at(area_index) ) {
-                                        dA = source_data.areas.at(area_index);
-                                        field_integrals.at(int_index) += postprocess_fields.at(Ifield)->at(index) * dA;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        #if DEBUG >= 2
-        if (wRank == 0) { fprintf(stdout, "    copying results for field %d of %d to outputs\n", Ifield + 1, num_fields); }
-        #endif
-
-        #pragma omp parallel default(none) \
-        private( int_index ) \
-        shared( field_integrals, field_averages ) \
-        firstprivate( Ifield )
-        {
-            #pragma omp for collapse(1) schedule(static)
-            for (int_index = 0; int_index < field_integrals.size(); int_index++) {
-                field_averages.at(Ifield).at(int_index) = field_integrals.at(int_index);
+        for (int_index = 0; int_index < num_bins; int_index++) {
+            OkuboWeiss_areas.at(int_index) = integrals[int_index];
+            for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+                field_averages.at(Ifield).at(int_index) = integrals[ (Ifield + 1) * num_bins + int_index ];
             }
         }
     }
@@ -0,0 +1,138 @@
+#include <math.h>
+#include <mpi.h>
+#include <omp.h>
+#include <vector>
+
+#include "../constants.hpp"
+#include "../functions.hpp"
+#include "../postprocess.hpp"
+
+/*!
+ * \brief Area-weighted quantiles of each field over each region, at each time and depth, and over all times
+ *
+ * Works like compute_zonal_quantiles, but with a quantile_sketch for each region instead of each latitude.
+ * The sketches over all times are merged across the processors that hold the other times.
+ *
+ * @param[in,out]   region_quantiles            quantiles, each (field) of size Ntime * Ndepth * Nquantiles * num_regions
+ * @param[in,out]   region_quantiles_all_times  quantiles over all times, each of size Ndepth * Nquantiles * num_regions
+ * @param[in]       source_data                 dataset class instance (for the grid, mask, regions, and communicators)
+ * @param[in]       postprocess_fields          fields to process
+ * @param[in]       quantile_levels             quantiles to compute (between 0 and 1)
+ * @param[in]       comm                        MPI communicator
+ *
+ */
+void compute_region_quantiles(
+        std::vector<std::vector<double>> & region_quantiles,
+        std::vector<std::vector<double>> & region_quantiles_all_times,
+        const dataset & source_data,
+        const std::vector<const std::vector<double>*> & postprocess_fields,
+        const std::vector<double> & quantile_levels,
+        const MPI_Comm comm
+        ){
+
+    int wRank=-1, wSize=-1;
+    MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
+    MPI_Comm_size( MPI_COMM_WORLD, &wSize );
+
+    const int   Ntime  = source_data.Ntime,
+                Ndepth = source_data.Ndepth,
+                Nlat   = source_data.Nlat,
+                Nlon   = source_data.Nlon;
+
+    const int   num_fields  = postprocess_fields.size(),
+                num_regions = source_data.region_names.size(),
+                Nquant      = quantile_levels.size();
+
+    if (Nquant == 0) { return; }
+
+    #if DEBUG >= 2
+    if (wRank == 0) { fprintf( stdout, "Computing region quantiles\n" ); }
+    #endif
+
+    // The cells in each region (from the regions of each cell)
+    std::vector<size_t> cell_starts;
+    std::vector<int> cell_lists;
+    if ( source_data.region_cell_starts.size() == (size_t) Nlat * Nlon + 1 ) {
+        cell_starts = source_data.region_cell_starts;
+        cell_lists  = source_data.region_cell_lists;
+    } else {
+        source_data.list_regions_by_cell( cell_starts, cell_lists );
+    }
+    std::vector< std::vector<size_t> > region_cells( num_regions );
+    for (size_t cell = 0; cell < (size_t) Nlat * Nlon; ++cell) {
+        for (size_t Ilist = cell_starts[cell]; Ilist < cell_starts[cell+1]; ++Ilist) {
+            region_cells[ cell_lists[Ilist] ].push_back( cell );
+        }
+    }
+
+    int Ifield, Itime, Idepth, Iregion, Iquant;
+    size_t index, cell, Icell, int_index, sketch_index;
+    double val;
+
+    // Sketches over all (local) times, indexed as (field, depth, region)
+    std::vector<quantile_sketch> all_times_sketches( num_fields * Ndepth * num_regions );
+
+    #pragma omp parallel default(none)\
+    private( Ifield, Itime, Idepth, Iregion, Iquant, index, cell, Icell, int_index, sketch_index, val )\
+    shared( postprocess_fields, source_data, region_quantiles, quantile_levels, all_times_sketches, region_cells ) \
+    firstprivate( Nlon, Nlat, Ndepth, Ntime, num_fields, num_regions, Nquant )
+    {
+        quantile_sketch region_sketch;
+
+        #pragma omp for collapse(3) schedule(dynamic)
+        for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+            for (Idepth = 0; Idepth < Ndepth; ++Idepth){
+                for (Iregion = 0; Iregion < num_regions; ++Iregion){
+
+                    sketch_index = Index( 0, Ifield, Idepth, Iregion, 1, num_fields, Ndepth, num_regions );
+
+                    for (Itime = 0; Itime < Ntime; ++Itime){
+
+                        region_sketch.clear();
+                        for (Icell = 0; Icell < region_cells[Iregion].size(); ++Icell) {
+                            cell = region_cells[Iregion][Icell];
+                            index = Index(Itime, Idepth, cell / Nlon, cell % Nlon, Ntime, Ndepth, Nlat, Nlon);
+
+                            if ( source_data.mask.at(index) ) {
+                                val = postprocess_fields.at(Ifield)->at(index);
+                                if ( val != constants::fill_value ) {
+                                    region_sketch.add( val, source_data.areas.at(cell) );
+                                }
+                            }
+                        }
+
+                        for (Iquant = 0; Iquant < Nquant; ++Iquant) {
+                            int_index = Index( Itime, Idepth, Iquant, Iregion, Ntime, Ndepth, Nquant, num_regions );
+                            region_quantiles[Ifield][int_index] = region_sketch.quantile( quantile_levels[Iquant] );
+                        }
+
+                        all_times_sketches[sketch_index].merge( region_sketch );
+                        all_times_sketches[sketch_index].compress();
+                    }
+                }
+            }
+        }
+    }
+
+    // Combine with the other times
+    merge_quantile_sketches( all_times_sketches, source_data.MPI_subcomm_samedepths );
+
+    #pragma omp parallel default(none)\
+    private( Ifield, Idepth, Iregion, Iquant, int_index, sketch_index )\
+    shared( region_quantiles_all_times, quantile_levels, all_times_sketches ) \
+    firstprivate( Ndepth, num_fields, num_regions, Nquant )
+    {
+        #pragma omp for collapse(3) schedule(dynamic)
+        for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+            for (Idepth = 0; Idepth < Ndepth; ++Idepth){
+                for (Iregion = 0; Iregion < num_regions; ++Iregion){
+                    sketch_index = Index( 0, Ifield, Idepth, Iregion, 1, num_fields, Ndepth, num_regions );
+                    for (Iquant = 0; Iquant < Nquant; ++Iquant) {
+                        int_index = Index( 0, Idepth, Iquant, Iregion, 1, Ndepth, Nquant, num_regions );
+                        region_quantiles_all_times[Ifield][int_index] = all_times_sketches[sketch_index].quantile( quantile_levels[Iquant] );
+                    }
+                }
+            }
+        }
+    }
+}
@@ -8,6 +8,27 @@
 #include "../postprocess.hpp"
 
 
+/*!
+ * \brief Time average and standard deviation of each field at each (water) point, over all times (on all processors)
+ *
+ * Each processor accumulates its own times with the Welford update (count, mean, and sum of squared deviations
+ * from the mean), and the processors are then combined (Chan et al.): the sums give the full mean, and each
+ * processor's squared deviations are shifted to that mean. These are exactly the sufficient statistics written
+ * to the time-statistics files (see write_time_statistics), so later runs can be merged with this one.
+ *
+ * The squared deviations (and so the standard deviations) are only accumulated and reduced when time_sq_devs
+ * is given, i.e. when the time statistics are written. Otherwise, time_std_dev is left untouched.
+ *
+ * @param[in,out]   time_average        time averages, each (field) of size Ndepth * Nlat * Nlon
+ * @param[in,out]   time_std_dev        time standard deviations (same size, only set if time_sq_devs is given)
+ * @param[in]       source_data         dataset class instance (for the mask and communicators)
+ * @param[in]       postprocess_fields  fields to process
+ * @param[in]       mask_count          number of times (over all processors) that each point is water
+ * @param[in]       always_masked       points that are never water
+ * @param[in]       full_Ntime          total number of times
+ * @param[in,out]   time_sq_devs        (optional) sum over time of the squared deviations from the time average
+ *
+ */
 void compute_time_avg_std(
         std::vector<std::vector<double>> & time_average,
         std::vector<std::vector<double>> & time_std_dev,
@@ -15,7 +36,8 @@ void compute_time_avg_std(
         const std::vector<const std::vector<double>*> & postprocess_fields,
         const std::vector<int> & mask_count,
         const std::vector<bool> & always_masked,
-        const int full_Ntime
+        const int full_Ntime,
+        std::vector<std::vector<double>> * time_sq_devs
         ){
 
     //MPI_Comm &comm = source_data.MPI_Comm_Global;
@@ -31,21 +53,28 @@ void compute_time_avg_std(
                 Nlon   = source_data.Nlon;
 
     const int num_fields = postprocess_fields.size();
+    const size_t Npts = (size_t) Ndepth * Nlat * Nlon;
 
     int Ifield, Itime, Idepth, Ilat, Ilon;
     size_t index, space_index;
+    double local_count, delta, val;
+    const bool do_sq_devs = ( time_sq_devs != NULL );
 
     // storage arrays for local values (before MPI reducing)
-    std::vector<std::vector<double>> time_average_loc(num_fields), time_std_dev_loc(num_fields);
+    //   the sums are the local means times the local counts, and the squared deviations are 
+    //   from the local means until they're shifted to the full mean
+    std::vector<std::vector<double>> time_sum_loc(num_fields), time_mean_loc(num_fields), time_sq_dev_loc(num_fields);
+    std::vector<double> time_count_loc( Npts, 0. );
     for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-        time_average_loc.at(Ifield).resize( Ndepth * Nlat * Nlon, 0. );
-        time_std_dev_loc.at(Ifield).resize( Ndepth * Nlat * Nlon, 0. );
+        time_sum_loc.at(Ifield).resize( Npts, 0. );
+        time_mean_loc.at(Ifield).resize( Npts, 0. );
+        if (do_sq_devs) { time_sq_dev_loc.at(Ifield).resize( Npts, 0. ); }
     }
 
     #pragma omp parallel default(none)\
-    private(Ifield, Ilat, Ilon, Itime, Idepth, index, space_index )\
-    shared(postprocess_fields, source_data, always_masked, mask_count, time_average_loc) \
-    firstprivate( Nlon, Nlat, Ndepth, Ntime, num_fields )
+    private(Ifield, Ilat, Ilon, Itime, Idepth, index, space_index, local_count, delta, val )\
+    shared(postprocess_fields, source_data, always_masked, time_count_loc, time_sum_loc, time_mean_loc, time_sq_dev_loc) \
+    firstprivate( Nlon, Nlat, Ndepth, Ntime, num_fields, do_sq_devs )
     { 
         #pragma omp for collapse(3) schedule(guided)
         for (Ilat = 0; Ilat < Nlat; ++Ilat){
@@ -55,20 +84,29 @@ void compute_time_avg_std(
                     space_index = Index(0, Idepth, Ilat, Ilon, 1, Ndepth, Nlat, Nlon);
 
                     if (not(always_masked.at(space_index))) { // Skip land areas
+                        local_count = 0.;
                         for (Itime = 0; Itime < Ntime; ++Itime){
 
                             // get some indices
                             index = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
 
                             if ( source_data.mask.at(index) ) {
+                                local_count += 1.;
                                 for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-
-                                    // compute the time average for the part on this processor
-                                    time_average_loc.at(Ifield).at(space_index) 
-                                        += postprocess_fields.at(Ifield)->at(index) / mask_count.at(space_index);
+                                    // Welford update for the part on this processor
+                                    val = postprocess_fields.at(Ifield)->at(index);
+                                    delta = val - time_mean_loc[Ifield][space_index];
+                                    time_mean_loc[Ifield][space_index]   += delta / local_count;
+                                    if (do_sq_devs) {
+                                        time_sq_dev_loc[Ifield][space_index] += delta * ( val - time_mean_loc[Ifield][space_index] );
+                                    }
                                 }
                             }
                         }
+                        time_count_loc[space_index] = local_count;
+                        for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+                            time_sum_loc[Ifield][space_index] = local_count * time_mean_loc[Ifield][space_index];
+                        }
                     }
                 }
             }
@@ -82,95 +120,46 @@ void compute_time_avg_std(
     #endif
 
     for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-        MPI_Allreduce(&(time_average_loc.at(Ifield)[0]),
-                      &(time_average.at(    Ifield)[0]),
-                      Ndepth * Nlat * Nlon, MPI_DOUBLE, MPI_SUM, comm);
+        MPI_Allreduce(&(time_sum_loc.at(Ifield)[0]),
+                      &(time_average.at(Ifield)[0]),
+                      Npts, MPI_DOUBLE, MPI_SUM, comm);
     }
 
-    /*
-     *  We've silenced time standard deviation outputs for now, so don't waste time computing them
-     *
-
-    // Compute the standard deviation
-    #if DEBUG >= 2
-    if (wRank == 0) { fprintf(stdout, "  .. computing time standard deviations\n"); }
-    fflush(stdout);
-    #endif
-
+    // Shift each processor's squared deviations to the full mean, and sum those too
     #pragma omp parallel default(none)\
-    private(Ifield, Ilat, Ilon, Itime, Idepth, index, space_index )\
-    shared(wSize, postprocess_fields, source_data, always_masked, mask_count, \
-            time_average_loc, time_std_dev_loc, time_average)
-    { 
-        #pragma omp for collapse(3) schedule(guided, chunk_size)
-        for (Ilat = 0; Ilat < Nlat; ++Ilat){
-            for (Ilon = 0; Ilon < Nlon; ++Ilon){
-                for (Idepth = 0; Idepth < Ndepth; ++Idepth){
-                    space_index = Index(0, Idepth, Ilat, Ilon,
-                                        1, Ndepth, Nlat, Nlon);
-                    if (not(always_masked.at(space_index))) { // Skip land areas
-                        for (Itime = 0; Itime < Ntime; ++Itime){
-
-                            // get some indices
-                            index = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
-
-                            if ( source_data.mask.at(index) ) { // Skip land areas
-                                for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-
-                                    // compute the time std. dev. for 
-                                    // the part on this processor
-                                    time_std_dev_loc.at(Ifield).at(space_index) += 
-                                        pow(   postprocess_fields.at(Ifield)->at(index) 
-                                             - time_average.at(Ifield).at(space_index), 
-                                            2.) / mask_count.at(space_index);
-                                }
-                            }
-                        }
-                    } else {
-                        for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-                            // We'll handle these later to avoid over-flow issues
-                            time_std_dev_loc.at(Ifield).at(space_index) = 0.; 
-                        }
+    private(Ifield, space_index )\
+    shared(always_masked, mask_count, time_count_loc, time_average, time_mean_loc, time_sq_dev_loc) \
+    firstprivate( Npts, num_fields, do_sq_devs )
+    {
+        #pragma omp for collapse(1) schedule(static)
+        for (space_index = 0; space_index < Npts; ++space_index) {
+            for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+                if ( not( always_masked.at(space_index) ) ) {
+                    time_average[Ifield][space_index] /= mask_count.at(space_index);
+                    if (do_sq_devs) {
+                        time_sq_dev_loc[Ifield][space_index] += 
+                            time_count_loc[space_index] * pow( time_mean_loc[Ifield][space_index] - time_average[Ifield][space_index], 2 );
                     }
+                } else {
+                    time_average[Ifield][space_index] = 0.;
                 }
             }
         }
     }
 
-    #if DEBUG >= 2
-    if (wRank == 0) { fprintf(stdout, "  .. .. reducing across processors and taking square root\n"); }
-    fflush(stdout);
-    #endif
+    if (not(do_sq_devs)) { return; }
 
-    // Now communicate with other processors to get the full time average
+    std::vector<double> time_sq_dev( Npts );
+    time_sq_devs->resize( num_fields );
     for (Ifield = 0; Ifield < num_fields; ++Ifield) {
-        MPI_Allreduce(&(time_std_dev_loc.at(Ifield)[0]),
-                      &(time_std_dev.at(    Ifield)[0]),
-                      Ndepth * Nlat * Nlon, MPI_DOUBLE, MPI_SUM, comm);
-    }
+        MPI_Allreduce(&(time_sq_dev_loc.at(Ifield)[0]),
+                      &(time_sq_dev[0]),
+                      Npts, MPI_DOUBLE, MPI_SUM, comm);
 
-    // Re-mask to fill in land areas / apply sqrt to water
-    for (int Ifield = 0; Ifield < num_fields; ++Ifield) {
-        #pragma omp parallel default(none)\
-        private(index, space_index)\
-        shared(Ifield, time_average, time_std_dev, always_masked)
-        { 
-            #pragma omp for collapse(3) schedule(dynamic, chunk_size)
-            for (Idepth = 0; Idepth < Ndepth; ++Idepth){
-                for (Ilat = 0; Ilat < Nlat; ++Ilat){
-                    for (Ilon = 0; Ilon < Nlon; ++Ilon){
-                        space_index = Index(0, Idepth, Ilat, Ilon, 1, Ndepth, Nlat, Nlon);
-                        if ( not( always_masked.at(space_index) ) ) {
-                            time_std_dev.at(Ifield).at(index) = sqrt(time_std_dev.at(Ifield).at(index));
-                        }
-                    }
-                }
-            }
+        for (space_index = 0; space_index < Npts; ++space_index) {
+            time_std_dev.at(Ifield).at(space_index) = always_masked.at(space_index) ? 0. :
+                sqrt( time_sq_dev[space_index] / mask_count.at(space_index) );
         }
+        time_sq_devs->at(Ifield) = time_sq_dev;
     }
-
-    *
-    * 
-    */
-
 }
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <math.h>
+#include <mpi.h>
+#include <omp.h>
+#include <vector>
+
+#include "../constants.hpp"
+#include "../functions.hpp"
+#include "../postprocess.hpp"
+
+/*!
+ * \brief Zonal medians and (area-weighted) quantiles of each field, at each latitude
+ *
+ * The medians are the exact (unweighted) middle water value of each row, as before (0 for rows without water).
+ *
+ * For the quantiles, each latitude row (at each time and depth) is summarized by a quantile_sketch, which is also merged
+ * into a sketch for that latitude (and depth) over all times. Those are then merged across the processors
+ * that hold the other times, so the _all_times quantiles cover the whole dataset.
+ * Only water cells are used, and fill values are skipped. Rows without any values are set to fill_value
+ * (which write_quantiles masks out).
+ *
+ * @param[in,out]   zonal_medians               medians, each (field) of size Ntime * Ndepth * Nlat
+ * @param[in,out]   zonal_quantiles             quantiles, each of size Ntime * Ndepth * Nquantiles * Nlat
+ * @param[in,out]   zonal_quantiles_all_times   quantiles over all times, each of size Ndepth * Nquantiles * Nlat
+ * @param[in]       source_data                 dataset class instance (for the grid, mask, and communicators)
+ * @param[in]       postprocess_fields          fields to process
+ * @param[in]       quantile_levels             quantiles to compute (between 0 and 1)
+ * @param[in]       comm                        MPI communicator
+ *
+ */
+void compute_zonal_quantiles(
+        std::vector<std::vector<double>> & zonal_medians,
+        std::vector<std::vector<double>> & zonal_quantiles,
+        std::vector<std::vector<double>> & zonal_quantiles_all_times,
+        const dataset & source_data,
+        const std::vector<const std::vector<double>*> & postprocess_fields,
+        const std::vector<double> & quantile_levels,
+        const MPI_Comm comm
+        ){
+
+    int wRank=-1, wSize=-1;
+    MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
+    MPI_Comm_size( MPI_COMM_WORLD, &wSize );
+
+    const int   Ntime  = source_data.Ntime,
+                Ndepth = source_data.Ndepth,
+                Nlat   = source_data.Nlat,
+                Nlon   = source_data.Nlon;
+
+    const int   num_fields = postprocess_fields.size(),
+                Nquant     = quantile_levels.size();
+
+    int Ifield, Itime, Idepth, Ilat, Ilon, Iquant;
+    size_t index, int_index, sketch_index, Ipt;
+    double val;
+
+    #if DEBUG >= 2
+    if (wRank == 0) { fprintf( stdout, "Computing zonal quantiles\n" ); }
+    #endif
+
+    // Sketches over all (local) times, indexed as (field, depth, latitude)
+    std::vector<quantile_sketch> all_times_sketches( num_fields * Ndepth * Nlat );
+
+    #pragma omp parallel default(none)\
+    private( Ifield, Ilat, Ilon, Itime, Idepth, Iquant, index, int_index, sketch_index, val, Ipt )\
+    shared( postprocess_fields, source_data, zonal_medians, zonal_quantiles, quantile_levels, all_times_sketches ) \
+    firstprivate( Nlon, Nlat, Ndepth, Ntime, num_fields, Nquant )
+    {
+        quantile_sketch row_sketch;
+        std::vector<double> lon_slice( Nlon );
+
+        #pragma omp for collapse(3) schedule(dynamic)
+        for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+            for (Idepth = 0; Idepth < Ndepth; ++Idepth){
+                for (Ilat = 0; Ilat < Nlat; ++Ilat){
+
+                    sketch_index = Index( 0, Ifield, Idepth, Ilat, 1, num_fields, Ndepth, Nlat );
+
+                    for (Itime = 0; Itime < Ntime; ++Itime){
+
+                        row_sketch.clear();
+                        std::fill( lon_slice.begin(), lon_slice.end(), 0.);
+                        Ipt = 0;
+
+                        for (Ilon = 0; Ilon < Nlon; ++Ilon){
+                            index = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
+
+                            if ( source_data.mask.at(index) ) {
+                                val = postprocess_fields.at(Ifield)->at(index);
+
+                                lon_slice[Ipt] = val;
+                                Ipt++;
+
+                                if ( val != constants::fill_value ) {
+                                    row_sketch.add( val, source_data.areas.at( Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon) ) );
+                                }
+                            }
+                        }
+
+                        // Exact median
+                        std::nth_element( lon_slice.begin(), lon_slice.begin() + Ipt/2, lon_slice.begin() + Ipt );
+                        int_index = Index( 0, Itime, Idepth, Ilat, 1, Ntime, Ndepth, Nlat );
+                        zonal_medians[Ifield][int_index] = lon_slice[ Ipt/2 ];
+
+                        for (Iquant = 0; Iquant < Nquant; ++Iquant) {
+                            int_index = Index( Itime, Idepth, Iquant, Ilat, Ntime, Ndepth, Nquant, Nlat );
+                            zonal_quantiles[Ifield][int_index] = row_sketch.quantile( quantile_levels[Iquant] );
+                        }
+
+                        all_times_sketches[sketch_index].merge( row_sketch );
+                        all_times_sketches[sketch_index].compress();
+                    }
+                }
+            }
+        }
+    }
+
+    if (Nquant == 0) { return; }
+
+    // Combine with the other times
+    merge_quantile_sketches( all_times_sketches, source_data.MPI_subcomm_samedepths );
+
+    #pragma omp parallel default(none)\
+    private( Ifield, Ilat, Idepth, Iquant, int_index, sketch_index )\
+    shared( zonal_quantiles_all_times, quantile_levels, all_times_sketches ) \
+    firstprivate( Nlat, Ndepth, num_fields, Nquant )
+    {
+        #pragma omp for collapse(3) schedule(dynamic)
+        for (Ifield = 0; Ifield < num_fields; ++Ifield) {
+            for (Idepth = 0; Idepth < Ndepth; ++Idepth){
+                for (Ilat = 0; Ilat < Nlat; ++Ilat){
+                    sketch_index = Index( 0, Ifield, Idepth, Ilat, 1, num_fields, Ndepth, Nlat );
+                    for (Iquant = 0; Iquant < Nquant; ++Iquant) {
+                        int_index = Index( 0, Idepth, Iquant, Ilat, 1, Ndepth, Nquant, Nlat );
+                        zonal_quantiles_all_times[Ifield][int_index] = all_times_sketches[sketch_index].quantile( quantile_levels[Iquant] );
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#include <math.h>
+#include <mpi.h>
+#include <omp.h>
+#include <vector>
+
+#include "../constants.hpp"
+#include "../functions.hpp"
+#include "../postprocess.hpp"
+#include "../netcdf_io.hpp"
+
+void write_quantiles(
+        const std::vector< std::vector< double > > & quantiles,
+        const std::vector< std::vector< double > > & quantiles_all_times,
+        const std::vector<std::string> & vars_to_process,
+        const std::string & kind,
+        const char * filename,
+        const int Stime,
+        const int Sdepth,
+        const int Ntime,
+        const int Ndepth,
+        const int Nquantiles,
+        const int Nspace,
+        const int num_fields
+        ){
+
+    // kind is "zonal" (Nspace = Nlat) or "area" (Nspace = num_regions)
+
+    // Rows / regions without any values hold fill_value: mask them out, so that they are written
+    //   as missing and don't affect the packing of the real values
+    auto non_empty = []( std::vector<bool> & mask, const std::vector<double> & field ) {
+        mask.resize( field.size() );
+        for (size_t II = 0; II < field.size(); ++II) { mask[II] = ( field[II] != constants::fill_value ); }
+    };
+    std::vector<bool> mask;
+
+    // Dimension order: time - depth - quantile - latitude / region
+    size_t start[4], count[4];
+    start[0] = Stime;
+    count[0] = Ntime;
+
+    start[1] = Sdepth;
+    count[1] = Ndepth;
+
+    start[2] = 0;
+    count[2] = Nquantiles;
+
+    start[3] = 0;
+    count[3] = Nspace;
+
+    for ( int Ifield = 0; Ifield < num_fields; ++Ifield ) {
+        non_empty( mask, quantiles.at(Ifield) );
+        write_field_to_output( 
+                quantiles.at(Ifield), vars_to_process.at(Ifield) + "_" + kind + "_quantiles", 
+                start, count, filename, &mask );
+    }
+
+    // Dimension order: depth - quantile - latitude / region
+    //   (every processor with the same depths has the same values)
+    size_t start_all[3], count_all[3];
+    start_all[0] = Sdepth;
+    count_all[0] = Ndepth;
+
+    start_all[1] = 0;
+    count_all[1] = Nquantiles;
+
+    start_all[2] = 0;
+    count_all[2] = Nspace;
+
+    for ( int Ifield = 0; Ifield < num_fields; ++Ifield ) {
+        non_empty( mask, quantiles_all_times.at(Ifield) );
+        write_field_to_output( 
+                quantiles_all_times.at(Ifield), vars_to_process.at(Ifield) + "_" + kind + "_quantiles_all_times", 
+                start_all, count_all, filename, &mask );
+    }
+}
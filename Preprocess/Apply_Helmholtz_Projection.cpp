@@ -7,6 +7,7 @@
 #include <vector>
 #include <omp.h>
 #include <math.h>
+#include <cassert>
 #include "../ALGLIB/stdafx.h"
 #include "../ALGLIB/linalg.h"
 #include "../ALGLIB/solvers.h"
@@ -20,7 +21,8 @@ void sparse_vel_from_PsiPhi_vortdiv(
         const bool weight_err,
         const double Tikhov_Laplace,
         const double deriv_scale_factor,
-        const int wRank
+        const int wRank,
+        const spherical_derivative_operators & ops
         ) {
 
     const std::vector<double>   &latitude   = source_data.latitude,
@@ -34,11 +36,15 @@ void sparse_vel_from_PsiPhi_vortdiv(
                 Nlat    = myCounts.at(2),
                 Nlon    = myCounts.at(3);
 
-    int Ilat, Ilon, IDIFF, Idiff, Ndiff, LB;
-    size_t index_sub, diff_index;
+    // The stencils are the same as from get_diff_vector (including the back-up plans)
+    assert( ops.applies_to( longitude, latitude, mask, Tikhov_Laplace > 0 ) );
+
+    int Ilat, Ilon, Idiff, Ndiff;
+    size_t index, index_sub, diff_index;
     const size_t Npts = Nlat * Nlon;
     double tmp_val, tan_lat;
-    std::vector<double> diff_vec;
+    const long *diff_offsets;
+    const double *diff_coeffs;
     bool is_pole;
 
     const double R_inv  = 1. / constants::R_earth,
@@ -60,6 +66,8 @@ void sparse_vel_from_PsiPhi_vortdiv(
             // If we're too close to the pole (less than 0.01 degrees), bad things happen
             is_pole = std::fabs( std::fabs( latitude.at(Ilat) * 180.0 / M_PI ) - 90 ) < 0.01;
 
+            index = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
+
             index_sub = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
             
             double weight_val = weight_err ? dAreas.at(index_sub) : 1.;
@@ -72,34 +80,24 @@ void sparse_vel_from_PsiPhi_vortdiv(
                 //// LON first derivative part
                 //
 
-                LB = - 2 * Nlon;
-                get_diff_vector(diff_vec, LB, longitude, "lon", Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask, 1, constants::DiffOrd);
-
-                Ndiff = diff_vec.size();
-
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlon) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
+                Ndiff = ops.ddlon.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                        if (constants::PERIODIC_X) { Idiff = ( IDIFF % Nlon + Nlon ) % Nlon; }
-                        else                       { Idiff = IDIFF;                          }
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                        diff_index = Index(0, 0, Ilat, Idiff, 1, 1, Nlat, Nlon);
+                    tmp_val     = diff_coeffs[Idiff] * cos_lat_inv * R_inv;
+                    tmp_val    *= weight_val;
+                    if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
 
-                        tmp_val     = diff_vec.at(IDIFF-LB) * cos_lat_inv * R_inv;
-                        tmp_val    *= weight_val;
-                        if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
+                    // Psi part
+                    size_t  column_skip = 0 * Npts,
+                            row_skip    = 1 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
 
-                        // Psi part
-                        size_t  column_skip = 0 * Npts,
-                                row_skip    = 1 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
-
-                        // Phi part
-                        column_skip = 1 * Npts;
-                        row_skip    = 0 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
-                    }
+                    // Phi part
+                    column_skip = 1 * Npts;
+                    row_skip    = 0 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
                 }
 
 
@@ -107,34 +105,24 @@ void sparse_vel_from_PsiPhi_vortdiv(
                 //// LAT first derivative part
                 //
 
-                LB = - 2 * Nlat;
-                get_diff_vector(diff_vec, LB, latitude, "lat", Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask, 1, constants::DiffOrd);
-
-                Ndiff = diff_vec.size();
-
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlat) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
-
-                        if (constants::PERIODIC_Y) { Idiff = ( IDIFF % Nlat + Nlat ) % Nlat; }
-                        else                       { Idiff = IDIFF;                          }
+                Ndiff = ops.ddlat.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                        diff_index = Index(0, 0, Idiff, Ilon, 1, 1, Nlat,  Nlon);
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                        tmp_val     = diff_vec.at(IDIFF-LB) * R_inv;
-                        tmp_val    *= weight_val;
-                        if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
+                    tmp_val     = diff_coeffs[Idiff] * R_inv;
+                    tmp_val    *= weight_val;
+                    if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
 
-                        // Psi part
-                        size_t  column_skip = 0 * Npts,
-                                row_skip    = 0 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, -tmp_val );
+                    // Psi part
+                    size_t  column_skip = 0 * Npts,
+                            row_skip    = 0 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, -tmp_val );
 
-                        // Phi part
-                        column_skip = 1 * Npts;
-                        row_skip    = 1 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index,  tmp_val );
-                    }
+                    // Phi part
+                    column_skip = 1 * Npts;
+                    row_skip    = 1 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index,  tmp_val );
                 }
             }
         }
@@ -158,6 +146,8 @@ void sparse_vel_from_PsiPhi_vortdiv(
             // If we're too close to the pole (less than 0.01 degrees), bad things happen
             is_pole = std::fabs( std::fabs( latitude.at(Ilat) * 180.0 / M_PI ) - 90 ) < 0.01;
 
+            index = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
+
             index_sub = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
 
             double weight_val = weight_err ? dAreas.at(index_sub) : 1.;
@@ -171,35 +161,25 @@ void sparse_vel_from_PsiPhi_vortdiv(
                 //      i.e. force neighbouring points to sum to zero
 
                 // i.e. force zero zonal derivative
-                LB = - 2 * Nlon;
-                get_diff_vector(diff_vec, LB, longitude, "lon", Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask, 1, constants::DiffOrd);
-
-                Ndiff = diff_vec.size();
-
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlon) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
-
-                        if (constants::PERIODIC_X) { Idiff = ( IDIFF % Nlon + Nlon ) % Nlon; }
-                        else                       { Idiff = IDIFF;                          }
+                Ndiff = ops.ddlon.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                        diff_index = Index(0, 0, Ilat, Idiff, 1, 1, Nlat, Nlon);
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                        //tmp_val     = diff_vec.at(IDIFF-LB);
-                        tmp_val     = diff_vec.at(IDIFF-LB) * cos_lat_inv * R_inv;
-                        tmp_val    *= weight_val;
-                        if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
+                    //tmp_val     = diff_coeffs[Idiff];
+                    tmp_val     = diff_coeffs[Idiff] * cos_lat_inv * R_inv;
+                    tmp_val    *= weight_val;
+                    if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
 
-                        // Psi part
-                        size_t  column_skip = 1 * Npts,
-                                row_skip    = 2 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
+                    // Psi part
+                    size_t  column_skip = 1 * Npts,
+                            row_skip    = 2 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
 
-                        // Phi part
-                        column_skip = 0 * Npts;
-                        row_skip    = 3 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
-                    }
+                    // Phi part
+                    column_skip = 0 * Npts;
+                    row_skip    = 3 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
                 }
 
             } else if ( (not(is_pole)) and (Tikhov_Laplace > 0) ) {
@@ -209,110 +189,469 @@ void sparse_vel_from_PsiPhi_vortdiv(
                 //// LON second derivative part
                 //
 
-                LB = - 2 * Nlon;
-                get_diff_vector(diff_vec, LB, longitude, "lon", Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask, 2, constants::DiffOrd);
+                Ndiff = ops.d2dlon2.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
+
+                    diff_index = index_sub + diff_offsets[Idiff];
+
+                    tmp_val     = diff_coeffs[Idiff] * cos2_lat_inv * R2_inv;
+                    tmp_val    *= weight_val * Tikhov_Laplace / deriv_scale_factor;
+                    if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
+
+                    // (2,0) entry
+                    size_t  row_skip    = 2 * Npts,
+                            column_skip = 0 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
+
+                    // (3,1) entry
+                    row_skip    = 3 * Npts;
+                    column_skip = 1 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
+                }
 
-                Ndiff = diff_vec.size();
 
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlon) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
+                //
+                //// LAT second derivative part
+                //
 
-                        if (constants::PERIODIC_X) { Idiff = ( IDIFF % Nlon + Nlon ) % Nlon; }
-                        else                       { Idiff = IDIFF;                          }
+                Ndiff = ops.d2dlat2.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                        diff_index = Index(0, 0, Ilat, Idiff, 1, 1, Nlat, Nlon);
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                        tmp_val     = diff_vec.at(IDIFF-LB) * cos2_lat_inv * R2_inv;
-                        tmp_val    *= weight_val * Tikhov_Laplace / deriv_scale_factor;
-                        if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
+                    tmp_val     = diff_coeffs[Idiff] * R2_inv;
+                    tmp_val    *= weight_val * Tikhov_Laplace / deriv_scale_factor;
+                    if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
 
-                        // (2,0) entry
-                        size_t  row_skip    = 2 * Npts,
-                                column_skip = 0 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
+                    // (2,0) entry
+                    size_t  row_skip    = 2 * Npts,
+                            column_skip = 0 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
 
-                        // (3,1) entry
-                        row_skip    = 3 * Npts;
-                        column_skip = 1 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
-                    }
+                    // (3,1) entry
+                    row_skip    = 3 * Npts;
+                    column_skip = 1 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
                 }
 
 
                 //
-                //// LAT second derivative part
+                //// LAT first derivative part
                 //
 
-                LB = -2 * Nlat;
-                get_diff_vector(diff_vec, LB, latitude, "lat", Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask, 2, constants::DiffOrd);
+                Ndiff = ops.ddlat.stencil_at( index, diff_offsets, diff_coeffs );
+                //tan_lat = tan( latitude.at(Ilat) );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                Ndiff = diff_vec.size();
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlat) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
+                    tmp_val     = - diff_coeffs[Idiff] * tan_lat * R2_inv;
+                    tmp_val    *= weight_val * Tikhov_Laplace / deriv_scale_factor;
+                    if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
 
-                        if (constants::PERIODIC_Y) { Idiff = ( IDIFF % Nlat + Nlat ) % Nlat; }
-                        else                       { Idiff = IDIFF;                          }
+                    // (2,0) entry
+                    size_t  row_skip    = 2 * Npts,
+                            column_skip = 0 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
 
-                        diff_index = Index(0, 0, Idiff, Ilon, 1, 1, Nlat,  Nlon);
+                    // (3,1) entry
+                    row_skip    = 3 * Npts;
+                    column_skip = 1 * Npts;
+                    alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
+                }
+            }
+        }
+    }
+        
+}
 
-                        tmp_val     = diff_vec.at(IDIFF-LB) * R2_inv;
-                        tmp_val    *= weight_val * Tikhov_Laplace / deriv_scale_factor;
-                        if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
 
-                        // (2,0) entry
-                        size_t  row_skip    = 2 * Npts,
-                                column_skip = 0 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
+double Helmholtz_deriv_scale_factor(
+        const dataset & grid_data,
+        const std::vector<bool> & mask
+        ) {
 
-                        // (3,1) entry
-                        row_skip    = 3 * Npts;
-                        column_skip = 1 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
-                    }
+    // Get a magnitude for the derivatives, to help normalize the rows of the 
+    //  Laplace entries to have similar magnitude to the others.
+    const int   Nlat = grid_data.latitude.size(),
+                Nlon = grid_data.longitude.size();
+    int LB = - 2 * Nlat;
+    std::vector<double> diff_vec;
+    get_diff_vector(diff_vec, LB, grid_data.latitude, "lat", 0, 0, Nlat/2, 0, 1, 1, Nlat, Nlon, mask, 1, constants::DiffOrd);
+    int Ndiff = diff_vec.size();
+    double deriv_scale_factor = 0;
+    for ( size_t IDIFF = 0; IDIFF < diff_vec.size(); IDIFF++ ) { 
+        deriv_scale_factor += std::fabs( diff_vec.at(IDIFF) ) / Ndiff; 
+    }
+    return deriv_scale_factor;
+}
+
+void Helmholtz_build_RHS(
+        std::vector<double> & RHS_vector,
+        const std::vector<double> & u_lon,
+        const std::vector<double> & u_lat,
+        const dataset & grid_data,
+        const std::vector<bool> & mask,
+        const bool weight_err,
+        const double Tikhov_Laplace,
+        const double deriv_scale_factor
+        ) {
+
+    const std::vector<double>   &latitude   = grid_data.latitude,
+                                &longitude  = grid_data.longitude,
+                                &dAreas     = grid_data.areas;
+
+    const int   Nlat = latitude.size(),
+                Nlon = longitude.size();
+    const size_t Npts = Nlat * Nlon;
+
+    int Ilat, Ilon;
+    size_t index;
+
+    std::vector<double> div_term( Npts, 0. ), vort_term( Npts, 0. );
+
+    #if DEBUG >= 3
+    fprintf( stdout, "Getting divergence and vorticity from velocity.\n" );
+    fflush(stdout);
+    #endif
+    toroidal_vel_div(        div_term, u_lon, u_lat, longitude, latitude,       1, 1, Nlat, Nlon, mask );
+    toroidal_curl_u_dot_er( vort_term, u_lon, u_lat, longitude, latitude, 0, 0, 1, 1, Nlat, Nlon, mask );
+
+    //
+    //// Set up the RHS_vector
+    //
+    
+    double is_pole;
+    #pragma omp parallel default(none) \
+    shared( dAreas, latitude, RHS_vector, div_term, vort_term, u_lon, u_lat, deriv_scale_factor ) \
+    private( Ilat, Ilon, index, is_pole ) \
+    firstprivate( Nlon, Nlat, Npts, Tikhov_Laplace, weight_err )
+    {
+        #pragma omp for collapse(2) schedule(static)
+        for (Ilat = 0; Ilat < Nlat; ++Ilat) {
+            for (Ilon = 0; Ilon < Nlon; ++Ilon) {
+                index = Index( 0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
+
+                is_pole = std::fabs( std::fabs( latitude.at(Ilat) * 180.0 / M_PI ) - 90 ) < 0.01;
+
+                RHS_vector.at( 0*Npts + index) = u_lon.at(index);
+                RHS_vector.at( 1*Npts + index) = u_lat.at(index);
+
+                if ( ( Ilat == 0 ) or ( is_pole ) ) {
+                    RHS_vector.at( 2*Npts + index) = 0.;
+                    RHS_vector.at( 3*Npts + index) = 0.;
+                } else {
+                    RHS_vector.at( 2*Npts + index) = vort_term.at(index) * Tikhov_Laplace / deriv_scale_factor;
+                    RHS_vector.at( 3*Npts + index) = div_term.at( index) * Tikhov_Laplace / deriv_scale_factor;
                 }
 
+                if ( weight_err ) {
+                    RHS_vector.at( 0*Npts + index) *= dAreas.at(index);
+                    RHS_vector.at( 1*Npts + index) *= dAreas.at(index);
+                    RHS_vector.at( 2*Npts + index) *= dAreas.at(index);
+                    RHS_vector.at( 3*Npts + index) *= dAreas.at(index);
+                }
+            }
+        }
+    }
+}
 
-                //
-                //// LAT first derivative part
-                //
+void Helmholtz_solve_slice(
+        std::vector<double> & Psi_vector,
+        std::vector<double> & Phi_vector,
+        size_t & iters_used,
+        int & termination_type,
+        double & seed_misfit,
+        alglib::linlsqrstate & state,
+        const alglib::sparsematrix & LHS_matr,
+        const std::vector<double> & u_lon,
+        const std::vector<double> & u_lat,
+        const std::vector<double> & Psi_seed,
+        const std::vector<double> & Phi_seed,
+        const dataset & grid_data,
+        const std::vector<bool> & mask,
+        const spherical_derivative_operators * ops,
+        const bool weight_err,
+        const double Tikhov_Laplace,
+        const double deriv_scale_factor,
+        const double rel_tol,
+        const int max_iters,
+        const double tol_scale,
+        const int check_interval = 0,
+        const double velocity_tolerance = 0.,
+        std::vector<double> * residual_history = NULL,
+        std::vector<double> * residual_iterations = NULL
+        ) {
 
-                LB = - 2 * Nlat;
-                get_diff_vector(diff_vec, LB, latitude, "lat", Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask, 1, constants::DiffOrd);
+    const std::vector<double>   &latitude   = grid_data.latitude,
+                                &longitude  = grid_data.longitude,
+                                &dAreas     = grid_data.areas;
 
-                Ndiff = diff_vec.size();
-                //tan_lat = tan( latitude.at(Ilat) );
+    const int   Nlat = latitude.size(),
+                Nlon = longitude.size();
+    const size_t Npts = Nlat * Nlon;
 
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlat) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
+    int Ilat, Ilon;
+    size_t index;
 
-                        if (constants::PERIODIC_Y) { Idiff = ( IDIFF % Nlat + Nlat ) % Nlat; }
-                        else                       { Idiff = IDIFF;                          }
+    std::vector<double> 
+        RHS_vector(  4 * Npts, 0. ),
+        u_lon_rem(       Npts, 0. ),
+        u_lat_rem(       Npts, 0. ),
+        u_lon_tor_seed(  Npts, 0. ),
+        u_lat_tor_seed(  Npts, 0. ),
+        u_lon_pot_seed(  Npts, 0. ),
+        u_lat_pot_seed(  Npts, 0. );
 
-                        diff_index = Index(0, 0, Idiff, Ilon, 1, 1, Nlat,  Nlon);
+    // Get velocity from seed
+    #if DEBUG >= 3
+    fprintf( stdout, "Getting velocities from seed.\n" );
+    fflush(stdout);
+    #endif
+    toroidal_vel_from_F(  u_lon_tor_seed, u_lat_tor_seed, Psi_seed, longitude, latitude, 1, 1, Nlat, Nlon, mask, ops);
+    potential_vel_from_F( u_lon_pot_seed, u_lat_pot_seed, Phi_seed, longitude, latitude, 1, 1, Nlat, Nlon, mask, ops);
 
-                        tmp_val     = - diff_vec.at(IDIFF-LB) * tan_lat * R2_inv;
-                        tmp_val    *= weight_val * Tikhov_Laplace / deriv_scale_factor;
-                        if (isnan(tmp_val)) { fprintf( stdout, "  Rank %d encountered a NaN at lat/lon %d,%d (codeline %d)\n", wRank, Ilat, Ilon, __LINE__ ); }
+    #if DEBUG >= 3
+    fprintf( stdout, "Subtracting seed velocity to get remaining.\n" );
+    fflush(stdout);
+    #endif
+    double rem_KE = 0., orig_KE = 0.;
+    #pragma omp parallel default(none) \
+    shared( dAreas, u_lon, u_lon_tor_seed, u_lon_pot_seed, u_lon_rem, \
+                    u_lat, u_lat_tor_seed, u_lat_pot_seed, u_lat_rem ) \
+    private( Ilat, Ilon, index ) \
+    firstprivate( Nlon, Nlat ) \
+    reduction(+ : rem_KE, orig_KE)
+    {
+        #pragma omp for collapse(2) schedule(static)
+        for (Ilat = 0; Ilat < Nlat; ++Ilat) {
+            for (Ilon = 0; Ilon < Nlon; ++Ilon) {
+                index = Index( 0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
 
-                        // (2,0) entry
-                        size_t  row_skip    = 2 * Npts,
-                                column_skip = 0 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
+                u_lon_rem.at( index ) = u_lon.at(index) - u_lon_tor_seed.at(index) - u_lon_pot_seed.at(index);
+                u_lat_rem.at( index ) = u_lat.at(index) - u_lat_tor_seed.at(index) - u_lat_pot_seed.at(index);
 
-                        // (3,1) entry
-                        row_skip    = 3 * Npts;
-                        column_skip = 1 * Npts;
-                        alglib::sparseadd(  LHS_matr, row_skip + index_sub, column_skip + diff_index, tmp_val );
-                    }
-                }
+                rem_KE  += dAreas.at(index) * ( pow( u_lon_rem.at(index), 2. ) + pow( u_lat_rem.at(index), 2. ) );
+                orig_KE += dAreas.at(index) * ( pow( u_lon.at(    index), 2. ) + pow( u_lat.at(    index), 2. ) );
             }
         }
     }
-        
+
+    // Relative (area-weighted) velocity error of the seed
+    seed_misfit = ( orig_KE > 0 ) ? sqrt( rem_KE / orig_KE ) : 0.;
+
+    Helmholtz_build_RHS( RHS_vector, u_lon_rem, u_lat_rem, grid_data, mask, weight_err, Tikhov_Laplace, deriv_scale_factor );
+
+    // The tolerance on ||Rk|| is relative to ||B||, which a good seed makes small. Loosen it
+    //   by ||B|| / ||B_unseeded|| so that seeded solves target the same accuracy as unseeded 
+    //   ones, rather than pushing the remainder to the full relative tolerance.
+    //   tol_scale does the same for callers that pass in an already-reduced velocity.
+    double rhs_ratio = 1.;
+    if ( rem_KE != orig_KE ) {
+        std::vector<double> RHS_unseeded( 4 * Npts, 0. );
+        Helmholtz_build_RHS( RHS_unseeded, u_lon, u_lat, grid_data, mask, weight_err, Tikhov_Laplace, deriv_scale_factor );
+        double rem_norm = 0., full_norm = 0.;
+        for (index = 0; index < 4 * Npts; ++index) {
+            rem_norm  += pow( RHS_vector.at(  index), 2. );
+            full_norm += pow( RHS_unseeded.at(index), 2. );
+        }
+        rhs_ratio = ( full_norm > 0 ) ? sqrt( rem_norm / full_norm ) : 1.;
+    }
+
+    //
+    //// Now apply the least-squares solver
+    //
+    alglib::real_1d_array rhs, F_alglib;
+    alglib::linlsqrreport report;
+    rhs.attach_to_ptr( 4 * Npts, &RHS_vector[0] );
+
+    const double rhs_tol = rel_tol * tol_scale / rhs_ratio;
+    alglib::linlsqrsetcond(state, rel_tol, (rhs_tol < 1.) ? rhs_tol : 1., max_iters);
+
+    // Relative (area-weighted) error in the full velocity for a given solution (of the seeded problem).
+    //   Since the seed velocity has already been removed, only the velocity from the solution is needed
+    //   (the seed velocity arrays are re-used as workspace).
+    std::vector<double> Psi_iter( Npts ), Phi_iter( Npts );
+    auto velocity_error = [&]( const double * solution ) -> double {
+        std::copy( solution,        solution +     Npts, Psi_iter.begin() );
+        std::copy( solution + Npts, solution + 2 * Npts, Phi_iter.begin() );
+        toroidal_vel_from_F(  u_lon_tor_seed, u_lat_tor_seed, Psi_iter, longitude, latitude, 1, 1, Nlat, Nlon, mask, ops);
+        potential_vel_from_F( u_lon_pot_seed, u_lat_pot_seed, Phi_iter, longitude, latitude, 1, 1, Nlat, Nlon, mask, ops);
+
+        double err_KE = 0.;
+        #pragma omp parallel default(none) \
+        shared( dAreas, u_lon_rem, u_lon_tor_seed, u_lon_pot_seed, u_lat_rem, u_lat_tor_seed, u_lat_pot_seed ) \
+        firstprivate( Npts ) \
+        reduction(+ : err_KE)
+        {
+            #pragma omp for collapse(1) schedule(static)
+            for (size_t ii = 0; ii < Npts; ++ii) {
+                err_KE += dAreas.at(ii) * (   pow( u_lon_rem.at(ii) - u_lon_tor_seed.at(ii) - u_lon_pot_seed.at(ii), 2. )
+                                            + pow( u_lat_rem.at(ii) - u_lat_tor_seed.at(ii) - u_lat_pot_seed.at(ii), 2. ) );
+            }
+        }
+        return ( orig_KE > 0 ) ? sqrt( err_KE / orig_KE ) : 0.;
+    };
+
+    // Every check_interval iterations, record the velocity error, and stop if it's good enough
+    auto check_solution = [&]( const std::vector<double> & solution, const int iteration ) -> bool {
+        const double vel_err = velocity_error( &solution[0] );
+        if ( residual_history    != NULL ) { residual_history->push_back( vel_err ); }
+        if ( residual_iterations != NULL ) { residual_iterations->push_back( iteration ); }
+        #if DEBUG >= 2
+        fprintf( stdout, "    iteration %d: relative velocity error %g\n", iteration, vel_err );
+        #endif
+        return ( velocity_tolerance > 0 ) and ( vel_err <= velocity_tolerance );
+    };
+
+    monitored_lsqr_solve_sparse( state, LHS_matr, rhs, check_interval, check_solution );
+    alglib::linlsqrresults(state, F_alglib, report);
+
+    /*    Rep     -   optimization report:
+        * Rep.TerminationType completetion code:
+            *  1    ||Rk||<=EpsB*||B||
+            *  4    ||A^T*Rk||/(||A||*||Rk||)<=EpsA
+            *  5    MaxIts steps was taken
+            *  7    rounding errors prevent further progress,
+                    X contains best point found so far.
+                    (sometimes returned on singular systems)
+            *  8    user requested termination via calling
+                    linlsqrrequesttermination()
+        * Rep.IterationsCount contains iterations count
+        * NMV countains number of matrix-vector calculations
+    */
+    termination_type = report.terminationtype;
+    iters_used = linlsqrpeekiterationscount( state );
+
+    // Make sure that the history ends with the final solution
+    if ( ( check_interval > 0 ) and ( residual_history != NULL ) and ( residual_iterations != NULL ) ) {
+        if ( residual_iterations->empty() or ( residual_iterations->back() != (double) iters_used ) ) {
+            residual_history->push_back( velocity_error( F_alglib.getcontent() ) );
+            residual_iterations->push_back( iters_used );
+        }
+    }
+
+    // Extract the solution and add the seed back in
+    const double *F_array = F_alglib.getcontent();
+    Psi_vector.assign( F_array,        F_array +     Npts );
+    Phi_vector.assign( F_array + Npts, F_array + 2 * Npts );
+    for (size_t ii = 0; ii < Npts; ++ii) {
+        Psi_vector.at(ii) += Psi_seed.at(ii);
+        Phi_vector.at(ii) += Phi_seed.at(ii);
+    }
+}
+
+// Solve for Psi and Phi on all (local) times / depths at once with spherical harmonics.
+//   The harmonics invert the continuous Laplacian, while the velocities are built with
+//   finite differences, so the velocity that is left over is fed back through the
+//   solver for a few sweeps, which stop once they no longer pay off. The result is
+//   then used to seed the least-squares solver, which removes the remaining misfit.
+bool Helmholtz_SHT_solve(
+        std::vector<double> & full_Psi,
+        std::vector<double> & full_Phi,
+        int & sweeps_used,
+        double & final_misfit,
+        const spherical_harmonic_Lap_solver & SHT_solver,
+        const std::vector<double> & u_lon,
+        const std::vector<double> & u_lat,
+        const dataset & source_data,
+        const std::vector<bool> & mask,
+        const spherical_derivative_operators & ops
+        ) {
+
+    const std::vector<double>   &latitude   = source_data.latitude,
+                                &longitude  = source_data.longitude,
+                                &dAreas     = source_data.areas;
+
+    const std::vector<int>  &myCounts = source_data.myCounts;
+
+    const int   Ntime   = myCounts.at(0),
+                Ndepth  = myCounts.at(1),
+                Nlat    = myCounts.at(2),
+                Nlon    = myCounts.at(3),
+                Nslices = Ntime * Ndepth;
+
+    const size_t Npts = Nlat * Nlon,
+                 Nfull = u_lon.size();
+
+    const int max_sweeps = 10;
+    const double min_improvement = 0.75;
+
+    std::vector<double>
+        u_lon_rem( u_lon ),
+        u_lat_rem( u_lat ),
+        RHS_vector( 2 * Nfull, 0. ),
+        Psi_Phi_update,
+        u_lon_tor( Nfull, 0. ),
+        u_lat_tor( Nfull, 0. ),
+        u_lon_pot( Nfull, 0. ),
+        u_lat_pot( Nfull, 0. );
+
+    size_t index;
+    double rem_KE, orig_KE = 0., prev_misfit = 1.;
+    for (index = 0; index < Nfull; ++index) {
+        orig_KE += dAreas.at(index % Npts) * ( pow( u_lon.at(index), 2. ) + pow( u_lat.at(index), 2. ) );
+    }
+
+    full_Psi.assign( Nfull, 0. );
+    full_Phi.assign( Nfull, 0. );
+    sweeps_used = 0;
+    final_misfit = 1.;
+    if (orig_KE == 0) { final_misfit = 0.; return true; }
+
+    for (int Isweep = 0; Isweep < max_sweeps; ++Isweep) {
+
+        // Vorticity into the first Nslices slices of the RHS, divergence into the rest
+        std::vector<double> vort_term( Npts, 0. ), div_term( Npts, 0. ), u_lon_slice( Npts ), u_lat_slice( Npts );
+        for (int Islice = 0; Islice < Nslices; ++Islice) {
+            std::copy( u_lon_rem.begin() + Islice * Npts, u_lon_rem.begin() + (Islice + 1) * Npts, u_lon_slice.begin() );
+            std::copy( u_lat_rem.begin() + Islice * Npts, u_lat_rem.begin() + (Islice + 1) * Npts, u_lat_slice.begin() );
+
+            toroidal_vel_div(        div_term, u_lon_slice, u_lat_slice, longitude, latitude,       1, 1, Nlat, Nlon, mask );
+            toroidal_curl_u_dot_er( vort_term, u_lon_slice, u_lat_slice, longitude, latitude, 0, 0, 1, 1, Nlat, Nlon, mask );
+
+            std::copy( vort_term.begin(), vort_term.end(), RHS_vector.begin() +             Islice  * Npts );
+            std::copy( div_term.begin(),  div_term.end(),  RHS_vector.begin() + (Nslices + Islice) * Npts );
+        }
+
+        if (not( SHT_solver.solve( Psi_Phi_update, RHS_vector, 2 * Nslices ) )) { return false; }
+
+        for (index = 0; index < Nfull; ++index) {
+            full_Psi.at(index) += Psi_Phi_update.at(index);
+            full_Phi.at(index) += Psi_Phi_update.at(Nfull + index);
+        }
+
+        toroidal_vel_from_F(  u_lon_tor, u_lat_tor, full_Psi, longitude, latitude, Ntime, Ndepth, Nlat, Nlon, mask, &ops );
+        potential_vel_from_F( u_lon_pot, u_lat_pot, full_Phi, longitude, latitude, Ntime, Ndepth, Nlat, Nlon, mask, &ops );
+
+        rem_KE = 0.;
+        for (index = 0; index < Nfull; ++index) {
+            u_lon_rem.at(index) = u_lon.at(index) - u_lon_tor.at(index) - u_lon_pot.at(index);
+            u_lat_rem.at(index) = u_lat.at(index) - u_lat_tor.at(index) - u_lat_pot.at(index);
+            rem_KE += dAreas.at(index % Npts) * ( pow( u_lon_rem.at(index), 2. ) + pow( u_lat_rem.at(index), 2. ) );
+        }
+        const double misfit = sqrt( rem_KE / orig_KE );
+
+        #if DEBUG >= 1
+        fprintf( stdout, "  SHT sweep %d: relative velocity misfit %g\n", Isweep, misfit );
+        #endif
+
+        // If the sweep made things worse, then undo it and stop
+        if ( (Isweep > 0) and (misfit > prev_misfit) ) {
+            for (index = 0; index < Nfull; ++index) {
+                full_Psi.at(index) -= Psi_Phi_update.at(index);
+                full_Phi.at(index) -= Psi_Phi_update.at(Nfull + index);
+            }
+            break;
+        }
+
+        sweeps_used = Isweep + 1;
+        final_misfit = misfit;
+        if ( (Isweep > 0) and (misfit > min_improvement * prev_misfit) ) { break; }
+        prev_misfit = misfit;
+    }
+
+    return true;
 }
 
 
@@ -327,6 +666,12 @@ void Apply_Helmholtz_Projection(
         const bool weight_err,
         const bool use_mask,
         const double Tikhov_Laplace,
+        const int coarse_seed_factor,
+        const bool extrapolate_seed,
+        const bool measure_seed_savings,
+        const bool use_SHT,
+        const double velocity_tolerance,
+        const int residual_check_interval,
         const MPI_Comm comm
         ) {
 
@@ -360,7 +705,7 @@ void Apply_Helmholtz_Projection(
 
     const size_t Npts = Nlat * Nlon;
 
-    int Itime=0, Idepth=0, Ilat, Ilon;
+    int Ilat, Ilon;
     size_t index, index_sub, iters_used = 0;
 
     // Fill in the land areas with zero velocity
@@ -388,23 +733,16 @@ void Apply_Helmholtz_Projection(
         full_u_lon_tor(  u_lon.size(), 0. ),
         full_u_lat_tor(  u_lon.size(), 0. ),
         full_u_lon_pot(  u_lon.size(), 0. ),
-        full_u_lat_pot(  u_lon.size(), 0. ),
-        u_lon_tor_seed(  Npts, 0. ),
-        u_lat_tor_seed(  Npts, 0. ),
-        u_lon_pot_seed(  Npts, 0. ),
-        u_lat_pot_seed(  Npts, 0. );
+        full_u_lat_pot(  u_lon.size(), 0. );
 
-    // alglib variables
-    alglib::real_1d_array rhs;
     std::vector<double> 
-        RHS_vector( 4 * Npts, 0. ),
         Psi_seed(       Npts, 0. ),
         Phi_seed(       Npts, 0. ),
-        work_arr(       Npts, 0. ),
-        div_term(       Npts, 0. ),
-        vort_term(      Npts, 0. ),
-        u_lon_rem(      Npts, 0. ),
-        u_lat_rem(      Npts, 0. );
+        Psi_vector(     Npts, 0. ),
+        Phi_vector(     Npts, 0. ),
+        u_lon_slice(    Npts, 0. ),
+        u_lat_slice(    Npts, 0. ),
+        work_arr(       Npts, 0. );
     
 
     // Copy the starting seed.
@@ -426,14 +764,9 @@ void Apply_Helmholtz_Projection(
         }
     }
 
-    rhs.attach_to_ptr( 4 * Npts, &RHS_vector[0] );
+    const double solve_start_time = MPI_Wtime();
 
     alglib::linlsqrstate state;
-    alglib::linlsqrreport report;
-
-    alglib::real_1d_array F_alglib;
-
-    double *F_array;
 
     //
     //// Build the LHS part of the problem
@@ -453,23 +786,20 @@ void Apply_Helmholtz_Projection(
     #endif
 
     alglib::sparsematrix LHS_matr;
-    alglib::sparsecreate(4*Npts, 2*Npts, LHS_matr);
 
-    // Get a magnitude for the derivatives, to help normalize the rows of the 
-    //  Laplace entries to have similar magnitude to the others.
-    int LB = - 2 * Nlat;
-    std::vector<double> diff_vec;
-    get_diff_vector(diff_vec, LB, latitude, "lat", Itime, Idepth, Nlat/2, 0, Ntime, Ndepth, Nlat, Nlon, unmask, 1, constants::DiffOrd);
-    int Ndiff = diff_vec.size();
-    double deriv_scale_factor = 0;
-    for ( size_t IDIFF = 0; IDIFF < diff_vec.size(); IDIFF++ ) { 
-        deriv_scale_factor += std::fabs( diff_vec.at(IDIFF) ) / Ndiff; 
-    }
+    // Derivative operators for the projection mask, shared by the least-squares matrix, the spherical-harmonic
+    //    correction sweeps, and the velocity extraction
+    spherical_derivative_operators proj_ops;
+    proj_ops.build( longitude, latitude, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, Tikhov_Laplace > 0 );
+
+    const double deriv_scale_factor = Helmholtz_deriv_scale_factor( source_data, unmask );
     if (wRank == 0) { fprintf( stdout, "deriv_scale_factor = %g\n", deriv_scale_factor ); }
 
+    alglib::sparsecreate(4*Npts, 2*Npts, LHS_matr);
+
     // Put in {u,v}_from_{psi,phi} bits
     //      this assumes that we can use the same operator for all times / depths
-    sparse_vel_from_PsiPhi_vortdiv( LHS_matr, source_data, 0, 0, use_mask ? mask : unmask, weight_err, Tikhov_Laplace, deriv_scale_factor, wRank );
+    sparse_vel_from_PsiPhi_vortdiv( LHS_matr, source_data, 0, 0, use_mask ? mask : unmask, weight_err, Tikhov_Laplace, deriv_scale_factor, wRank, proj_ops );
 
     alglib::sparseconverttocrs(LHS_matr);
 
@@ -480,20 +810,182 @@ void Apply_Helmholtz_Projection(
     }
     #endif
     alglib::linlsqrcreate(4*Npts, 2*Npts, state);
-    alglib::linlsqrsetcond(state, rel_tol, rel_tol, max_iters);
+
+    //
+    //// If requested (and possible), solve every time / depth at once with spherical harmonics,
+    ////    which then seeds the least-squares solver
+    //
+    bool do_SHT = false;
+    int SHT_sweeps = 0;
+    double SHT_misfit = 0.;
+    if (use_SHT) {
+        spherical_harmonic_Lap_solver SHT_solver;
+        SHT_solver.build( source_data, use_mask ? mask : unmask );
+        if (SHT_solver.usable) {
+            do_SHT = Helmholtz_SHT_solve( full_Psi, full_Phi, SHT_sweeps, SHT_misfit, SHT_solver,
+                                          u_lon, u_lat, source_data, use_mask ? mask : unmask, proj_ops );
+        }
+        if (wRank == 0) {
+            if (do_SHT) {
+                fprintf(stdout, "Seeding with the spherical-harmonic solver (%d sweeps, relative velocity misfit %g).\n", SHT_sweeps, SHT_misfit);
+            } else {
+                fprintf(stdout, "The spherical-harmonic solver can not be used on this grid / mask, "
+                                "so the usual seeds will be used.\n");
+            }
+        }
+    }
+
+    //
+    //// Build the coarse problem used to correct the seeds
+    //      The coarse grid is a strided subset of the full grid, so that the
+    //      coarse solution can be interpolated straight back onto it.
+    //
+    std::vector<int> coarse_lat_inds, coarse_lon_inds;
+    for (Ilat = 0; Ilat < Nlat; Ilat += std::max(coarse_seed_factor, 1)) { coarse_lat_inds.push_back(Ilat); }
+    for (Ilon = 0; Ilon < Nlon; Ilon += std::max(coarse_seed_factor, 1)) { coarse_lon_inds.push_back(Ilon); }
+
+    // Non-uniform latitude grids can keep the last row (e.g. the pole) without breaking the derivatives
+    if ( (not(constants::UNIFORM_LAT_GRID)) and (coarse_lat_inds.back() != Nlat - 1) ) { coarse_lat_inds.push_back(Nlat - 1); }
+
+    const int   Nlat_coarse = coarse_lat_inds.size(),
+                Nlon_coarse = coarse_lon_inds.size();
+    const size_t Npts_coarse = Nlat_coarse * Nlon_coarse;
+
+    // Periodic longitude requires the coarse grid to stay uniform across the wrap
+    const bool do_coarse_seed = (coarse_seed_factor > 1) and not(do_SHT)
+                                and ( Nlat_coarse > constants::DiffOrd ) and ( Nlon_coarse > constants::DiffOrd )
+                                and ( not(constants::PERIODIC_X) or (Nlon % coarse_seed_factor == 0) );
+    if ( (coarse_seed_factor > 1) and not(do_coarse_seed) and not(do_SHT) and (wRank == 0) ) {
+        fprintf( stdout, "Coarse seeding (factor %d) is not possible on this grid, and will be skipped.\n", coarse_seed_factor );
+    }
+
+    dataset coarse_data;
+    std::vector<bool> coarse_mask;
+    std::vector<double> coarse_interp_lat;
+    int Ilat_coarse_start = 0, Ilat_coarse_end = Nlat_coarse;
+    alglib::sparsematrix LHS_coarse;
+    alglib::linlsqrstate state_coarse;
+    spherical_derivative_operators coarse_ops;
+    double deriv_scale_coarse = 1.;
+    std::vector<double> 
+        u_lon_coarse(   Npts_coarse, 0. ),
+        u_lat_coarse(   Npts_coarse, 0. ),
+        coarse_zero(    Npts_coarse, 0. ),
+        Psi_coarse(     Npts_coarse, 0. ),
+        Phi_coarse(     Npts_coarse, 0. ),
+        u_lon_tor_seed( Npts, 0. ),
+        u_lat_tor_seed( Npts, 0. ),
+        u_lon_pot_seed( Npts, 0. ),
+        u_lat_pot_seed( Npts, 0. );
+    if (do_coarse_seed) {
+        #if DEBUG >= 0
+        if (wRank == 0) { fprintf( stdout, "Building the coarse (%d x %d) problem for seeding.\n", Nlat_coarse, Nlon_coarse ); }
+        #endif
+
+        for (Ilat = 0; Ilat < Nlat_coarse; ++Ilat) { coarse_data.latitude.push_back(  latitude.at(  coarse_lat_inds.at(Ilat) ) ); }
+        for (Ilon = 0; Ilon < Nlon_coarse; ++Ilon) { coarse_data.longitude.push_back( longitude.at( coarse_lon_inds.at(Ilon) ) ); }
+        coarse_data.Nlat = Nlat_coarse;
+        coarse_data.Nlon = Nlon_coarse;
+        coarse_data.myCounts = { 1, 1, Nlat_coarse, Nlon_coarse };
+        coarse_data.compute_cell_areas();
+
+        // The operator only uses the mask at the first time / depth, so do the same here
+        const std::vector<bool> &full_mask = use_mask ? mask : unmask;
+        coarse_mask.resize( Npts_coarse );
+        for (Ilat = 0; Ilat < Nlat_coarse; ++Ilat) {
+            for (Ilon = 0; Ilon < Nlon_coarse; ++Ilon) {
+                coarse_mask.at( Index(0, 0, Ilat, Ilon, 1, 1, Nlat_coarse, Nlon_coarse) ) 
+                    = full_mask.at( Index(0, 0, coarse_lat_inds.at(Ilat), coarse_lon_inds.at(Ilon), 1, 1, Nlat, Nlon) );
+            }
+        }
+
+        // Coarse latitudes to interpolate from, which skip the pole rows
+        while ( ( Ilat_coarse_start < Nlat_coarse ) and 
+                ( std::fabs( std::fabs( coarse_data.latitude.at(Ilat_coarse_start) * 180.0 / M_PI ) - 90 ) < 0.01 ) ) { Ilat_coarse_start++; }
+        while ( ( Ilat_coarse_end > Ilat_coarse_start ) and
+                ( std::fabs( std::fabs( coarse_data.latitude.at(Ilat_coarse_end - 1) * 180.0 / M_PI ) - 90 ) < 0.01 ) ) { Ilat_coarse_end--; }
+        coarse_interp_lat.assign( coarse_data.latitude.begin() + Ilat_coarse_start, coarse_data.latitude.begin() + Ilat_coarse_end );
+
+        const std::vector<bool> coarse_unmask( Npts_coarse, true );
+        deriv_scale_coarse = Helmholtz_deriv_scale_factor( coarse_data, coarse_unmask );
+
+        coarse_ops.build( coarse_data.longitude, coarse_data.latitude, 1, 1, Nlat_coarse, Nlon_coarse, coarse_mask, Tikhov_Laplace > 0 );
+
+        alglib::sparsecreate(4*Npts_coarse, 2*Npts_coarse, LHS_coarse);
+        sparse_vel_from_PsiPhi_vortdiv( LHS_coarse, coarse_data, 0, 0, coarse_mask, weight_err, Tikhov_Laplace, deriv_scale_coarse, wRank, coarse_ops );
+        alglib::sparseconverttocrs(LHS_coarse);
+
+        alglib::linlsqrcreate(4*Npts_coarse, 2*Npts_coarse, state_coarse);
+    }
 
     // Counters to track termination types
     int terminate_count_abs_tol = 0,
         terminate_count_rel_tol = 0,
         terminate_count_max_iter = 0,
         terminate_count_rounding = 0,
+        terminate_count_vel_tol = 0,
         terminate_count_other = 0;
 
+    // Seeding statistics for each time / depth
+    //      seed_type: 0 = previous solution / provided seed, 1 = extrapolated from the two previous solutions,
+    //                 2 = spherical-harmonic solution
+    std::vector<double> seed_type(              Ntime * Ndepth, 0. ),
+                        seed_misfit(            Ntime * Ndepth, 0. ),
+                        LSQR_iterations(        Ntime * Ndepth, 0. ),
+                        coarse_LSQR_iterations( Ntime * Ndepth, 0. ),
+                        iterations_saved(       Ntime * Ndepth, 0. );
+
+    // Velocity error every residual_check_interval iterations (and at the end) for each time / depth
+    std::vector< std::vector<double> >  residual_history(           Ntime * Ndepth ),
+                                        residual_history_iterations( Ntime * Ndepth );
+    int termination_type, coarse_termination_type;
+    size_t coarse_iters_used = 0, ref_iters_used;
+    double misfit, coarse_misfit = 0.;
+
     // Now do the solve!
     for (int Itime = 0; Itime < Ntime; ++Itime) {
         for (int Idepth = 0; Idepth < Ndepth; ++Idepth) {
 
-            if (not(single_seed)) {
+            const size_t stat_index = Index( Itime, Idepth, 0, 0, Ntime, Ndepth, 1, 1);
+
+            // Pull out the velocities for this time / depth
+            #pragma omp parallel \
+            default(none) \
+            shared( u_lon, u_lat, u_lon_slice, u_lat_slice, Itime, Idepth ) \
+            private( Ilat, Ilon, index, index_sub ) \
+            firstprivate( Nlon, Nlat, Ndepth, Ntime )
+            {
+                #pragma omp for collapse(2) schedule(static)
+                for (Ilat = 0; Ilat < Nlat; ++Ilat) {
+                    for (Ilon = 0; Ilon < Nlon; ++Ilon) {
+                        index     = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
+                        index_sub = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
+                        u_lon_slice.at(index_sub) = u_lon.at(index);
+                        u_lat_slice.at(index_sub) = u_lat.at(index);
+                    }
+                }
+            }
+
+            if (do_SHT) {
+                // Seed with the spherical-harmonic solution for this time / depth
+                #pragma omp parallel \
+                default(none) \
+                shared( Psi_seed, Phi_seed, full_Psi, full_Phi, Itime, Idepth ) \
+                private( Ilat, Ilon, index, index_sub ) \
+                firstprivate( Nlon, Nlat, Ndepth, Ntime )
+                {
+                    #pragma omp for collapse(2) schedule(static)
+                    for (Ilat = 0; Ilat < Nlat; ++Ilat) {
+                        for (Ilon = 0; Ilon < Nlon; ++Ilon) {
+                            index     = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
+                            index_sub = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
+                            Psi_seed.at(index_sub) = full_Psi.at(index);
+                            Phi_seed.at(index_sub) = full_Phi.at(index);
+                        }
+                    }
+                }
+                seed_type.at(stat_index) = 2;
+            } else if (not(single_seed)) {
                 #if DEBUG >= 2
                 fprintf( stdout, "Extracting seed.\n" );
                 fflush(stdout);
@@ -515,89 +1007,85 @@ void Apply_Helmholtz_Projection(
                         }
                     }
                 }
-            }
-
-            // Get velocity from seed
-            #if DEBUG >= 3
-            fprintf( stdout, "Getting velocities from seed.\n" );
-            fflush(stdout);
-            #endif
-            toroidal_vel_from_F(  u_lon_tor_seed, u_lat_tor_seed, Psi_seed, longitude, latitude, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
-            potential_vel_from_F( u_lon_pot_seed, u_lat_pot_seed, Phi_seed, longitude, latitude, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
-
-            #if DEBUG >= 3
-            fprintf( stdout, "Subtracting seed velocity to get remaining.\n" );
-            fflush(stdout);
-            #endif
-            #pragma omp parallel default(none) \
-            shared( dAreas, Itime, Idepth, RHS_vector, \
-                    u_lon, u_lon_tor_seed, u_lon_pot_seed, u_lon_rem, \
-                    u_lat, u_lat_tor_seed, u_lat_pot_seed, u_lat_rem ) \
-            private( Ilat, Ilon, index, index_sub ) \
-            firstprivate( Nlon, Nlat, Ndepth, Ntime )
-            {
-                #pragma omp for collapse(2) schedule(static)
-                for (Ilat = 0; Ilat < Nlat; ++Ilat) {
-                    for (Ilon = 0; Ilon < Nlon; ++Ilon) {
-                        index_sub = Index( 0,     0,      Ilat, Ilon, 1,     1,      Nlat, Nlon);
-                        index     = Index( Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
-
-                        u_lon_rem.at( index_sub ) = u_lon.at(index) - u_lon_tor_seed.at(index_sub) - u_lon_pot_seed.at(index_sub);
-                        u_lat_rem.at( index_sub ) = u_lat.at(index) - u_lat_tor_seed.at(index_sub) - u_lat_pot_seed.at(index_sub);
+            } else if ( extrapolate_seed and ( (Itime >= 2) or (Idepth >= 2) ) ) {
+                #if DEBUG >= 2
+                fprintf( stdout, "Extrapolating seed.\n" );
+                fflush(stdout);
+                #endif
+                // Linearly extrapolate from the two previous times (at this depth), 
+                //   or otherwise from the two previous depths (at this time)
+                const int   Itime_1  = (Itime >= 2) ? Itime - 1 : Itime,
+                            Itime_2  = (Itime >= 2) ? Itime - 2 : Itime,
+                            Idepth_1 = (Itime >= 2) ? Idepth    : Idepth - 1,
+                            Idepth_2 = (Itime >= 2) ? Idepth    : Idepth - 2;
+                size_t index_1, index_2;
+                #pragma omp parallel \
+                default(none) \
+                shared( Psi_seed, Phi_seed, full_Psi, full_Phi ) \
+                private( Ilat, Ilon, index_1, index_2, index_sub ) \
+                firstprivate( Nlon, Nlat, Ndepth, Ntime, Itime_1, Itime_2, Idepth_1, Idepth_2 )
+                {
+                    #pragma omp for collapse(2) schedule(static)
+                    for (Ilat = 0; Ilat < Nlat; ++Ilat) {
+                        for (Ilon = 0; Ilon < Nlon; ++Ilon) {
+                            index_1   = Index(Itime_1, Idepth_1, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
+                            index_2   = Index(Itime_2, Idepth_2, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
+                            index_sub = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
+                            Psi_seed.at(index_sub) = 2. * full_Psi.at(index_1) - full_Psi.at(index_2);
+                            Phi_seed.at(index_sub) = 2. * full_Phi.at(index_1) - full_Phi.at(index_2);
+                        }
                     }
                 }
+                seed_type.at(stat_index) = 1;
             }
-            #if DEBUG >= 3
-            fprintf( stdout, "Getting divergence and vorticity from remaining velocity.\n" );
-            fflush(stdout);
-            #endif
-            toroidal_vel_div(        div_term, u_lon_rem, u_lat_rem, longitude, latitude,       1, 1, Nlat, Nlon, use_mask ? mask : unmask );
-            toroidal_curl_u_dot_er( vort_term, u_lon_rem, u_lat_rem, longitude, latitude, 0, 0, 1, 1, Nlat, Nlon, use_mask ? mask : unmask );
-
-            #if DEBUG >= 2
-            if ( wRank == 0 ) {
-                fprintf(stdout, "Building the RHS of the least squares problem.\n");
-                fflush(stdout);
-            }
-            #endif
 
             //
-            //// Set up the RHS_vector
+            //// Correct the seed with a solve on the coarse grid
+            //      the velocity not yet accounted for by the seed is solved for
+            //      on the coarse grid, and the result is interpolated back.
             //
-            
-            double is_pole;
-            #pragma omp parallel default(none) \
-            shared( dAreas, latitude, Itime, Idepth, RHS_vector, div_term, vort_term, u_lon_rem, u_lat_rem, deriv_scale_factor ) \
-            private( Ilat, Ilon, index, index_sub, is_pole ) \
-            firstprivate( Nlon, Nlat, Ndepth, Ntime, Npts, Tikhov_Laplace, weight_err )
-            {
-                #pragma omp for collapse(2) schedule(static)
-                for (Ilat = 0; Ilat < Nlat; ++Ilat) {
-                    for (Ilon = 0; Ilon < Nlon; ++Ilon) {
-                        index_sub = Index( 0,     0,      Ilat, Ilon, 1,     1,      Nlat, Nlon);
-                        index     = Index( Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
-
-                        is_pole = std::fabs( std::fabs( latitude.at(Ilat) * 180.0 / M_PI ) - 90 ) < 0.01;
-
-                        RHS_vector.at( 0*Npts + index_sub) = u_lon_rem.at(index_sub);
-                        RHS_vector.at( 1*Npts + index_sub) = u_lat_rem.at(index_sub);
-
-                        if ( ( Ilat == 0 ) or ( is_pole ) ) {
-                            RHS_vector.at( 2*Npts + index_sub) = 0.;
-                            RHS_vector.at( 3*Npts + index_sub) = 0.;
-                        } else {
-                            RHS_vector.at( 2*Npts + index_sub) = vort_term.at(index_sub) * Tikhov_Laplace / deriv_scale_factor;
-                            RHS_vector.at( 3*Npts + index_sub) = div_term.at( index_sub) * Tikhov_Laplace / deriv_scale_factor;
-                        }
-
-                        if ( weight_err ) {
-                            RHS_vector.at( 0*Npts + index_sub) *= dAreas.at(index_sub);
-                            RHS_vector.at( 1*Npts + index_sub) *= dAreas.at(index_sub);
-                            RHS_vector.at( 2*Npts + index_sub) *= dAreas.at(index_sub);
-                            RHS_vector.at( 3*Npts + index_sub) *= dAreas.at(index_sub);
-                        }
+            if (do_coarse_seed) {
+                #if DEBUG >= 2
+                if ( wRank == 0 ) {
+                    fprintf(stdout, "Solving the coarse least squares problem.\n");
+                    fflush(stdout);
+                }
+                #endif
+                toroidal_vel_from_F(  u_lon_tor_seed, u_lat_tor_seed, Psi_seed, longitude, latitude, 1, 1, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
+                potential_vel_from_F( u_lon_pot_seed, u_lat_pot_seed, Phi_seed, longitude, latitude, 1, 1, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
+
+                // Track how much of the velocity is left, so that the coarse problem is only
+                //   converged as far as it would be for the full velocity
+                double coarse_rem_KE = 0., coarse_orig_KE = 0.;
+                for (Ilat = 0; Ilat < Nlat_coarse; ++Ilat) {
+                    for (Ilon = 0; Ilon < Nlon_coarse; ++Ilon) {
+                        index     = Index(0, 0, Ilat, Ilon, 1, 1, Nlat_coarse, Nlon_coarse);
+                        index_sub = Index(0, 0, coarse_lat_inds.at(Ilat), coarse_lon_inds.at(Ilon), 1, 1, Nlat, Nlon);
+                        u_lon_coarse.at(index) = u_lon_slice.at(index_sub) - u_lon_tor_seed.at(index_sub) - u_lon_pot_seed.at(index_sub);
+                        u_lat_coarse.at(index) = u_lat_slice.at(index_sub) - u_lat_tor_seed.at(index_sub) - u_lat_pot_seed.at(index_sub);
+
+                        coarse_rem_KE  += coarse_data.areas.at(index) * ( pow( u_lon_coarse.at(index), 2. ) + pow( u_lat_coarse.at(index), 2. ) );
+                        coarse_orig_KE += coarse_data.areas.at(index) * ( pow( u_lon_slice.at(index_sub), 2. ) + pow( u_lat_slice.at(index_sub), 2. ) );
                     }
                 }
+
+                Helmholtz_solve_slice( Psi_coarse, Phi_coarse, coarse_iters_used, coarse_termination_type, coarse_misfit,
+                        state_coarse, LHS_coarse, u_lon_coarse, u_lat_coarse, coarse_zero, coarse_zero,
+                        coarse_data, coarse_mask, &coarse_ops, weight_err, Tikhov_Laplace, deriv_scale_coarse, rel_tol, max_iters,
+                        ( coarse_rem_KE > 0 ) ? sqrt( coarse_orig_KE / coarse_rem_KE ) : 1. );
+                coarse_LSQR_iterations.at(stat_index) = coarse_iters_used;
+
+                // The values on the pole rows are not meaningful (only their latitude derivatives are), 
+                //   so drop them and let the interpolation extrapolate from the interior rows instead.
+                Psi_coarse.erase( Psi_coarse.begin() + (Ilat_coarse_end * Nlon_coarse), Psi_coarse.end() );
+                Psi_coarse.erase( Psi_coarse.begin(), Psi_coarse.begin() + (Ilat_coarse_start * Nlon_coarse) );
+                refine_field_cubic( work_arr, Psi_coarse, coarse_interp_lat, coarse_data.longitude, latitude, longitude );
+                for (index = 0; index < Npts; ++index) { Psi_seed.at(index) += work_arr.at(index); }
+
+                Phi_coarse.erase( Phi_coarse.begin() + (Ilat_coarse_end * Nlon_coarse), Phi_coarse.end() );
+                Phi_coarse.erase( Phi_coarse.begin(), Phi_coarse.begin() + (Ilat_coarse_start * Nlon_coarse) );
+                refine_field_cubic( work_arr, Phi_coarse, coarse_interp_lat, coarse_data.longitude, latitude, longitude );
+                for (index = 0; index < Npts; ++index) { Phi_seed.at(index) += work_arr.at(index); }
             }
 
             //
@@ -609,39 +1097,42 @@ void Apply_Helmholtz_Projection(
                 fflush(stdout);
             }
             #endif
-            alglib::linlsqrsolvesparse(state, LHS_matr, rhs);
-            alglib::linlsqrresults(state, F_alglib, report);
-
-            /*    Rep     -   optimization report:
-                * Rep.TerminationType completetion code:
-                    *  1    ||Rk||<=EpsB*||B||
-                    *  4    ||A^T*Rk||/(||A||*||Rk||)<=EpsA
-                    *  5    MaxIts steps was taken
-                    *  7    rounding errors prevent further progress,
-                            X contains best point found so far.
-                            (sometimes returned on singular systems)
-                    *  8    user requested termination via calling
-                            linlsqrrequesttermination()
-                * Rep.IterationsCount contains iterations count
-                * NMV countains number of matrix-vector calculations
-            */
+            Helmholtz_solve_slice( Psi_vector, Phi_vector, iters_used, termination_type, misfit,
+                    state, LHS_matr, u_lon_slice, u_lat_slice, Psi_seed, Phi_seed,
+                    source_data, use_mask ? mask : unmask, &proj_ops, weight_err, Tikhov_Laplace, deriv_scale_factor, rel_tol, max_iters, 1.,
+                    residual_check_interval, velocity_tolerance,
+                    &residual_history.at( stat_index ), &residual_history_iterations.at( stat_index ) );
 
             #if DEBUG >= 1
-            if      (report.terminationtype == 1) { fprintf(stdout, "Termination type: absolulte tolerance reached.\n"); }
-            else if (report.terminationtype == 4) { fprintf(stdout, "Termination type: relative tolerance reached.\n"); }
-            else if (report.terminationtype == 5) { fprintf(stdout, "Termination type: maximum number of iterations reached.\n"); }
-            else if (report.terminationtype == 7) { fprintf(stdout, "Termination type: round-off errors prevent further progress.\n"); }
-            else if (report.terminationtype == 8) { fprintf(stdout, "Termination type: user requested (?)\n"); }
-            else                                  { fprintf(stdout, "Termination type: unknown\n"); }
+            if      (termination_type == 1) { fprintf(stdout, "Termination type: absolulte tolerance reached.\n"); }
+            else if (termination_type == 4) { fprintf(stdout, "Termination type: relative tolerance reached.\n"); }
+            else if (termination_type == 5) { fprintf(stdout, "Termination type: maximum number of iterations reached.\n"); }
+            else if (termination_type == 7) { fprintf(stdout, "Termination type: round-off errors prevent further progress.\n"); }
+            else if (termination_type == 8) { fprintf(stdout, "Termination type: velocity tolerance reached.\n"); }
+            else                            { fprintf(stdout, "Termination type: unknown\n"); }
             #endif
-            if      (report.terminationtype == 1) { terminate_count_abs_tol++; }
-            else if (report.terminationtype == 4) { terminate_count_rel_tol++; }
-            else if (report.terminationtype == 5) { terminate_count_max_iter++; }
-            else if (report.terminationtype == 7) { terminate_count_rounding++; }
-            else if (report.terminationtype == 8) { terminate_count_other++; }
-            else                                  { terminate_count_other++; }
+            if      (termination_type == 1) { terminate_count_abs_tol++; }
+            else if (termination_type == 4) { terminate_count_rel_tol++; }
+            else if (termination_type == 5) { terminate_count_max_iter++; }
+            else if (termination_type == 7) { terminate_count_rounding++; }
+            else if (termination_type == 8) { terminate_count_vel_tol++; }
+            else                            { terminate_count_other++; }
 
-            iters_used = linlsqrpeekiterationscount( state );
+            #if DEBUG >= 2
+            fprintf(stdout, "  seed misfit %g (coarse: %g after %zu iterations)\n", misfit, coarse_misfit, coarse_iters_used);
+            #endif
+            seed_misfit.at(     stat_index ) = misfit;
+            LSQR_iterations.at( stat_index ) = iters_used;
+
+            // If requested, also solve from a zero seed to see how much the seed helped
+            if (measure_seed_savings) {
+                std::fill( work_arr.begin(), work_arr.end(), 0. );
+                std::vector<double> Psi_ref, Phi_ref;
+                Helmholtz_solve_slice( Psi_ref, Phi_ref, ref_iters_used, termination_type, misfit,
+                        state, LHS_matr, u_lon_slice, u_lat_slice, work_arr, work_arr,
+                        source_data, use_mask ? mask : unmask, &proj_ops, weight_err, Tikhov_Laplace, deriv_scale_factor, rel_tol, max_iters, 1. );
+                iterations_saved.at( stat_index ) = (double) ref_iters_used - (double) iters_used;
+            }
 
             #if DEBUG >= 2
             if ( wRank == 0 ) {
@@ -650,15 +1141,6 @@ void Apply_Helmholtz_Projection(
             }
             #endif
 
-            // Extract the solution and add the seed back in
-            F_array = F_alglib.getcontent();
-            std::vector<double> Psi_vector(F_array,        F_array +     Npts),
-                                Phi_vector(F_array + Npts, F_array + 2 * Npts);
-            for (size_t ii = 0; ii < Npts; ++ii) {
-                Psi_vector.at(ii) += Psi_seed.at(ii);
-                Phi_vector.at(ii) += Phi_seed.at(ii);
-            }
-
             // Get velocity associated to computed F field
             #if DEBUG >= 2
             if ( wRank == 0 ) {
@@ -668,8 +1150,8 @@ void Apply_Helmholtz_Projection(
             #endif
 
             std::vector<double> u_lon_tor(Npts, 0.), u_lat_tor(Npts, 0.), u_lon_pot(Npts, 0.), u_lat_pot(Npts, 0.);
-            toroidal_vel_from_F(  u_lon_tor, u_lat_tor, Psi_vector, longitude, latitude, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
-            potential_vel_from_F( u_lon_pot, u_lat_pot, Phi_vector, longitude, latitude, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
+            toroidal_vel_from_F(  u_lon_tor, u_lat_tor, Psi_vector, longitude, latitude, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
+            potential_vel_from_F( u_lon_pot, u_lat_pot, Phi_vector, longitude, latitude, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
 
             //
             //// Store into the full arrays
@@ -732,16 +1214,28 @@ void Apply_Helmholtz_Projection(
         #endif
     }
 
+    // Wall time spent on the solves (including recovering the velocities), to compare the solvers
+    const double local_solve_time = MPI_Wtime() - solve_start_time;
+    double solve_time;
+    MPI_Reduce( &local_solve_time, &solve_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD );
+
+    #if DEBUG >= 0
+    if (wRank == 0) {
+        fprintf( stdout, "\nSolve time (%s): %g seconds\n", do_SHT ? "spherical harmonics + least squares" : "least squares", solve_time );
+    }
+    #endif
+
     //
     //// Print termination counts
     //
 
-    int total_count_abs_tol, total_count_rel_tol, total_count_max_iter, total_count_rounding, total_count_other;
+    int total_count_abs_tol, total_count_rel_tol, total_count_max_iter, total_count_rounding, total_count_vel_tol, total_count_other;
 
     MPI_Reduce( &terminate_count_abs_tol,  &total_count_abs_tol,  1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
     MPI_Reduce( &terminate_count_rel_tol,  &total_count_rel_tol,  1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
     MPI_Reduce( &terminate_count_max_iter, &total_count_max_iter, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
     MPI_Reduce( &terminate_count_rounding, &total_count_rounding, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
+    MPI_Reduce( &terminate_count_vel_tol,  &total_count_vel_tol,  1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
     MPI_Reduce( &terminate_count_other,    &total_count_other,    1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
 
     #if DEBUG >= 0
@@ -751,6 +1245,7 @@ void Apply_Helmholtz_Projection(
         fprintf( stdout, "                    %'d from relative tolerance\n", total_count_rel_tol );
         fprintf( stdout, "                    %'d from iteration maximum\n", total_count_max_iter );
         fprintf( stdout, "                    %'d from rounding errors \n", total_count_rounding );
+        fprintf( stdout, "                    %'d from velocity tolerance \n", total_count_vel_tol );
         fprintf( stdout, "                    %'d from other causes \n", total_count_other );
         fprintf( stdout, "\n" );
     }
@@ -799,6 +1294,13 @@ void Apply_Helmholtz_Projection(
     add_attr_to_file("use_mask",        (double) use_mask,              output_fname.c_str());
     add_attr_to_file("weight_err",      (double) weight_err,            output_fname.c_str());
     add_attr_to_file("Tikhov_Laplace",  Tikhov_Laplace,                 output_fname.c_str());
+    add_attr_to_file("coarse_seed_factor", (double) (do_coarse_seed ? coarse_seed_factor : 1), output_fname.c_str());
+    add_attr_to_file("extrapolate_seed",   (double) extrapolate_seed,   output_fname.c_str());
+    add_attr_to_file("use_SHT",            (double) do_SHT,             output_fname.c_str());
+    add_attr_to_file("SHT_sweeps",         (double) SHT_sweeps,         output_fname.c_str());
+    add_attr_to_file("solve_time",         solve_time,                  output_fname.c_str());
+    add_attr_to_file("velocity_tolerance", velocity_tolerance,          output_fname.c_str());
+    add_attr_to_file("residual_check_interval", (double) residual_check_interval, output_fname.c_str());
 
 
     //
@@ -923,4 +1425,92 @@ void Apply_Helmholtz_Projection(
     write_field_to_output( toroidal_KE,   "toroidal_KE",   starts_error, counts_error, output_fname.c_str() );
     write_field_to_output( potential_KE,  "potential_KE",  starts_error, counts_error, output_fname.c_str() );
 
+
+    //
+    //// Seeding statistics
+    //
+
+    double local_iters = 0., local_coarse_iters = 0., local_saved = 0., total_iters, total_coarse_iters, total_saved;
+    for (size_t II = 0; II < LSQR_iterations.size(); ++II) {
+        local_iters         += LSQR_iterations.at(II);
+        local_coarse_iters  += coarse_LSQR_iterations.at(II);
+        local_saved         += iterations_saved.at(II);
+    }
+    MPI_Reduce( &local_iters,        &total_iters,        1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
+    MPI_Reduce( &local_coarse_iters, &total_coarse_iters, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
+    MPI_Reduce( &local_saved,        &total_saved,        1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
+
+    #if DEBUG >= 0
+    if (wRank == 0) {
+        fprintf( stdout, "Seeding: %'.0f LSQR iterations on the full grid", total_iters );
+        if (do_coarse_seed) { fprintf( stdout, ", %'.0f on the coarse grid", total_coarse_iters ); }
+        if (measure_seed_savings) { fprintf( stdout, ", %'.0f saved by seeding", total_saved ); }
+        fprintf( stdout, "\n\n" );
+    }
+    #endif
+
+    add_attr_to_file("total_LSQR_iterations",        total_iters,        output_fname.c_str());
+    add_attr_to_file("total_coarse_LSQR_iterations", total_coarse_iters, output_fname.c_str());
+    if (measure_seed_savings) {
+        add_attr_to_file("total_iterations_saved",   total_saved,        output_fname.c_str());
+    }
+
+    if (wRank == 0) {
+        add_var_to_file( "seed_type",              dim_names, ndims_error, output_fname.c_str() );
+        add_var_to_file( "seed_misfit",            dim_names, ndims_error, output_fname.c_str() );
+        add_var_to_file( "LSQR_iterations",        dim_names, ndims_error, output_fname.c_str() );
+        add_var_to_file( "coarse_LSQR_iterations", dim_names, ndims_error, output_fname.c_str() );
+        if (measure_seed_savings) {
+            add_var_to_file( "iterations_saved",   dim_names, ndims_error, output_fname.c_str() );
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    write_field_to_output( seed_type,              "seed_type",              starts_error, counts_error, output_fname.c_str() );
+    write_field_to_output( seed_misfit,            "seed_misfit",            starts_error, counts_error, output_fname.c_str() );
+    write_field_to_output( LSQR_iterations,        "LSQR_iterations",        starts_error, counts_error, output_fname.c_str() );
+    write_field_to_output( coarse_LSQR_iterations, "coarse_LSQR_iterations", starts_error, counts_error, output_fname.c_str() );
+    if (measure_seed_savings) {
+        write_field_to_output( iterations_saved,   "iterations_saved",       starts_error, counts_error, output_fname.c_str() );
+    }
+
+
+    //
+    //// Velocity error histories
+    //
+
+    // The number of checks varies between times / depths (and processors), so pad them
+    //   out to the longest one with fill values
+    int local_num_checks = 0, num_checks = 0;
+    for (size_t II = 0; II < residual_history.size(); ++II) {
+        local_num_checks = std::max( local_num_checks, (int) residual_history.at(II).size() );
+    }
+    MPI_Allreduce( &local_num_checks, &num_checks, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD );
+
+    if ( num_checks > 0 ) {
+        std::vector<double> residual_history_out(            Ntime * Ndepth * num_checks, constants::fill_value ),
+                            residual_history_iterations_out( Ntime * Ndepth * num_checks, constants::fill_value );
+        for (size_t II = 0; II < residual_history.size(); ++II) {
+            std::copy( residual_history.at(II).begin(),            residual_history.at(II).end(),
+                       residual_history_out.begin()            + II * num_checks );
+            std::copy( residual_history_iterations.at(II).begin(), residual_history_iterations.at(II).end(),
+                       residual_history_iterations_out.begin() + II * num_checks );
+        }
+
+        const char* dim_names_hist[] = {"time", "depth", "residual_check"};
+        const int ndims_hist = 3;
+        if (wRank == 0) {
+            add_dim_to_file( "residual_check", num_checks, output_fname.c_str() );
+            add_var_to_file( "residual_history",            dim_names_hist, ndims_hist, output_fname.c_str() );
+            add_var_to_file( "residual_history_iterations", dim_names_hist, ndims_hist, output_fname.c_str() );
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        size_t starts_hist[ndims_hist] = { size_t(myStarts.at(0)), size_t(myStarts.at(1)), 0 };
+        size_t counts_hist[ndims_hist] = { size_t(Ntime), size_t(Ndepth), size_t(num_checks) };
+
+        write_field_to_output( residual_history_out,            "residual_history",            starts_hist, counts_hist, output_fname.c_str() );
+        write_field_to_output( residual_history_iterations_out, "residual_history_iterations", starts_hist, counts_hist, output_fname.c_str() );
+    }
+
 }
@@ -21,6 +21,7 @@ void Apply_Potential_Projection(
         const int max_iters,
         const bool weight_err,
         const bool use_mask,
+        const bool use_direct_solve,
         const MPI_Comm comm
         ) {
 
@@ -131,23 +132,50 @@ void Apply_Potential_Projection(
     //
     //// Build the LHS part of the problem (Lap)
     //
-    if (wRank == 0) {
-        fprintf(stdout, "Building the LHS of the least squares problem.\n");
+
+    // If possible (no land, periodic uniform longitude), invert the Laplacian directly
+    //   with an FFT in longitude and banded solves in latitude, instead of iterating.
+    direct_Lap_solver direct_solver;
+    if (use_direct_solve) { direct_solver.build( source_data, use_mask ? mask : unmask ); }
+    const bool do_direct_solve = use_direct_solve and direct_solver.usable;
+    if ( use_direct_solve and (wRank == 0) ) {
+        if (do_direct_solve) {
+            fprintf(stdout, "Using the direct (FFT + banded) Laplacian solver.\n");
+        } else {
+            fprintf(stdout, "Direct Laplacian solver not applicable to this grid / mask, falling back to least-squares solver.\n");
+        }
         fflush(stdout);
     }
 
+    // Derivative operators for the projection mask, shared by the Laplacian matrix and the velocity extraction
+    spherical_derivative_operators proj_ops;
+    proj_ops.build( longitude, latitude, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask );
+
+    // The least-squares problem is only set up if it is needed, i.e. if the direct
+    //   solver is not used, or if it fails on some slice.
     alglib::sparsematrix Lap;
-    alglib::sparsecreate(Npts, Npts, Lap);
+    bool least_squares_ready = false;
+    auto setup_least_squares = [&]() {
+        if (wRank == 0) {
+            fprintf(stdout, "Building the LHS of the least squares problem.\n");
+            fflush(stdout);
+        }
 
-    toroidal_sparse_Lap(Lap, source_data, Itime, Idepth, use_mask ? mask : unmask, weight_err);
-    alglib::sparseconverttocrs(Lap);
+        alglib::sparsecreate(Npts, Npts, Lap);
 
-    if (wRank == 0) {
-        fprintf(stdout, "Declaring the least squares problem.\n");
-        fflush(stdout);
-    }
-    alglib::linlsqrcreate(Npts, Npts, state);
-    alglib::linlsqrsetcond(state, rel_tol, rel_tol, max_iters);
+        toroidal_sparse_Lap(Lap, source_data, Itime, Idepth, use_mask ? mask : unmask, weight_err, 0, 0, &proj_ops);
+        alglib::sparseconverttocrs(Lap);
+
+        if (wRank == 0) {
+            fprintf(stdout, "Declaring the least squares problem.\n");
+            fflush(stdout);
+        }
+        alglib::linlsqrcreate(Npts, Npts, state);
+        alglib::linlsqrsetcond(state, rel_tol, rel_tol, max_iters);
+
+        least_squares_ready = true;
+    };
+    if (not(do_direct_solve)) { setup_least_squares(); }
 
     // Now do the solve!
     for (int Itime = 0; Itime < Ntime; ++Itime) {
@@ -193,13 +221,13 @@ void Apply_Potential_Projection(
             //   problem Ax' = b - Ax0
             //
             toroidal_Lap_F(F_seed_Lap, F_seed, longitude, latitude,
-                    Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
+                    Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
 
             #pragma omp parallel \
             default(none) \
             shared( div_term, full_div_orig, F_seed_Lap, dAreas, Itime, Idepth ) \
             private( Ilat, Ilon, index_sub, index ) \
-            firstprivate( Nlon, Nlat, Ndepth, Ntime, weight_err )
+            firstprivate( Nlon, Nlat, Ndepth, Ntime, weight_err, do_direct_solve )
             {
                 #pragma omp for collapse(2) schedule(static)
                 for (Ilat = 0; Ilat < Nlat; ++Ilat) {
@@ -210,7 +238,8 @@ void Apply_Potential_Projection(
                                           1, 1, Nlat, Nlon);
                         div_term.at(index_sub) = full_div_orig.at(index) - F_seed_Lap.at(index_sub);
 
-                        if (weight_err) { div_term.at(index_sub) *= dAreas.at(index_sub); }
+                        // (the direct solve is exact, so weighting has no effect)
+                        if ( weight_err and not(do_direct_solve) ) { div_term.at(index_sub) *= dAreas.at(index_sub); }
                     }
                 }
             }
@@ -222,35 +251,58 @@ void Apply_Potential_Projection(
                 fprintf(stdout, "Solving the least squares problem.\n");
                 fflush(stdout);
             }
-            alglib::linlsqrsolvesparse(state, Lap, rhs);
-            alglib::linlsqrresults(state, F_alglib, report);
-
-            #if DEBUG >= 1
-            if      (report.terminationtype == 1) { fprintf(stdout, "Termination type: absolulte tolerance reached.\n"); }
-            else if (report.terminationtype == 4) { fprintf(stdout, "Termination type: relative tolerance reached.\n"); }
-            else if (report.terminationtype == 5) { fprintf(stdout, "Termination type: maximum number of iterations reached.\n"); }
-            else if (report.terminationtype == 7) { fprintf(stdout, "Termination type: round-off errors prevent further progress.\n"); }
-            else if (report.terminationtype == 8) { fprintf(stdout, "Termination type: user requested (?)\n"); }
-            else                                  { fprintf(stdout, "Termination type: unknown\n"); }
-            #endif
+            std::vector<double> F_vector(Npts, 0.);
+            bool solved_directly = false;
+            if (do_direct_solve) {
+                solved_directly = direct_solver.solve( F_vector, div_term );
+                if (not(solved_directly)) {
+                    fprintf(stdout, "Direct Laplacian solve failed on rank %d (time %d, depth %d), falling back to least-squares solver.\n",
+                            wRank, Itime, Idepth);
+                    fflush(stdout);
+                    F_vector.assign(Npts, 0.);
+                    if (not(least_squares_ready)) { setup_least_squares(); }
+
+                    // The RHS was not area-weighted for the direct solve, so do that now
+                    if (weight_err) {
+                        for (size_t ii = 0; ii < div_term.size(); ++ii) {
+                            div_term.at(ii) *= dAreas.at(ii);
+                        }
+                    }
+                }
+            }
+            if (not(solved_directly)) {
+                alglib::linlsqrsolvesparse(state, Lap, rhs);
+                alglib::linlsqrresults(state, F_alglib, report);
+
+                #if DEBUG >= 1
+                if      (report.terminationtype == 1) { fprintf(stdout, "Termination type: absolulte tolerance reached.\n"); }
+                else if (report.terminationtype == 4) { fprintf(stdout, "Termination type: relative tolerance reached.\n"); }
+                else if (report.terminationtype == 5) { fprintf(stdout, "Termination type: maximum number of iterations reached.\n"); }
+                else if (report.terminationtype == 7) { fprintf(stdout, "Termination type: round-off errors prevent further progress.\n"); }
+                else if (report.terminationtype == 8) { fprintf(stdout, "Termination type: user requested (?)\n"); }
+                else                                  { fprintf(stdout, "Termination type: unknown\n"); }
+                #endif
+
+                /*    Rep     -   optimization report:
+                    * Rep.TerminationType completetion code:
+                        *  1    ||Rk||<=EpsB*||B||
+                        *  4    ||A^T*Rk||/(||A||*||Rk||)<=EpsA
+                        *  5    MaxIts steps was taken
+                        *  7    rounding errors prevent further progress,
+                                X contains best point found so far.
+                                (sometimes returned on singular systems)
+                        *  8    user requested termination via calling
+                                linlsqrrequesttermination()
+                    * Rep.IterationsCount contains iterations count
+                    * NMV countains number of matrix-vector calculations
+                */
+
+                // Extract the solution
+                F_array = F_alglib.getcontent();
+                F_vector.assign(F_array, F_array + Npts);
+            }
 
-            /*    Rep     -   optimization report:
-                * Rep.TerminationType completetion code:
-                    *  1    ||Rk||<=EpsB*||B||
-                    *  4    ||A^T*Rk||/(||A||*||Rk||)<=EpsA
-                    *  5    MaxIts steps was taken
-                    *  7    rounding errors prevent further progress,
-                            X contains best point found so far.
-                            (sometimes returned on singular systems)
-                    *  8    user requested termination via calling
-                            linlsqrrequesttermination()
-                * Rep.IterationsCount contains iterations count
-                * NMV countains number of matrix-vector calculations
-            */
-
-            // Extract the solution and add the seed back in
-            F_array = F_alglib.getcontent();
-            std::vector<double> F_vector(F_array, F_array + Npts);
+            // Add the seed back in
             for (size_t ii = 0; ii < F_vector.size(); ++ii) {
                 F_vector.at(ii) += F_seed.at(ii);
             }
@@ -259,7 +311,7 @@ void Apply_Potential_Projection(
             std::vector<double> 
                 u_lon_pot(Npts, 0.), u_lat_pot(Npts, 0.), div_pot(Npts, 0.);
             potential_vel_from_F(u_lon_pot, u_lat_pot, F_vector, longitude, latitude,
-                                Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
+                                Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
             toroidal_vel_div(div_pot, u_lon_pot, u_lat_pot, longitude, latitude,
                                 Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
 
@@ -370,5 +422,6 @@ void Apply_Potential_Projection(
     add_attr_to_file("diff_order", (double) constants::DiffOrd, output_fname.c_str());
     add_attr_to_file("use_mask",   (double) use_mask,           output_fname.c_str());
     add_attr_to_file("weight_err", (double) weight_err,         output_fname.c_str());
+    add_attr_to_file("direct_solve", (double) do_direct_solve,  output_fname.c_str());
 
 }
@@ -21,6 +21,7 @@ void Apply_Toroidal_Projection(
         const int max_iters,
         const bool weight_err,
         const bool use_mask,
+        const bool use_direct_solve,
         const MPI_Comm comm
         ) {
 
@@ -141,27 +142,54 @@ void Apply_Toroidal_Projection(
     //
     //// Build the LHS part of the problem (Lap)
     //
-    #if DEBUG >= 1
-    if (wRank == 0) {
-        fprintf(stdout, "Building the LHS of the least squares problem.\n");
+
+    // If possible (no land, periodic uniform longitude), invert the Laplacian directly
+    //   with an FFT in longitude and banded solves in latitude, instead of iterating.
+    direct_Lap_solver direct_solver;
+    if (use_direct_solve) { direct_solver.build( source_data, use_mask ? mask : unmask ); }
+    const bool do_direct_solve = use_direct_solve and direct_solver.usable;
+    if ( use_direct_solve and (wRank == 0) ) {
+        if (do_direct_solve) {
+            fprintf(stdout, "Using the direct (FFT + banded) Laplacian solver.\n");
+        } else {
+            fprintf(stdout, "Direct Laplacian solver not applicable to this grid / mask, falling back to least-squares solver.\n");
+        }
         fflush(stdout);
     }
-    #endif
 
+    // Derivative operators for the projection mask, shared by the Laplacian matrix and the velocity extraction
+    spherical_derivative_operators proj_ops;
+    proj_ops.build( longitude, latitude, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask );
+
+    // The least-squares problem is only set up if it is needed, i.e. if the direct
+    //   solver is not used, or if it fails on some slice.
     alglib::sparsematrix Lap;
-    alglib::sparsecreate(Npts, Npts, Lap);
+    bool least_squares_ready = false;
+    auto setup_least_squares = [&]() {
+        #if DEBUG >= 1
+        if (wRank == 0) {
+            fprintf(stdout, "Building the LHS of the least squares problem.\n");
+            fflush(stdout);
+        }
+        #endif
 
-    toroidal_sparse_Lap(Lap, source_data, Itime, Idepth, use_mask ? mask : unmask, weight_err);
-    alglib::sparseconverttocrs(Lap);
+        alglib::sparsecreate(Npts, Npts, Lap);
 
-    #if DEBUG >= 1
-    if (wRank == 0) {
-        fprintf(stdout, "Declaring the least squares problem.\n");
-        fflush(stdout);
-    }
-    #endif
-    alglib::linlsqrcreate(Npts, Npts, state);
-    alglib::linlsqrsetcond(state, rel_tol, rel_tol, max_iters);
+        toroidal_sparse_Lap(Lap, source_data, Itime, Idepth, use_mask ? mask : unmask, weight_err, 0, 0, &proj_ops);
+        alglib::sparseconverttocrs(Lap);
+
+        #if DEBUG >= 1
+        if (wRank == 0) {
+            fprintf(stdout, "Declaring the least squares problem.\n");
+            fflush(stdout);
+        }
+        #endif
+        alglib::linlsqrcreate(Npts, Npts, state);
+        alglib::linlsqrsetcond(state, rel_tol, rel_tol, max_iters);
+
+        least_squares_ready = true;
+    };
+    if (not(do_direct_solve)) { setup_least_squares(); }
 
     // Now do the solve!
     for (int Itime = 0; Itime < Ntime; ++Itime) {
@@ -209,31 +237,11 @@ void Apply_Toroidal_Projection(
             //   problem Ax' = b - Ax0
             //
             toroidal_Lap_F(F_seed_Lap, F_seed, longitude, latitude,
-                    Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
+                    Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
 
             toroidal_curl_u_dot_er(curl_term, u_lon, u_lat, longitude, latitude, 
                     Itime, Idepth, Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, &F_seed_Lap);
 
-            if (weight_err) {
-                // Weight by area if requested
-                #pragma omp parallel \
-                default(none) \
-                shared( curl_term, dAreas ) \
-                private( Ilat, Ilon, index_sub ) \
-                firstprivate( Nlon, Nlat )
-                {
-                    #pragma omp for collapse(2) schedule(static)
-                    for (Ilat = 0; Ilat < Nlat; ++Ilat) {
-                        for (Ilon = 0; Ilon < Nlon; ++Ilon) {
-                            index_sub = Index(0, 0, Ilat, Ilon,
-                                              1, 1, Nlat, Nlon);
-
-                            curl_term.at(index_sub) *= dAreas.at(index_sub);
-                        }
-                    }
-                }
-            }
-
             //
             //// Now apply the least-squares solver
             //
@@ -243,42 +251,78 @@ void Apply_Toroidal_Projection(
                 fflush(stdout);
             }
             #endif
-            alglib::linlsqrsolvesparse(state, Lap, rhs);
-            alglib::linlsqrresults(state, F_alglib, report);
-
-            #if DEBUG >= 1
-            if      (report.terminationtype == 1) { fprintf(stdout, "Termination type: absolulte tolerance reached.\n"); }
-            else if (report.terminationtype == 4) { fprintf(stdout, "Termination type: relative tolerance reached.\n"); }
-            else if (report.terminationtype == 5) { fprintf(stdout, "Termination type: maximum number of iterations reached.\n"); }
-            else if (report.terminationtype == 7) { fprintf(stdout, "Termination type: round-off errors prevent further progress.\n"); }
-            else if (report.terminationtype == 8) { fprintf(stdout, "Termination type: user requested (?)\n"); }
-            else                                  { fprintf(stdout, "Termination type: unknown\n"); }
-            #endif
+            std::vector<double> F_vector(Npts, 0.);
+            bool solved_directly = false;
+            if (do_direct_solve) {
+                solved_directly = direct_solver.solve( F_vector, curl_term );
+                if (not(solved_directly)) {
+                    fprintf(stdout, "Direct Laplacian solve failed on rank %d (time %d, depth %d), falling back to least-squares solver.\n",
+                            wRank, Itime, Idepth);
+                    fflush(stdout);
+                    F_vector.assign(Npts, 0.);
+                    if (not(least_squares_ready)) { setup_least_squares(); }
+                }
+            }
+            if (not(solved_directly)) {
+                if (weight_err) {
+                    // Weight by area if requested (the direct solve is exact, so weighting has no effect there)
+                    #pragma omp parallel \
+                    default(none) \
+                    shared( curl_term, dAreas ) \
+                    private( Ilat, Ilon, index_sub ) \
+                    firstprivate( Nlon, Nlat )
+                    {
+                        #pragma omp for collapse(2) schedule(static)
+                        for (Ilat = 0; Ilat < Nlat; ++Ilat) {
+                            for (Ilon = 0; Ilon < Nlon; ++Ilon) {
+                                index_sub = Index(0, 0, Ilat, Ilon,
+                                                  1, 1, Nlat, Nlon);
+
+                                curl_term.at(index_sub) *= dAreas.at(index_sub);
+                            }
+                        }
+                    }
+                }
 
-            /*    Rep     -   optimization report:
-                * Rep.TerminationType completetion code:
-                    *  1    ||Rk||<=EpsB*||B||
-                    *  4    ||A^T*Rk||/(||A||*||Rk||)<=EpsA
-                    *  5    MaxIts steps was taken
-                    *  7    rounding errors prevent further progress,
-                            X contains best point found so far.
-                            (sometimes returned on singular systems)
-                    *  8    user requested termination via calling
-                            linlsqrrequesttermination()
-                * Rep.IterationsCount contains iterations count
-                * NMV countains number of matrix-vector calculations
-            */
+                alglib::linlsqrsolvesparse(state, Lap, rhs);
+                alglib::linlsqrresults(state, F_alglib, report);
+
+                #if DEBUG >= 1
+                if      (report.terminationtype == 1) { fprintf(stdout, "Termination type: absolulte tolerance reached.\n"); }
+                else if (report.terminationtype == 4) { fprintf(stdout, "Termination type: relative tolerance reached.\n"); }
+                else if (report.terminationtype == 5) { fprintf(stdout, "Termination type: maximum number of iterations reached.\n"); }
+                else if (report.terminationtype == 7) { fprintf(stdout, "Termination type: round-off errors prevent further progress.\n"); }
+                else if (report.terminationtype == 8) { fprintf(stdout, "Termination type: user requested (?)\n"); }
+                else                                  { fprintf(stdout, "Termination type: unknown\n"); }
+                #endif
+
+                /*    Rep     -   optimization report:
+                    * Rep.TerminationType completetion code:
+                        *  1    ||Rk||<=EpsB*||B||
+                        *  4    ||A^T*Rk||/(||A||*||Rk||)<=EpsA
+                        *  5    MaxIts steps was taken
+                        *  7    rounding errors prevent further progress,
+                                X contains best point found so far.
+                                (sometimes returned on singular systems)
+                        *  8    user requested termination via calling
+                                linlsqrrequesttermination()
+                    * Rep.IterationsCount contains iterations count
+                    * NMV countains number of matrix-vector calculations
+                */
+
+                #if DEBUG >= 1
+                if ( (wRank == 0) and (Itime == 0) ) {
+                    fprintf(stdout, " Done solving the least squares problem.\n");
+                    fflush(stdout);
+                }
+                #endif
 
-            #if DEBUG >= 1
-            if ( (wRank == 0) and (Itime == 0) ) {
-                fprintf(stdout, " Done solving the least squares problem.\n");
-                fflush(stdout);
+                // Extract the solution
+                F_array = F_alglib.getcontent();
+                F_vector.assign(F_array, F_array + Npts);
             }
-            #endif
 
-            // Extract the solution and add the seed back in
-            F_array = F_alglib.getcontent();
-            std::vector<double> F_vector(F_array, F_array + Npts);
+            // Add the seed back in
             for (size_t ii = 0; ii < F_vector.size(); ++ii) {
                 F_vector.at(ii) += F_seed.at(ii);
             }
@@ -294,7 +338,7 @@ void Apply_Toroidal_Projection(
             std::vector<double> 
                 u_lon_tor(Npts, 0.), u_lat_tor(Npts, 0.), div_tor(Npts, 0.);
             toroidal_vel_from_F(u_lon_tor, u_lat_tor, F_vector, longitude, latitude,
-                                Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
+                                Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
             toroidal_vel_div(div_tor, u_lon_tor, u_lat_tor, longitude, latitude,
                                 Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
 
@@ -308,7 +352,7 @@ void Apply_Toroidal_Projection(
 
             std::vector<double> u_lon_seed(Npts, 0.), u_lat_seed(Npts, 0.);
             toroidal_vel_from_F(u_lon_seed, u_lat_seed, F_seed, longitude, latitude,
-                                Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
+                                Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
 
             // Get Lap of computed F term
             #if DEBUG >= 1
@@ -319,7 +363,7 @@ void Apply_Toroidal_Projection(
             #endif
 
             toroidal_Lap_F(Lap_F_tor, F_vector, longitude, latitude,
-                    Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask);
+                    Ntime, Ndepth, Nlat, Nlon, use_mask ? mask : unmask, &proj_ops);
 
             //
             //// Store into the full arrays
@@ -447,5 +491,6 @@ void Apply_Toroidal_Projection(
     add_attr_to_file("diff_order", (double) constants::DiffOrd, output_fname.c_str());
     add_attr_to_file("use_mask",   (double) use_mask,           output_fname.c_str());
     add_attr_to_file("weight_err", (double) weight_err,         output_fname.c_str());
+    add_attr_to_file("direct_solve", (double) do_direct_solve,  output_fname.c_str());
 
 }
@@ -0,0 +1,376 @@
+#include "../constants.hpp"
+#include "../functions.hpp"
+#include "../differentiation_tools.hpp"
+#include "../preprocess.hpp"
+#include <algorithm>
+#include <vector>
+#include <complex>
+#include <omp.h>
+#include <math.h>
+#include "../ALGLIB/stdafx.h"
+#include "../ALGLIB/fasttransforms.h"
+
+// This file provides the implementation details for the direct_Lap_solver class
+
+// Class constructor
+direct_Lap_solver::direct_Lap_solver() {
+}
+
+/*!
+ * \brief Check if the direct (FFT + banded) Laplacian solve can be applied.
+ * @ingroup ToroidalProjection
+ *
+ * The longitude part of the Laplacian is only circulant if the grid is spherical,
+ * periodic and uniform in longitude, spans the full longitude domain, and has no
+ * land cells to break up the stencils.
+ *
+ * @param[in]   source_data     dataset class instance containing the grid
+ * @param[in]   mask            mask that would be used to build the Laplacian
+ *
+ * @returns     true if the direct solve reproduces toroidal_sparse_Lap exactly
+ */
+bool direct_Lap_solver_applicable(
+        const dataset & source_data,
+        const std::vector<bool> & mask
+        ) {
+
+    if (    constants::CARTESIAN
+         or not( constants::PERIODIC_X )
+         or      constants::PERIODIC_Y
+         or not( constants::UNIFORM_LON_GRID )
+         or not( constants::FULL_LON_SPAN )
+       ) { return false; }
+
+    if ( ( source_data.Nlat < 3 ) or ( source_data.Nlon < 3 ) ) { return false; }
+
+    // Any land at all means that the longitude stencils vary from point to point
+    return std::all_of( mask.begin(), mask.end(), [](bool v) { return v; } );
+}
+
+
+/*!
+ * \brief Build the banded latitude operator and the longitude symbols.
+ *
+ * The coefficients are pulled from get_diff_vector, exactly as in toroidal_sparse_Lap,
+ * so that the direct solve inverts the same discrete operator that the iterative
+ * solver works with.
+ *
+ * @param[in]   source_data     dataset class instance containing the grid
+ * @param[in]   mask            mask used to build the Laplacian (must be all water)
+ */
+void direct_Lap_solver::build(
+        const dataset & source_data,
+        const std::vector<bool> & mask
+        ) {
+
+    const std::vector<double>   &latitude   = source_data.latitude,
+                                &longitude  = source_data.longitude;
+
+    const std::vector<int>  &myCounts = source_data.myCounts;
+
+    const int   Ntime   = myCounts.at(0),
+                Ndepth  = myCounts.at(1);
+    const int   Itime   = 0,
+                Idepth  = 0;
+
+    Nlat = myCounts.at(2);
+    Nlon = myCounts.at(3);
+    Nfreq = Nlon / 2 + 1;
+    lower_band = 0;
+    upper_band = 0;
+
+    usable = direct_Lap_solver_applicable( source_data, mask );
+    if (not(usable)) { return; }
+
+    const double R2_inv = 1. / pow(constants::R_earth, 2);
+
+    int Ilat, IDIFF, Ik, LB;
+    std::vector<double> diff_vec;
+
+    //
+    //// Longitude part: on a periodic uniform grid the stencil is the same everywhere,
+    ////    so just pull it from the first non-pole point and convert it to
+    ////    a symbol for each zonal wavenumber
+    //
+    Ilat = Nlat / 2;
+    LB = - 2 * Nlon;
+    get_diff_vector(diff_vec, LB, longitude, "lon",
+                    Itime, Idepth, Ilat, 0,
+                    Ntime, Ndepth, Nlat, Nlon,
+                    mask, 2, constants::DiffOrd);
+    if (LB == - 2 * Nlon) { usable = false; return; }
+
+    // With the forward convention F[k] = sum_n f[n] exp(-2 pi i n k / N), a stencil
+    //   that reads f[n + offset] becomes multiplication by exp(+2 pi i k offset / N)
+    lon_symbol.resize( Nfreq );
+    for ( Ik = 0; Ik < Nfreq; Ik++ ) {
+        std::complex<double> symb = 0.;
+        for ( IDIFF = 0; IDIFF < (int) diff_vec.size(); IDIFF++ ) {
+            symb += diff_vec.at(IDIFF) * std::polar( 1., 2. * M_PI * Ik * (LB + IDIFF) / Nlon );
+        }
+        lon_symbol.at(Ik) = symb;
+    }
+
+    //
+    //// Latitude part: collect the (first + second derivative) stencils row by row
+    //
+    std::vector< std::vector<double> > row_vals( Nlat );
+    std::vector< int > row_start( Nlat, 0 );
+    lon_scale.resize( Nlat );
+    bool is_pole, has_pole = false;
+
+    for ( Ilat = 0; Ilat < Nlat; Ilat++ ) {
+
+        // If we're too close to the pole (less than 0.01 degrees), bad things happen
+        is_pole = std::fabs( std::fabs( latitude.at(Ilat) * 180.0 / M_PI ) - 90 ) < 0.01;
+
+        row_start.at(Ilat) = Ilat;
+        if ( is_pole ) {
+            // Pole rows are identity rows, as in toroidal_sparse_Lap
+            has_pole = true;
+            row_vals.at(Ilat).assign( 1, 1. );
+            lon_scale.at(Ilat) = 0.;
+            continue;
+        }
+
+        lon_scale.at(Ilat) = R2_inv / pow( cos(latitude.at(Ilat)), 2 );
+        const double tan_lat = tan(latitude.at(Ilat));
+
+        std::vector<double> d2_vec, d1_vec;
+        int LB2 = - 2 * Nlat, LB1 = - 2 * Nlat;
+        get_diff_vector(d2_vec, LB2, latitude, "lat",
+                        Itime, Idepth, Ilat, 0,
+                        Ntime, Ndepth, Nlat, Nlon,
+                        mask, 2, constants::DiffOrd);
+        get_diff_vector(d1_vec, LB1, latitude, "lat",
+                        Itime, Idepth, Ilat, 0,
+                        Ntime, Ndepth, Nlat, Nlon,
+                        mask, 1, constants::DiffOrd);
+
+        // If LB is unchanged, then we failed to build a stencil (and toroidal_sparse_Lap skips it)
+        const bool has_d2 = (LB2 != - 2 * Nlat),
+                   has_d1 = (LB1 != - 2 * Nlat);
+
+        // The diagonal is always part of the row, since it carries the longitude part
+        int first = Ilat, last = Ilat;
+        if (has_d2) { first = std::min( first, LB2 ); last = std::max( last, LB2 + (int) d2_vec.size() - 1 ); }
+        if (has_d1) { first = std::min( first, LB1 ); last = std::max( last, LB1 + (int) d1_vec.size() - 1 ); }
+
+        std::vector<double> & vals = row_vals.at(Ilat);
+        vals.assign( last - first + 1, 0. );
+        if (has_d2) {
+            for ( IDIFF = 0; IDIFF < (int) d2_vec.size(); IDIFF++ ) {
+                vals.at( LB2 + IDIFF - first ) += d2_vec.at(IDIFF) * R2_inv;
+            }
+        }
+        if (has_d1) {
+            for ( IDIFF = 0; IDIFF < (int) d1_vec.size(); IDIFF++ ) {
+                vals.at( LB1 + IDIFF - first ) -= d1_vec.at(IDIFF) * tan_lat * R2_inv;
+            }
+        }
+        row_start.at(Ilat) = first;
+
+        lower_band = std::max( lower_band, Ilat  - first );
+        upper_band = std::max( upper_band, last - Ilat );
+    }
+
+    // Store the rows in band form: entry (Ilat, Ilat + off) for off in [-lower_band, upper_band]
+    const int band_width = lower_band + upper_band + 1;
+    lat_band.assign( (size_t) Nlat * band_width, 0. );
+    for ( Ilat = 0; Ilat < Nlat; Ilat++ ) {
+        for ( IDIFF = 0; IDIFF < (int) row_vals.at(Ilat).size(); IDIFF++ ) {
+            const int off = row_start.at(Ilat) + IDIFF - Ilat;
+            lat_band.at( (size_t) Ilat * band_width + off + lower_band ) = row_vals.at(Ilat).at(IDIFF);
+        }
+    }
+
+    // Without the pole rows to pin it down, the zonal mean has a constant null-space
+    //   (the stencils annihilate constants), so only the least-squares solver gives
+    //   a meaningful answer.
+    if (not(has_pole)) { usable = false; return; }
+
+    // Finally, make sure that every wavenumber gives a non-singular system.
+    int num_singular = 0;
+    #pragma omp parallel default(none) shared( num_singular ) private( Ik )
+    {
+        std::vector< std::complex<double> > work, rhs( Nlat, 0. );
+        #pragma omp for collapse(1) schedule(static) reduction(+:num_singular)
+        for ( Ik = 0; Ik < Nfreq; Ik++ ) {
+            if (not( factor_and_solve( rhs, work, Ik ) )) { num_singular++; }
+        }
+    }
+    if (num_singular > 0) { usable = false; }
+}
+
+
+/*!
+ * \brief Factor the latitude system for wavenumber Ik and solve it in place.
+ *
+ * Banded Gaussian elimination with partial pivoting. Row swaps can push the
+ * upper band out by lower_band, so each row stores 2 * lower_band + upper_band + 1 entries,
+ * with entry (I, J) at I * width + (J - I + lower_band).
+ *
+ * @param[in,out]   rhs     right-hand side on input, solution on output (length Nlat)
+ * @param[in,out]   work    workspace (resized as needed)
+ * @param[in]       Ik      zonal wavenumber
+ *
+ * @returns         false if a (numerically) zero pivot was found
+ */
+bool direct_Lap_solver::factor_and_solve(
+        std::vector< std::complex<double> > & rhs,
+        std::vector< std::complex<double> > & work,
+        const int Ik
+        ) const {
+
+    const int band_width = lower_band + upper_band + 1,
+              width      = 2 * lower_band + upper_band + 1;
+
+    int Irow, Icol, Jcol, Ipiv, Jlast;
+    double max_abs = 0.;
+
+    // Assemble the system for this wavenumber
+    //   (pole rows are identity rows, so leave them out of the magnitude estimate)
+    work.assign( (size_t) Nlat * width, 0. );
+    for ( Irow = 0; Irow < Nlat; Irow++ ) {
+        for ( Icol = 0; Icol < band_width; Icol++ ) {
+            work[ (size_t) Irow * width + Icol ] = lat_band[ (size_t) Irow * band_width + Icol ];
+        }
+        if ( lon_scale[Irow] == 0. ) { continue; }
+        work[ (size_t) Irow * width + lower_band ] += lon_scale[Irow] * lon_symbol[Ik];
+        for ( Icol = 0; Icol < band_width; Icol++ ) {
+            max_abs = std::max( max_abs, std::abs( work[ (size_t) Irow * width + Icol ] ) );
+        }
+    }
+    const double pivot_tol = 1e-12 * max_abs;
+
+    #define BAND(I, J) work[ (size_t) (I) * width + ( (J) - (I) + lower_band ) ]
+
+    // Forward elimination (applied to the RHS as we go)
+    for ( Icol = 0; Icol < Nlat; Icol++ ) {
+
+        const int last_row = std::min( Nlat - 1, Icol + lower_band );
+        Jlast = std::min( Nlat - 1, Icol + lower_band + upper_band );
+
+        // Find the pivot
+        Ipiv = Icol;
+        for ( Irow = Icol + 1; Irow <= last_row; Irow++ ) {
+            if ( std::abs( BAND(Irow, Icol) ) > std::abs( BAND(Ipiv, Icol) ) ) { Ipiv = Irow; }
+        }
+        if ( std::abs( BAND(Ipiv, Icol) ) <= pivot_tol ) { return false; }
+
+        if ( Ipiv != Icol ) {
+            for ( Jcol = Icol; Jcol <= Jlast; Jcol++ ) { std::swap( BAND(Ipiv, Jcol), BAND(Icol, Jcol) ); }
+            std::swap( rhs[Ipiv], rhs[Icol] );
+        }
+
+        const std::complex<double> pivot_inv = 1. / BAND(Icol, Icol);
+        for ( Irow = Icol + 1; Irow <= last_row; Irow++ ) {
+            const std::complex<double> factor = BAND(Irow, Icol) * pivot_inv;
+            if ( factor == 0. ) { continue; }
+            for ( Jcol = Icol + 1; Jcol <= Jlast; Jcol++ ) {
+                BAND(Irow, Jcol) -= factor * BAND(Icol, Jcol);
+            }
+            rhs[Irow] -= factor * rhs[Icol];
+        }
+    }
+
+    // Back substitution
+    for ( Irow = Nlat - 1; Irow >= 0; Irow-- ) {
+        Jlast = std::min( Nlat - 1, Irow + lower_band + upper_band );
+        std::complex<double> tmp = rhs[Irow];
+        for ( Jcol = Irow + 1; Jcol <= Jlast; Jcol++ ) {
+            tmp -= BAND(Irow, Jcol) * rhs[Jcol];
+        }
+        rhs[Irow] = tmp / BAND(Irow, Irow);
+    }
+
+    #undef BAND
+
+    return true;
+}
+
+
+/*!
+ * \brief Solve Lap(F) = RHS on a single (time, depth) slice.
+ *
+ * FFT in longitude, one banded solve per zonal wavenumber, and an inverse FFT.
+ * RHS is expected to be un-weighted (i.e. not multiplied by cell areas).
+ *
+ * @param[in,out]   F       solution, resized to Nlat * Nlon
+ * @param[in]       RHS     right-hand side (Nlat * Nlon), ordered as Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon)
+ *
+ * @returns         false if the solver is not usable for this grid, or if one of the banded
+ *                  systems turned out to be singular (use the iterative solver instead)
+ */
+bool direct_Lap_solver::solve(
+        std::vector<double> & F,
+        const std::vector<double> & RHS
+        ) const {
+
+    if (not(usable)) { return false; }
+
+    int Ilat, Ilon, Ik;
+    size_t index;
+    std::vector< std::complex<double> > RHS_hat( (size_t) Nlat * Nfreq );
+
+    F.resize( (size_t) Nlat * Nlon );
+
+    // Transform each latitude band into zonal wavenumbers
+    //   (ALGLIB's default-parameter globals rule out default(none) here)
+    #pragma omp parallel shared( RHS, RHS_hat ) private( Ilat, Ilon, Ik, index )
+    {
+        alglib::real_1d_array row;
+        alglib::complex_1d_array row_hat;
+        row.setlength( Nlon );
+
+        #pragma omp for collapse(1) schedule(static)
+        for ( Ilat = 0; Ilat < Nlat; Ilat++ ) {
+            for ( Ilon = 0; Ilon < Nlon; Ilon++ ) {
+                index = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
+                row[Ilon] = RHS[index];
+            }
+            alglib::fftr1d( row, Nlon, row_hat );
+            for ( Ik = 0; Ik < Nfreq; Ik++ ) {
+                RHS_hat[ (size_t) Ik * Nlat + Ilat ] = std::complex<double>( row_hat[Ik].x, row_hat[Ik].y );
+            }
+        }
+    }
+
+    // One banded latitude solve per wavenumber
+    bool all_good = true;
+    #pragma omp parallel default(none) shared( RHS_hat ) private( Ik ) reduction(&&:all_good)
+    {
+        std::vector< std::complex<double> > work, rhs_k( Nlat );
+
+        #pragma omp for collapse(1) schedule(dynamic)
+        for ( Ik = 0; Ik < Nfreq; Ik++ ) {
+            std::copy( RHS_hat.begin() + (size_t) Ik * Nlat, RHS_hat.begin() + (size_t) (Ik + 1) * Nlat, rhs_k.begin() );
+            all_good = factor_and_solve( rhs_k, work, Ik ) and all_good;
+            std::copy( rhs_k.begin(), rhs_k.end(), RHS_hat.begin() + (size_t) Ik * Nlat );
+        }
+    }
+    if (not(all_good)) { return false; }
+
+    // And transform back to physical space
+    #pragma omp parallel shared( F, RHS_hat ) private( Ilat, Ilon, Ik, index )
+    {
+        alglib::real_1d_array row;
+        alglib::complex_1d_array row_hat;
+        row_hat.setlength( Nfreq );
+
+        #pragma omp for collapse(1) schedule(static)
+        for ( Ilat = 0; Ilat < Nlat; Ilat++ ) {
+            for ( Ik = 0; Ik < Nfreq; Ik++ ) {
+                row_hat[Ik].x = RHS_hat[ (size_t) Ik * Nlat + Ilat ].real();
+                row_hat[Ik].y = RHS_hat[ (size_t) Ik * Nlat + Ilat ].imag();
+            }
+            alglib::fftr1dinv( row_hat, Nlon, row );
+            for ( Ilon = 0; Ilon < Nlon; Ilon++ ) {
+                index = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
+                F[index] = row[Ilon];
+            }
+        }
+    }
+
+    return true;
+}
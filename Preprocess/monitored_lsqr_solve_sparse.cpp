@@ -0,0 +1,104 @@
+#include "../constants.hpp"
+#include "../functions.hpp"
+#include "../preprocess.hpp"
+#include <vector>
+#include <string>
+#include <functional>
+#include <csetjmp>
+#include "../ALGLIB/stdafx.h"
+#include "../ALGLIB/linalg.h"
+#include "../ALGLIB/solvers.h"
+
+/*!
+ * \brief Run the ALGLIB LSQR solver on a sparse system, checking the solution every check_interval iterations.
+ * @ingroup ToroidalProjection
+ *
+ * linlsqrsolvesparse does not pass the intermediate solutions to the caller, so this
+ * drives the reverse-communication loop of the solver directly, in exactly the same
+ * way (including the default column-norm preconditioner).
+ *
+ * Every check_interval iterations, check_solution is called with the current (un-preconditioned)
+ * solution and iteration count. If it returns true, the solver is asked to stop, in which case
+ * the termination type (from linlsqrresults) is 8.
+ *
+ * If check_interval <= 0, then this is simply linlsqrsolvesparse.
+ *
+ * @param[in,out]   state               LSQR solver (with the stopping conditions already set)
+ * @param[in]       A                   sparse (CRS) matrix
+ * @param[in]       b                   right-hand side
+ * @param[in]       check_interval      number of iterations between checks
+ * @param[in]       check_solution      function (solution, iteration) that returns true to stop the solver
+ */
+void monitored_lsqr_solve_sparse(
+        alglib::linlsqrstate & state,
+        const alglib::sparsematrix & A,
+        const alglib::real_1d_array & b,
+        const int check_interval,
+        const std::function< bool( const std::vector<double> &, const int ) > & check_solution
+        ) {
+
+    if ( check_interval <= 0 ) {
+        alglib::linlsqrsolvesparse( state, A, b );
+        return;
+    }
+
+    alglib_impl::linlsqrstate *s = state.c_ptr();
+    alglib_impl::sparsematrix *a = A.c_ptr();
+
+    // ALGLIB reports errors by jumping back here, which the C++ interface turns into exceptions
+    jmp_buf break_jump;
+    alglib_impl::ae_state env;
+    alglib_impl::ae_state_init( &env );
+    if ( setjmp( break_jump ) ) {
+        const std::string msg = ( env.error_msg == NULL ) ? "monitored_lsqr_solve_sparse failed" : env.error_msg;
+        alglib_impl::ae_state_clear( &env );
+        throw alglib::ap_error( msg.c_str() );
+    }
+    alglib_impl::ae_state_set_break_jump( &env, &break_jump );
+
+    const int n = s->n;
+    alglib_impl::ae_int_t t0 = 0, t1 = 0, Irow, Icol;
+    double val;
+    int ii;
+
+    alglib_impl::rvectorsetlengthatleast( &s->tmpd, n, &env );
+    alglib_impl::rvectorsetlengthatleast( &s->tmpx, n, &env );
+
+    // Diagonal (column-norm) preconditioner, as in linlsqrsolvesparse
+    for ( ii = 0; ii < n; ii++ ) { s->tmpd.ptr.p_double[ii] = ( s->prectype == 0 ) ? 0. : 1.; }
+    if ( s->prectype == 0 ) {
+        while ( alglib_impl::sparseenumerate( a, &t0, &t1, &Irow, &Icol, &val, &env ) ) {
+            s->tmpd.ptr.p_double[Icol] += val * val;
+        }
+        for ( ii = 0; ii < n; ii++ ) {
+            s->tmpd.ptr.p_double[ii] = ( s->tmpd.ptr.p_double[ii] > 0 ) ? 1. / sqrt( s->tmpd.ptr.p_double[ii] ) : 1.;
+        }
+    }
+
+    std::vector<double> solution( n );
+
+    alglib_impl::linlsqrsetxrep( s, ae_true, &env );
+    alglib_impl::linlsqrsetb( s, const_cast<alglib_impl::ae_vector*>( b.c_ptr() ), &env );
+    alglib_impl::linlsqrrestart( s, &env );
+    while ( alglib_impl::linlsqriteration( s, &env ) ) {
+        if ( s->needmv ) {
+            for ( ii = 0; ii < n; ii++ ) { s->tmpx.ptr.p_double[ii] = s->tmpd.ptr.p_double[ii] * s->x.ptr.p_double[ii]; }
+            alglib_impl::sparsemv( a, &s->tmpx, &s->mv, &env );
+        }
+        if ( s->needmtv ) {
+            alglib_impl::sparsemtv( a, &s->x, &s->mtv, &env );
+            for ( ii = 0; ii < n; ii++ ) { s->mtv.ptr.p_double[ii] *= s->tmpd.ptr.p_double[ii]; }
+        }
+        if ( s->xupdated ) {
+            const int iteration = s->repiterationscount;
+            if ( ( iteration > 0 ) and ( iteration % check_interval == 0 ) ) {
+                for ( ii = 0; ii < n; ii++ ) { solution[ii] = s->tmpd.ptr.p_double[ii] * s->x.ptr.p_double[ii]; }
+                if ( check_solution( solution, iteration ) ) { alglib_impl::linlsqrrequesttermination( s, &env ); }
+            }
+        }
+    }
+    for ( ii = 0; ii < n; ii++ ) { s->rx.ptr.p_double[ii] *= s->tmpd.ptr.p_double[ii]; }
+
+    alglib_impl::linlsqrsetxrep( s, ae_false, &env );
+    alglib_impl::ae_state_clear( &env );
+}
@@ -0,0 +1,106 @@
+#include "../constants.hpp"
+#include "../functions.hpp"
+#include "../preprocess.hpp"
+#include <algorithm>
+#include <vector>
+#include <omp.h>
+#include <math.h>
+
+// Build the (up to) four-point Lagrange stencil on grid that is used to interpolate to target.
+//   For periodic grids, the stencil wraps around (with the coordinates unwrapped accordingly),
+//   otherwise it is shifted inwards at the edges.
+void cubic_stencil_in_grid(
+        std::vector<int> & inds,
+        std::vector<double> & weights,
+        const std::vector<double> & grid,
+        const double target,
+        const bool periodic
+        ) {
+
+    const int Ngrid = grid.size(),
+              Nsten = std::min( Ngrid, 4 );
+    const bool increasing = grid.back() > grid.front();
+    const double period = ( Ngrid > 1 ) ? Ngrid * ( grid.at(1) - grid.at(0) ) : 0.;
+
+    // Index of the last grid point that is at or before the target
+    int LO;
+    if ( increasing ) {
+        LO = ( std::upper_bound( grid.begin(), grid.end(), target ) - grid.begin() ) - 1;
+    } else {
+        LO = ( std::upper_bound( grid.rbegin(), grid.rend(), target ) - grid.rbegin() ) - 1;
+        LO = (Ngrid - 1) - LO - 1;
+    }
+
+    int start = LO - (Nsten / 2 - 1);
+    if ( not(periodic) ) { start = std::max( 0, std::min( start, Ngrid - Nsten ) ); }
+
+    std::vector<double> coords(Nsten);
+    inds.resize(Nsten);
+    weights.resize(Nsten);
+    for (int II = 0; II < Nsten; ++II) {
+        const int Iraw = start + II,
+                  Iwrap = ( Iraw % Ngrid + Ngrid ) % Ngrid;
+        inds.at(II)   = Iwrap;
+        coords.at(II) = grid.at(Iwrap) + ( periodic ? period * ( (Iraw - Iwrap) / Ngrid ) : 0. );
+    }
+
+    for (int II = 0; II < Nsten; ++II) {
+        weights.at(II) = 1.;
+        for (int JJ = 0; JJ < Nsten; ++JJ) {
+            if (JJ != II) { weights.at(II) *= ( target - coords.at(JJ) ) / ( coords.at(II) - coords.at(JJ) ); }
+        }
+    }
+}
+
+void refine_field_cubic(
+        std::vector<double> & fine_field,
+        const std::vector<double> & coarse_field,
+        const std::vector<double> & coarse_latitude,
+        const std::vector<double> & coarse_longitude,
+        const std::vector<double> & fine_latitude,
+        const std::vector<double> & fine_longitude
+        ) {
+
+    const int   Nlon_coarse = coarse_longitude.size(),
+                Nlat_fine   = fine_latitude.size(),
+                Nlon_fine   = fine_longitude.size();
+
+    fine_field.resize( Nlat_fine * Nlon_fine );
+
+    // Pre-compute the stencils for each fine lat/lon, since they're
+    //   shared across the full row / column.
+    std::vector< std::vector<int> >     lat_inds(Nlat_fine),    lon_inds(Nlon_fine);
+    std::vector< std::vector<double> >  lat_weights(Nlat_fine), lon_weights(Nlon_fine);
+
+    int Ilat, Ilon;
+    for (Ilat = 0; Ilat < Nlat_fine; ++Ilat) {
+        cubic_stencil_in_grid( lat_inds.at(Ilat), lat_weights.at(Ilat), coarse_latitude,  fine_latitude.at(Ilat),  constants::PERIODIC_Y );
+    }
+    for (Ilon = 0; Ilon < Nlon_fine; ++Ilon) {
+        cubic_stencil_in_grid( lon_inds.at(Ilon), lon_weights.at(Ilon), coarse_longitude, fine_longitude.at(Ilon), constants::PERIODIC_X );
+    }
+
+    double interp_val;
+    #pragma omp parallel \
+    default(none) \
+    shared( fine_field, coarse_field, lat_inds, lat_weights, lon_inds, lon_weights ) \
+    private( Ilat, Ilon, interp_val ) \
+    firstprivate( Nlat_fine, Nlon_fine, Nlon_coarse )
+    {
+        #pragma omp for collapse(2) schedule(static)
+        for (Ilat = 0; Ilat < Nlat_fine; ++Ilat) {
+            for (Ilon = 0; Ilon < Nlon_fine; ++Ilon) {
+
+                interp_val = 0.;
+                for (size_t IA = 0; IA < lat_inds.at(Ilat).size(); ++IA) {
+                    for (size_t IB = 0; IB < lon_inds.at(Ilon).size(); ++IB) {
+                        interp_val +=   lat_weights.at(Ilat).at(IA) * lon_weights.at(Ilon).at(IB)
+                                      * coarse_field.at( lat_inds.at(Ilat).at(IA) * Nlon_coarse + lon_inds.at(Ilon).at(IB) );
+                    }
+                }
+
+                fine_field.at( Index(0, 0, Ilat, Ilon, 1, 1, Nlat_fine, Nlon_fine) ) = interp_val;
+            }
+        }
+    }
+}
@@ -21,6 +21,7 @@
  * @param[in]       Itime,Idepth    Indices to denote which time/depth index we're doing
  * @param[in]       mask            array to distinguish land/water
  * @param[in]       area_weight     Boolean indicating if rows in least-squares problem should be area-weighted
+ * @param[in]       ops             (optional) derivative operators for this mask, built here if not provided
  *
  */
 
@@ -30,7 +31,8 @@ void sparse_vel_from_PsiPhi(
         const int Itime,
         const int Idepth,
         const std::vector<bool> & mask,
-        const bool area_weight
+        const bool area_weight,
+        const spherical_derivative_operators * ops
         ) {
 
     const std::vector<double>   &latitude   = source_data.latitude,
@@ -44,11 +46,19 @@ void sparse_vel_from_PsiPhi(
                 Nlat    = myCounts.at(2),
                 Nlon    = myCounts.at(3);
 
-    int Ilat, Ilon, IDIFF, Idiff, Ndiff, LB;
-    size_t index_sub, diff_index;
+    // The stencils are the same as from get_diff_vector (including the back-up plans)
+    spherical_derivative_operators local_ops;
+    if ( (ops == NULL) or not( ops->applies_to( longitude, latitude, mask ) ) ) {
+        local_ops.build( longitude, latitude, Ntime, Ndepth, Nlat, Nlon, mask, false );
+        ops = &local_ops;
+    }
+
+    int Ilat, Ilon, Idiff, Ndiff;
+    size_t index, index_sub, diff_index;
     const size_t Npts = Nlat * Nlon;
     double old_val, tmp, cos_lat_inv;
-    std::vector<double> diff_vec;
+    const long *diff_offsets;
+    const double *diff_coeffs;
     bool is_pole;
 
     const double R_inv = 1. / constants::R_earth;
@@ -59,45 +69,38 @@ void sparse_vel_from_PsiPhi(
             // If we're too close to the pole (less than 0.01 degrees), bad things happen
             is_pole = std::fabs( std::fabs( latitude.at(Ilat) * 180.0 / M_PI ) - 90 ) < 0.01;
 
+            index = Index(Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon);
             index_sub = Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon);
 
             cos_lat_inv = 1. / cos(latitude.at(Ilat));
 
             if ( not(is_pole) ) { // Skip land areas and poles
 
+                // The stencils stay within the time-depth slice, so the offsets also apply to index_sub
+
                 //
                 //// LON first derivative part
                 //
 
-                LB = - 2 * Nlon;
-                get_diff_vector(diff_vec, LB, longitude, "lon", Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon, mask, 1, constants::DiffOrd);
-
-                Ndiff = diff_vec.size();
-
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlon) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
+                Ndiff = ops->ddlon.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                        if (constants::PERIODIC_X) { Idiff = ( IDIFF % Nlon + Nlon ) % Nlon; }
-                        else                       { Idiff = IDIFF;                          }
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                        diff_index = Index(0, 0, Ilat, Idiff, 1, 1, Nlat, Nlon);
+                    tmp = diff_coeffs[Idiff] * cos_lat_inv * R_inv;
+                    if (area_weight) { tmp *= areas.at(index_sub); }
 
-                        tmp = diff_vec.at(IDIFF-LB) * cos_lat_inv * R_inv;
-                        if (area_weight) { tmp *= areas.at(index_sub); }
+                    // Psi part
+                    size_t  column_skip = 0,
+                            row_skip    = Npts;
+                    old_val = sparseget(LHS_matr, row_skip + index_sub, column_skip + diff_index);
+                    alglib::sparseset(  LHS_matr, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
 
-                        // Psi part
-                        size_t  column_skip = 0,
-                                row_skip    = Npts;
-                        old_val = sparseget(LHS_matr, row_skip + index_sub, column_skip + diff_index);
-                        alglib::sparseset(  LHS_matr, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
-
-                        // Phi part
-                        column_skip = Npts;
-                        row_skip    = 0;
-                        old_val = sparseget(LHS_matr, row_skip + index_sub, column_skip + diff_index);
-                        alglib::sparseset(  LHS_matr, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
-                    }
+                    // Phi part
+                    column_skip = Npts;
+                    row_skip    = 0;
+                    old_val = sparseget(LHS_matr, row_skip + index_sub, column_skip + diff_index);
+                    alglib::sparseset(  LHS_matr, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
                 }
 
 
@@ -105,38 +108,25 @@ void sparse_vel_from_PsiPhi(
                 //// LAT first derivative part
                 //
 
-                LB = - 2 * Nlat;
-                get_diff_vector(diff_vec, LB, latitude, "lat",
-                                Itime, Idepth, Ilat, Ilon,
-                                Ntime, Ndepth, Nlat, Nlon,
-                                mask, 1, constants::DiffOrd);
-
-                Ndiff = diff_vec.size();
-
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlat) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
-
-                        if (constants::PERIODIC_Y) { Idiff = ( IDIFF % Nlat + Nlat ) % Nlat; }
-                        else                       { Idiff = IDIFF;                          }
+                Ndiff = ops->ddlat.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                        diff_index = Index(0, 0, Idiff, Ilon, 1, 1, Nlat,  Nlon);
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                        tmp = diff_vec.at(IDIFF-LB) * R_inv;
-                        if (area_weight) { tmp *= areas.at(index_sub); }
+                    tmp = diff_coeffs[Idiff] * R_inv;
+                    if (area_weight) { tmp *= areas.at(index_sub); }
 
-                        // Psi part
-                        size_t  column_skip = 0,
-                                row_skip    = 0;
-                        old_val = sparseget(LHS_matr, row_skip + index_sub, column_skip + diff_index);
-                        alglib::sparseset(  LHS_matr, row_skip + index_sub, column_skip + diff_index, old_val - tmp);
+                    // Psi part
+                    size_t  column_skip = 0,
+                            row_skip    = 0;
+                    old_val = sparseget(LHS_matr, row_skip + index_sub, column_skip + diff_index);
+                    alglib::sparseset(  LHS_matr, row_skip + index_sub, column_skip + diff_index, old_val - tmp);
 
-                        // Phi part
-                        column_skip = Npts;
-                        row_skip    = Npts;
-                        old_val = sparseget(LHS_matr, row_skip + index_sub, column_skip + diff_index);
-                        alglib::sparseset(  LHS_matr, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
-                    }
+                    // Phi part
+                    column_skip = Npts;
+                    row_skip    = Npts;
+                    old_val = sparseget(LHS_matr, row_skip + index_sub, column_skip + diff_index);
+                    alglib::sparseset(  LHS_matr, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
                 }
             }
         }
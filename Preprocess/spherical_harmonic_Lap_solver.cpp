@@ -0,0 +1,385 @@
+#include "../constants.hpp"
+#include "../functions.hpp"
+#include "../preprocess.hpp"
+#include <algorithm>
+#include <vector>
+#include <complex>
+#include <omp.h>
+#include <math.h>
+#include "../ALGLIB/stdafx.h"
+#include "../ALGLIB/linalg.h"
+#include "../ALGLIB/fasttransforms.h"
+
+// This file provides the implementation details for the spherical_harmonic_Lap_solver class
+
+// Class constructor
+spherical_harmonic_Lap_solver::spherical_harmonic_Lap_solver() {
+}
+
+/*!
+ * \brief Check if the spherical-harmonic Laplacian solve can be applied.
+ * @ingroup ToroidalProjection
+ *
+ * Spherical harmonics are only a basis on the full sphere, so the grid needs to be spherical,
+ * periodic and uniform in longitude, span the full longitude domain, reach (to within
+ * a couple of grid cells) both poles, and have no land cells.
+ *
+ * @param[in]   source_data     dataset class instance containing the grid
+ * @param[in]   mask            mask that would be used for the projection
+ *
+ * @returns     true if the spherical-harmonic solve can be used
+ */
+bool spherical_harmonic_Lap_solver_applicable(
+        const dataset & source_data,
+        const std::vector<bool> & mask
+        ) {
+
+    if (    constants::CARTESIAN
+         or not( constants::PERIODIC_X )
+         or      constants::PERIODIC_Y
+         or not( constants::UNIFORM_LON_GRID )
+         or not( constants::FULL_LON_SPAN )
+       ) { return false; }
+
+    const std::vector<double> &latitude = source_data.latitude;
+    const int Nlat = latitude.size(),
+              Nlon = source_data.longitude.size();
+
+    if ( ( Nlat < 3 ) or ( Nlon < 4 ) ) { return false; }
+
+    // The gap between the grid and each pole can be at most a couple of grid spacings
+    double max_dlat = 0.;
+    for (int Ilat = 1; Ilat < Nlat; ++Ilat) {
+        max_dlat = std::max( max_dlat, std::fabs( latitude.at(Ilat) - latitude.at(Ilat-1) ) );
+    }
+    const double lat_min = *std::min_element( latitude.begin(), latitude.end() ),
+                 lat_max = *std::max_element( latitude.begin(), latitude.end() );
+    if (    ( lat_min + M_PI / 2. > 2. * max_dlat )
+         or ( M_PI / 2. - lat_max > 2. * max_dlat )
+       ) { return false; }
+
+    // Land would need to be handled as a boundary, which the harmonics can't do
+    return std::all_of( mask.begin(), mask.end(), [](bool v) { return v; } );
+}
+
+
+/*!
+ * \brief Set up the latitude information needed for the transforms.
+ *
+ * @param[in]   source_data     dataset class instance containing the grid
+ * @param[in]   mask            mask used for the projection (must be all water)
+ */
+void spherical_harmonic_Lap_solver::build(
+        const dataset & source_data,
+        const std::vector<bool> & mask
+        ) {
+
+    const std::vector<double> &latitude = source_data.latitude;
+
+    Nlat  = latitude.size();
+    Nlon  = source_data.longitude.size();
+    Nfreq = Nlon / 2 + 1;
+    cached = false;
+    cached_ops.clear();
+
+    usable = spherical_harmonic_Lap_solver_applicable( source_data, mask );
+    if (not(usable)) { return; }
+
+    // Use the Nyquist wavenumber (for even Nlon) only as an upper bound,
+    //   since it can't be distinguished from aliasing
+    Lmax = (Nlon - 1) / 2;
+
+    sin_lat.resize( Nlat );
+    cos_lat.resize( Nlat );
+    fit_row.resize( Nlat );
+    row_weight.resize( Nlat );
+    Nfit = 0;
+    for (int Ilat = 0; Ilat < Nlat; ++Ilat) {
+        sin_lat.at(Ilat) = sin( latitude.at(Ilat) );
+        cos_lat.at(Ilat) = std::max( cos( latitude.at(Ilat) ), 0. );
+
+        // The RHS (vorticity / divergence) isn't computed at the poles, so leave those
+        //   rows out of the fit, and recover the pole values from the harmonics instead.
+        fit_row.at(Ilat) = not( std::fabs( std::fabs( latitude.at(Ilat) * 180.0 / M_PI ) - 90 ) < 0.01 );
+        if (fit_row.at(Ilat)) { Nfit++; }
+
+        // Area weighting (up to a constant) for the least-squares fit
+        row_weight.at(Ilat) = sqrt( source_data.areas.at( Index(0, 0, Ilat, 0, 1, 1, Nlat, Nlon) ) ) / constants::R_earth;
+    }
+
+    if ( Nfit < 2 ) { usable = false; return; }
+
+    // Each wavenumber only needs its (Nlat x Nfit) inverse operator, so keep them around
+    //   if they fit in memory (otherwise they are rebuilt in each solve call),
+    //   which also checks that every fit is well-posed.
+    const int Nfreq_used = std::min( Nfreq, Lmax + 1 );
+    cached = (double) Nlat * Nfit * Nfreq_used * sizeof(double) <= max_cache_GB * pow( 1024., 3 );
+    if (not(cached)) { return; }
+
+    cached_ops.resize( Nfreq_used );
+    int Ik, num_singular = 0;
+    #pragma omp parallel private( Ik ) reduction(+:num_singular)
+    {
+        #pragma omp for collapse(1) schedule(dynamic)
+        for ( Ik = 0; Ik < Nfreq_used; Ik++ ) {
+            if (not( inverse_operator( cached_ops.at(Ik), Ik ) )) { num_singular++; }
+        }
+    }
+    if (num_singular > 0) { usable = false; cached = false; cached_ops.clear(); }
+}
+
+
+/*!
+ * \brief Number of degrees used for zonal wavenumber Im.
+ *
+ * Degrees Im, Im+1, ..., are used up to Lmax, but never more than the number of
+ * latitude rows that are being fit (so that each fit is square or over-determined).
+ */
+int spherical_harmonic_Lap_solver::num_degrees(
+        const int Im
+        ) const {
+    return std::max( 0, std::min( Lmax, Im + Nfit - 1 ) - Im + 1 );
+}
+
+
+/*!
+ * \brief Evaluate the (orthonormal) associated Legendre functions for zonal wavenumber Im.
+ *
+ * Uses the standard three-term recurrence in degree, starting from P_mm.
+ * P_mm decays like cos(lat)^m, and so simply underflows to zero near the poles for large m.
+ *
+ * @param[in,out]   Pmat    Nlat x Ndeg matrix, with entry (Ilat, l - Im)
+ * @param[in]       Im      zonal wavenumber
+ * @param[in]       Ndeg    number of degrees to evaluate
+ */
+void spherical_harmonic_Lap_solver::legendre_matrix(
+        alglib::real_2d_array & Pmat,
+        const int Im,
+        const int Ndeg
+        ) const {
+
+    Pmat.setlength( Nlat, Ndeg );
+
+    int Ilat, Ik, Il;
+    double Pmm, a_lm, b_lm;
+    for (Ilat = 0; Ilat < Nlat; ++Ilat) {
+
+        Pmm = sqrt( 0.5 );
+        for (Ik = 1; Ik <= Im; ++Ik) { Pmm *= sqrt( (2. * Ik + 1.) / (2. * Ik) ) * cos_lat.at(Ilat); }
+        Pmat[Ilat][0] = Pmm;
+
+        if (Ndeg > 1) { Pmat[Ilat][1] = sqrt( 2. * Im + 3. ) * sin_lat.at(Ilat) * Pmm; }
+
+        for (Il = Im + 2; Il < Im + Ndeg; ++Il) {
+            a_lm = sqrt( ( 4. * Il * Il - 1. ) / ( (double) Il * Il - (double) Im * Im ) );
+            b_lm = sqrt( ( (Il - 1.) * (Il - 1.) - (double) Im * Im ) / ( 4. * (Il - 1.) * (Il - 1.) - 1. ) );
+            Pmat[Ilat][Il - Im] = a_lm * ( sin_lat.at(Ilat) * Pmat[Ilat][Il - Im - 1] - b_lm * Pmat[Ilat][Il - Im - 2] );
+        }
+    }
+}
+
+
+/*!
+ * \brief Build the operator that takes the latitude profile of zonal wavenumber Im (on the fit rows) to its inverse Laplacian (on all rows).
+ *
+ * The profile is fit (in the area-weighted least-squares sense) with the Legendre functions,
+ * using a QR factorization, the coefficients are divided by \f$ -l(l+1)/R^2 \f$,
+ * and then summed back onto every latitude (including the poles).
+ *
+ * @param[in,out]   Kmat    Nlat x Nfit operator
+ * @param[in]       Im      zonal wavenumber
+ *
+ * @returns         false if the fit is (numerically) rank-deficient
+ */
+bool spherical_harmonic_Lap_solver::inverse_operator(
+        alglib::real_2d_array & Kmat,
+        const int Im
+        ) const {
+
+    const int Ndeg = num_degrees( Im );
+    const double R2 = pow( constants::R_earth, 2 );
+
+    Kmat.setlength( Nlat, Nfit );
+    if ( Ndeg == 0 ) {
+        for ( int Ilat = 0; Ilat < Nlat; Ilat++ ) {
+            for ( int Ifit = 0; Ifit < Nfit; Ifit++ ) { Kmat[Ilat][Ifit] = 0.; }
+        }
+        return true;
+    }
+
+    alglib::real_2d_array Pmat, Amat, Qmat, Rmat, Xmat;
+    alglib::real_1d_array tau;
+    int Ilat, Ifit, Il;
+
+    legendre_matrix( Pmat, Im, Ndeg );
+
+    // Weighted least-squares system, using only the fit rows
+    Amat.setlength( Nfit, Ndeg );
+    Ifit = 0;
+    for ( Ilat = 0; Ilat < Nlat; Ilat++ ) {
+        if (not(fit_row[Ilat])) { continue; }
+        for ( Il = 0; Il < Ndeg; Il++ ) { Amat[Ifit][Il] = row_weight[Ilat] * Pmat[Ilat][Il]; }
+        Ifit++;
+    }
+
+    alglib::rmatrixqr( Amat, Nfit, Ndeg, tau );
+    alglib::rmatrixqrunpackq( Amat, Nfit, Ndeg, tau, Ndeg, Qmat );
+    alglib::rmatrixqrunpackr( Amat, Ndeg, Ndeg, Rmat );
+
+    double max_diag = 0., min_diag = std::fabs( Rmat[0][0] );
+    for ( Il = 0; Il < Ndeg; Il++ ) {
+        max_diag = std::max( max_diag, std::fabs( Rmat[Il][Il] ) );
+        min_diag = std::min( min_diag, std::fabs( Rmat[Il][Il] ) );
+    }
+    if ( min_diag <= 1e-10 * max_diag ) { return false; }
+
+    // X = R^{-1} Q^T W, so that X times the (un-weighted) profile gives the coefficients
+    Xmat.setlength( Ndeg, Nfit );
+    Ifit = 0;
+    for ( Ilat = 0; Ilat < Nlat; Ilat++ ) {
+        if (not(fit_row[Ilat])) { continue; }
+        for ( Il = 0; Il < Ndeg; Il++ ) { Xmat[Il][Ifit] = Qmat[Ifit][Il] * row_weight[Ilat]; }
+        Ifit++;
+    }
+    alglib::rmatrixlefttrsm( Ndeg, Nfit, Rmat, 0, 0, true, false, 0, Xmat, 0, 0 );
+
+    // Invert the Laplacian
+    for ( Il = 0; Il < Ndeg; Il++ ) {
+        const int degree = Im + Il;
+        const double scale = (degree == 0) ? 0. : - R2 / ( degree * ( degree + 1. ) );
+        for ( Ifit = 0; Ifit < Nfit; Ifit++ ) { Xmat[Il][Ifit] *= scale; }
+    }
+
+    // And sum back onto all latitudes
+    alglib::rmatrixgemm( Nlat, Nfit, Ndeg, 1., Pmat, 0, 0, 0, Xmat, 0, 0, 0, 0., Kmat, 0, 0 );
+
+    return true;
+}
+
+
+/*!
+ * \brief Solve Lap(F) = RHS on one or more (time, depth) slices.
+ *
+ * Each latitude band is Fourier transformed in longitude, each zonal wavenumber
+ * is passed through its inverse operator (see inverse_operator), and the result
+ * is transformed back into longitude.
+ *
+ * If the inverse operators were not cached by build(), they are rebuilt here, in which
+ * case it is much cheaper to solve many slices in one call than one slice at a time.
+ *
+ * The l = 0 (global mean) component is set to zero.
+ *
+ * @param[in,out]   F           solution, resized to Nslices * Nlat * Nlon
+ * @param[in]       RHS         right-hand side, with slice Islice at Islice * Nlat * Nlon + Index(0, 0, Ilat, Ilon, 1, 1, Nlat, Nlon)
+ * @param[in]       Nslices     number of slices in RHS
+ *
+ * @returns         false if the solver is not usable for this grid (use the iterative solver instead)
+ */
+bool spherical_harmonic_Lap_solver::solve(
+        std::vector<double> & F,
+        const std::vector<double> & RHS,
+        const int Nslices
+        ) const {
+
+    if (not(usable)) { return false; }
+
+    const size_t Npts = (size_t) Nlat * Nlon;
+    const int Nrow_fft = Nslices * Nlat,
+              Nfreq_used = std::min( Nfreq, Lmax + 1 ),
+              Ncols = 2 * Nslices;
+
+    int Irow, Ilon, Ik;
+    size_t index;
+
+    // Spectral coefficients, ordered as [ Ik ][ Islice ][ Ilat ]
+    std::vector< std::complex<double> > RHS_hat( (size_t) Nfreq * Nrow_fft, 0. );
+
+    F.resize( Nslices * Npts );
+
+    // Transform each latitude band into zonal wavenumbers
+    //   (ALGLIB's default-parameter globals rule out default(none) here)
+    #pragma omp parallel shared( RHS, RHS_hat ) private( Irow, Ilon, Ik, index )
+    {
+        alglib::real_1d_array row;
+        alglib::complex_1d_array row_hat;
+        row.setlength( Nlon );
+
+        #pragma omp for collapse(1) schedule(static)
+        for ( Irow = 0; Irow < Nrow_fft; Irow++ ) {
+            for ( Ilon = 0; Ilon < Nlon; Ilon++ ) {
+                index = (size_t) Irow * Nlon + Ilon;
+                row[Ilon] = RHS[index];
+            }
+            alglib::fftr1d( row, Nlon, row_hat );
+            for ( Ik = 0; Ik < Nfreq; Ik++ ) {
+                RHS_hat[ (size_t) Ik * Nrow_fft + Irow ] = std::complex<double>( row_hat[Ik].x, row_hat[Ik].y );
+            }
+        }
+    }
+
+    // Apply the inverse operator for each wavenumber
+    bool all_good = true;
+    #pragma omp parallel shared( RHS_hat ) private( Ik ) reduction(&&:all_good)
+    {
+        alglib::real_2d_array Kmat, Bmat, Out;
+        int Ilat, Ifit, Islice;
+
+        #pragma omp for collapse(1) schedule(dynamic)
+        for ( Ik = 0; Ik < Nfreq; Ik++ ) {
+
+            if ( (Ik >= Nfreq_used) or (num_degrees( Ik ) == 0) ) {
+                std::fill( RHS_hat.begin() + (size_t) Ik * Nrow_fft, RHS_hat.begin() + (size_t) (Ik + 1) * Nrow_fft, 0. );
+                continue;
+            }
+
+            if ( not(cached) and not( inverse_operator( Kmat, Ik ) ) ) { all_good = false; continue; }
+            const alglib::real_2d_array & op = cached ? cached_ops[Ik] : Kmat;
+
+            // Real and imaginary parts of each slice are separate columns
+            Bmat.setlength( Nfit, Ncols );
+            Ifit = 0;
+            for ( Ilat = 0; Ilat < Nlat; Ilat++ ) {
+                if (not(fit_row[Ilat])) { continue; }
+                for ( Islice = 0; Islice < Nslices; Islice++ ) {
+                    const std::complex<double> & val = RHS_hat[ (size_t) Ik * Nrow_fft + (size_t) Islice * Nlat + Ilat ];
+                    Bmat[Ifit][2 * Islice    ] = val.real();
+                    Bmat[Ifit][2 * Islice + 1] = val.imag();
+                }
+                Ifit++;
+            }
+
+            Out.setlength( Nlat, Ncols );
+            alglib::rmatrixgemm( Nlat, Ncols, Nfit, 1., op, 0, 0, 0, Bmat, 0, 0, 0, 0., Out, 0, 0 );
+            for ( Islice = 0; Islice < Nslices; Islice++ ) {
+                for ( Ilat = 0; Ilat < Nlat; Ilat++ ) {
+                    RHS_hat[ (size_t) Ik * Nrow_fft + (size_t) Islice * Nlat + Ilat ]
+                        = std::complex<double>( Out[Ilat][2 * Islice], Out[Ilat][2 * Islice + 1] );
+                }
+            }
+        }
+    }
+    if (not(all_good)) { return false; }
+
+    // And transform back to physical space
+    #pragma omp parallel shared( F, RHS_hat ) private( Irow, Ilon, Ik, index )
+    {
+        alglib::real_1d_array row;
+        alglib::complex_1d_array row_hat;
+        row_hat.setlength( Nfreq );
+
+        #pragma omp for collapse(1) schedule(static)
+        for ( Irow = 0; Irow < Nrow_fft; Irow++ ) {
+            for ( Ik = 0; Ik < Nfreq; Ik++ ) {
+                row_hat[Ik].x = RHS_hat[ (size_t) Ik * Nrow_fft + Irow ].real();
+                row_hat[Ik].y = RHS_hat[ (size_t) Ik * Nrow_fft + Irow ].imag();
+            }
+            alglib::fftr1dinv( row_hat, Nlon, row );
+            for ( Ilon = 0; Ilon < Nlon; Ilon++ ) {
+                index = (size_t) Irow * Nlon + Ilon;
+                F[index] = row[Ilon];
+            }
+        }
+    }
+
+    return true;
+}
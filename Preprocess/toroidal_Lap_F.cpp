@@ -16,7 +16,8 @@ void toroidal_Lap_F(
         const int Ndepth,
         const int Nlat,
         const int Nlon,
-        const std::vector<bool> & mask
+        const std::vector<bool> & mask,
+        const spherical_derivative_operators * ops
         ) {
 
     // ret = ddlon(vel_lat) / cos_lat - ddlat( u_lon * cos_lat ) / cos_lat 
@@ -31,15 +32,24 @@ void toroidal_Lap_F(
     bool is_pole;
 
     deriv_fields.push_back(&F);
+
+    // If the operators were built for this grid and mask, take the derivatives for all points at once
+    const bool use_ops = ( ops != NULL ) and ops->applies_to( longitude, latitude, mask, true );
+    std::vector<double> d2Fdlon2_all, d1Fdlat1_all, d2Fdlat2_all;
+    if (use_ops) {
+        ops->d2dlon2.apply( d2Fdlon2_all, F );
+        ops->ddlat.apply(   d1Fdlat1_all, F );
+        ops->d2dlat2.apply( d2Fdlat2_all, F );
+    }
     
     #pragma omp parallel \
     default(none) \
     shared( out_arr, latitude, longitude, mask,\
-            F, deriv_fields)\
+            F, deriv_fields, d2Fdlon2_all, d1Fdlat1_all, d2Fdlat2_all )\
     private(Ilat, Ilon, index, tmp, is_pole, \
             d2Fdlon2, d1Fdlat1, d2Fdlat2, \
             lon2_deriv_vals, lat1_deriv_vals, lat2_deriv_vals) \
-    firstprivate( Nlon, Nlat, Ndepth, Ntime )
+    firstprivate( Nlon, Nlat, Ndepth, Ntime, use_ops )
     {
 
         lon2_deriv_vals.push_back(&d2Fdlon2);
@@ -56,29 +66,35 @@ void toroidal_Lap_F(
 
                 if (mask.at(index)) { // Skip land areas
 
-                    // Second lon derivative
-                    spher_derivative_at_point(
-                            lon2_deriv_vals, deriv_fields,
-                            longitude, "lon",
-                            Itime, Idepth, Ilat, Ilon,
-                            Ntime, Ndepth, Nlat, Nlon,
-                            mask, 2);
-
-                    // First lat derivative
-                    spher_derivative_at_point(
-                            lat1_deriv_vals, deriv_fields,
-                            latitude, "lat",
-                            Itime, Idepth, Ilat, Ilon,
-                            Ntime, Ndepth, Nlat, Nlon,
-                            mask, 1);
-
-                    // Second lat derivative
-                    spher_derivative_at_point(
-                            lat2_deriv_vals, deriv_fields,
-                            latitude, "lat",
-                            Itime, Idepth, Ilat, Ilon,
-                            Ntime, Ndepth, Nlat, Nlon,
-                            mask, 2);
+                    if (use_ops) {
+                        d2Fdlon2 = d2Fdlon2_all[index];
+                        d1Fdlat1 = d1Fdlat1_all[index];
+                        d2Fdlat2 = d2Fdlat2_all[index];
+                    } else {
+                        // Second lon derivative
+                        spher_derivative_at_point(
+                                lon2_deriv_vals, deriv_fields,
+                                longitude, "lon",
+                                Itime, Idepth, Ilat, Ilon,
+                                Ntime, Ndepth, Nlat, Nlon,
+                                mask, 2);
+
+                        // First lat derivative
+                        spher_derivative_at_point(
+                                lat1_deriv_vals, deriv_fields,
+                                latitude, "lat",
+                                Itime, Idepth, Ilat, Ilon,
+                                Ntime, Ndepth, Nlat, Nlon,
+                                mask, 1);
+
+                        // Second lat derivative
+                        spher_derivative_at_point(
+                                lat2_deriv_vals, deriv_fields,
+                                latitude, "lat",
+                                Itime, Idepth, Ilat, Ilon,
+                                Ntime, Ndepth, Nlat, Nlon,
+                                mask, 2);
+                    }
 
                     // If we're too close to the pole (less than 0.01 degrees), bad things happen
                     is_pole = std::fabs( std::fabs( latitude.at(Ilat) * 180.0 / M_PI ) - 90 ) < 0.01;
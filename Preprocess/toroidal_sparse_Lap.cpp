@@ -24,6 +24,8 @@
  * @param[in]       Itime,Idepth            Current time-depth iteration
  * @param[in]       mask                    Array to distinguish land/water
  * @param[in]       area_weight             Bool indicating if the Laplacian should be weighted by cell-size (i.e. weight error by cell size). Default is false.
+ * @param[in]       row_skip,column_skip    Offsets at which to place the block in Lap
+ * @param[in]       ops                     (optional) derivative operators (with second derivatives) for this mask, built here if not provided
  *
  */
 void toroidal_sparse_Lap(
@@ -34,7 +36,8 @@ void toroidal_sparse_Lap(
         const std::vector<bool>   & mask,
         const bool area_weight,
         const size_t row_skip,
-        const size_t column_skip
+        const size_t column_skip,
+        const spherical_derivative_operators * ops
         ) {
 
     const std::vector<double>   &latitude   = source_data.latitude,
@@ -48,10 +51,18 @@ void toroidal_sparse_Lap(
                 Nlat    = myCounts.at(2),
                 Nlon    = myCounts.at(3);
 
-    int Ilat, Ilon, IDIFF, Idiff, Ndiff, LB;
+    // The stencils are the same as from get_diff_vector (including the back-up plans)
+    spherical_derivative_operators local_ops;
+    if ( (ops == NULL) or not( ops->applies_to( longitude, latitude, mask, true ) ) ) {
+        local_ops.build( longitude, latitude, Ntime, Ndepth, Nlat, Nlon, mask, true );
+        ops = &local_ops;
+    }
+
+    int Ilat, Ilon, Idiff, Ndiff;
     size_t index, index_sub, diff_index;
     double old_val, tmp, cos2_lat_inv, tan_lat;
-    std::vector<double> diff_vec;
+    const long *diff_offsets;
+    const double *diff_coeffs;
     bool is_pole;
 
     const double R2_inv = 1. / pow(constants::R_earth, 2);
@@ -70,33 +81,22 @@ void toroidal_sparse_Lap(
 
             if ( (mask.at(index)) and not(is_pole) ) { // Skip land areas and poles
 
+                // The stencils stay within the time-depth slice, so the offsets also apply to index_sub
+
                 //
                 //// LON second derivative part
                 //
 
-                LB = - 2 * Nlon;
-                get_diff_vector(diff_vec, LB, longitude, "lon",
-                                Itime, Idepth, Ilat, Ilon,
-                                Ntime, Ndepth, Nlat, Nlon,
-                                mask, 2, constants::DiffOrd);
-
-                Ndiff = diff_vec.size();
-
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlon) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
-
-                        if (constants::PERIODIC_X) { Idiff = ( IDIFF % Nlon + Nlon ) % Nlon; }
-                        else                       { Idiff = IDIFF;                          }
+                Ndiff = ops->d2dlon2.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                        diff_index = Index(0, 0, Ilat, Idiff, 1, 1, Nlat, Nlon);
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                        tmp = diff_vec.at(IDIFF-LB) * cos2_lat_inv * R2_inv;
-                        if (area_weight) { tmp *= areas.at(index_sub); }
+                    tmp = diff_coeffs[Idiff] * cos2_lat_inv * R2_inv;
+                    if (area_weight) { tmp *= areas.at(index_sub); }
 
-                        old_val = sparseget(Lap, row_skip + index_sub, column_skip + diff_index);
-                        alglib::sparseset(  Lap, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
-                    }
+                    old_val = sparseget(Lap, row_skip + index_sub, column_skip + diff_index);
+                    alglib::sparseset(  Lap, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
                 }
 
 
@@ -104,29 +104,16 @@ void toroidal_sparse_Lap(
                 //// LAT second derivative part
                 //
 
-                LB = -2 * Nlat;
-                get_diff_vector(diff_vec, LB, latitude, "lat",
-                                Itime, Idepth, Ilat, Ilon,
-                                Ntime, Ndepth, Nlat, Nlon,
-                                mask, 2, constants::DiffOrd);
+                Ndiff = ops->d2dlat2.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                Ndiff = diff_vec.size();
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlat) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
+                    tmp = diff_coeffs[Idiff] * R2_inv;
+                    if (area_weight) { tmp *= areas.at(index_sub); }
 
-                        if (constants::PERIODIC_Y) { Idiff = ( IDIFF % Nlat + Nlat ) % Nlat; }
-                        else                       { Idiff = IDIFF;                          }
-
-                        diff_index = Index(0, 0, Idiff, Ilon, 1, 1, Nlat,  Nlon);
-
-                        tmp = diff_vec.at(IDIFF-LB) * R2_inv;
-                        if (area_weight) { tmp *= areas.at(index_sub); }
-
-                        old_val = sparseget(Lap, row_skip + index_sub, column_skip + diff_index);
-                        alglib::sparseset(  Lap, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
-                    }
+                    old_val = sparseget(Lap, row_skip + index_sub, column_skip + diff_index);
+                    alglib::sparseset(  Lap, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
                 }
 
 
@@ -134,29 +121,16 @@ void toroidal_sparse_Lap(
                 //// LAT first derivative part
                 //
 
-                LB = - 2 * Nlat;
-                get_diff_vector(diff_vec, LB, latitude, "lat",
-                                Itime, Idepth, Ilat, Ilon,
-                                Ntime, Ndepth, Nlat, Nlon,
-                                mask, 1, constants::DiffOrd);
-
-                Ndiff = diff_vec.size();
-
-                // If LB is unchanged, then we failed to build a stencil
-                if (LB != - 2 * Nlat) {
-                    for ( IDIFF = LB; IDIFF < LB + Ndiff; IDIFF++ ) {
-
-                        if (constants::PERIODIC_Y) { Idiff = ( IDIFF % Nlat + Nlat ) % Nlat; }
-                        else                       { Idiff = IDIFF;                          }
+                Ndiff = ops->ddlat.stencil_at( index, diff_offsets, diff_coeffs );
+                for ( Idiff = 0; Idiff < Ndiff; Idiff++ ) {
 
-                        diff_index = Index(0, 0, Idiff, Ilon, 1, 1, Nlat,  Nlon);
+                    diff_index = index_sub + diff_offsets[Idiff];
 
-                        tmp = - diff_vec.at(IDIFF-LB) * tan_lat * R2_inv;
-                        if (area_weight) { tmp *= areas.at(index_sub); }
+                    tmp = - diff_coeffs[Idiff] * tan_lat * R2_inv;
+                    if (area_weight) { tmp *= areas.at(index_sub); }
 
-                        old_val = sparseget(Lap, row_skip + index_sub, column_skip + diff_index);
-                        alglib::sparseset(  Lap, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
-                    }
+                    old_val = sparseget(Lap, row_skip + index_sub, column_skip + diff_index);
+                    alglib::sparseset(  Lap, row_skip + index_sub, column_skip + diff_index, old_val + tmp);
                 }
             } else { // end mask if
                 // If this spot is masked, then set the value to 1
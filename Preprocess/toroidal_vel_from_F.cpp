@@ -16,7 +16,8 @@ void toroidal_vel_from_F(
         const int Ndepth,
         const int Nlat,
         const int Nlon,
-        const std::vector<bool> & mask
+        const std::vector<bool> & mask,
+        const spherical_derivative_operators * ops
     ) {
 
     int Itime, Idepth, Ilat, Ilon, index;
@@ -27,12 +28,20 @@ void toroidal_vel_from_F(
 
     deriv_fields.push_back(&F);
 
+    // If the operators were built for this grid and mask, take the derivatives for all points at once
+    const bool use_ops = ( ops != NULL ) and ops->applies_to( longitude, latitude, mask );
+    std::vector<double> dFdlon_all, dFdlat_all;
+    if (use_ops) {
+        ops->ddlon.apply( dFdlon_all, F );
+        ops->ddlat.apply( dFdlat_all, F );
+    }
+
     #pragma omp parallel \
     default(none) \
-    shared( latitude, longitude, mask, F, vel_lon, vel_lat, deriv_fields)\
+    shared( latitude, longitude, mask, F, vel_lon, vel_lat, deriv_fields, dFdlon_all, dFdlat_all )\
     private(Itime, Idepth, Ilat, Ilon, index, cos_lat, tmp_lon, tmp_lat, \
             dFdlon, dFdlat, lon_deriv_vals, lat_deriv_vals, is_pole) \
-    firstprivate( Nlon, Nlat, Ndepth, Ntime )
+    firstprivate( Nlon, Nlat, Ndepth, Ntime, use_ops )
     {
 
         lon_deriv_vals.push_back(&dFdlon);
@@ -49,19 +58,24 @@ void toroidal_vel_from_F(
                 Index1to4(index, Itime, Idepth, Ilat, Ilon,
                                  Ntime, Ndepth, Nlat, Nlon);
 
-                spher_derivative_at_point(
-                        lon_deriv_vals, deriv_fields,
-                        longitude, "lon",
-                        Itime, Idepth, Ilat, Ilon,
-                        Ntime, Ndepth, Nlat, Nlon,
-                        mask);
+                if (use_ops) {
+                    dFdlon = dFdlon_all[index];
+                    dFdlat = dFdlat_all[index];
+                } else {
+                    spher_derivative_at_point<diff_dim::lon, 1, constants::DiffOrd>(
+                            lon_deriv_vals, deriv_fields,
+                            longitude,
+                            Itime, Idepth, Ilat, Ilon,
+                            Ntime, Ndepth, Nlat, Nlon,
+                            mask);
 
-                spher_derivative_at_point(
-                        lat_deriv_vals, deriv_fields,
-                        latitude, "lat",
-                        Itime, Idepth, Ilat, Ilon,
-                        Ntime, Ndepth, Nlat, Nlon,
-                        mask);
+                    spher_derivative_at_point<diff_dim::lat, 1, constants::DiffOrd>(
+                            lat_deriv_vals, deriv_fields,
+                            latitude,
+                            Itime, Idepth, Ilat, Ilon,
+                            Ntime, Ndepth, Nlat, Nlon,
+                            mask);
+                }
 
                 if (constants::CARTESIAN) {
                     tmp_lon = - dFdlat;
@@ -82,6 +82,7 @@ int main(int argc, char *argv[]) {
 
     std::vector<double> distances_slow( Nlat * Nlon, 0. ),
                         distances_fast( Nlat * Nlon, 0. ),
+                        distances_chord( Nlat * Nlon, 0. ),
                         times{ 0. },
                         depth{ 0. },
                         latitude( Nlat ),
@@ -120,10 +121,33 @@ int main(int argc, char *argv[]) {
     }
     const double fast_distance_stop_time = MPI_Wtime();
 
+    // Chord lengths between the unit vectors of the grid (as in compute_local_kernel)
+    grid_geometry geometry;
+    geometry.build( longitude, latitude );
+    const double    ref_x = cos(ref_lon) * cos(ref_lat),
+                    ref_y = sin(ref_lon) * cos(ref_lat),
+                    ref_z = sin(ref_lat);
+    const double chord_distance_start_time = MPI_Wtime();
+    for (index = 0; index < Nlat * Nlon; ++index) {
+        distances_chord.at(index) = grid_geometry::arc_from_chord_sq(
+                                          pow( geometry.r_hat_x.at(index) - ref_x, 2 )
+                                        + pow( geometry.r_hat_y.at(index) - ref_y, 2 )
+                                        + pow( geometry.r_hat_z.at(index) - ref_z, 2 ) );
+    }
+    const double chord_distance_stop_time = MPI_Wtime();
+
+    double max_chord_error = 0.;
+    for (index = 0; index < Nlat * Nlon; ++index) {
+        max_chord_error = std::max( max_chord_error, fabs( distances_chord.at(index) - distances_slow.at(index) ) );
+    }
+
 
     fprintf( stdout, "Timing Results  (Nlat, Nlon) = (%'d,%'d)\n\n", Nlat, Nlon );
     fprintf( stdout, " Simplified  calculation: %.13g \n", fast_distance_stop_time - fast_distance_start_time );
     fprintf( stdout, " Full stable calculation: %.13g \n", slow_distance_stop_time - slow_distance_start_time );
+    fprintf( stdout, " Chord (unit vectors)   : %.13g \n", chord_distance_stop_time - chord_distance_start_time );
+    fprintf( stdout, "\n" );
+    fprintf( stdout, " Max chord error (vs. full stable): %.4g m\n", max_chord_error );
     fprintf( stdout, "\n" );
 
     // Now write them to a file
@@ -141,6 +165,7 @@ int main(int argc, char *argv[]) {
     std::vector<std::string> vars_to_write;
     vars_to_write.push_back("distance_fast");
     vars_to_write.push_back("distance_slow");
+    vars_to_write.push_back("distance_chord");
 
     const std::string fname = "distance.nc";
     initialize_output_file( output_data, vars_to_write, fname.c_str() );
@@ -150,6 +175,7 @@ int main(int argc, char *argv[]) {
 
     write_field_to_output( distances_slow, "distance_slow", starts, counts, fname );
     write_field_to_output( distances_fast, "distance_fast", starts, counts, fname );
+    write_field_to_output( distances_chord, "distance_chord", starts, counts, fname );
 
     MPI_Finalize();
 
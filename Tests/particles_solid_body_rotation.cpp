@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <mpi.h>
+#include <omp.h>
+#include <assert.h>
+#include "../functions.hpp"
+#include "../constants.hpp"
+#include "../particles.hpp"
+
+// Solid-body rotation about the axis through (lon, lat) = (0, 0), with angular speed Omega
+//   The velocity is Omega x r, i.e. u_lon = - Omega R sin(lat) cos(lon) and u_lat = Omega R sin(lon),
+//   and each particle moves along a circle around (0, 0), so its position is known exactly at all times.
+void analytic_position(
+        double & lon_t,
+        double & lat_t,
+        const double lon0,
+        const double lat0,
+        const double angle
+        ) {
+
+    const double    x0 = cos(lat0) * cos(lon0),
+                    y0 = cos(lat0) * sin(lon0),
+                    z0 = sin(lat0);
+
+    const double    y = y0 * cos(angle) - z0 * sin(angle),
+                    z = y0 * sin(angle) + z0 * cos(angle);
+
+    lon_t = atan2( y, x0 );
+    lat_t = asin( std::max( -1., std::min( 1., z ) ) );
+}
+
+// Straight-line (chord) distance, in metres, between two points on the sphere
+//   distance() goes through an arccos, which can't resolve separations much below a metre,
+//   while the errors of interest here are millimetres
+double chord_distance(
+        const double lon1,
+        const double lat1,
+        const double lon2,
+        const double lat2
+        ) {
+
+    const double    dx = cos(lat1) * cos(lon1) - cos(lat2) * cos(lon2),
+                    dy = cos(lat1) * sin(lon1) - cos(lat2) * sin(lon2),
+                    dz = sin(lat1) - sin(lat2);
+
+    return constants::R_earth * sqrt( dx * dx + dy * dy + dz * dz );
+}
+
+// Advect the particles, and return the largest error (in metres) over all outputs,
+//   along with the mean number of steps per particle
+void run_integrator(
+        double & max_error,
+        double & mean_steps,
+        const int integrator,
+        const double tolerance,
+        const double Omega,
+        const std::vector<double> & target_times,
+        const std::vector<double> & starting_lat,
+        const std::vector<double> & starting_lon,
+        const std::vector<double> & u_lon,
+        const std::vector<double> & u_lat,
+        const std::vector<double> & time,
+        const std::vector<double> & latitude,
+        const std::vector<double> & longitude,
+        const std::vector<bool> & mask
+        ) {
+
+    const int   Nparts = starting_lat.size(),
+                Nouts  = target_times.size();
+
+    std::vector<const std::vector<double>*> fields_to_track;
+    std::vector<std::string> names_of_tracked_fields;
+    std::vector< std::vector<double> > field_trajectories, rev_field_trajectories;
+
+    std::vector<double> part_lon_hist( Nparts * Nouts, constants::fill_value ),
+                        part_lat_hist( Nparts * Nouts, constants::fill_value ),
+                        rev_part_lon_hist( Nparts * Nouts, constants::fill_value ),
+                        rev_part_lat_hist( Nparts * Nouts, constants::fill_value );
+    std::vector<int> steps_taken;
+
+    particles_evolve_trajectories(
+            part_lon_hist, part_lat_hist, rev_part_lon_hist, rev_part_lat_hist,
+            field_trajectories, rev_field_trajectories,
+            starting_lat, starting_lon, target_times, -1.,
+            u_lon, u_lat, fields_to_track, names_of_tracked_fields,
+            time, latitude, longitude, mask,
+            integrator, tolerance, &steps_taken );
+
+    double lon_t, lat_t, error;
+    max_error = 0.;
+    mean_steps = 0.;
+    for (int Ip = 0; Ip < Nparts; Ip++) {
+        for (int Iout = 0; Iout < Nouts; Iout++) {
+            const size_t index = Iout * Nparts + Ip;
+            analytic_position( lon_t, lat_t, starting_lon.at(Ip), starting_lat.at(Ip), Omega * target_times.at(Iout) );
+            if ( part_lon_hist.at(index) == constants::fill_value ) {
+                error = INFINITY;   // the particle was lost, or the output was missed
+            } else {
+                error = chord_distance( part_lon_hist.at(index), part_lat_hist.at(index), lon_t, lat_t );
+            }
+            max_error = std::max( max_error, error );
+        }
+        mean_steps += steps_taken.at(Ip) / (double) Nparts;
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    static_assert( not(constants::CARTESIAN), "Test only applicable to Spherical coordinates.\n" );
+
+    int thread_safety_provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_safety_provided);
+
+    int wRank=-1, wSize=-1;
+    MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
+    MPI_Comm_size( MPI_COMM_WORLD, &wSize );
+
+    assert(wSize==1);
+
+    fprintf(stdout, "Beginning solid-body rotation test for the particle integrators.\n");
+
+    // A small, fine (0.01 degree) patch around the rotation axis. The velocity is interpolated bilinearly
+    //   from the grid, which has a relative error of about dlon^2 / 8 (~ 4e-9) for this field, so that
+    //   the errors below come from the time integration, and not from the interpolation.
+    const int   Nlat = 300,
+                Nlon = 300,
+                Nparts = 16;
+
+    const double    dlat = 3. / Nlat * M_PI / 180.,
+                    dlon = 3. / Nlon * M_PI / 180.,
+                    Omega = 2. * M_PI / ( 24. * 3600. );  // one revolution per day
+
+    std::vector<double> latitude( Nlat ), longitude( Nlon ), time{ 0. };
+    for (int II = 0; II < Nlat; II++) { latitude.at( II) = - 1.5 * M_PI / 180. + (II + 0.5) * dlat; }
+    for (int II = 0; II < Nlon; II++) { longitude.at(II) = - 1.5 * M_PI / 180. + (II + 0.5) * dlon; }
+
+    std::vector<double> u_lon( Nlat * Nlon ), u_lat( Nlat * Nlon );
+    std::vector<bool> mask( Nlat * Nlon, true );
+    for (int Ilat = 0; Ilat < Nlat; Ilat++) {
+        for (int Ilon = 0; Ilon < Nlon; Ilon++) {
+            u_lon.at( Ilat * Nlon + Ilon ) = - Omega * constants::R_earth * sin( latitude.at(Ilat) ) * cos( longitude.at(Ilon) );
+            u_lat.at( Ilat * Nlon + Ilon ) =   Omega * constants::R_earth * sin( longitude.at(Ilon) );
+        }
+    }
+
+    // Starting positions on circles of 0.2 to 0.8 degrees (20 to 80 grid cells) around the axis,
+    //   i.e. speeds of 2 to 10 m/s
+    std::vector<double> starting_lat( Nparts ), starting_lon( Nparts );
+    for (int Ip = 0; Ip < Nparts; Ip++) {
+        const double    radius = ( 0.2 + 0.2 * ( Ip % 4 ) ) * M_PI / 180.,
+                        angle  = ( Ip / 4 ) * M_PI / 2. + 0.1234;
+        starting_lon.at(Ip) = radius * cos( angle );
+        starting_lat.at(Ip) = radius * sin( angle );
+    }
+
+    const int integrators[3] = {    constants::ParticleIntegratorType::ForwardEuler,
+                                    constants::ParticleIntegratorType::RK4,
+                                    constants::ParticleIntegratorType::RK45 };
+    const char * integrator_names[3] = { "Euler", "RK4", "RK45" };
+    double max_error, mean_steps;
+
+    //
+    //// Error control: one revolution, with outputs every three hours
+    //
+    const int Nouts = 9;
+    const double final_time = 24. * 3600.;
+    std::vector<double> target_times( Nouts );
+    for (int II = 0; II < Nouts; II++) { target_times.at(II) = II * final_time / (Nouts - 1); }
+
+    // The tolerance bounds the error of each step, and those errors accumulate over the
+    //   (roughly 30 to 60) steps of a revolution, so allow the global error a matching multiple
+    const int Ntols = 4;
+    const double tolerances[Ntols] = { 1e-3, 1e-2, 1e-1, 1. },
+                 error_factor = 50.;
+
+    fprintf(stdout, "\n %d particles, %g days, grid spacing %g degrees\n\n",
+            Nparts, final_time / (24. * 3600.), dlon * 180. / M_PI);
+    fprintf(stdout, " %-6s  %14s  %14s  %16s\n", "Scheme", "Tolerance (m)", "Max error (m)", "Steps / particle");
+
+    for (int Iint = 1; Iint < 3; Iint++) {
+        double prev_steps = INFINITY;
+        for (int Itol = 0; Itol < Ntols; Itol++) {
+            run_integrator( max_error, mean_steps, integrators[Iint], tolerances[Itol], Omega, target_times,
+                            starting_lat, starting_lon, u_lon, u_lat, time, latitude, longitude, mask );
+            fprintf(stdout, " %-6s  %14.4g  %14.4g  %16.1f\n", integrator_names[Iint], tolerances[Itol], max_error, mean_steps);
+
+            assert( max_error <= error_factor * tolerances[Itol] );
+            assert( mean_steps < prev_steps );  // looser tolerances take fewer steps
+            prev_steps = mean_steps;
+        }
+    }
+
+    //
+    //// Step counts against forward Euler, over a single hour (Euler needs millions of steps per particle)
+    //
+    const std::vector<double> short_times{ 0., 3600. };
+    double Euler_steps = 0.;
+    fprintf(stdout, "\n One hour, tolerance %g m\n\n", tolerances[1]);
+    fprintf(stdout, " %-6s  %14s  %16s\n", "Scheme", "Max error (m)", "Steps / particle");
+    for (int Iint = 0; Iint < 3; Iint++) {
+        run_integrator( max_error, mean_steps, integrators[Iint], tolerances[1], Omega, short_times,
+                        starting_lat, starting_lon, u_lon, u_lat, time, latitude, longitude, mask );
+        fprintf(stdout, " %-6s  %14.4g  %16.1f\n", integrator_names[Iint], max_error, mean_steps);
+
+        if (Iint == 0) { Euler_steps = mean_steps; }
+        else           { assert( mean_steps < Euler_steps ); }
+    }
+    fprintf(stdout, "\n");
+
+    MPI_Finalize();
+}
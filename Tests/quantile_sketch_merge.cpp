@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <math.h>
+#include <vector>
+#include <random>
+#include <mpi.h>
+#include <assert.h>
+#include "../functions.hpp"
+#include "../constants.hpp"
+
+// Largest difference between the requested quantile levels and the fraction of the (sorted) values
+//   that lie below the sketch estimates, i.e. the rank error
+double max_rank_error(
+        quantile_sketch & sketch,
+        const std::vector<double> & sorted_values,
+        const std::vector<double> & levels
+        ) {
+
+    double max_err = 0.;
+    for (size_t Iq = 0; Iq < levels.size(); Iq++) {
+        const double estimate = sketch.quantile( levels[Iq] );
+        const double rank = ( std::upper_bound( sorted_values.begin(), sorted_values.end(), estimate ) - sorted_values.begin() )
+                            / (double) sorted_values.size();
+        max_err = std::max( max_err, fabs( rank - levels[Iq] ) );
+    }
+    return max_err;
+}
+
+int main(int argc, char *argv[]) {
+
+    MPI_Init(&argc, &argv);
+
+    int wRank=-1, wSize=-1;
+    MPI_Comm_rank( MPI_COMM_WORLD, &wRank );
+    MPI_Comm_size( MPI_COMM_WORLD, &wSize );
+
+    // Same (seeded) values on every processor, so that each one knows the exact order statistics
+    const size_t Nvals = 200000;
+    const int Nparts = 4;
+    std::mt19937 generator( 12345 );
+    std::lognormal_distribution<double> lognormal( 0., 1. );
+    std::vector<double> values( Nvals );
+    for (size_t II = 0; II < Nvals; II++) { values[II] = lognormal( generator ); }
+
+    std::vector<double> sorted_values( values );
+    std::sort( sorted_values.begin(), sorted_values.end() );
+
+    const std::vector<double> levels{ 0.001, 0.01, 0.05, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999 };
+
+    // The rank error is roughly 1 / compression in the middle, and smaller towards the tails
+    const double tolerance = 1. / constants::QUANTILE_SKETCH_COMPRESSION;
+
+    //
+    //// Four sketches of interleaved parts of the values, merged through a flat buffer
+    //
+    std::vector<quantile_sketch> parts( Nparts );
+    for (size_t II = 0; II < Nvals; II++) { parts[ II % Nparts ].add( values[II] ); }
+
+    std::vector<double> buffer;
+    for (int Ipart = 0; Ipart < Nparts; Ipart++) { parts[Ipart].pack( buffer ); }
+
+    quantile_sketch merged;
+    size_t position = 0;
+    for (int Ipart = 0; Ipart < Nparts; Ipart++) { position = merged.unpack( buffer, position ); }
+    assert( position == buffer.size() );
+    assert( merged.total_weight() == (double) Nvals );
+
+    const double buffer_error = max_rank_error( merged, sorted_values, levels );
+    if (wRank == 0) { fprintf(stdout, "Max rank error after merging %d packed sketches: %g\n", Nparts, buffer_error); }
+    assert( buffer_error < tolerance );
+
+    //
+    //// The same, with the parts spread over the processors (run with 4 processors to match the above)
+    //
+    std::vector<quantile_sketch> local( 1 );
+    for (size_t II = wRank; II < Nvals; II += wSize) { local[0].add( values[II] ); }
+    merge_quantile_sketches( local, MPI_COMM_WORLD );
+    assert( local[0].total_weight() == (double) Nvals );
+
+    const double mpi_error = max_rank_error( local[0], sorted_values, levels );
+    if (wRank == 0) { fprintf(stdout, "Max rank error after merging over %d processors: %g\n", wSize, mpi_error); }
+    assert( mpi_error < tolerance );
+
+    // Every processor should end up with the same sketch
+    const double median = local[0].quantile( 0.5 );
+    double min_median, max_median;
+    MPI_Allreduce( &median, &min_median, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD );
+    MPI_Allreduce( &median, &max_median, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD );
+    assert( min_median == max_median );
+
+    MPI_Finalize();
+}
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 /*!
  * \param DEBUG
@@ -277,6 +278,17 @@ namespace constants
      */
     const bool CAST_TO_INT = false;
 
+    /*!
+     * \param READ_MEMORY_BUDGET
+     * \brief Largest single read (in bytes) requested from netcdf by read_var_from_file
+     *
+     * Larger reads are broken into chunks along the outermost dimension(s).
+     * Packed (short / float) variables are read natively through a buffer of at most this size.
+     *
+     * @ingroup constants
+     */
+    const size_t READ_MEMORY_BUDGET = 4 * ( (size_t) 512 * 512 * 512 ) * sizeof(double);
+
     /*!
      * \param DO_TIMING
      * \brief Boolean indicating if we want to output internal timings
@@ -305,6 +317,38 @@ namespace constants
      */
     const bool POSTPROCESS_DO_TIME_MEANS = false;
 
+    /*!
+     * \param POSTPROCESS_WRITE_TIME_STATISTICS
+     * \brief Boolean indicating whether the time means should also be written as mergeable statistics
+     *
+     * If true (and POSTPROCESS_DO_TIME_MEANS), the number of water times, the time mean, and the sum of
+     * squared deviations from it are written at each point to a separate file (see write_time_statistics).
+     * Files from runs over different times can then be combined with merge_time_statistics.x, e.g. to extend
+     * a climatology with new data without re-processing the whole record.
+     * @ingroup constants
+     */
+    const bool POSTPROCESS_WRITE_TIME_STATISTICS = false;
+
+    /*!
+     * \param POSTPROCESS_QUANTILES
+     * \brief Quantiles (between 0 and 1) that the postprocess routines report, zonally and over each region
+     *
+     * These are read from (area-weighted) quantile sketches, see quantile_sketch.
+     * Leave empty to skip the quantile outputs.
+     * @ingroup constants
+     */
+    const std::vector<double> POSTPROCESS_QUANTILES = { 0.05, 0.25, 0.5, 0.75, 0.95 };
+
+    /*!
+     * \param QUANTILE_SKETCH_COMPRESSION
+     * \brief Compression parameter for the quantile sketches (roughly the number of centroids kept)
+     *
+     * Larger values give more accurate quantiles (the rank error is roughly 1 / QUANTILE_SKETCH_COMPRESSION,
+     *   and smaller towards the tails) at the cost of memory and time.
+     * @ingroup constants
+     */
+    const double QUANTILE_SKETCH_COMPRESSION = 100.;
+
     /*!
      * \param KERNEL_OPT
      * \brief Integer flag indicating the choice of kernel
@@ -338,6 +382,25 @@ namespace constants
                            ( KERNEL_OPT == KernelType::HighOrder ) ? 2.5 :
                            -1;
 
+    /*!
+     * \param SEPARABLE_KERNEL
+     * \brief Boolean indicating whether or not to apply Gaussian kernels as two 1D passes (rows then columns)
+     *
+     * On uniform Cartesian grids, the Gaussian kernels factor as exp(-(x^2 + y^2)) = exp(-x^2) exp(-y^2),
+     * so filtering (in filtering) costs O(stencil) per point instead of O(stencil^2).
+     * The integration region is then the square around the usual circle (of radius (filt_scale/2) * KernPad),
+     * so results differ slightly from the direct kernel. Ignored for other grids or kernels.
+     *
+     * @ingroup constants
+     */
+    const bool SEPARABLE_KERNEL = false;
+
+    //! Whether or not SEPARABLE_KERNEL actually applies (see apply_separable_filter)
+    const bool USE_SEPARABLE_KERNEL =     SEPARABLE_KERNEL and CARTESIAN and UNIFORM_LON_GRID and UNIFORM_LAT_GRID 
+                                      and not(ZONAL_KERNEL_ONLY)
+                                      and (    ( KERNEL_OPT == KernelType::Gaussian ) 
+                                            or ( KERNEL_OPT == KernelType::JohnsonGaussian ) );
+
     /*!
      * \param PARTICLE_RECYCLE_TYPE
      * \brief Variable indicating what recycling scheme should be used for particles
@@ -346,6 +409,16 @@ namespace constants
     enum ParticleRecycleType : int { FixedInterval, Stochastic };
     const int PARTICLE_RECYCLE_TYPE = ParticleRecycleType::FixedInterval;
 
+    /*!
+     * \param ParticleIntegratorType
+     * \brief Time-stepping schemes for the particles (selected at run time, see particles_evolve_trajectories)
+     *
+     * ForwardEuler is the original operator-split scheme, with a fixed (small) CFL number.
+     * RK4 (with step doubling) and RK45 (Dormand-Prince) adapt the step size to a given tolerance.
+     * @ingroup constants
+     */
+    enum ParticleIntegratorType : int { ForwardEuler, RK4, RK45 };
+
 
     /*!
      * \param variable_descriptions
@@ -440,6 +513,15 @@ namespace constants
      */
     const std::string coarsened_map_description = "Full space-time map averaged onto a coarser lat/lon grid.";
 
+    /*!
+     * \param quantile_description
+     * \brief Human-friendly text that is added to all quantile variables in postprocessing outputs
+     *
+     * @ingroup constants
+     */
+    const std::string quantile_description = "Area-weighted quantiles (see quantile dimension) over each latitude band (zonal) or region (area). "
+                                             "The _all_times versions are over all times in the dataset.";
+
     /*!
      * \param OkuboWeiss_average_description
      * \brief Human-friendly text that is added to all OkuboWeiss-average variables in postprocessing outputs
@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <vector>
 #include <string>
+#include <math.h>
+#include <assert.h>
 #include "constants.hpp"
 #include "functions.hpp"
 
@@ -170,4 +172,464 @@ void get_diff_vector(
         const int diff_ord = constants::DiffOrd
         );
 
+//
+//// Compile-time versions
+//
+//      spher_derivative_at_point and get_diff_vector are called per point (and per field),
+//      so these versions take the dimension, derivative order, and convergence order
+//      as template parameters. There are no string comparisons or allocations, the grid
+//      is only walked once (the lower-order fall-backs just shrink that stencil), and the 
+//      fall-backs to lower orders are resolved at compile time.
+//
+//      They give exactly the same results as the run-time versions (which call these).
+//
+
+/*!
+ * \brief Dimension along which to differentiate (compile-time version of "depth", "lat", "lon")
+ */
+enum class diff_dim { depth, lat, lon };
+
+/*!
+ * \brief Convert the dimension name ("depth", "lat", "lon") into a diff_dim
+ */
+inline diff_dim diff_dim_from_string( const std::string & dim ) {
+    const bool do_dep = (dim == "depth");
+    const bool do_lat = (dim == "lat");
+    const bool do_lon = (dim == "lon");
+    assert( do_dep ^ (do_lat ^ do_lon) ); // ^ = xor
+    return do_dep ? diff_dim::depth : do_lat ? diff_dim::lat : diff_dim::lon;
+}
+
+/*!
+ * \brief Uniform-grid differentiation coefficients (see differentiation_vector)
+ *
+ * coeffs(index) gives the num_pts coefficients for the derivative at position index in the stencil, 
+ * which then need to be divided by ( delta^order_of_deriv * scale_factor() ).
+ *
+ */
+template <int order_of_deriv, int diff_ord> struct uniform_diff_stencil;
+
+template <> struct uniform_diff_stencil<1, 2> {
+    static const int num_pts = 3;
+    static double scale_factor() { return 1.; }
+    static const double * coeffs( const int index ) {
+        static const double table[num_pts][num_pts] = {
+            { -1.5,  2., -0.5 },
+            { -0.5,  0.,  0.5 },
+            {  0.5, -2.,  1.5 } };
+        return table[index];
+    }
+};
+
+template <> struct uniform_diff_stencil<2, 2> {
+    static const int num_pts = 4;
+    static double scale_factor() { return 1.; }
+    static const double * coeffs( const int index ) {
+        static const double table[num_pts][num_pts] = {
+            {  2., -5.,  4., -1. },
+            {  1., -2.,  1.,  0. },
+            {  0.,  1., -2.,  1. },
+            { -1.,  4., -5.,  2. } };
+        return table[index];
+    }
+};
+
+template <> struct uniform_diff_stencil<1, 3> {
+    static const int num_pts = 4;
+    static double scale_factor() { return 3.; }
+    static const double * coeffs( const int index ) {
+        static const double table[num_pts][num_pts] = {
+            {  -5.5,  9.,   -4.5,  1.  },
+            {  -1.,  -1.5,   3.,  -0.5 },
+            {   0.5, -3.,    1.5,  1.  },
+            {  -1.,   4.5,  -9.,   5.5 } };
+        return table[index];
+    }
+};
+
+template <> struct uniform_diff_stencil<2, 3> {
+    static const int num_pts = 5;
+    static double scale_factor() { return 3.; }
+    static const double * coeffs( const int index ) {
+        static const double table[num_pts][num_pts] = {
+            {   8.75, -26.  ,  28.5 , -14.  ,   2.75  },
+            {   2.75,  -5.  ,   1.5 ,   1.  ,  -0.25  },
+            {  -0.25,   4.  ,  -7.5 ,   4.  ,  -0.25  },
+            {  -0.25,   1.  ,   1.5 ,  -5.  ,   2.75  },
+            {   2.75, -14.  ,  28.5 , -26.  ,   8.75  } };
+        return table[index];
+    }
+};
+
+template <> struct uniform_diff_stencil<1, 4> {
+    static const int num_pts = 5;
+    static double scale_factor() { return 3.; }
+    static const double * coeffs( const int index ) {
+        static const double table[num_pts][num_pts] = {
+            { -6.25,  12.,  -9.,    4., -0.75 },
+            { -0.75, - 2.5,  4.5, - 1.5, 0.25 },
+            {  0.25, - 2.,   0.,    2., -0.25 },
+            { -0.25,   1.5, -4.5,   2.5, 0.75 },
+            {  0.75, - 4.,   9.,  -12.,  6.25 } };
+        return table[index];
+    }
+};
+
+template <> struct uniform_diff_stencil<2, 4> {
+    static const int num_pts = 6;
+    static double scale_factor() { return 12.; }
+    static const double * coeffs( const int index ) {
+        static const double table[num_pts][num_pts] = {
+            {  45., -154.,  214., -156.,  61.,  -10. },
+            {  10.,  -15.,    4.,   14.,  -6.,    1. },
+            {  -1.,   16.,  -30.,   16.,  -1.,    0. },
+            {  -0.,   -1.,   16.,  -30.,  16.,   -1. },
+            {   1.,   -6.,   14.,   -4., -15.,   10. },
+            { -10.,   61., -156.,  214., -154.,  45. } };
+        return table[index];
+    }
+};
+
+template <> struct uniform_diff_stencil<1, 6> {
+    static const int num_pts = 7;
+    static double scale_factor() { return 6.; }
+    static const double * coeffs( const int index ) {
+        static const double table[num_pts][num_pts] = {
+            { -14.7,  36. , -45. ,  40. , -22.5,   7.2,  -1. },
+            {  -1. ,  -7.7,  15. , -10. ,   5. ,  -1.5,   0.2},
+            {   0.2,  -2.4,  -3.5,   8. ,  -3. ,   0.8,  -0.1},
+            {  -0.1,   0.9,  -4.5,   0. ,   4.5,  -0.9,   0.1},
+            {   0.1,  -0.8,   3. ,  -8. ,   3.5,   2.4,  -0.2},
+            {  -0.2,   1.5,  -5. ,  10. , -15. ,   7.7,   1. },
+            {   1. ,  -7.2,  22.5, -40. ,  45. , -36. ,  14.7} };
+        return table[index];
+    }
+};
+
+template <> struct uniform_diff_stencil<2, 6> {
+    static const int num_pts = 8;
+    static double scale_factor() { return 9.; }
+    static const double * coeffs( const int index ) {
+        static const double table[num_pts][num_pts] = {
+            { 46.9, -200.7,  395.55,  -474.5,  369.,   -180.9,    50.95,  -6.3  },
+            {  6.3,   -3.5,  -24.3,    42.75,  -33.5,    16.2,    -4.5,    0.55 },
+            { -0.55,  10.7,  -18.9,     6.5,     4.25,   -2.7,     0.8,   -0.1  },
+            {  0.1,   -1.35,  13.5,   -24.5,    13.5,    -1.35,    0.1,    0.   },
+            {  0.,     0.1,   -1.35,   13.5,   -24.5,    13.5,    -1.35,   0.1  },
+            { -0.1,    0.8,   -2.7,     4.25,    6.5,   -18.9,    10.7,   -0.55 },
+            {  0.55,  -4.5,   16.2,   -33.5,    42.75,  -24.3,    -3.5,    6.3  },
+            { -6.3,   50.95, -180.9,  369.,    -474.5,  395.55, -200.7,   46.9  } };
+        return table[index];
+    }
+};
+
+/*!
+ * \brief Second-order first-derivative coefficients on a non-uniform grid (see non_uniform_diff_vector)
+ *
+ * @param[in,out]   diff_array  where to store the three coefficients
+ * @param[in]       grid        grid on which the derivative is taken
+ * @param[in]       Iref        index of the point at which you want the derivative
+ * @param[in]       LB,UB       bounds of the (three-point) stencil
+ *
+ */
+inline void non_uniform_first_deriv_coeffs(
+        double * diff_array,
+        const std::vector<double> & grid,
+        const int Iref,
+        const int LB,
+        const int UB
+        ) {
+    double c1, c2, c3, scale_factor;
+    const double    xn1 = grid[LB],
+                    x0  = grid[LB+1],
+                    xp1 = grid[UB];
+    if (Iref == LB) {
+        c2 = -1. / ( 0.5 * pow(x0  - xn1, 2.) );
+        c3 =  1. / ( 0.5 * pow(xp1 - xn1, 2.) );
+        c1 = -(c3 + c2);
+        scale_factor = (2/(xp1-xn1)) - (2/(x0-xn1));
+    } else if (Iref == UB) {
+        c1 = -1. / ( 0.5 * pow(xn1 - xp1, 2.) );
+        c2 =  1. / ( 0.5 * pow(x0  - xp1, 2.) );
+        c3 = -(c2 + c1);
+        scale_factor = (2/(x0-xp1)) - (2/(xn1-xp1));
+    } else {
+        c1 = -1. / ( 0.5 * pow(xn1 - x0, 2.) );
+        c3 =  1. / ( 0.5 * pow(xp1 - x0, 2.) );
+        c2 = -(c3 + c1);
+        scale_factor = (2/(xp1-x0)) - (2/(xn1-x0));
+    }
+    diff_array[0] = c1 / scale_factor;
+    diff_array[1] = c2 / scale_factor;
+    diff_array[2] = c3 / scale_factor;
+}
+
+/*!
+ * \brief Find the widest land-avoiding stencil that any order would use
+ *
+ * Builds outwards from Iref until hitting land, the edge of the (non-periodic) grid,
+ * or max_pts points on that side. The stencil for a particular order is then 
+ * obtained from this by collapse_stencil.
+ *
+ * @param[in,out]   LB_max,UB_max   widest stencil bounds (not periodicity-adjusted)
+ * @param[in]       Iref            index (along the dimension) of the point at which you want the derivative
+ * @param[in]       Nref            size of the dimension
+ * @param[in]       periodic        whether or not the dimension is periodic
+ * @param[in]       max_pts         number of points needed by the highest order stencil
+ * @param[in]       base_index      (flattened) index of the point with the same time, depth, lat, lon, except at position 0 along the dimension
+ * @param[in]       stride          distance between (flattened) indices of neighbouring points along the dimension
+ * @param[in]       mask            array to distinguish land/water cells
+ *
+ */
+inline void widest_stencil_bounds(
+        int & LB_max,
+        int & UB_max,
+        const int Iref,
+        const int Nref,
+        const bool periodic,
+        const int max_pts,
+        const size_t base_index,
+        const size_t stride,
+        const std::vector<bool> & mask
+        ) {
+
+    const int LLB = periodic ? Iref - Nref : 0 ;
+    const int UUB = periodic ? Iref + Nref : Nref - 1 ;
+
+    // lb / ub (lower case) are the periodicity-adjusted values of LB / UB
+    int lb, ub;
+    LB_max = Iref;
+    while ( (LB_max > LLB) and ( (Iref - LB_max) < max_pts ) ) {
+        lb = ( ( LB_max - 1 ) % Nref + Nref ) % Nref;
+        if ( mask[ base_index + lb * stride ] ) { LB_max--; } else { break; }
+    }
+
+    UB_max = Iref;
+    while ( (UB_max < UUB) and ( (UB_max - Iref) < max_pts ) ) {
+        ub = ( ( UB_max + 1 ) % Nref + Nref ) % Nref;
+        if ( mask[ base_index + ub * stride ] ) { UB_max++; } else { break; }
+    }
+}
+
+/*!
+ * \brief Restrict the widest stencil to the one used for num_pts points
+ *
+ * Gives the same stencil as building outwards from Iref for num_pts points, and then
+ * collapsing back down (preferring to keep the stencil centred), as spher_derivative_at_point does.
+ * The resulting stencil may have fewer than num_pts points, if there's not enough room.
+ *
+ */
+inline void collapse_stencil(
+        int & LB,
+        int & UB,
+        const int Iref,
+        const int LB_max,
+        const int UB_max,
+        const int num_pts
+        ) {
+
+    LB = ( LB_max > Iref - num_pts ) ? LB_max : Iref - num_pts;
+    UB = ( UB_max < Iref + num_pts ) ? UB_max : Iref + num_pts;
+
+    while (UB - LB + 1 > num_pts) {
+        if ((UB - Iref > Iref - LB) and (UB >= Iref)) { UB--; }
+        else { LB++; }
+    }
+}
+
+/*!
+ * \brief Land-avoiding differentiation stencil, with the fall-backs to lower orders resolved at compile time
+ *
+ * build() fills diff_array (which must have room for diff_ord + order_of_deriv values) with the coefficients
+ * for the highest order (starting at diff_ord, and lowering by two) for which there is room, and 
+ * returns the number of points in the stencil (or 0 if there was no room for even second order).
+ *
+ */
+template <diff_dim dim, int order_of_deriv, int diff_ord>
+struct spher_diff_stencil {
+
+    static int build(
+            double * diff_array,
+            int & LB,
+            const std::vector<double> & grid,
+            const int Iref,
+            const int LB_max,
+            const int UB_max
+            ) {
+
+        const int num_pts = diff_ord + order_of_deriv;
+
+        int UB;
+        collapse_stencil( LB, UB, Iref, LB_max, UB_max, num_pts );
+
+        if (UB - LB + 1 == num_pts) {
+            const bool uniform = (dim == diff_dim::lon) or ( (dim == diff_dim::lat) and constants::UNIFORM_LAT_GRID );
+            if ( uniform ) {
+                // Since we're on a uniform grid, we can use pre-computed
+                //   differentiation coefficients
+                const double dl = grid[1] - grid[0];
+                const double denom = pow(dl, order_of_deriv) * uniform_diff_stencil<order_of_deriv, diff_ord>::scale_factor();
+                const double * coeffs = uniform_diff_stencil<order_of_deriv, diff_ord>::coeffs( Iref - LB );
+                for (int II = 0; II < num_pts; II++) { diff_array[II] = coeffs[II] / denom; }
+            } else if ( (order_of_deriv == 1) and (diff_ord == 2) ) {
+                // NOTE: This CANNOT handle periodicity
+                non_uniform_first_deriv_coeffs( diff_array, grid, Iref, LB, UB );
+            } else {
+                // Not implemented (non_uniform_diff_vector will complain)
+                std::vector<double> ddl;
+                non_uniform_diff_vector( ddl, grid, Iref, LB, UB, diff_ord );
+                for (int II = 0; II < num_pts; II++) { diff_array[II] = ( II < (int) ddl.size() ) ? ddl[II] : 0.; }
+            }
+            return num_pts;
+        }
+
+        // If we couldn't build a large enough stencil, then 
+        //   try again with a lower order.
+        return spher_diff_stencil< dim, order_of_deriv, (diff_ord > 3) ? diff_ord - 2 : 0 >::build( 
+                diff_array, LB, grid, Iref, LB_max, UB_max );
+    }
+};
+
+// Nothing lower than second order
+template <diff_dim dim, int order_of_deriv>
+struct spher_diff_stencil<dim, order_of_deriv, 0> {
+    static int build( double *, int &, const std::vector<double> &, const int, const int, const int ) { return 0; }
+};
+
+/*!
+ * \brief Position along the differentiation dimension, and (flattened) index information for walking along it
+ */
+template <diff_dim dim>
+inline void diff_dim_indexing(
+        int & Iref,
+        size_t & base_index,
+        size_t & stride,
+        const int Itime, const int Idepth, const int Ilat, const int Ilon,
+        const int Ntime, const int Ndepth, const int Nlat, const int Nlon
+        ) {
+    Iref   = (dim == diff_dim::depth) ? Idepth : (dim == diff_dim::lat) ? Ilat : Ilon;
+    stride = (dim == diff_dim::lon)   ? 1      : (dim == diff_dim::lat) ? (size_t) Nlon : (size_t) Nlat * Nlon;
+    base_index = Index( Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon ) - Iref * stride;
+}
+
+/*!
+ * \brief Compile-time version of spher_derivative_at_point (same arguments, without dim, order_of_deriv, and diff_ord)
+ */
+template <diff_dim dim, int order_of_deriv, int diff_ord>
+void spher_derivative_at_point(
+        const std::vector<double*> & deriv_vals,
+        const std::vector<const std::vector<double>*> & fields,
+        const std::vector<double> & grid,
+        const int Itime, const int Idepth, const int Ilat, const int Ilon,
+        const int Ntime, const int Ndepth, const int Nlat, const int Nlon,
+        const std::vector<bool> & mask
+        ) {
+
+    // Confirm that input sizes match
+    assert(deriv_vals.size() == fields.size());
+    const int num_deriv = deriv_vals.size();
+
+    // Zero out before computing
+    for (int ii = 0; ii < num_deriv; ii++) {
+        if (deriv_vals[ii] != NULL) { *(deriv_vals[ii]) = 0.; }
+    }
+
+    // If it's a singleton dimension, just return zeros
+    const int Nref = grid.size();
+    if (Nref == 1) { return; }
+
+    const bool periodic = (dim == diff_dim::lat) ? constants::PERIODIC_Y : 
+                          (dim == diff_dim::lon) ? constants::PERIODIC_X : false;
+
+    int Iref, LB_max, UB_max, LB;
+    size_t base_index, stride;
+    diff_dim_indexing<dim>( Iref, base_index, stride, Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon );
+
+    widest_stencil_bounds( LB_max, UB_max, Iref, Nref, periodic, diff_ord + order_of_deriv, base_index, stride, mask );
+
+    double ddl[ diff_ord + order_of_deriv ];
+    const int num_pts = spher_diff_stencil<dim, order_of_deriv, diff_ord>::build( ddl, LB, grid, Iref, LB_max, UB_max );
+
+    int ind;
+    size_t index;
+    for (int IND = LB; IND < LB + num_pts; IND++) {
+
+        // Apply periodicity adjustment 
+        //   (has no effect for non-periodic, since then LB >= 0 and UB < Nref)
+        ind = ( IND % Nref + Nref ) % Nref;
+        index = base_index + ind * stride;
+
+        for (int ii = 0; ii < num_deriv; ii++) {
+            if (deriv_vals[ii] != NULL) {
+                *(deriv_vals[ii]) += (*fields[ii])[index] * ddl[IND - LB];
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Compile-time version of get_diff_vector
+ *
+ * Stores the coefficients in diff_array (which must have room for diff_ord + order_of_deriv values),
+ * and returns the number of coefficients (0 if no stencil could be built).
+ */
+template <diff_dim dim, int order_of_deriv, int diff_ord>
+int get_diff_vector(
+        double * diff_array,
+        int & LB_ret,
+        const std::vector<double> & grid,
+        const int Itime, const int Idepth, const int Ilat, const int Ilon,
+        const int Ntime, const int Ndepth, const int Nlat, const int Nlon,
+        const std::vector<bool> & mask
+        ) {
+
+    const int Nref = grid.size();
+    const bool periodic = (dim == diff_dim::lat) ? constants::PERIODIC_Y : 
+                          (dim == diff_dim::lon) ? constants::PERIODIC_X : false;
+
+    int Iref, LB_max, UB_max, LB, UB;
+    size_t base_index, stride;
+    diff_dim_indexing<dim>( Iref, base_index, stride, Itime, Idepth, Ilat, Ilon, Ntime, Ndepth, Nlat, Nlon );
+
+    widest_stencil_bounds( LB_max, UB_max, Iref, Nref, periodic, diff_ord + order_of_deriv, base_index, stride, mask );
+
+    const int num_pts = spher_diff_stencil<dim, order_of_deriv, diff_ord>::build( diff_array, LB, grid, Iref, LB_max, UB_max );
+    if (num_pts > 0) {
+        LB_ret = LB;
+        return num_pts;
+    }
+
+    // Some back-up plans, in the case nothing else worked
+    //   (using the stencil that the second order method would have used)
+    collapse_stencil( LB, UB, Iref, LB_max, UB_max, 2 + order_of_deriv );
+    const bool uniform = (dim == diff_dim::lon) or ( (dim == diff_dim::lat) and constants::UNIFORM_LAT_GRID );
+
+    // Back-up plan 1: first derivative with two points?
+    //                 then use a first-order derivative
+    //                 (not great, but better than nothing (hopefully))
+    if ( (order_of_deriv == 1) and (UB - LB + 1 == 2)) {
+        const double dl = grid[1] - grid[0];
+        diff_array[0] = -1. / dl;
+        diff_array[1] =  1. / dl;
+        LB_ret = LB;
+        return 2;
+    }
+
+    // Back-up plan 2: second derivative with only three points?
+    //                 assume the second derivative is constant on those
+    //                 three points, and use a classic (1, -2, 1) stencil
+    //                 (not great, but better than nothing (hopefully))
+    //                 For now require uniform grid
+    if ( (order_of_deriv == 2) and (UB - LB + 1 == 3) and uniform ) {
+        const double dl = grid[1] - grid[0];
+        diff_array[0] =  1. / pow(dl, 2.);
+        diff_array[1] = -2. / pow(dl, 2.);
+        diff_array[2] =  1. / pow(dl, 2.);
+        LB_ret = LB;
+        return 3;
+    }
+
+    return 0;
+}
+
 #endif
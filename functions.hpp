@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <vector>
 #include <string>
 #include <map>
@@ -14,6 +15,399 @@
  * \brief Collection of all computation-related functions.
  */
 
+/*!
+ * \brief Pre-computed finite-difference stencils for derivatives along one dimension.
+ *
+ * For every point, spher_derivative_at_point searches through the mask for the
+ * stencil bounds and then rebuilds the differentiation coefficients. Since these only
+ * depend on the grid, the mask, and the derivative order, this class does that once
+ * (in build) and stores the stencils (offsets into the flattened arrays, and coefficients)
+ * in flat arrays, so that taking a derivative is just a gather-multiply.
+ *
+ * Only the distinct stencils are stored (each point just stores which one it uses), and
+ * if the mask is the same at every time then the points are only stored for the first time.
+ *
+ * The results are identical to spher_derivative_at_point.
+ * Note that the mask is tracked by address, so if it is changed after building, then build needs
+ * to be called again.
+ *
+ * If built with_backups, then the points where get_diff_vector would fall back to its back-up
+ * plans (two-point first derivatives, three-point second derivatives) also get those stencils.
+ * They are only visible through stencil_at (which is what the sparse matrices are built from), 
+ * and are skipped by apply and apply_at_point, so the derivatives still match spher_derivative_at_point.
+ *
+ * See dataset::build_derivative_operators and spherical_derivative_operators
+ */
+class differentiation_operator {
+
+    public:
+
+        bool built = false;
+
+        /*!
+         * \brief Build the stencils.
+         *
+         * @param[in]   grid                    grid along which to differentiate
+         * @param[in]   dim                     "lon", "lat", or "depth"
+         * @param[in]   Ntime,Ndepth,Nlat,Nlon  sizes of the (MPI-local) dimensions
+         * @param[in]   mask                    mask to distinguish land/water cells
+         * @param[in]   order_of_deriv          order of the derivative
+         * @param[in]   diff_ord                convergence order (default is specified in constants.hpp)
+         */
+        void build( const std::vector<double> & grid,
+                    const std::string & dim,
+                    const int Ntime, const int Ndepth, const int Nlat, const int Nlon,
+                    const std::vector<bool> & mask,
+                    const int order_of_deriv = 1,
+                    const int diff_ord = constants::DiffOrd,
+                    const bool with_backups = false );
+
+        // Indicates if the stencils were built for this grid, mask, and derivative order
+        bool applies_to( const std::vector<double> & grid_in, 
+                         const std::vector<bool> & mask_in, 
+                         const int order_of_deriv_in, 
+                         const int diff_ord_in ) const {
+            return built and ( &grid_in == grid_ptr ) and ( &mask_in == mask_ptr ) and ( mask_in.size() == mask_size )
+                         and ( order_of_deriv_in == order_of_deriv ) and ( diff_ord_in == diff_ord );
+        }
+
+        // Indicates if the back-up stencils (see get_diff_vector) are available through stencil_at
+        bool has_backups() const { return built and with_backups; }
+
+        // Same conventions as spher_derivative_at_point, with index the (MPI-local) flattened index of the point
+        inline void apply_at_point( const std::vector<double*> & deriv_vals,
+                                    const std::vector<const std::vector<double>*> & fields,
+                                    const size_t index ) const {
+            const size_t num_deriv = deriv_vals.size();
+            for (size_t ii = 0; ii < num_deriv; ii++) {
+                if (deriv_vals[ii] != NULL) { *(deriv_vals[ii]) = 0.; }
+            }
+
+            const int sid = stencil_id[ time_invariant ? index % points_per_time : index ];
+            if (sid < 0) { return; }
+
+            for (size_t kk = stencil_start[sid]; kk < stencil_start[sid+1]; kk++) {
+                const size_t pt = index + stencil_offset[kk];
+                const double coeff = stencil_coeff[kk];
+                for (size_t ii = 0; ii < num_deriv; ii++) {
+                    if (deriv_vals[ii] != NULL) { *(deriv_vals[ii]) += (*fields[ii])[pt] * coeff; }
+                }
+            }
+        }
+
+        /*!
+         * \brief Stencil used at a point, as offsets into the flattened arrays and coefficients
+         *
+         * Returns the number of points in the stencil (0 if there isn't one). These are the stencils that 
+         * get_diff_vector would return, so the back-up stencils are included if they were built.
+         */
+        inline int stencil_at( const size_t index, const long * & offsets, const double * & coeffs ) const {
+            int sid = stencil_id[ time_invariant ? index % points_per_time : index ];
+            if (sid < -1) { sid = -2 - sid; } // back-up stencil
+            if (sid < 0) { return 0; }
+            offsets = &stencil_offset[ stencil_start[sid] ];
+            coeffs  = &stencil_coeff[  stencil_start[sid] ];
+            return stencil_start[sid+1] - stencil_start[sid];
+        }
+
+        // Differentiate a full (MPI-local) field
+        void apply( std::vector<double> & deriv, const std::vector<double> & field ) const;
+
+        // Differentiate several fields at once (all of the same size, which can be smaller than the 
+        //   mask if they only cover the first time(s) / depth(s)), so that each stencil is read once
+        void apply( const std::vector<std::vector<double>*> & derivs, 
+                    const std::vector<const std::vector<double>*> & fields ) const;
+
+        // Number of distinct stencils
+        size_t num_stencils() const { return stencil_start.empty() ? 0 : stencil_start.size() - 1; }
+
+    private:
+
+        const std::vector<double> * grid_ptr = NULL;
+        const std::vector<bool> * mask_ptr = NULL;
+        size_t mask_size = 0, points_per_time = 0;
+        int order_of_deriv = -1, diff_ord = -1;
+        bool time_invariant = false, with_backups = false;
+
+        // Which stencil each point uses (-1 if the derivative is zero, and -2 - id for back-up stencils)
+        std::vector<int> stencil_id;
+
+        // The distinct stencils, with stencil ii in [ stencil_start[ii], stencil_start[ii+1] )
+        std::vector<size_t> stencil_start;
+        std::vector<long> stencil_offset;
+        std::vector<double> stencil_coeff;
+};
+
+/*!
+ * \brief The horizontal derivative operators on the sphere, built once for a grid and mask.
+ *
+ * These are the building blocks of the velocity-from-potential matrices (sparse_vel_from_PsiPhi)
+ * and of the Laplacian (toroidal_sparse_Lap, toroidal_Lap_F), which is applied as
+ * \f$ \nabla^2 F = \left( F_{\lambda\lambda} / \cos^2\phi + F_{\phi\phi} - \tan\phi F_\phi \right) / R^2 \f$ .
+ * The sparse matrices are assembled from stencil_at, and the derivatives of fields (e.g. in 
+ * toroidal_vel_from_F) are taken with the batched apply, instead of rebuilding the stencils point by point.
+ *
+ * All of the operators are built with the get_diff_vector back-up stencils (see differentiation_operator).
+ */
+class spherical_derivative_operators {
+
+    public:
+
+        differentiation_operator ddlon, ddlat, d2dlon2, d2dlat2;
+
+        void build( const std::vector<double> & longitude,
+                    const std::vector<double> & latitude,
+                    const int Ntime, const int Ndepth, const int Nlat, const int Nlon,
+                    const std::vector<bool> & mask,
+                    const bool second_derivs = true );
+
+        // Indicates if the operators were built for this grid and mask
+        bool applies_to( const std::vector<double> & longitude,
+                         const std::vector<double> & latitude,
+                         const std::vector<bool> & mask,
+                         const bool second_derivs = false ) const {
+            return     ddlon.applies_to( longitude, mask, 1, constants::DiffOrd ) and ddlon.has_backups()
+                   and ddlat.applies_to( latitude,  mask, 1, constants::DiffOrd ) and ddlat.has_backups()
+                   and (    not(second_derivs) 
+                         or (     d2dlon2.applies_to( longitude, mask, 2, constants::DiffOrd ) and d2dlon2.has_backups()
+                              and d2dlat2.applies_to( latitude,  mask, 2, constants::DiffOrd ) and d2dlat2.has_backups() ) );
+        }
+};
+
+/*!
+ * \brief Trigonometry of the (horizontal) grid, computed once.
+ *
+ * The coordinate transforms (vel_Spher_to_Cart, vel_Cart_to_Spher) and the kernel distances
+ * (compute_local_kernel) only ever need sin / cos of the grid latitudes and longitudes, so
+ * these are stored here instead of being recomputed at every point for every call.
+ *
+ * Like differentiation_operator, the grid is tracked by address, so if the longitude / latitude
+ * are changed after building (e.g. converted to radians, or extended to the poles), then build
+ * needs to be called again (dataset::compute_cell_areas does this).
+ */
+class grid_geometry {
+
+    public:
+
+        bool built = false;
+
+        // sin / cos of each latitude (size Nlat) and longitude (size Nlon)
+        std::vector<double> cos_lat, sin_lat, cos_lon, sin_lon;
+
+        // Unit position vectors (size Nlat * Nlon, lon fastest)
+        std::vector<double> r_hat_x, r_hat_y, r_hat_z;
+
+        void build( const std::vector<double> & longitude, const std::vector<double> & latitude );
+
+        // Indicates if the cache was built for this grid
+        bool applies_to( const std::vector<double> & longitude, const std::vector<double> & latitude ) const {
+            return built and ( &longitude == lon_ptr ) and ( &latitude == lat_ptr )
+                         and ( longitude.size() == cos_lon.size() ) and ( latitude.size() == cos_lat.size() );
+        }
+
+        /*!
+         * \brief Great-circle distance (in metres) between two grid points
+         *
+         * Only for spherical coordinates. Computed from the chord between the unit vectors
+         * (see arc_from_chord_sq), so without any trig calls other than one asin.
+         */
+        inline double distance_between( const int Ilat1, const int Ilon1, const int Ilat2, const int Ilon2 ) const {
+            const size_t ind1 = (size_t) Ilat1 * cos_lon.size() + Ilon1,
+                         ind2 = (size_t) Ilat2 * cos_lon.size() + Ilon2;
+            const double dx = r_hat_x[ind1] - r_hat_x[ind2],
+                         dy = r_hat_y[ind1] - r_hat_y[ind2],
+                         dz = r_hat_z[ind1] - r_hat_z[ind2];
+            return arc_from_chord_sq( dx * dx + dy * dy + dz * dz );
+        }
+
+        /*!
+         * \brief Great-circle distance (in metres) from the squared chord length between two unit vectors
+         *
+         * Unlike acos of the dot product, this is well-conditioned for short distances (it is the
+         * haversine formula), and agrees with the high-precision version of distance() to rounding
+         * except within a few metres of antipodal points. It only needs one asin, so it vectorizes
+         * (see compute_local_kernel).
+         */
+        static inline double arc_from_chord_sq( const double chord_sq ) {
+            return 2. * constants::R_earth * asin( fmin( 1., 0.5 * sqrt( chord_sq ) ) );
+        }
+
+        static double great_circle_distance( const long double cos_lat1, const long double sin_lat1,
+                                             const long double cos_lat2, const long double sin_lat2,
+                                             const long double cos_Delta_lon, const long double sin_Delta_lon );
+
+    private:
+
+        const std::vector<double> * lon_ptr = NULL;
+        const std::vector<double> * lat_ptr = NULL;
+};
+
+/*!
+ * \brief Sparse fine-to-coarse (horizontal) remapping operator, built once per pair of grids.
+ *
+ * Each coarse cell (Ilat_coarse * Nlon_coarse + Ilon_coarse) is the weighted average of a box of
+ * fine cells (Ilat * Nlon + Ilon), with weights given by the fine cell areas (or one, to simply count
+ * cells). The boxes are given as index ranges along each dimension, so finding them only takes one
+ * search per coarse latitude and longitude, instead of one per coarse cell, time, depth, and field.
+ *
+ * Since the mask can change with time and depth, apply only uses the water cells, normalizing by
+ * their total weight (which it also returns), and handles all of the fields in the same pass.
+ *
+ * Used for the coarsened maps (see dataset::coarse_map_operator) and by coarsen_grid_linear.
+ */
+class remap_operator {
+
+    public:
+
+        bool built = false;
+
+        int Nlat_fine = 0, Nlon_fine = 0, Nlat_coarse = 0, Nlon_coarse = 0;
+
+        // The fine cells (and their weights) of coarse cell I are columns / weights[ row_starts[I] ], ..., [ row_starts[I+1] - 1 ]
+        std::vector<size_t> row_starts, columns;
+        std::vector<double> weights;
+
+        // Total weight of each coarse cell (including land)
+        std::vector<double> row_weights;
+
+        /*!
+         * \brief Build the operator from the (half-open) fine index ranges [first, last) of each coarse latitude and longitude
+         *
+         * @param[in]   Nlat_fine, Nlon_fine            size of the fine grid
+         * @param[in]   lat_first, lat_last             fine latitude index range of each coarse latitude
+         * @param[in]   lon_first, lon_last             fine longitude index range of each coarse longitude
+         * @param[in]   fine_weights                    weight of each fine cell (e.g. areas, size Nlat_fine * Nlon_fine). NULL means all ones
+         */
+        void build( const int Nlat_fine, const int Nlon_fine,
+                    const std::vector<int> & lat_first, const std::vector<int> & lat_last,
+                    const std::vector<int> & lon_first, const std::vector<int> & lon_last,
+                    const std::vector<double> * fine_weights = NULL );
+
+        // Box of fine cells used by the coarsened maps (see compute_coarsened_map), area-weighted
+        void build_for_coarse_map(  const std::vector<double> & latitude,
+                                    const std::vector<double> & longitude,
+                                    const std::vector<double> & coarse_latitude,
+                                    const std::vector<double> & coarse_longitude,
+                                    const std::vector<double> & areas );
+
+        // Indicates if the operator maps from / to grids of these sizes
+        bool applies_to( const int Nlat_fine_in, const int Nlon_fine_in, const int Nlat_coarse_in, const int Nlon_coarse_in ) const {
+            return built and ( Nlat_fine_in == Nlat_fine ) and ( Nlon_fine_in == Nlon_fine ) 
+                         and ( Nlat_coarse_in == Nlat_coarse ) and ( Nlon_coarse_in == Nlon_coarse );
+        }
+
+        /*!
+         * \brief Remap several fields (each of size Ntime * Ndepth * Nlat_fine * Nlon_fine) at once
+         *
+         * Coarse cells without any water are set to zero (their water_weights are zero).
+         *
+         * @param[in,out]   coarse_fields       remapped fields, each of size Ntime * Ndepth * Nlat_coarse * Nlon_coarse
+         * @param[in,out]   water_weights       total weight of the water cells in each coarse cell (same size)
+         * @param[in]       fine_fields         fields to remap
+         * @param[in]       fine_mask           mask of the fine grid (true = water)
+         * @param[in]       Ntime, Ndepth       sizes of the (MPI-local) time and depth dimensions
+         */
+        void apply( std::vector< std::vector<double> > & coarse_fields,
+                    std::vector<double> & water_weights,
+                    const std::vector<const std::vector<double>*> & fine_fields,
+                    const std::vector<bool> & fine_mask,
+                    const int Ntime, const int Ndepth ) const;
+};
+
+class dataset;
+
+/*!
+ * \brief Sample locations (e.g. moorings) at which to output area-averages over windows, instead of full fields.
+ *
+ * For each window radius (in metres) and sample location, build stores the grid points within
+ * that distance of the sample, along with their cell areas. A radius of zero (or a window that
+ * catches no grid points) uses the nearest grid point.
+ *
+ * needed_points flags (size Nlat * Nlon, lon fastest) the grid points that the sampled outputs
+ * depend on: the windows, plus a halo of grid cells for the derivatives taken of the coarse fields.
+ * The filtering routines skip all other points (see dataset::load_sample_points and initialize_subset_file).
+ *
+ * Like grid_geometry, build needs to be called again if the grid is changed.
+ */
+class point_samples {
+
+    public:
+
+        // Sample locations (same units as the grid) and window radii (in metres)
+        std::vector<double> latitude, longitude, windows;
+
+        // Grid points (Ilat * Nlon + Ilon) in each window, and their areas, indexed by Iwindow * Nsamples + Isample
+        std::vector< std::vector<size_t> > window_points;
+        std::vector< std::vector<double> > window_areas;
+
+        std::vector<bool> needed_points;
+
+        bool empty() const { return latitude.empty(); }
+        size_t Nsamples() const { return latitude.size(); }
+        size_t Nwindows() const { return windows.size(); }
+
+        void build( const dataset & source_data, const int halo );
+
+        /*!
+         * \brief Area-weighted mean of field over each window, ordered as (time, depth, window, sample)
+         *
+         * Only points where mask is true (if given) are used. Windows without any such points are
+         * flagged false in sampled_mask.
+         */
+        void sample( std::vector<double> & sampled,
+                     std::vector<bool> & sampled_mask,
+                     const std::vector<double> & field,
+                     const std::vector<bool> * mask,
+                     const int Ntime, const int Ndepth ) const;
+};
+
+/*!
+ * \brief Mergeable (weighted) quantile sketch, following the merging t-digest (Dunning & Ertl)
+ *
+ * Values are buffered by add, and periodically compressed into at most ~compression centroids,
+ * with smaller centroids near the tails (so the extreme quantiles stay accurate). Two sketches
+ * are combined with merge, which is what lets partial sketches from different threads, times,
+ * or processors (see merge_quantile_sketches) be combined into one.
+ *
+ * Sketches with few values keep each value as its own centroid, in which case the median (and
+ * the other quantiles) match the usual interpolated order statistics.
+ */
+class quantile_sketch {
+
+    public:
+
+        quantile_sketch( const double compression = constants::QUANTILE_SKETCH_COMPRESSION );
+
+        void add( const double value, const double weight = 1. );
+        void merge( const quantile_sketch & other );
+        void clear();
+
+        // Merge the buffered values into the centroids (done automatically once the buffer is full)
+        void compress();
+
+        // Value below which a fraction q (of the total weight) lies. Returns constants::fill_value if empty.
+        double quantile( const double q );
+
+        double total_weight() const { return total; }
+        bool empty() const { return total <= 0; }
+
+        // Append to / merge from a flat buffer as [ number of centroids, means..., weights..., min, max ]
+        void pack( std::vector<double> & buffer );
+        size_t unpack( const std::vector<double> & buffer, const size_t position );
+
+    private:
+
+        double compression, total, min_value, max_value;
+
+        // Compressed centroids (sorted by mean) and the values added since the last compression
+        std::vector<double> means, weights, buffered_means, buffered_weights;
+};
+
+void merge_quantile_sketches(
+        std::vector<quantile_sketch> & sketches,
+        const MPI_Comm comm = MPI_COMM_WORLD
+        );
+
 /*!
  * \brief Class to store main variables.
  *
@@ -37,6 +431,12 @@ class dataset {
         int Ntime = -1, Ndepth = -1, Nlat = -1, Nlon = -1;
         int full_Ntime = -1, full_Ndepth = -1;
 
+        // Input files along the time dimension (more than one if the time axis is spread over 
+        //   several files, see load_time) and the index in the full time axis at which each file 
+        //   starts (plus a final entry for the end of the last file)
+        std::vector< std::string > time_files;
+        std::vector< int > time_file_starts;
+
         // MPI Communicator Objects
         MPI_Comm MPI_Comm_Global = MPI_COMM_WORLD;
         MPI_Comm MPI_subcomm_sametimes,
@@ -62,12 +462,31 @@ class dataset {
         std::map< std::string, std::vector<bool> > regions;
         std::vector<double> region_areas, region_areas_water_only;
 
+        // The regions containing each (horizontal) grid cell, so that all of the regions can be
+        //    handled in one pass over a field: cell Ilat * Nlon + Ilon is in regions 
+        //    region_cell_lists[ region_cell_starts[cell] ], ..., region_cell_lists[ region_cell_starts[cell + 1] - 1 ]
+        //    (built by compute_region_areas)
+        std::vector<size_t> region_cell_starts;
+        std::vector<int> region_cell_lists;
+
         // The vectors for the coarse lat/lon maps
         std::vector<double> coarse_map_lat, coarse_map_lon, coarse_map_areas;
 
+        // Remapping from the grid to the coarse map grid (built by compute_cell_areas / prepare_for_coarsened_grids)
+        remap_operator coarse_map_operator;
+
+        // Sample locations for subset outputs (see load_sample_points)
+        point_samples samples;
+
         // Store mask data (i.e. land vs water)
         std::vector<bool> mask, reference_mask, mask_DEPTH;
 
+        // Pre-computed (first) derivative stencils for the mask (see build_derivative_operators)
+        differentiation_operator lon_deriv_op, lat_deriv_op;
+
+        // Pre-computed trigonometry of the grid (see compute_cell_areas)
+        grid_geometry geometry;
+
         // Store data-chunking info. These keep track of the MPI divisions to ensure 
         // that the output is in the same order as the input.
         std::vector<int> myCounts, myStarts;
@@ -85,7 +504,7 @@ class dataset {
         void load_latitude(  const std::string dim_name, const std::string filename );
         void load_longitude( const std::string dim_name, const std::string filename );
 
-        // Compute areas
+        // Compute areas (and the grid geometry)
         void compute_cell_areas();
 
         // Load in variable and store in dictionary
@@ -96,17 +515,41 @@ class dataset {
                             const bool load_counts = true,
                             const bool do_splits = true );
 
+        // Load in several variables (name, name in file) at once, opening the file only once
+        void load_variables( const std::vector< std::pair< std::string, std::string > > & vars,
+                             const std::string filename,
+                             const bool read_mask = true,
+                             const bool load_counts = true,
+                             const bool do_splits = true,
+                             const bool read_reference_mask = false );
+
         // Load in region definitions
         void load_region_definitions(   const std::string filename, 
                                         const std::string dim_name, 
                                         const std::string var_name, 
                                         const MPI_Comm = MPI_COMM_WORLD );
         void compute_region_areas();
+        void list_regions_by_cell(  std::vector<size_t> & cell_starts,
+                                    std::vector<int> & cell_lists ) const;
+
+        // Load in sample locations, and set up the windows around them, for subset outputs
+        //  (call once the grid is final). halo is the number of extra cells kept for derivative stencils
+        void load_sample_points(    const std::string filename,
+                                    const std::string lat_name,
+                                    const std::string lon_name,
+                                    const std::vector<double> & windows,
+                                    const bool in_degrees = true,
+                                    const int halo = 2 * constants::DiffOrd,
+                                    const MPI_Comm = MPI_COMM_WORLD );
 
         // Prepare for grid-coarsening outputs
         void prepare_for_coarsened_grids(   const std::string filename,
                                             const MPI_Comm = MPI_COMM_WORLD );
 
+        // Build the derivative stencils for the current grid and mask
+        //  (call again if the mask is changed)
+        void build_derivative_operators( const int diff_ord = constants::DiffOrd );
+
         // Check the processors divions between dimensions
         void check_processor_divisions( const int Nprocs_in_time_input, 
                                         const int Nprocs_in_depth_input, 
@@ -146,6 +589,47 @@ class dataset {
 
 };
 
+/*!
+ * \brief Kernel values on a uniform Cartesian grid, as a function of the index offsets.
+ *
+ * With CARTESIAN and uniform grids, the distance between two points (and so the kernel) only
+ * depends on how many points apart they are in each dimension (accounting for periodicity).
+ * So the kernel only needs to be computed once per scale (in build), and can then be shared
+ * (read-only) by all threads, with compute_local_kernel just looking up the values.
+ */
+class cartesian_offset_kernel {
+
+    public:
+
+        bool built = false;
+        double scale = -1;
+        int Nlat = 0, Nlon = 0, max_dlat = -1, max_dlon = -1;
+
+        // Kernel (and ell-derivatives) at offsets [dlat][dlon], with dlat in [0, max_dlat] and dlon in [0, max_dlon]
+        std::vector<double> kern, dl_kern, dll_kern;
+
+        // Whether or not the kernel is translation-invariant for the current constants
+        static bool is_possible() {
+            return constants::CARTESIAN and constants::UNIFORM_LON_GRID and constants::UNIFORM_LAT_GRID;
+        }
+
+        void build( const dataset & source_data, const double scale, const bool with_derivs = true );
+
+        // Indicates if the kernel was built for this scale and grid size
+        bool applies_to( const dataset & source_data, const double scale_in ) const {
+            return built and ( scale_in == scale ) and ( source_data.Nlat == Nlat ) and ( source_data.Nlon == Nlon );
+        }
+
+        // Where the kernel between (Ilat1, Ilon1) and (Ilat2, Ilon2) is stored (indices within [0, Nlat) and [0, Nlon))
+        inline size_t offset_index( const int Ilat1, const int Ilon1, const int Ilat2, const int Ilon2 ) const {
+            int dlat = abs( Ilat2 - Ilat1 ),
+                dlon = abs( Ilon2 - Ilon1 );
+            if ( (constants::PERIODIC_Y) and ( 2 * dlat > Nlat ) ) { dlat = Nlat - dlat; }
+            if ( (constants::PERIODIC_X) and ( 2 * dlon > Nlon ) ) { dlon = Nlon - dlon; }
+            return (size_t) dlat * ( max_dlon + 1 ) + dlon;
+        }
+};
+
 void compute_areas(
         std::vector<double> & areas, 
         const std::vector<double> & longitude, 
@@ -169,7 +653,8 @@ void compute_local_kernel(
         const double scale,
         const dataset & source_data,
         const int Ilat,     const int Ilon,
-        const int LAT_lb,   const int LAT_ub);
+        const int LAT_lb,   const int LAT_ub,
+        const cartesian_offset_kernel * offset_kernel = NULL);
 
 void KE_from_vels(
             std::vector<double> & KE,
@@ -201,6 +686,20 @@ void vel_Spher_to_Cart_at_point(
             const double lat
         );
 
+// Same as above, but with the trigonometry of the location already computed (e.g. from grid_geometry)
+void vel_Spher_to_Cart_at_point(
+            double & u_x,
+            double & u_y,
+            double & u_z,
+            const double u_r,
+            const double u_lon,
+            const double u_lat,
+            const double cos_lon,
+            const double sin_lon,
+            const double cos_lat,
+            const double sin_lat
+        );
+
 
 void vel_Cart_to_Spher(
             std::vector<double> & u_r,
@@ -224,6 +723,19 @@ void vel_Cart_to_Spher_at_point(
             const double lat 
             );
 
+void vel_Cart_to_Spher_at_point(
+            double & u_r, 
+            double & u_lon, 
+            double & u_lat,
+            const double u_x, 
+            const double u_y, 
+            const double u_z,
+            const double cos_lon, 
+            const double sin_lon, 
+            const double cos_lat, 
+            const double sin_lat 
+            );
+
 void filtering(const dataset & source_data,
                const std::vector<double> & scales, 
                const MPI_Comm comm = MPI_COMM_WORLD);
@@ -253,10 +765,49 @@ void apply_filter_at_point(
         const std::vector<double> * weight = NULL
         );
 
+void apply_separable_filter(
+        const std::vector<std::vector<double>*> & coarse_fields,
+        const std::vector<const std::vector<double>*> & fields,
+        const dataset & source_data,
+        const double scale,
+        const std::vector<double> * weight = NULL
+        );
+
 double kernel(const double distance, const double scale, const int deriv_order = 0);
 
 double kernel_alpha(void);
 
+/*!
+ * \brief Cartesian velocity gradient, computed once (per filter scale) and shared between diagnostics.
+ *
+ * compute_vorticity, compute_Pi, and compute_div_transport would otherwise each differentiate
+ * the same coarse velocity. Build this once for a coarse (Cartesian) velocity, and pass it to them.
+ *
+ * The gradient is stored point-by-point (9 values per point), and optionally so are the
+ * derivatives of the velocity products that are needed for div(J).
+ */
+class velocity_gradient_cache {
+
+    public:
+
+        // grad[ 9 * index + 3 * ii + jj ] = d u_i / d x_j (zero on land)
+        std::vector<double> grad;
+
+        // prod_deriv[ 9 * index + 3 * ii + jj ] = d ( u_i u_j ) / d x_j (only if built with the products)
+        std::vector<double> prod_deriv;
+
+        void build( const dataset & source_data,
+                    const std::vector<double> & ux,
+                    const std::vector<double> & uy,
+                    const std::vector<double> & uz,
+                    const std::vector<const std::vector<double>*> * products = NULL );
+
+        bool has_products() const { return prod_deriv.size() == grad.size(); }
+
+        // Velocity gradient at a point
+        inline const double * at( const size_t index ) const { return &grad[ 9 * index ]; }
+};
+
 void compute_vorticity_at_point(
         double & vort_r_tmp, 
         double & vort_lon_tmp, 
@@ -271,7 +822,8 @@ void compute_vorticity_at_point(
         const std::vector<double> & u_r, 
         const std::vector<double> & u_lon, 
         const std::vector<double> & u_lat,
-        const int Itime,  const int Idepth, const int Ilat, const int Ilon);
+        const int Itime,  const int Idepth, const int Ilat, const int Ilon,
+        const velocity_gradient_cache * vel_grad = NULL);
 
 void compute_vorticity(
         std::vector<double> & vort_r,    
@@ -287,6 +839,7 @@ void compute_vorticity(
         const std::vector<double> & u_r, 
         const std::vector<double> & u_lon, 
         const std::vector<double> & u_lat,
+        const velocity_gradient_cache * vel_grad = NULL,
         const MPI_Comm comm = MPI_COMM_WORLD);
 
 void apply_filter_at_point_for_quadratics(
@@ -318,6 +871,7 @@ void compute_Pi(
         const std::vector<double> * ux_in_tau = NULL,   
         const std::vector<double> * uy_in_tau = NULL,   
         const std::vector<double> * uz_in_tau = NULL,
+        const velocity_gradient_cache * vel_grad = NULL,
         const MPI_Comm comm = MPI_COMM_WORLD);
 
 void compute_Pi_shift_deriv(
@@ -426,6 +980,7 @@ void compute_div_transport(
         const std::vector<double> & uyuz,
         const std::vector<double> & uzuz,
         const std::vector<double> & coarse_p,
+        const velocity_gradient_cache * vel_grad = NULL,
         const MPI_Comm comm = MPI_COMM_WORLD
         );
 
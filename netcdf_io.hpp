@@ -7,6 +7,7 @@
 #include <string>
 #include <mpi.h>
 #include <math.h>
+#include <thread>
 
 #include "netcdf.h"
 #include "netcdf_par.h"
@@ -52,6 +53,332 @@ bool check_file_existence (
         );
 
 
+/*!
+ * \brief Memory-mappable raw files, for passing intermediate products between stages
+ *
+ * Files whose names end in '.raw' are written and read in this format (instead of netcdf) by
+ * initialize_output_file, add_var_to_file, add_attr_to_file, write_field_to_output, and read_var_from_file.
+ *
+ * The file starts with a JSON header (padded to header_bytes) that lists the dimensions, the fill value 
+ * (which marks land), global attributes, and the variables (with their dimensions, units, and byte offsets).
+ * Each variable is then stored as a contiguous, unpacked, array of doubles (in the usual index ordering),
+ * starting at a multiple of data_alignment. A later stage on the same filesystem can then use the data 
+ * in place (via map_variable) without decoding.
+ *
+ */
+class raw_file {
+
+    public:
+
+        //! Size (in bytes) reserved at the start of the file for the header
+        static const size_t header_bytes = 65536;
+
+        //! Byte alignment of the start of each variable
+        static const size_t data_alignment = 4096;
+
+        struct variable_info {
+            std::string name, units;
+            std::vector< std::string > dims;
+            size_t size = 0, offset = 0;
+        };
+
+        std::string filename;
+        double fill_value = constants::fill_value;
+        std::vector< std::pair< std::string, size_t > > dims;
+        std::vector< std::pair< std::string, double > > attributes;
+        std::vector< variable_info > variables;
+
+        raw_file() {};
+        ~raw_file();
+
+        //! Whether or not a filename refers to a raw file (i.e. ends in '.raw')
+        static bool is_raw( const std::string & filename );
+
+        //! Create a new (empty) file with the given dimensions, and write the header
+        void create( const std::string & filename, const std::vector< std::pair< std::string, size_t > > & dims );
+
+        //! Read the header of an existing file
+        void read_header( const std::string & filename );
+
+        //! (Re-)write the header
+        void write_header() const;
+
+        //! Add a variable (the file is extended to hold it) and re-write the header
+        void add_variable( const std::string & var_name, const std::vector< std::string > & var_dims, const std::string & units = "" );
+
+        //! Add (or update) a global attribute and re-write the header
+        void add_attribute( const std::string & attr_name, const double value );
+
+        const variable_info & get_variable( const std::string & var_name ) const;
+
+        //! Size of each dimension of a variable
+        std::vector< size_t > shape( const variable_info & var ) const;
+
+        /*!
+         * \brief Map a variable into memory, and return a pointer to its first element
+         *
+         * The mapping is released when the raw_file is destroyed (or unmap_all is called).
+         */
+        double * map_variable( const std::string & var_name, const bool writable = false );
+        void unmap_all();
+
+        /*!
+         * \brief Split a hyperslab (start, count) of a variable into contiguous runs
+         *
+         * @returns the number of elements in each run, and fills run_offsets with the (element) offset of each run
+         */
+        size_t slab_runs( const variable_info & var, const size_t * start, const size_t * count, 
+                          std::vector< size_t > & run_offsets ) const;
+
+    private:
+        std::vector< std::pair< void *, size_t > > mappings;
+};
+
+
+/*!
+ * \brief Expand a list of input files
+ *
+ * The list is comma-separated, and each entry can be a glob (e.g. "day_*.nc"),
+ * whose matches are added in sorted order. This allows, for example, one file per day
+ * to be used as a single input along the time dimension (see dataset::load_time).
+ *
+ * @param[in] file_spec     list of files / globs
+ *
+ * @returns the list of files (a single name, without commas or wildcards, is returned as-is)
+ *
+ */
+std::vector< std::string > expand_input_files(
+        const std::string & file_spec
+        );
+
+
+/*!
+ * \brief MPI-IO hints (as an MPI_Info) used by every parallel netcdf open / create
+ *
+ * Hints are comma-separated key=value pairs, e.g. "cb_nodes=8,cb_buffer_size=16777216,romio_cb_write=enable,striping_factor=16".
+ * They are read from the FLOWSIEVE_MPIIO_HINTS environment variable, and can be added to (or overridden)
+ * with set_mpi_io_hints (e.g. from a --mpi_io_hints command-line argument).
+ *
+ * @returns MPI_INFO_NULL if no hints have been given
+ *
+ */
+MPI_Info mpi_io_hints();
+
+void set_mpi_io_hints( const std::string & hints );
+
+//! Record the bytes written (by this processor) and the time taken, for print_write_bandwidth
+void record_write_bandwidth( const double bytes, const double seconds );
+
+//! Print (from rank 0) the aggregate output bandwidth and the MPI-IO hints in use (collective over comm)
+void print_write_bandwidth( const MPI_Comm comm = MPI_COMM_WORLD );
+
+
+/*!
+ * \brief Per-rank outputs: one file per processor instead of a single shared file
+ *
+ * When turned on (e.g. from a --per_rank_outputs command-line argument), initialize_output_file creates,
+ * for 'name.nc', a file 'name.rankNNNN.nc' for each processor, holding that processor's times and depths
+ * (processors are divided in time / depth, and each holds the full horizontal grid). write_field_to_output
+ * and output_batch then open and write each processor's file on its own, so there is no MPI-IO locking,
+ * barriers, or collective writes. Only the extremes are still reduced, so that every part is packed
+ * with the same scale_factor / add_offset.
+ *
+ * Rank 0 also writes 'name.ncml', an NcML aggregation (joinExisting over depth, nested in one over time)
+ * that presents the parts as a single dataset to NcML-aware tools (e.g. netcdf-java, THREDDS, Panoply).
+ * merge_per_rank_outputs (see Case_Files/merge_per_rank_outputs.cpp) writes the single file 'name.nc'.
+ *
+ * Raw ('.raw') outputs are unaffected.
+ *
+ */
+void set_per_rank_outputs( const bool per_rank );
+
+bool per_rank_outputs();
+
+//! Name of the file that holds the part of filename written by processor rank
+std::string per_rank_output_name( const std::string & filename, const int rank );
+
+/*!
+ * \brief Whether filename was initialized as per-rank files (in which case part_start, if not NULL,
+ *        is set to this processor's starting time and depth index)
+ */
+bool is_per_rank_output( const std::string & filename, size_t * part_start = NULL );
+
+/*!
+ * \brief Record that filename is written as per-rank files, and have rank 0 write the NcML index
+ *
+ * Called by initialize_output_file (collective over comm).
+ *
+ * @param[in] filename      name of the (logical) output file
+ * @param[in] part_start    this processor's starting (time, depth) index
+ * @param[in] part_count    this processor's number of (times, depths)
+ * @param[in] comm          MPI Communicator
+ *
+ */
+void register_per_rank_output(
+        const std::string & filename,
+        const size_t * part_start,
+        const size_t * part_count,
+        const MPI_Comm comm = MPI_COMM_WORLD
+        );
+
+/*!
+ * \brief Combine per-rank files into a single output file (collective over comm)
+ *
+ * The parts are shared out over the processors (which need not match the number of parts),
+ * and each processor reads its parts and writes them into output_filename, which is
+ * set up as by initialize_output_file (with the global attributes of the parts).
+ *
+ * @param[in] filename          name of the (logical) output file, as passed to initialize_output_file
+ * @param[in] output_filename   name of the merged file
+ * @param[in] comm              MPI Communicator
+ *
+ */
+void merge_per_rank_outputs(
+        const std::string & filename,
+        const std::string & output_filename,
+        const MPI_Comm comm = MPI_COMM_WORLD
+        );
+
+/*!
+ * \brief Write the (mergeable) time statistics of each variable: the number of times, the means, and the summed squared deviations
+ *
+ * Everything is stored as doubles (depth, latitude, longitude), along with the global attributes
+ *  time_first, time_last, and num_times, so that files for consecutive periods can be combined
+ *  exactly by merge_time_statistics. The standard deviation is sqrt( sq_dev / count ).
+ *
+ * @param[in] filename                      name of the file to create
+ * @param[in] vars                          names of the variables
+ * @param[in] depth,latitude,longitude      (full) grid
+ * @param[in] time_counts                   number of (water) times at each of this processor's points (Ndepth * Nlat * Nlon)
+ * @param[in] time_means                    time means of each variable, on the same points
+ * @param[in] time_sq_devs                  summed squared deviations from the means, on the same points
+ * @param[in] Sdepth,Ndepth                 this processor's depths
+ * @param[in] time_first,time_last          first and last times covered
+ * @param[in] num_times                     number of times covered
+ * @param[in] filter_scale                  filter scale (global attribute)
+ * @param[in] comm                          MPI Communicator
+ *
+ */
+void write_time_statistics(
+        const std::string & filename,
+        const std::vector<std::string> & vars,
+        const std::vector<double> & depth,
+        const std::vector<double> & latitude,
+        const std::vector<double> & longitude,
+        const std::vector<double> & time_counts,
+        const std::vector< std::vector<double> > & time_means,
+        const std::vector< std::vector<double> > & time_sq_devs,
+        const int Sdepth,
+        const int Ndepth,
+        const double time_first,
+        const double time_last,
+        const double num_times,
+        const double filter_scale,
+        const MPI_Comm comm = MPI_COMM_WORLD
+        );
+
+/*!
+ * \brief Combine time-statistics files (from write_time_statistics) into one covering all of their times (collective over comm)
+ *
+ * Uses the pairwise update of Chan et al. for the means and squared deviations, so the result
+ *  matches the statistics of the full record (to rounding). The depths are shared out over the processors.
+ *
+ * @param[in] filenames         time-statistics files to combine (on the same grid)
+ * @param[in] output_filename   name of the combined file
+ * @param[in] comm              MPI Communicator
+ *
+ */
+void merge_time_statistics(
+        const std::vector<std::string> & filenames,
+        const std::string & output_filename,
+        const MPI_Comm comm = MPI_COMM_WORLD
+        );
+
+
+/*!
+ * \brief Read a variable (or several) one chunk of times at a time, reading the next chunk while the current one is used
+ *
+ * The chunks cover this processor's times and depths (dataset::myStarts / myCounts), and do not cross 
+ * file boundaries when the time axis is spread over several files (dataset::time_files). 
+ * The next chunk is read on a helper thread (double-buffered), so that reading overlaps with
+ * whatever is done with the current chunk. The time spent waiting on reads is recorded as 
+ * exposed I/O, and the rest of the read time as hidden I/O.
+ *
+ * Netcdf is not thread-safe, so no other netcdf calls should be made between constructing
+ * the reader and the last call to next. If MPI does not provide MPI_THREAD_MULTIPLE, then
+ * the chunks are read synchronously instead.
+ *
+ */
+class prefetching_reader {
+
+    public:
+
+        /*!
+         * \brief Set up the chunks and start reading the first one
+         *
+         * @param[in]   source_data     dataset (with the time axis and processor divisions already loaded)
+         * @param[in]   var_names       names of the variables (in the file) to read
+         * @param[in]   filename        file to read from (unless source_data.time_files is set)
+         * @param[in]   chunk_size      number of times in each chunk
+         * @param[in]   timings         (optional) where to record the exposed / hidden I/O times
+         *
+         */
+        prefetching_reader(
+                const dataset & source_data,
+                const std::vector< std::string > & var_names,
+                const std::string & filename,
+                const int chunk_size = 1,
+                Timing_Records * timings = NULL
+                );
+        ~prefetching_reader();
+
+        /*!
+         * \brief Get the next chunk, and start reading the one after
+         *
+         * The chunk is swapped into fields and mask (so those buffers are re-used for later reads).
+         *
+         * @param[in,out]   fields          one vector per variable, sized Ntime x myCounts[1] x Nlat x Nlon
+         * @param[in,out]   mask            mask for the chunk
+         * @param[in,out]   Itime_start     first time of the chunk (relative to this processor's first time)
+         * @param[in,out]   Ntime           number of times in the chunk
+         *
+         * @returns false (and leaves the arguments alone) once every chunk has been returned
+         */
+        bool next(
+                std::vector< std::vector<double> > & fields,
+                std::vector<bool> & mask,
+                int & Itime_start,
+                int & Ntime
+                );
+
+        size_t num_chunks() const { return chunk_files.size(); }
+
+        //! Total exposed (waited on) and hidden (overlapped) read times so far
+        double exposed_time = 0., hidden_time = 0.;
+
+    private:
+        struct chunk_buffer {
+            std::vector< std::vector<double> > fields;
+            std::vector<bool> mask;
+            double read_time = 0.;
+        };
+
+        void read_chunk( const size_t Ichunk, chunk_buffer & buffer ) const;
+        void start_read( const size_t Ichunk );
+        void finish_read();
+
+        std::vector< std::string > var_names, chunk_files;
+        std::vector< int > chunk_file_starts, chunk_starts, chunk_counts;
+        int depth_start, depth_count, Nlat, Nlon;
+
+        chunk_buffer pending;
+        size_t next_chunk = 0;
+        bool use_thread, reading = false;
+        std::thread helper;
+        Timing_Records * timings;
+};
+
+
 /*! 
  * \brief Initialize netcdf output file for filtered fields.
  *
@@ -84,17 +411,40 @@ void initialize_output_file(
         MPI_Comm = MPI_COMM_WORLD
         );
 
+/*!
+ * \brief Initialize netcdf output file for sampled (subset) outputs.
+ *
+ *  Instead of the full fields, the file holds area-averages over windows
+ *  around a set of sample locations (see point_samples).
+ *
+ *  Dimension ordering is:
+ *    time, depth, window, sample
+ *
+ *  The file is remembered, along with the samples, and fields that are then written to it
+ *  with write_field_to_output / output_batch (as full MPI-local fields) are sampled first.
+ *  So samples needs to outlive the writes.
+ *
+ * @param[in] time, depth                   time and depth vectors (full, not MPI-local)
+ * @param[in] samples                       sample locations and windows
+ * @param[in] vars                          name of variables to write
+ * @param[in] filename                      name for the output file
+ * @param[in] filter_scale                  lengthscale used in the filter
+ * @param[in] comm                          MPI Communicator (defaults to MPI_COMM_WORLD)
+ *
+ */
 void initialize_subset_file(
         const std::vector<double> & time,
         const std::vector<double> & depth,
-        const std::vector<double> & windows,
-        const int & Nsamples,
+        const point_samples & samples,
         const std::vector<std::string> & vars,
         const char * filename,
         const double filter_scale,
         MPI_Comm = MPI_COMM_WORLD
         );
 
+//! Samples of filename, if it was initialized by initialize_subset_file (otherwise NULL)
+const point_samples * subset_output_samples( const std::string & filename );
+
 /*! 
  * \brief Initialize netcdf output file for the postprocessing results.
  *
@@ -195,6 +545,73 @@ void write_field_to_output(
         );
 
 
+/*!
+ * \brief Queue several fields, and then write them to a previously initialized file together
+ *
+ * Writes the same values as write_field_to_output for each field, but the file is only opened once,
+ * the extremes (used for the scale_factor / add_offset) of every queued field are computed locally
+ * and then combined with a single MPI_Allreduce, and the packing is done in parallel.
+ *
+ * The fields (and masks) are not copied, so they must not change until write is called.
+ *
+ * If filename was set up by initialize_subset_file, the (full MPI-local) fields are sampled before writing.
+ *
+ */
+class output_batch {
+
+    public:
+
+        /*!
+         * @param[in] filename      name of the netcdf (or raw) file
+         * @param[in] start         starting indices for the writes
+         * @param[in] count         size of the writes in each dimension
+         * @param[in] comm          MPI Communicator
+         */
+        output_batch(
+                const std::string & filename,
+                const size_t * start,
+                const size_t * count,
+                MPI_Comm comm = MPI_COMM_WORLD
+                );
+
+        //! Queue a field to be written to the variable field_name
+        void add(
+                const std::vector<double> & field,
+                const std::string & field_name,
+                const std::vector<bool> * mask = NULL
+                );
+
+        /*!
+         * \brief Queue a field to be written to its own hyperslab (field_start, field_count) of the variable field_name
+         *
+         * A variable can be queued several times (e.g. for disjoint slabs), in which case the packing uses 
+         * the extremes over all of them. Every processor must queue the same variables, in the same order
+         * (a placeholder with zero counts can be used if a processor has nothing to write).
+         * Like the fields, field_start and field_count are not copied.
+         */
+        void add(
+                const std::vector<double> & field,
+                const std::string & field_name,
+                const std::vector<bool> * mask,
+                const size_t * field_start,
+                const size_t * field_count
+                );
+
+        //! Write every queued field (collective over comm), and empty the queue
+        void write();
+
+    private:
+        std::string filename;
+        const size_t * start, * count;
+        MPI_Comm comm;
+
+        std::vector< const std::vector<double> * > fields;
+        std::vector< std::string > field_names;
+        std::vector< const std::vector<bool> * > masks;
+        std::vector< const size_t * > field_starts, field_counts;
+};
+
+
 void write_integral_to_post(
         const std::vector<
             std::vector<double> > & field,
@@ -238,7 +655,27 @@ void read_var_from_file(
         const bool do_splits = true,
         const int force_split_dim = -1,
         const double land_fill_value = 0.,
-        const MPI_Comm = MPI_COMM_WORLD 
+        const MPI_Comm = MPI_COMM_WORLD,
+        const size_t * slab_starts = NULL,
+        const size_t * slab_counts = NULL
+        );
+
+void read_vars_from_file(
+        const std::vector< std::vector<double> * > & vars,
+        const std::vector< std::string > & var_names,
+        const std::string & filename,
+        std::vector<bool> *mask = NULL,
+        std::vector<int> *myCounts = NULL,
+        std::vector<int> *myStarts = NULL,
+        const int Nprocs_in_time = 1,
+        const int Nprocs_in_depth = 1,
+        const bool do_splits = true,
+        const int force_split_dim = -1,
+        const double land_fill_value = 0.,
+        const MPI_Comm = MPI_COMM_WORLD,
+        const size_t * slab_starts = NULL,
+        const size_t * slab_counts = NULL,
+        std::vector<bool> *reference_mask = NULL
         );
 
 void read_mask_from_file(
@@ -292,6 +729,23 @@ void add_var_to_file(
         );
 
 
+/*!
+ *  \brief Add a new dimension to a netcdf file
+ *
+ *  Used for output variables that need a dimension beyond time / depth / latitude / longitude.
+ *  Like add_var_to_file, this should only be called by a single processor.
+ *
+ *  @param[in] dim_name name of the dimension to add
+ *  @param[in] dim_len  length of the dimension
+ *  @param[in] filename file name to add the dimension
+ */
+void add_dim_to_file(
+        const std::string dim_name,
+        const size_t dim_len,
+        const char * filename
+        );
+
+
 /*!
  *  \brief Add a new (double) attribute to a netcdf file
  *
@@ -327,4 +781,37 @@ void package_field(
         const MPI_Comm comm = MPI_COMM_WORLD
         );
 
+/*!
+ *  \brief Version of package_field for when the (global) extremes are already known
+ *
+ *  No communication is done, so this can be used after reducing the extremes of several fields at once.
+ *
+ */
+void package_field(
+        std::vector<signed short> & packaged,
+        double & scale_factor,
+        double & add_offset,
+        const std::vector<double> & original,
+        const std::vector<bool> * mask,
+        const double fmin,
+        const double fmax
+        );
+
+/*!
+ *  \brief Local (i.e. this processor's) extremes of the water values of a field
+ *
+ *  As in the packing, both extremes start at zero (so fmin <= 0 <= fmax).
+ *
+ *  @param[out] fmin,fmax   local minimum and maximum
+ *  @param[in]  field       values
+ *  @param[in]  mask        (pointer to) mask, where false values are skipped (NULL means all are used)
+ *
+ */
+void field_extremes(
+        double & fmin,
+        double & fmax,
+        const std::vector<double> & field,
+        const std::vector<bool> * mask
+        );
+
 #endif
@@ -28,9 +28,49 @@ void particles_evolve_trajectories(
         const std::vector<double> & lat,
         const std::vector<double> & lon,
         const std::vector<bool> & mask,
+        const int integrator = constants::ParticleIntegratorType::ForwardEuler,
+        const double tolerance = 1.,
+        std::vector<int> * steps_taken = NULL,
         const MPI_Comm comm = MPI_COMM_WORLD
         );
 
+bool particles_velocity_at_point(
+        double & dlon_dt,
+        double & dlat_dt,
+        const double t_part,
+        const double ref_lat,
+        double ref_lon,
+        int ref_ind,
+        const std::vector<double> & vel_lon,
+        const std::vector<double> & vel_lat,
+        const std::vector<double> & time,
+        const std::vector<double> & lat,
+        const std::vector<double> & lon,
+        const std::vector<bool> & mask
+        );
+
+bool particles_RK_step(
+        double & lon_new,
+        double & lat_new,
+        double & step_error,
+        double & dlon_dt_end,
+        double & dlat_dt_end,
+        const double dlon_dt,
+        const double dlat_dt,
+        const double t_part,
+        const double dt,
+        const double lon0,
+        const double lat0,
+        const int integrator,
+        const int ref_ind,
+        const std::vector<double> & vel_lon,
+        const std::vector<double> & vel_lat,
+        const std::vector<double> & time,
+        const std::vector<double> & lat,
+        const std::vector<double> & lon,
+        const std::vector<bool> & mask
+        );
+
 void particles_get_edges(
         int & left,
         int & right,
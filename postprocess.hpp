@@ -65,10 +65,22 @@ void compute_zonal_avg_and_std(
         const MPI_Comm comm = MPI_COMM_WORLD
         );
 
-void compute_zonal_median(
-        std::vector<std::vector<double>> & zonal_median,
+void compute_zonal_quantiles(
+        std::vector<std::vector<double>> & zonal_medians,
+        std::vector<std::vector<double>> & zonal_quantiles,
+        std::vector<std::vector<double>> & zonal_quantiles_all_times,
         const dataset & source_data,
         const std::vector<const std::vector<double>*> & postprocess_fields,
+        const std::vector<double> & quantile_levels,
+        const MPI_Comm comm = MPI_COMM_WORLD
+        );
+
+void compute_region_quantiles(
+        std::vector<std::vector<double>> & region_quantiles,
+        std::vector<std::vector<double>> & region_quantiles_all_times,
+        const dataset & source_data,
+        const std::vector<const std::vector<double>*> & postprocess_fields,
+        const std::vector<double> & quantile_levels,
         const MPI_Comm comm = MPI_COMM_WORLD
         );
 
@@ -91,7 +103,8 @@ void compute_time_avg_std(
         const std::vector<const std::vector<double>*> & postprocess_fields,
         const std::vector<int> & mask_count,
         const std::vector<bool> & always_masked,
-        const int full_Ntime
+        const int full_Ntime,
+        std::vector<std::vector<double> > * time_sq_devs = NULL
         );
 
 void write_region_avg_and_std(
@@ -134,6 +147,21 @@ void write_zonal_avg_and_std(
         const int num_fields
         );
 
+void write_quantiles(
+        const std::vector< std::vector< double > > & quantiles,
+        const std::vector< std::vector< double > > & quantiles_all_times,
+        const std::vector<std::string> & vars_to_process,
+        const std::string & kind,
+        const char * filename,
+        const int Stime,
+        const int Sdepth,
+        const int Ntime,
+        const int Ndepth,
+        const int Nquantiles,
+        const int Nspace,
+        const int num_fields
+        );
+
 void write_region_avg_and_std_OkuboWeiss(
         const std::vector< std::vector< double > > & field_averages_OW,
         const std::vector< std::vector< double > > & field_std_devs_OW,
@@ -4,8 +4,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "ALGLIB/linalg.h"
+#include "ALGLIB/solvers.h"
 #include <mpi.h>
 #include <vector>
+#include <complex>
+#include <functional>
 
 /*!
  * \file
@@ -67,6 +70,29 @@ void get_coast(
         const int Nlat,
         const int Nlon);
 
+/*!
+ * \brief Interpolate a single (lat,lon) slice from a coarse grid onto a fine grid with cubic (four-point Lagrange) interpolation.
+ * @ingroup InterpolationRoutines
+ *
+ * The coarse grid is assumed to have the same orientation as the fine one (e.g. a strided
+ * subset of it). Periodicity is taken from constants.hpp. Cubic, rather than linear, interpolation 
+ * is used so that derivatives of the interpolated field (e.g. velocities from a streamfunction) are 
+ * also reasonably accurate.
+ *
+ * @param[in,out]   fine_field                  interpolated field (resized to Nlat_fine * Nlon_fine)
+ * @param[in]       coarse_field                field on the coarse grid
+ * @param[in]       coarse_latitude,coarse_longitude    coarse grid (1D)
+ * @param[in]       fine_latitude,fine_longitude        fine grid (1D)
+ */
+void refine_field_cubic(
+        std::vector<double> & fine_field,
+        const std::vector<double> & coarse_field,
+        const std::vector<double> & coarse_latitude,
+        const std::vector<double> & coarse_longitude,
+        const std::vector<double> & fine_latitude,
+        const std::vector<double> & fine_longitude
+        );
+
 /*!
  *  \addtogroup ToroidalProjection
  *  @{
@@ -82,6 +108,10 @@ void get_coast(
  *
  * This uses sparse differentiation matrices (of the order specified in constants.hpp) and the ALGLIB least-squares solver.
  *
+ * If use_direct_solve is true, and the grid / mask allow it (see direct_Lap_solver), then the
+ * Laplacian is instead inverted directly with an FFT in longitude and banded solves in latitude.
+ * Otherwise, the least-squares solver is used.
+ *
  * *single_seed*: If true, then only one seed is provided and should be used as the seed for all different times. If false, then the provided seed incorporates a different seed for each time.
  *
  * @param[in]       output_fname                    Name for the output file
@@ -92,6 +122,7 @@ void get_coast(
  * @param[in]       myStarts                        Vector indicating where the local (to MPI process) region fits in the whole
  * @param[in]       seed                            Seed for the least-squares solver
  * @param[in]       single_seed                     Indicates if a single seed is used - see notes
+ * @param[in]       use_direct_solve                Use the direct (FFT + banded) solver when possible
  * @param[in]       comm                            MPI communicator (default MPI_COMM_WORLD)
  *
  */
@@ -104,6 +135,7 @@ void Apply_Toroidal_Projection(
         const int max_iters,
         const bool weight_err,
         const bool use_mask,
+        const bool use_direct_solve = false,
         const MPI_Comm comm = MPI_COMM_WORLD
         );
 
@@ -123,9 +155,54 @@ void Apply_Potential_Projection(
         const int max_iters,
         const bool weight_err,
         const bool use_mask,
+        const bool use_direct_solve = false,
         const MPI_Comm comm = MPI_COMM_WORLD
         );
 
+/*!
+ * \brief Applies a Helmholtz decomposition (streamfunction Psi and potential Phi) to the velocity field.
+ * @ingroup ToroidalProjection
+ *
+ * Each time / depth slice is solved with the ALGLIB least-squares solver, starting from a seed.
+ *
+ * Seeding: the seed for a slice is either the provided seed (if single_seed is false), a linear
+ * extrapolation from the two previous time (or depth) solutions (if extrapolate_seed is true and
+ * they exist), or otherwise the previous solution (or the single provided seed).
+ * If coarse_seed_factor > 1, the seed is then corrected by solving for the remaining velocity
+ * on a grid subsampled by that factor, and interpolating the result back onto the full grid.
+ *
+ * Seeding statistics (seed type, coarse / fine iteration counts, and seed misfit) are written to the output.
+ * If measure_seed_savings is true, each slice is additionally solved from a zero seed so that
+ * the number of iterations saved can be recorded (this roughly doubles the cost).
+ *
+ * If use_SHT is true, and the grid / mask allow it (full sphere, no land), then all slices are first
+ * solved directly with spherical harmonics, followed by a few correction sweeps on the velocity that
+ * is left over. That solution replaces the usual seeds, and the least-squares solver then removes the
+ * remaining misfit, so both paths converge to the same tolerance.
+ * The wall time of the solve is recorded in the output either way, so that the two can be compared.
+ *
+ * If residual_check_interval > 0, then every that many least-squares iterations the relative (area-weighted)
+ * error of the reconstructed velocity (from toroidal_vel_from_F and potential_vel_from_F) is computed.
+ * These are written to the output as residual_history (with the iterations in residual_history_iterations),
+ * and the solver stops once the error is below velocity_tolerance (if positive).
+ *
+ * @param[in]       output_fname            Name for the output file
+ * @param[in,out]   source_data             dataset containing the grid and the velocities (u_lon, u_lat)
+ * @param[in]       seed_tor,seed_pot       Seeds for Psi and Phi
+ * @param[in]       single_seed             Indicates if a single seed is used for all times / depths
+ * @param[in]       rel_tol                 Termination tolerance for the least-squares solver
+ * @param[in]       max_iters               Maximum number of least-squares iterations
+ * @param[in]       weight_err              Weight the least-squares problem by cell area
+ * @param[in]       use_mask                Account for the land mask in the derivatives
+ * @param[in]       Tikhov_Laplace          Weight for the vorticity / divergence matching terms
+ * @param[in]       coarse_seed_factor      Subsampling factor for the coarse-grid seed correction (1 to disable)
+ * @param[in]       extrapolate_seed        Linearly extrapolate seeds from the two previous solutions
+ * @param[in]       measure_seed_savings    Also solve from a zero seed to measure iterations saved
+ * @param[in]       use_SHT                 Seed with the spherical-harmonic solver when possible (see spherical_harmonic_Lap_solver)
+ * @param[in]       velocity_tolerance      Stop the least-squares solver once the relative velocity error is below this (0 to disable)
+ * @param[in]       residual_check_interval Number of least-squares iterations between velocity error checks (0 to disable)
+ * @param[in]       comm                    MPI communicator (default MPI_COMM_WORLD)
+ */
 void Apply_Helmholtz_Projection(
         const std::string output_fname,
         dataset & source_data,
@@ -137,6 +214,12 @@ void Apply_Helmholtz_Projection(
         const bool weight_err,
         const bool use_mask,
         const double Tikhov_Laplace,
+        const int coarse_seed_factor = 1,
+        const bool extrapolate_seed = false,
+        const bool measure_seed_savings = false,
+        const bool use_SHT = false,
+        const double velocity_tolerance = 0.,
+        const int residual_check_interval = 0,
         const MPI_Comm comm = MPI_COMM_WORLD
         );
 
@@ -181,6 +264,7 @@ void Apply_Helmholtz_Projection_SymTensor(
  * @param[in]       longitude,latitude      Grid vectors (1D)
  * @param[in]       Ntime,Ndepth,Nlat,Nlon  Dimension sizes
  * @param[in]       mask                    Array to distinguish land/water
+ * @param[in]       ops                     (optional) derivative operators, used if they were built for this grid and mask
  *
  */
 void toroidal_vel_from_F(  
@@ -193,7 +277,8 @@ void toroidal_vel_from_F(
         const int Ndepth,
         const int Nlat,
         const int Nlon,
-        const std::vector<bool> & mask
+        const std::vector<bool> & mask,
+        const spherical_derivative_operators * ops = NULL
     );
 
 void potential_vel_from_F(  
@@ -206,7 +291,8 @@ void potential_vel_from_F(
         const int Ndepth,
         const int Nlat,
         const int Nlon,
-        const std::vector<bool> & mask
+        const std::vector<bool> & mask,
+        const spherical_derivative_operators * ops = NULL
     );
 
 void uiuj_from_Helmholtz(  
@@ -260,6 +346,14 @@ void toroidal_curl_u_dot_er(
         );
 
 
+void monitored_lsqr_solve_sparse(
+        alglib::linlsqrstate & state,
+        const alglib::sparsematrix & A,
+        const alglib::real_1d_array & b,
+        const int check_interval,
+        const std::function< bool( const std::vector<double> &, const int ) > & check_solution
+        );
+
 void toroidal_sparse_Lap(
         alglib::sparsematrix & Lap,
         const dataset & source_data,
@@ -268,16 +362,154 @@ void toroidal_sparse_Lap(
         const std::vector<bool> & mask,
         const bool area_weight = false,
         const size_t row_skip = 0,
-        const size_t column_skip = 0
+        const size_t column_skip = 0,
+        const spherical_derivative_operators * ops = NULL
+        );
+
+bool direct_Lap_solver_applicable(
+        const dataset & source_data,
+        const std::vector<bool> & mask
         );
 
+/*!
+ * \brief Direct solver for the (unmasked) spherical Laplacian.
+ * @ingroup ToroidalProjection
+ *
+ * On a periodic, uniform longitude grid without land, the Laplacian built by
+ * toroidal_sparse_Lap is circulant in longitude. An FFT in longitude therefore
+ * decouples it into one banded system in latitude per zonal wavenumber, which
+ * are solved directly. This replaces the least-squares iterations with an
+ * O(N log N) solve.
+ *
+ * If the grid is not suitable (land, non-uniform longitude, singular systems, etc.)
+ * then usable is false after build(), and the caller should fall back onto the least-squares solver.
+ *
+ */
+class direct_Lap_solver {
+
+    public:
+        //! Constructor. The operator is only set up once build() is called.
+        direct_Lap_solver();
+
+        void build(
+                const dataset & source_data,
+                const std::vector<bool> & mask
+                );
+
+        bool solve(
+                std::vector<double> & F,
+                const std::vector<double> & RHS
+                ) const;
+
+        //! Indicates if the direct solve can be used on this grid
+        bool usable = false;
+
+    private:
+        bool factor_and_solve(
+                std::vector< std::complex<double> > & rhs,
+                std::vector< std::complex<double> > & work,
+                const int Ik
+                ) const;
+
+        int Nlat = 0, Nlon = 0, Nfreq = 0, lower_band = 0, upper_band = 0;
+
+        //! Latitude part of the operator, stored in band form (Nlat x (lower_band + upper_band + 1))
+        std::vector<double> lat_band;
+
+        //! Factor multiplying the longitude second derivative ( 1 / (R cos(lat))^2 ), zero at the poles
+        std::vector<double> lon_scale;
+
+        //! Longitude second-derivative operator for each zonal wavenumber
+        std::vector< std::complex<double> > lon_symbol;
+};
+
+bool spherical_harmonic_Lap_solver_applicable(
+        const dataset & source_data,
+        const std::vector<bool> & mask
+        );
+
+/*!
+ * \brief Spherical-harmonic solver for the (unmasked) spherical Laplacian.
+ * @ingroup ToroidalProjection
+ *
+ * On a full-sphere grid without land, the Laplacian is diagonal in spherical harmonics.
+ * Each latitude band is transformed with an FFT in longitude, and each zonal wavenumber is
+ * then fit with associated Legendre functions (which works for Gauss or regular latitudes,
+ * with or without the poles), divided by \f$ -l(l+1)/R^2 \f$, and transformed back.
+ *
+ * Unlike direct_Lap_solver, this inverts the continuous Laplacian rather than the
+ * finite-difference one. Its solution is therefore close to, but not the same as, the
+ * least-squares one, and Apply_Helmholtz_Projection uses it to seed the least-squares solver.
+ *
+ * If the grid is not suitable (land, partial sphere, etc.) then usable is false
+ * after build(), and the caller should use the usual seeds instead.
+ *
+ */
+class spherical_harmonic_Lap_solver {
+
+    public:
+        //! Constructor. The transforms are only set up once build() is called.
+        spherical_harmonic_Lap_solver();
+
+        void build(
+                const dataset & source_data,
+                const std::vector<bool> & mask
+                );
+
+        bool solve(
+                std::vector<double> & F,
+                const std::vector<double> & RHS,
+                const int Nslices = 1
+                ) const;
+
+        //! Indicates if the spherical-harmonic solve can be used on this grid
+        bool usable = false;
+
+    private:
+        int num_degrees(
+                const int Im
+                ) const;
+
+        void legendre_matrix(
+                alglib::real_2d_array & Pmat,
+                const int Im,
+                const int Ndeg
+                ) const;
+
+        bool inverse_operator(
+                alglib::real_2d_array & Kmat,
+                const int Im
+                ) const;
+
+        int Nlat = 0, Nlon = 0, Nfreq = 0, Lmax = 0, Nfit = 0;
+
+        //! Largest amount of memory (in GB) to use for caching the inverse operators
+        const double max_cache_GB = 2.;
+
+        //! Indicates if the inverse operators are cached
+        bool cached = false;
+
+        //! Inverse operator (Nlat x Nfit) for each zonal wavenumber, if cached
+        std::vector<alglib::real_2d_array> cached_ops;
+
+        //! sin / cos of latitude at each grid row
+        std::vector<double> sin_lat, cos_lat;
+
+        //! Indicates which rows are used in the Legendre fits (i.e. not the poles)
+        std::vector<bool> fit_row;
+
+        //! Square root of the (normalized) cell area in each row, used to weight the fits
+        std::vector<double> row_weight;
+};
+
 void sparse_vel_from_PsiPhi(
         alglib::sparsematrix & LHS_matr,
         const dataset & source_data,
         const int Itime,
         const int Idepth,
         const std::vector<bool> & mask,
-        const bool area_weight
+        const bool area_weight,
+        const spherical_derivative_operators * ops = NULL
         );
 
 
@@ -290,6 +522,7 @@ void sparse_vel_from_PsiPhi(
  * @param[in]       longitude,latitude      Grid vectors (1D)
  * @param[in]       Ntime,Ndepth,Nlat,Nlon  Dimension sizes
  * @param[in]       mask                    Array to distinguish land/water
+ * @param[in]       ops                     (optional) derivative operators (with second derivatives), used if they were built for this grid and mask
  *
  */
 void toroidal_Lap_F(
@@ -301,7 +534,8 @@ void toroidal_Lap_F(
         const int Ndepth,
         const int Nlat,
         const int Nlon,
-        const std::vector<bool> & mask
+        const std::vector<bool> & mask,
+        const spherical_derivative_operators * ops = NULL
         );
 
 